@@ -0,0 +1,93 @@
+#ifndef APP_CONFIG_H
+#define APP_CONFIG_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "face_quality.h"
+#include "live_config.h"
+#include "system_init.h"
+#include "tdl_handler.h"
+#include "venc_handler.h"
+
+// Read from the working directory at start-up. Without it the built-in
+// defaults apply and the model comes from the command line.
+#define APP_CONFIG_PATH "config.json"
+#define APP_CONFIG_PATH_MAX 256
+// Thread CPU masks cover CPUs 0 to APP_CONFIG_MAX_CPUS - 1
+#define APP_CONFIG_MAX_CPUS 32
+
+// Pipeline threads that can be pinned
+typedef enum {
+    APP_THREAD_VENC = 0,
+    APP_THREAD_TDL_ACQUIRE,
+    APP_THREAD_TDL_INFER,
+    APP_THREAD_TDL_POST,
+    APP_THREAD_FRAME_BROKER,
+    APP_THREAD_RECOGNIZER,
+    APP_THREAD_BUTTON,
+    APP_THREAD_STREAM_PUMP,
+    APP_THREAD_COUNT,
+} AppThread_t;
+
+typedef struct {
+    // models; argv overrides the detector models
+    char szDetectModel[APP_CONFIG_PATH_MAX];   // empty until set here or on the command line
+    char szRoiModel[APP_CONFIG_PATH_MAX];      // empty = no center ROI fast path
+    char szRecogParam[APP_CONFIG_PATH_MAX];
+    char szRecogModel[APP_CONFIG_PATH_MAX];
+
+    // video pipeline, copied into SystemConfig_t
+    SystemDetectInput_t enDetectInput;
+    SIZE_S stVencSize;
+    uint32_t u32VencBitrateKbps;
+    uint32_t u32VencGop;                       // 0 = leave the encoder's as it is
+    SystemRateControl_t enVencRc;
+    uint32_t u32RtspPort;
+    SIZE_S stDetectSize;
+    SIZE_S stRoiSize;
+    SIZE_S stRoiWindow;
+    uint32_t u32SharedBlks;
+    uint32_t u32DetectBlks;
+    uint32_t u32RoiBlks;
+    uint32_t u32TdlBlks;
+    uint32_t u32EncodeBlks;                    // OSD backend only
+
+    // GPIO
+    int s32ButtonPin;
+    int s32LedPin;
+
+    float fScoreThreshold;                     // detector thresholds, 0 = the model's own
+    float fNmsThreshold;
+    TDLDetectConfig_t stDetect;
+    FaceQualityConfig_t stQuality;
+    bool bOverlay;
+    VENCOverlayMode_t enOverlayMode;
+    VENCOverlayBackend_t enOverlayBackend;     // start-up only
+    VENCEncodePath_t enEncodePath;             // start-up only
+    EncoderRoiConfig_t stEncoderRoi;
+    uint32_t u32MaxDelayFrames;
+    uint32_t au32Cpus[APP_THREAD_COUNT];       // CPU masks, 0 = not pinned
+} AppConfig_t;
+
+void AppConfig_DefaultConfig(AppConfig_t *pstConfig);
+
+// Defaults overridden by the JSON file at path. A missing file keeps the
+// defaults; a malformed one, wrongly typed or out of range values fail with
+// every problem reported by its JSON path. Unknown keys are reported and ignored.
+CVI_S32 AppConfig_Load(AppConfig_t *pstConfig, const char *path);
+
+// Fill the fields of pstSystem that the caller sets before SystemInit_All
+void AppConfig_ToSystem(const AppConfig_t *pstConfig, SystemConfig_t *pstSystem);
+
+// The settings that may change while running, see config_watcher.h
+void AppConfig_ToLive(const AppConfig_t *pstConfig, LiveConfig_t *pstLive);
+
+// Same live settings, field by field; the generation is not compared
+bool AppConfig_LiveEqual(const LiveConfig_t *pstA, const LiveConfig_t *pstB);
+
+// Restrict thread to the CPUs of u32Cpus, a no-op for 0. Failures are
+// reported under name and otherwise ignored.
+void AppConfig_PinThread(pthread_t thread, uint32_t u32Cpus, const char *name);
+
+#endif // APP_CONFIG_H
@@ -0,0 +1,36 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <atomic>
+#include <pthread.h>
+
+#include "app_config.h"
+#include "live_config.h"
+
+// How often the watcher checks for a stop request while the file is unchanged
+#define CONFIG_WATCHER_POLL_MS 200
+
+// Reloads the configuration file whenever it is written or replaced and
+// publishes its live part (see LiveConfig_t). A file that fails to load
+// leaves the running configuration alone; changes to the other settings are
+// reported and wait for a restart.
+typedef struct {
+    char szPath[APP_CONFIG_PATH_MAX];
+    const char *pszName;             // file name within the watched directory
+    AppConfig_t stStarted;           // the configuration the pipeline was started from
+    LiveConfig_t stLive;             // last published
+    LiveConfigStore_t *pstStore;
+    int s32Fd;                       // inotify descriptor
+    std::atomic<bool> bStop;
+    pthread_t thread;
+    bool bThreadStarted;
+    uint32_t u32Reloads;
+} ConfigWatcher_t;
+
+// pstLoaded is the configuration the pipeline was started from, as read from path
+CVI_S32 ConfigWatcher_Start(ConfigWatcher_t *pstWatcher, const char *path, const AppConfig_t *pstLoaded,
+                            LiveConfigStore_t *pstStore);
+
+void ConfigWatcher_Stop(ConfigWatcher_t *pstWatcher);
+
+#endif // CONFIG_WATCHER_H
@@ -0,0 +1,75 @@
+#ifndef ENCODER_ROI_H
+#define ENCODER_ROI_H
+
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+
+extern "C" {
+#include <cvi_comm.h>
+#include "middleware_utils.h"
+}
+
+// Regions are placed on the encoder's 16x16 macroblock grid
+#define ENCODER_ROI_ALIGN 16
+#define ENCODER_ROI_REPORT_FRAMES 300
+// Defaults: faces 6 QP under the rate control (about twice the bits), the
+// rest 4 QP over it (about 0.6 times), boxes grown by a fifth on each side
+#define ENCODER_ROI_FACE_QP -6
+#define ENCODER_ROI_BACKGROUND_QP 4
+#define ENCODER_ROI_MARGIN 0.2f
+
+typedef struct {
+    bool bEnabled;
+    int32_t s32FaceQp;               // -51 to 0, relative to the rate control
+    int32_t s32BackgroundQp;         // 0 to 51, 0 = the rate control's own
+    uint32_t u32BackgroundFps;       // encode the background at this rate, 0 = every frame
+    float fMargin;                   // face box growth per side, as a fraction of its size
+} EncoderRoiConfig_t;
+
+// The face boxes of each frame become encoder regions. With a background QP,
+// region 0 covers the frame with it and the faces take the other
+// VENC_MAX_ROI_NUM - 1; the faces are merged two by two, least added area
+// first, until they fit. Only the regions that changed are sent to VENC.
+typedef struct {
+    SAMPLE_TDL_MW_CONTEXT *pstMWContext;
+    SIZE_S stSize;                   // encoded frame, the face boxes are in its pixels
+    uint32_t u32Fps;                 // the encoder's frame rate
+    EncoderRoiConfig_t stConfig;
+    bool bDirty;                     // resend every region on the next update
+    bool bRetry;                     // VENC refused a region on this update
+    bool abEnabled[VENC_MAX_ROI_NUM];   // as last sent
+    RECT_S astRect[VENC_MAX_ROI_NUM];
+    int32_t as32Qp[VENC_MAX_ROI_NUM];
+    uint32_t u32BackgroundFps;       // as last sent, 0 = every frame
+    // since the last report
+    uint32_t u32Frames;
+    uint32_t u32FaceFrames;          // frames with at least one face
+    uint32_t u32MergedFrames;        // frames with more faces than regions
+    uint64_t u64Regions;             // face regions, summed over the frames
+    uint64_t u64RegionArea;          // pixels in face regions, summed over the frames
+    uint32_t u32Calls;               // regions sent to VENC
+    uint32_t u32Errors;
+} EncoderRoi_t;
+
+void EncoderRoi_DefaultConfig(EncoderRoiConfig_t *pstConfig);
+
+// Same settings, field by field
+bool EncoderRoi_ConfigEqual(const EncoderRoiConfig_t *pstA, const EncoderRoiConfig_t *pstB);
+
+// NULL pstConfig selects the defaults; nothing is sent to VENC until the first update
+void EncoderRoi_Init(EncoderRoi_t *pstRoi, SAMPLE_TDL_MW_CONTEXT *pstMWContext, const SIZE_S *pstSize,
+                     uint32_t u32Fps, const EncoderRoiConfig_t *pstConfig);
+
+// Takes effect on the next update
+void EncoderRoi_SetConfig(EncoderRoi_t *pstRoi, const EncoderRoiConfig_t *pstConfig);
+
+// Steer the frames encoded from now on to the faces of pstFaceMeta, or
+// release every region when disabled. A region VENC refuses is reported and
+// sent again on the next update.
+void EncoderRoi_Update(EncoderRoi_t *pstRoi, const cvtdl_face_t *pstFaceMeta);
+
+// Release every region
+void EncoderRoi_Cleanup(EncoderRoi_t *pstRoi);
+
+#endif // ENCODER_ROI_H
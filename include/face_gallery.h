@@ -0,0 +1,121 @@
+#ifndef FACE_GALLERY_H
+#define FACE_GALLERY_H
+
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+
+// Gallery file opened at startup, relative to the working directory
+#define FACE_GALLERY_PATH "gallery.db"
+// Legacy enrollment: one int8 feature file per identity (the format written
+// for register_gallery_feature), named after the file. Imported into
+// FACE_GALLERY_PATH when that does not exist yet.
+#define FACE_GALLERY_DIR "gallery"
+// Size of the features the SDK's own recognizer writes for
+// register_gallery_feature. They live in another embedding space than
+// mobilefacenet's, so they are never imported: those identities have to be
+// enrolled again from a face (--extract, then --enroll).
+#define FACE_GALLERY_SDK_FEATURE_SIZE 256
+#define FACE_GALLERY_NAME_LEN 64
+// Rows are zero padded to a multiple of this, so the match kernels run
+// without a tail loop and every row starts on a cache line
+#define FACE_GALLERY_ALIGN 64
+
+#define FACE_GALLERY_MAGIC 0x4C414746   // "FGAL"
+#define FACE_GALLERY_VERSION 1
+// The header takes a page, so the feature matrix is page aligned in the file
+#define FACE_GALLERY_HEADER_SIZE 4096
+// Rows a new gallery has room for; the file doubles when it fills up
+#define FACE_GALLERY_INITIAL_CAPACITY 1024
+
+// File layout, every section at a fixed offset for the current capacity:
+//   header | feature matrix (capacity x stride) | norms (capacity) | slots (capacity)
+// Rows are only appended or reused from the free list, so enrolling and
+// deleting touch one row and the header.
+typedef struct {
+    uint32_t u32Magic;
+    uint32_t u32Version;
+    uint32_t u32Dim;
+    uint32_t u32Stride;
+    uint32_t u32Capacity;
+    uint32_t u32Count;          // rows ever used, live or free
+    uint32_t u32Live;
+    uint32_t u32FreeHead;       // first free row + 1, 0 when the free list is empty
+    uint32_t u32NextId;
+    uint32_t u32NameLen;
+    uint64_t u64FeatureOffset;
+    uint64_t u64NormOffset;
+    uint64_t u64SlotOffset;
+    uint64_t u64FileSize;
+} FaceGalleryHeader_t;
+
+// Identity of one row. A free row has u32Id 0, a zero norm and links to the
+// next free row.
+typedef struct {
+    uint32_t u32Id;
+    uint32_t u32NextFree;
+    char szName[FACE_GALLERY_NAME_LEN];
+} FaceGallerySlot_t;
+
+// A gallery mapped in memory: a file opened with FaceGallery_Open, or
+// anonymous memory with the same layout from FaceGallery_Init
+typedef struct {
+    int s32Fd;                  // -1 for an in-memory gallery
+    char szPath[256];
+    uint8_t *pu8Map;
+    size_t mapSize;
+    FaceGalleryHeader_t *pstHeader;
+    int8_t *ps8Features;        // u32Count rows of u32Stride bytes
+    float *pfNorm;              // 0 for free rows, which never match
+    FaceGallerySlot_t *pstSlots;
+    uint32_t u32Dim;
+    uint32_t u32Stride;
+    uint32_t u32Count;
+    uint32_t u32Capacity;
+} FaceGallery_t;
+
+// Empty in-memory gallery
+CVI_S32 FaceGallery_Init(FaceGallery_t *pstGallery, uint32_t u32Dim);
+
+// Map a gallery file. Nothing is read up front, so opening takes the same
+// time whatever the gallery size. With bCreate an empty gallery is created
+// when the file does not exist; an existing one must hold u32Dim features.
+CVI_S32 FaceGallery_Open(FaceGallery_t *pstGallery, const char *path, uint32_t u32Dim, bool bCreate);
+
+// Flush a file-backed gallery and unmap it
+void FaceGallery_Close(FaceGallery_t *pstGallery);
+
+// Enroll one identity in a free row, or append one. The file only grows
+// (by doubling) when every row is in use. pu32Id receives its ID if not NULL.
+CVI_S32 FaceGallery_Add(FaceGallery_t *pstGallery, const int8_t *ps8Feature, const char *name,
+                        uint32_t *pu32Id);
+
+// Delete an identity, its row goes to the free list
+CVI_S32 FaceGallery_Remove(FaceGallery_t *pstGallery, uint32_t u32Id);
+
+// Enroll every file of szDir holding exactly u32Dim bytes, in name order.
+// SDK features (FACE_GALLERY_SDK_FEATURE_SIZE bytes) are counted into
+// *pu32Sdk if not NULL and named once. Returns the number of identities
+// added, or -1 if the directory is missing.
+int FaceGallery_ImportDir(FaceGallery_t *pstGallery, const char *szDir, uint32_t *pu32Sdk);
+
+// Euclidean norm of an int8 feature, as stored per gallery row
+float FaceGallery_Norm(const int8_t *ps8Feature, uint32_t u32Dim);
+
+// Enroll, reopen, delete and re-enroll u32Identities in a scratch file and
+// print how long each step takes
+CVI_S32 FaceGallery_Benchmark(uint32_t u32Identities, uint32_t u32Dim);
+
+static inline uint32_t FaceGallery_Live(const FaceGallery_t *pstGallery) {
+    return pstGallery->pstHeader ? pstGallery->pstHeader->u32Live : 0;
+}
+
+static inline const int8_t *FaceGallery_Row(const FaceGallery_t *pstGallery, uint32_t u32Index) {
+    return pstGallery->ps8Features + (size_t)u32Index * pstGallery->u32Stride;
+}
+
+static inline const char *FaceGallery_Name(const FaceGallery_t *pstGallery, uint32_t u32Index) {
+    return pstGallery->pstSlots[u32Index].szName;
+}
+
+#endif // FACE_GALLERY_H
@@ -0,0 +1,90 @@
+#ifndef FACE_INDEX_H
+#define FACE_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "cvi_tdl.h"
+#include "face_gallery.h"
+#include "face_matcher.h"
+
+// Galleries with at least this many identities are searched through the
+// index, smaller ones by the exact linear scan
+#define FACE_INDEX_MIN_IDENTITIES 20000
+// Saved next to the gallery file, with this suffix
+#define FACE_INDEX_SUFFIX ".ivf"
+// RAM the index may use at runtime, 0 for no limit
+#define FACE_INDEX_MEM_CAP_KB 4096
+
+#define FACE_INDEX_MAGIC 0x46564946     // "FIVF"
+#define FACE_INDEX_VERSION 1
+// Codewords per PQ subquantizer, one byte per code
+#define FACE_INDEX_PQ_CODES 256
+#define FACE_INDEX_KMEANS_ITERS 10
+
+// Inverted file over the gallery rows. Coarse k-means centroids split the
+// gallery into lists; a query scores only the rows of the u32Probes lists
+// closest to it.
+//   FLAT: probed rows are scored exactly with the match kernel, reading the
+//         gallery rows themselves.
+//   PQ:   each row is also kept as u32SubQuantizers one-byte product
+//         quantizer codes; probed rows are ranked with lookup tables and only
+//         the u32Rerank best are scored exactly. RAM is the codes, not rows.
+typedef enum {
+    FACE_INDEX_FLAT = 0,
+    FACE_INDEX_PQ,
+} FaceIndexMode_t;
+
+typedef struct {
+    uint32_t u32Lists;          // coarse centroids, 0 picks sqrt(rows)
+    uint32_t u32Probes;
+    uint32_t u32SubQuantizers;  // PQ bytes per row, must divide the dimension
+    uint32_t u32Rerank;         // PQ candidates rescored exactly per query
+    uint32_t u32MemCapKB;       // switch to PQ when FLAT would need more, 0 = no cap
+} FaceIndexConfig_t;
+
+typedef struct {
+    std::vector<uint32_t> rows;
+    std::vector<uint8_t> codes;     // u32SubQuantizers per row, in list order
+} FaceIndexList_t;
+
+typedef struct {
+    FaceIndexConfig_t stConfig;
+    FaceIndexMode_t enMode;
+    uint32_t u32Dim;
+    uint32_t u32Lists;
+    std::vector<float> centroids;   // u32Lists x u32Dim, unit length
+    std::vector<float> codebooks;   // subquantizer x FACE_INDEX_PQ_CODES x subdim
+    std::vector<FaceIndexList_t> lists;
+    std::vector<uint32_t> rowList;  // list of each gallery row, UINT32_MAX if none
+    uint32_t u32Rows;
+} FaceIndex_t;
+
+void FaceIndex_DefaultConfig(FaceIndexConfig_t *pstConfig);
+
+// Train the centroids (and PQ codebooks) on the live gallery rows and index all of them
+CVI_S32 FaceIndex_Build(FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, const FaceIndexConfig_t *pstConfig);
+
+// Index a row enrolled after the build, or drop a deleted one
+CVI_S32 FaceIndex_Insert(FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, uint32_t u32Row);
+CVI_S32 FaceIndex_Remove(FaceIndex_t *pstIndex, uint32_t u32Row);
+
+// FaceMatcher_Match over the probed lists only
+CVI_S32 FaceIndex_Query(const FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery,
+                        const int8_t *const *pps8Queries, uint32_t u32Queries, uint32_t u32TopK,
+                        float fThreshold, FaceMatch_t *pstMatches, uint32_t *pu32Sizes);
+
+// Serialize next to the gallery. Load reconciles with the gallery: rows
+// enrolled or deleted since the save are inserted or dropped.
+CVI_S32 FaceIndex_Save(const FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, const char *path);
+CVI_S32 FaceIndex_Load(FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, const char *path,
+                       const FaceIndexConfig_t *pstConfig);
+
+// RAM held by the index, plus the gallery rows FLAT mode scans
+size_t FaceIndex_MemoryBytes(const FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery);
+
+// Build over a clustered random gallery of u32Identities and report
+// recall@k and queries/s against the exact linear scan
+CVI_S32 FaceIndex_Benchmark(uint32_t u32Identities, uint32_t u32Dim, uint32_t u32MemCapKB);
+
+#endif // FACE_INDEX_H
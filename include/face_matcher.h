@@ -0,0 +1,66 @@
+#ifndef FACE_MATCHER_H
+#define FACE_MATCHER_H
+
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+#include "face_gallery.h"
+
+// Match kernel, chosen at build time (MATCHER_KERNEL in CMake):
+// RVV (XuanTie C906 vector unit, RVV 0.7.1), GENERIC (compiler vector
+// extensions, any target) or SCALAR. Left unset, RVV is used when the
+// compiler targets the vector unit and GENERIC otherwise.
+#if !defined(FACE_MATCHER_KERNEL_RVV) && !defined(FACE_MATCHER_KERNEL_GENERIC) && \
+    !defined(FACE_MATCHER_KERNEL_SCALAR)
+#if defined(__riscv_vector)
+#define FACE_MATCHER_KERNEL_RVV
+#elif defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+#define FACE_MATCHER_KERNEL_GENERIC
+#else
+#define FACE_MATCHER_KERNEL_SCALAR
+#endif
+#endif
+
+// Queries scored in one pass over the gallery
+#define FACE_MATCHER_MAX_QUERIES 8
+#define FACE_MATCHER_MAX_TOPK 8
+// Widest feature the matcher pads queries for
+#define FACE_MATCHER_MAX_DIM 512
+// Gallery rows scored per block, so a block of 256-byte rows stays in the
+// C906's 32 KB L1 while every query passes over it
+#define FACE_MATCHER_BLOCK_ROWS 64
+// Similarity a face needs to take the name of its best match
+#define FACE_MATCHER_THRESHOLD 0.5f
+
+typedef struct {
+    uint32_t u32Index;        // gallery row
+    float fScore;             // cosine similarity
+} FaceMatch_t;
+
+// Score u32Queries int8 features (u32Dim of the gallery) against the whole
+// gallery in one pass. Similarity is the SDK's COS_SIMILARITY for int8:
+// the int32 inner product divided by both norms. pstMatches receives
+// up to u32TopK entries per query, best first, of which pu32Sizes[q] scored
+// at least fThreshold (0 keeps all, as in the SDK).
+CVI_S32 FaceMatcher_Match(const FaceGallery_t *pstGallery, const int8_t *const *pps8Queries,
+                          uint32_t u32Queries, uint32_t u32TopK, float fThreshold,
+                          FaceMatch_t *pstMatches, uint32_t *pu32Sizes);
+
+// Exact inner product with the compiled kernel, n a multiple of FACE_GALLERY_ALIGN
+int32_t FaceMatcher_Dot(const int8_t *ps8A, const int8_t *ps8B, uint32_t n);
+
+// Top-k selection for other search paths: offer candidates one by one into
+// pstTopK (a heap of u32TopK entries, *pu32Size kept so far), then sort them
+// best first. Finish returns how many reach fThreshold (0 keeps all).
+void FaceMatcher_Offer(FaceMatch_t *pstTopK, uint32_t *pu32Size, uint32_t u32TopK, const FaceMatch_t *pstMatch);
+uint32_t FaceMatcher_Finish(FaceMatch_t *pstTopK, uint32_t u32Size, float fThreshold);
+
+// Name of the kernel compiled in
+const char *FaceMatcher_KernelName();
+
+// Match batches of random queries against a random gallery of u32Identities,
+// check the kernel against the scalar reference and, on the board, against
+// CVI_TDL_Service_FaceInfoMatching, and print matches/s
+CVI_S32 FaceMatcher_Benchmark(uint32_t u32Identities, uint32_t u32Dim);
+
+#endif // FACE_MATCHER_H
@@ -0,0 +1,69 @@
+#ifndef FACE_QUALITY_H
+#define FACE_QUALITY_H
+
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+
+// Default thresholds. Sizes are box sides in pixels of the shared frame,
+// angles in degrees.
+#define FACE_QUALITY_MIN_SCORE 0.6f
+#define FACE_QUALITY_MIN_SIDE 48.0f
+#define FACE_QUALITY_MAX_YAW 35.0f
+#define FACE_QUALITY_MAX_PITCH 30.0f
+#define FACE_QUALITY_MAX_ROLL 45.0f
+// Variance of the Laplacian of the crop's luma, below which it is too blurred
+#define FACE_QUALITY_MIN_SHARPNESS 40.0f
+
+// Why a face was kept from recognition, in order of the checks
+typedef enum {
+    FACE_QUALITY_OK = 0,
+    FACE_QUALITY_SCORE,
+    FACE_QUALITY_SIZE,
+    FACE_QUALITY_POSE,
+    FACE_QUALITY_BLUR,
+    FACE_QUALITY_COUNT,
+} FaceQualityVerdict_t;
+
+// 0 (or a negative value) disables a check
+typedef struct {
+    float fMinScore;
+    float fMinSide;
+    float fMaxYaw;
+    float fMaxPitch;
+    float fMaxRoll;
+    float fMinSharpness;
+    bool bGateMetadata;       // also drop faces failing the score and size checks from the published results
+} FaceQualityConfig_t;
+
+typedef struct {
+    FaceQualityConfig_t stConfig;
+    uint64_t u64Faces;                          // detections assessed
+    uint64_t u64Crops;                          // crops assessed
+    uint64_t au64Rejects[FACE_QUALITY_COUNT];   // by reason, FACE_QUALITY_OK counts faces that passed
+    uint64_t u64MetadataDrops;                  // faces left out of the published results
+} FaceQuality_t;
+
+void FaceQuality_DefaultConfig(FaceQualityConfig_t *pstConfig);
+
+void FaceQuality_Init(FaceQuality_t *pstQuality, const FaceQualityConfig_t *pstConfig);
+
+// Replace the thresholds, keeping the counters
+void FaceQuality_SetConfig(FaceQuality_t *pstQuality, const FaceQualityConfig_t *pstConfig);
+
+// Score, size and pose of one detection. Fills head_pose (via the HAL),
+// pose_score and face_quality of pstInfo.
+FaceQualityVerdict_t FaceQuality_CheckFace(FaceQuality_t *pstQuality, cvtdl_face_info_t *pstInfo);
+
+// Sharpness of a square BGR crop
+FaceQualityVerdict_t FaceQuality_CheckCrop(FaceQuality_t *pstQuality, const uint8_t *pu8Bgr, uint32_t u32Side);
+
+float FaceQuality_Sharpness(const uint8_t *pu8Bgr, uint32_t u32Side);
+
+// Remove the faces failing the score or size check from pstFaceMeta, in place,
+// when bGateMetadata is set. Returns the number removed.
+uint32_t FaceQuality_FilterMetadata(FaceQuality_t *pstQuality, cvtdl_face_t *pstFaceMeta);
+
+const char *FaceQuality_VerdictName(FaceQualityVerdict_t enVerdict);
+
+#endif // FACE_QUALITY_H
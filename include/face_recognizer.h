@@ -0,0 +1,96 @@
+#ifndef FACE_RECOGNIZER_H
+#define FACE_RECOGNIZER_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+#include "shared_data.h"
+#include "track_store.h"
+
+#define FACE_RECOG_PARAM_PATH "models/mobilefacenet.param"
+#define FACE_RECOG_MODEL_PATH "models/mobilefacenet.bin"
+// Embedding size of mobilefacenet, stored as int8 (L2-normalized, x127)
+#define FACE_RECOG_FEATURE_DIM 128
+// Faces embedded in one pass
+#define FACE_RECOG_MAX_BATCH 8
+// Batches queued or running at once; the detector never waits for a free one
+#define FACE_RECOG_JOBS 2
+// The worker yields the CPU to the capture, detect and encode threads
+#define FACE_RECOG_NICE 10
+
+typedef enum {
+    FACE_RECOG_JOB_FREE = 0,
+    FACE_RECOG_JOB_QUEUED,
+    FACE_RECOG_JOB_RUNNING,
+    FACE_RECOG_JOB_DONE,
+} FaceRecogJobState_t;
+
+// A face crop handed to the recognizer, as kept by the track store
+typedef struct {
+    uint64_t u64TrackId;
+    uint64_t u64CropPTS;
+    float fQuality;             // of the crop, passed through for embedding fusion
+    uint32_t u32Pts;
+    float afPtsX[FACE_RESULT_MAX_PTS];
+    float afPtsY[FACE_RESULT_MAX_PTS];
+    uint8_t au8Crop[TRACK_STORE_CROP_SIZE * TRACK_STORE_CROP_SIZE * 3];
+} FaceRecogInput_t;
+
+// One batch. Once done, stFaces.info[i] carries unique_id and the int8
+// embedding of astInput[i] in its feature, pointing into the job itself.
+typedef struct {
+    FaceRecogJobState_t enState;
+    uint32_t u32Count;
+    FaceRecogInput_t astInput[FACE_RECOG_MAX_BATCH];
+    CVI_S32 s32Result;
+    cvtdl_face_t stFaces;
+    cvtdl_face_info_t astInfo[FACE_RECOG_MAX_BATCH];
+    int8_t as8Feature[FACE_RECOG_MAX_BATCH][FACE_RECOG_FEATURE_DIM];
+} FaceRecogJob_t;
+
+typedef struct {
+    void *pNet;
+    FaceRecogJob_t astJob[FACE_RECOG_JOBS];
+    // aligned network input of the running job, owned by the worker
+    uint8_t au8Aligned[FACE_RECOG_MAX_BATCH][TRACK_STORE_CROP_SIZE * TRACK_STORE_CROP_SIZE * 3];
+    float afFeatures[FACE_RECOG_MAX_BATCH][FACE_RECOG_FEATURE_DIM];
+    bool bStop;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool bThreadStarted;
+
+    // worker statistics
+    uint64_t u64Embeddings;
+    uint64_t u64Batches;
+    uint64_t u64BusyUs;
+    uint64_t u64Rejected;        // submissions without a free job
+} FaceRecognizer_t;
+
+// Load the network and start the worker thread
+CVI_S32 FaceRecognizer_Start(FaceRecognizer_t *pstRecog, const char *paramPath, const char *modelPath);
+
+// Stop the worker, drop pending jobs and print the throughput
+void FaceRecognizer_Stop(FaceRecognizer_t *pstRecog);
+
+// A free job to fill, or NULL while all of them are busy. Never blocks.
+FaceRecogJob_t *FaceRecognizer_GetFreeJob(FaceRecognizer_t *pstRecog);
+
+void FaceRecognizer_Submit(FaceRecognizer_t *pstRecog, FaceRecogJob_t *pstJob);
+
+// A finished job, or NULL. Hand it back with FaceRecognizer_Recycle.
+FaceRecogJob_t *FaceRecognizer_PollDone(FaceRecognizer_t *pstRecog);
+
+void FaceRecognizer_Recycle(FaceRecognizer_t *pstRecog, FaceRecogJob_t *pstJob);
+
+// Embed one aligned face, raw BGR24 of HAL_RECOGNIZER_INPUT_SIZE squared as
+// read from facePath, and write its int8 feature to featurePath in the
+// format --enroll takes
+CVI_S32 FaceRecognizer_ExtractFile(const char *paramPath, const char *modelPath, const char *facePath,
+                                   const char *featurePath);
+
+// Embed u32Faces synthetic faces in batches and print embeddings/s
+CVI_S32 FaceRecognizer_Benchmark(const char *paramPath, const char *modelPath, uint32_t u32Faces);
+
+#endif // FACE_RECOGNIZER_H
@@ -0,0 +1,74 @@
+#ifndef FACE_TRACKER_H
+#define FACE_TRACKER_H
+
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+#include "shared_data.h"
+
+#define FACE_TRACKER_MAX_TRACKS FACE_RESULT_MAX_FACES
+// Minimum overlap between a prediction and a detection to continue a track
+#define FACE_TRACKER_IOU_MATCH 0.3f
+// Detections a track may miss before it is dropped
+#define FACE_TRACKER_MAX_MISSES 2
+// Predictions never extrapolate further than this past the last detection
+#define FACE_TRACKER_MAX_PREDICT_US 500000
+// Motion assumed for a track until its second detection, in box sizes per second
+#define FACE_TRACKER_NEW_TRACK_MOTION 4.0f
+// Window detections closer than this to its edge (pixels) may be cut by it
+// and are ignored
+#define FACE_TRACKER_WINDOW_MARGIN 4.0f
+// Alpha-beta gains (a fixed-gain Kalman filter on position and velocity)
+#define FACE_TRACKER_ALPHA 0.85f
+#define FACE_TRACKER_BETA 0.35f
+
+// One face followed across detections. The state is the box center and size
+// (cx, cy, w, h) at u64PTS together with its velocity in pixels per second.
+// Landmarks are kept relative to the box so they follow its motion.
+typedef struct {
+    bool bActive;
+    uint64_t u64UniqueId;     // ID given by the detector-side tracker, 0 if none
+    uint32_t u32Misses;
+    uint32_t u32Hits;
+    uint64_t u64PTS;
+    float afState[4];
+    float afVelocity[4];
+    float fScore;
+    uint32_t u32Pts;
+    float afPtsU[FACE_RESULT_MAX_PTS];
+    float afPtsV[FACE_RESULT_MAX_PTS];
+} FaceTrack_t;
+
+typedef struct {
+    FaceTrack_t astTrack[FACE_TRACKER_MAX_TRACKS];
+    // output of FaceTracker_Predict, valid until the next call
+    cvtdl_face_t stOut;
+    cvtdl_face_info_t astOutInfo[FACE_TRACKER_MAX_TRACKS];
+    float afOutPtsX[FACE_TRACKER_MAX_TRACKS][FACE_RESULT_MAX_PTS];
+    float afOutPtsY[FACE_TRACKER_MAX_TRACKS][FACE_RESULT_MAX_PTS];
+} FaceTracker_t;
+
+void FaceTracker_Init(FaceTracker_t *pstTracker);
+
+// Correct the tracks with the detections made on the frame at u64PTS.
+// Detections carrying a unique_id continue the track with the same ID.
+void FaceTracker_Update(FaceTracker_t *pstTracker, const cvtdl_face_t *pstFaceMeta, uint64_t u64PTS);
+
+// FaceTracker_Update with detections made on the pstWindow part of the frame
+// only (center ROI). Tracks not predicted entirely inside the window are
+// corrected when a detection matches them but never miss; new faces start tracks without a unique_id until the next full
+// update identifies them.
+void FaceTracker_UpdateWindow(FaceTracker_t *pstTracker, const cvtdl_face_t *pstFaceMeta, uint64_t u64PTS,
+                              const cvtdl_bbox_t *pstWindow);
+
+// Boxes of the confirmed tracks extrapolated to u64PTS, in the geometry of the
+// last update. The result is owned by the tracker; callers may annotate it.
+cvtdl_face_t *FaceTracker_Predict(FaceTracker_t *pstTracker, uint64_t u64PTS);
+
+// Number of tracks seen by the last update
+uint32_t FaceTracker_ActiveCount(const FaceTracker_t *pstTracker);
+
+// Fastest face motion, in box sizes per second
+float FaceTracker_Motion(const FaceTracker_t *pstTracker);
+
+#endif // FACE_TRACKER_H
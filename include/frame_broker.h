@@ -0,0 +1,64 @@
+#ifndef FRAME_BROKER_H
+#define FRAME_BROKER_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+extern "C" {
+#include <cvi_comm.h>
+}
+
+// Slots tracked by the broker, must cover every VB block of the channel
+#define FRAME_BROKER_DEPTH 8
+// Newest frames kept available for consumers that have not picked them up yet
+#define FRAME_BROKER_RETAIN 2
+
+// One captured frame shared by several consumers. It goes back to VPSS when
+// the broker stops retaining it and the last consumer has released it.
+typedef struct {
+    VIDEO_FRAME_INFO_S stFrame;
+    uint64_t u64Seq;           // broker sequence number, 0 = slot unused
+    int s32Ref;                // consumers currently holding the frame
+    bool bRetained;            // still offered to new consumers
+    bool bWriteLocked;         // a consumer draws into it, no new readers
+} FrameBrokerSlot_t;
+
+typedef struct {
+    VPSS_GRP grp;
+    VPSS_CHN chn;
+    FrameBrokerSlot_t astSlot[FRAME_BROKER_DEPTH];
+    uint64_t u64Seq;
+    uint64_t u64Dropped;
+    CVI_S32 s32Error;
+    bool bStopped;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t thread;
+    bool bThreadStarted;
+} FrameBroker_t;
+
+// Start pulling frames from VPSS (grp, chn) on a dedicated thread
+CVI_S32 FrameBroker_Start(FrameBroker_t *pstBroker, VPSS_GRP grp, VPSS_CHN chn);
+
+// Join the pull thread and return every retained frame to VPSS
+void FrameBroker_Stop(FrameBroker_t *pstBroker);
+
+// Get a frame newer than *pu64Cursor: the oldest retained one, or the newest
+// when bLatest is set (skipping the rest). *pu64Cursor is advanced to it.
+CVI_S32 FrameBroker_Acquire(FrameBroker_t *pstBroker, uint64_t *pu64Cursor, bool bLatest,
+                            FrameBrokerSlot_t **ppstSlot, CVI_S32 s32MilliSec);
+
+// Get the frame captured at u64PTS while the broker or another consumer still
+// holds it, waiting for it to arrive. Fails once a newer frame is in and that
+// one is gone or being drawn on.
+CVI_S32 FrameBroker_AcquirePTS(FrameBroker_t *pstBroker, uint64_t u64PTS,
+                               FrameBrokerSlot_t **ppstSlot, CVI_S32 s32MilliSec);
+
+void FrameBroker_Release(FrameBroker_t *pstBroker, FrameBrokerSlot_t *pstSlot);
+
+// Wait until the caller is the only holder of pstSlot, then keep new readers
+// away from it so it can be drawn on
+CVI_S32 FrameBroker_LockForWrite(FrameBroker_t *pstBroker, FrameBrokerSlot_t *pstSlot,
+                                 CVI_S32 s32MilliSec);
+
+#endif // FRAME_BROKER_H
@@ -0,0 +1,207 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <wiringx.h>
+#include <linux/cvi_comm_region.h>
+#include "cvi_tdl.h"
+#include "system_init.h"
+
+// Hardware abstraction layer for the capture -> detect -> encode pipeline.
+//
+// The backend is selected at build time (HAL_BACKEND=CVI|SIM in CMake):
+//   - hal_cvi.cpp : CVITEK VI/VPSS/TDL/VENC/RTSP and wiringX
+//   - hal_sim.cpp : host simulator producing synthetic NV21 frames, scripted
+//                   detections and an encoder/stream sink that only counts bytes
+//
+// The face recognizer network has its own switch (RECOGNIZER=NCNN|SIM), so the
+// simulator can run the real network on a host with NCNN installed:
+//   - hal_recog_ncnn.cpp : mobilefacenet through NCNN
+//   - hal_recog_sim.cpp  : synthetic embeddings with an emulated inference time
+
+// Name of the compiled-in backend ("cvi" or "sim")
+const char *HAL_GetBackendName();
+
+// ---------------------------------------------------------------------------
+// System bring-up (VI/ISP/VPSS/VENC/RTSP on the board)
+// ---------------------------------------------------------------------------
+CVI_S32 HAL_System_Init(SystemConfig_t *pstConfig, SAMPLE_TDL_MW_CONTEXT *pstMWContext);
+void HAL_System_Cleanup(SAMPLE_TDL_MW_CONTEXT *pstMWContext);
+
+// ---------------------------------------------------------------------------
+// Frame source (VPSS channels)
+// ---------------------------------------------------------------------------
+CVI_S32 HAL_FrameSource_GetFrame(VPSS_GRP grp, VPSS_CHN chn, VIDEO_FRAME_INFO_S *pstFrame,
+                                 CVI_S32 s32MilliSec);
+CVI_S32 HAL_FrameSource_ReleaseFrame(VPSS_GRP grp, VPSS_CHN chn, VIDEO_FRAME_INFO_S *pstFrame);
+
+// Crop the group input to pstRect (group input pixels) before channel chn scales it
+CVI_S32 HAL_FrameSource_SetCrop(VPSS_GRP grp, VPSS_CHN chn, const RECT_S *pstRect);
+
+// Map/unmap the frame planes into user space (no-op when already mapped)
+void HAL_FrameSource_Mmap(VIDEO_FRAME_INFO_S *pstFrame);
+void HAL_FrameSource_Munmap(VIDEO_FRAME_INFO_S *pstFrame);
+
+// Dump a (mapped) frame to a file
+CVI_S32 HAL_FrameSource_DumpFrame(const char *filepath, VIDEO_FRAME_INFO_S *pstFrame);
+
+// ---------------------------------------------------------------------------
+// Face detector
+// ---------------------------------------------------------------------------
+CVI_S32 HAL_Detector_Open(cvitdl_handle_t *pTdlHandle, cvitdl_service_handle_t *pServiceHandle,
+                          const char *modelPath);
+void HAL_Detector_Close(cvitdl_handle_t tdlHandle, cvitdl_service_handle_t serviceHandle);
+
+// A second face detector on its own handle, for the center ROI channel
+// (closed with HAL_Detector_Close(tdlHandle, NULL))
+CVI_S32 HAL_Detector_OpenRoi(cvitdl_handle_t *pTdlHandle, const char *modelPath);
+
+// Let the SDK resize full frames itself, into VB pool u32PoolId
+CVI_S32 HAL_Detector_SetPreprocessPool(cvitdl_handle_t tdlHandle, CVI_U32 u32PoolId);
+
+// Program VPSS (grp, chn) with the model's input scaling and normalization for
+// pstSrcSize frames and make the SDK skip its own preprocessing. Fails when the
+// model input does not match pstChnSize, the size the channel pool was made for.
+CVI_S32 HAL_Detector_BindInputChannel(cvitdl_handle_t tdlHandle, VPSS_GRP grp, VPSS_CHN chn,
+                                      const SIZE_S *pstSrcSize, const SIZE_S *pstChnSize);
+
+// Map boxes and landmarks detected on a model-sized frame back to pstDstSize
+CVI_S32 HAL_Detector_RescaleFaceMeta(const SIZE_S *pstDstSize, cvtdl_face_t *pstFaceMeta);
+
+CVI_S32 HAL_Detector_DetectFace(cvitdl_handle_t tdlHandle, VIDEO_FRAME_INFO_S *pstFrame,
+                                cvtdl_face_t *pstFaceMeta);
+
+// Score and NMS thresholds of the detector on tdlHandle, changeable between frames
+CVI_S32 HAL_Detector_GetThresholds(cvitdl_handle_t tdlHandle, float *pfScore, float *pfNms);
+CVI_S32 HAL_Detector_SetThresholds(cvitdl_handle_t tdlHandle, float fScore, float fNms);
+
+// Free detector output
+void HAL_Detector_FreeFaceMeta(cvtdl_face_t *pstFaceMeta);
+
+// Head pose from the five landmarks, yaw/pitch/roll in radians as the SDK reports them
+CVI_S32 HAL_Detector_FaceAngle(const cvtdl_pts_t *pstPts, cvtdl_head_pose_t *pstPose);
+
+// ---------------------------------------------------------------------------
+// Face tracker (DeepSORT on the detector handle)
+// ---------------------------------------------------------------------------
+CVI_S32 HAL_Tracker_Open(cvitdl_handle_t tdlHandle);
+
+// Give every face a unique_id that stays the same while it is tracked.
+// pstTracker receives one entry per face with its track state.
+CVI_S32 HAL_Tracker_TrackFace(cvitdl_handle_t tdlHandle, cvtdl_face_t *pstFaceMeta,
+                              cvtdl_tracker_t *pstTracker);
+
+void HAL_Tracker_FreeResult(cvtdl_tracker_t *pstTracker);
+
+// ---------------------------------------------------------------------------
+// Reference matcher: the SDK's feature service (COS_SIMILARITY), kept to
+// check the gallery matcher against. The simulator has none and fails to open.
+// ---------------------------------------------------------------------------
+// Register u32Rows int8 features of u32Dim bytes, packed row after row
+CVI_S32 HAL_RefMatcher_Open(void **ppHandle, const int8_t *ps8Rows, uint32_t u32Rows, uint32_t u32Dim);
+void HAL_RefMatcher_Close(void *pHandle);
+
+// Top u32TopK rows for one u32Dim query through CVI_TDL_Service_FaceInfoMatching,
+// best first, no threshold
+CVI_S32 HAL_RefMatcher_Match(void *pHandle, const int8_t *ps8Query, uint32_t u32TopK, uint32_t *pu32Indices,
+                             float *pfScores, uint32_t *pu32Size);
+
+// ---------------------------------------------------------------------------
+// Face recognizer network (mobilefacenet, 112x112 input)
+// ---------------------------------------------------------------------------
+#define HAL_RECOGNIZER_INPUT_SIZE 112
+
+CVI_S32 HAL_Recognizer_Open(void **ppHandle, const char *paramPath, const char *modelPath);
+void HAL_Recognizer_Close(void *pHandle);
+
+// Embed u32Count aligned faces (BGR packed, HAL_RECOGNIZER_INPUT_SIZE squared)
+// in one pass; pfFeatures receives u32Dim raw floats per face
+CVI_S32 HAL_Recognizer_Extract(void *pHandle, const uint8_t *const *ppu8Faces, uint32_t u32Count,
+                               float *pfFeatures, uint32_t u32Dim);
+
+// ---------------------------------------------------------------------------
+// On-screen display: VPSS region overlays, blended by the hardware into every
+// frame the channel outputs. Handles are chosen by the caller.
+// ---------------------------------------------------------------------------
+typedef struct {
+    CVI_U8 *pu8Data;           // ARGB1555
+    CVI_U64 u64PhyAddr;        // tells the buffers of a double-buffered canvas apart
+    CVI_U32 u32Stride;
+    SIZE_S stSize;
+} HalOsdCanvas_t;
+
+// An ARGB1555 overlay of pstSize at the top left of VPSS (grp, chn), transparent
+// where the alpha bit is clear, double buffered
+CVI_S32 HAL_Osd_CreateCanvas(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, const SIZE_S *pstSize);
+
+// The canvas buffer not on display, to draw the next content into
+CVI_S32 HAL_Osd_GetCanvas(RGN_HANDLE handle, HalOsdCanvas_t *pstCanvas);
+
+// Display the buffer drawn since HAL_Osd_GetCanvas from the next frame on
+CVI_S32 HAL_Osd_UpdateCanvas(RGN_HANDLE handle);
+
+// A solid rectangle of u32Rgb (0xRRGGBB) on VPSS (grp, chn)
+CVI_S32 HAL_Osd_CreateCover(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, const RECT_S *pstRect, CVI_U32 u32Rgb);
+
+CVI_S32 HAL_Osd_Show(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, bool bShow);
+
+// Detach and destroy a canvas or cover
+void HAL_Osd_Destroy(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn);
+
+// ---------------------------------------------------------------------------
+// Video encoder
+// ---------------------------------------------------------------------------
+// Queue a frame for encoding, waiting up to s32MilliSec for room (0 = not at
+// all, -1 = forever); fails with CVI_ERR_VENC_BUF_FULL while the encoded
+// frames are not fetched
+CVI_S32 HAL_Encoder_SendFrame(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VIDEO_FRAME_INFO_S *pstFrame,
+                              CVI_S32 s32MilliSec);
+
+// File descriptor of the channel, readable (poll/epoll) while an encoded frame waits
+CVI_S32 HAL_Encoder_GetFd(SAMPLE_TDL_MW_CONTEXT *pstMWContext);
+
+// Number of packets of the oldest encoded frame not fetched yet (0 if none)
+CVI_S32 HAL_Encoder_QueryPacks(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 *pu32PackCount);
+
+// Fetch the oldest encoded frame, waiting up to s32MilliSec (0 = not at all,
+// -1 = forever). pstStream->pstPack must hold room for the count returned by
+// HAL_Encoder_QueryPacks; CVI_ERR_VENC_BUF_EMPTY when there is none
+CVI_S32 HAL_Encoder_GetStream(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream,
+                              CVI_S32 s32MilliSec);
+CVI_S32 HAL_Encoder_ReleaseStream(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream);
+
+// Have VENC take the frames of VPSS (grp, chn) itself in the SYS layer, so
+// no frame passes through user space and HAL_Encoder_SendFrame is not used.
+// The packets are still fetched with HAL_Encoder_GetStream.
+CVI_S32 HAL_Encoder_Bind(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VPSS_GRP grp, VPSS_CHN chn);
+void HAL_Encoder_Unbind(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VPSS_GRP grp, VPSS_CHN chn);
+
+// Region u32Index (0 to VENC_MAX_ROI_NUM - 1) of the encoder, with s32Qp
+// relative to the QP of the rate control. Where regions overlap the higher
+// index applies. Takes effect from the next frame encoded.
+CVI_S32 HAL_Encoder_SetRoi(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32Index, bool bEnable,
+                           const RECT_S *pstRect, CVI_S32 s32Qp);
+
+// While a region is enabled, encode what lies outside the regions in
+// u32DstFps of every u32SrcFps frames only; equal rates encode it in every frame
+CVI_S32 HAL_Encoder_SetRoiBgFrameRate(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32SrcFps, CVI_U32 u32DstFps);
+
+// Change the bitrate of the running channel, and its GOP unless u32Gop is 0.
+// Takes effect from the next frame without restarting the channel.
+CVI_S32 HAL_Encoder_SetRate(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32BitrateKbps, CVI_U32 u32Gop);
+
+// ---------------------------------------------------------------------------
+// Stream sink (RTSP on the board)
+// ---------------------------------------------------------------------------
+CVI_S32 HAL_StreamSink_Write(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream);
+
+// ---------------------------------------------------------------------------
+// GPIO (button / LED)
+// ---------------------------------------------------------------------------
+int HAL_Gpio_Setup();
+void HAL_Gpio_Release();
+int HAL_Gpio_PinMode(int pin, enum pinmode_t mode);
+int HAL_Gpio_ValidGPIO(int pin);
+int HAL_Gpio_DigitalRead(int pin);
+int HAL_Gpio_DigitalWrite(int pin, enum digital_value_t value);
+
+#endif // HAL_H
@@ -0,0 +1,65 @@
+#ifndef LIVE_CONFIG_H
+#define LIVE_CONFIG_H
+
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+#include "encoder_roi.h"
+#include "face_quality.h"
+#include "tdl_handler.h"
+#include "venc_handler.h"
+
+// Settings that can change while the pipeline runs. A published snapshot is
+// never modified; a change publishes a new one.
+typedef struct {
+    uint32_t u32Generation;          // set by LiveConfig_Publish, 1 for the first snapshot
+    float fScoreThreshold;           // detector thresholds, 0 = the model's own
+    float fNmsThreshold;
+    TDLDetectConfig_t stDetect;
+    FaceQualityConfig_t stQuality;
+    uint32_t u32VencBitrateKbps;
+    uint32_t u32VencGop;             // 0 = leave it as it is
+    EncoderRoiConfig_t stEncoderRoi;
+    bool bOverlay;                   // draw the face boxes, crosshair and FPS on the stream
+    VENCOverlayMode_t enOverlayMode;
+    uint32_t u32MaxDelayFrames;
+} LiveConfig_t;
+
+// Threads reading snapshots, one slot each
+typedef enum {
+    LIVE_READER_TDL_ACQUIRE = 0,
+    LIVE_READER_TDL_INFER,
+    LIVE_READER_TDL_POST,
+    LIVE_READER_VENC,
+    LIVE_READER_COUNT,
+} LiveConfigReader_t;
+
+// Read-copy-update with quiescent states. Readers load the current snapshot
+// without locking and keep using it until their next LiveConfig_Read or
+// LiveConfig_Offline. A replaced snapshot is freed once every reader has
+// passed one of those, so the writer never waits for the readers.
+typedef struct LiveConfigStore {
+    std::atomic<const LiveConfig_t *> pstCurrent;
+    std::atomic<uint64_t> u64Epoch;                      // bumped by every publish
+    std::atomic<uint64_t> au64Seen[LIVE_READER_COUNT];   // epoch at each reader's last read, 0 = offline
+    pthread_mutex_t mutex;                               // serializes writers
+    std::vector<std::pair<const LiveConfig_t *, uint64_t> > retired;   // with the epoch that replaced them
+} LiveConfigStore_t;
+
+void LiveConfig_Init(LiveConfigStore_t *pstStore, const LiveConfig_t *pstInitial);
+
+// All readers must be offline
+void LiveConfig_Destroy(LiveConfigStore_t *pstStore);
+
+// The current snapshot, valid until this reader's next Read or Offline
+const LiveConfig_t *LiveConfig_Read(LiveConfigStore_t *pstStore, LiveConfigReader_t enReader);
+
+// The reader holds no snapshot (e.g. on thread exit)
+void LiveConfig_Offline(LiveConfigStore_t *pstStore, LiveConfigReader_t enReader);
+
+// Copy pstNext into a new snapshot and make it current
+void LiveConfig_Publish(LiveConfigStore_t *pstStore, const LiveConfig_t *pstNext);
+
+#endif // LIVE_CONFIG_H
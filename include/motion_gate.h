@@ -0,0 +1,81 @@
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+
+extern "C" {
+#include <cvi_comm.h>
+}
+
+// The detector input is reduced to a grid of block means, each compared with
+// a running background. A region of blocks with enough changed ones is active.
+#define MOTION_GATE_COLS 64
+#define MOTION_GATE_ROWS 36
+// Pixels sampled per block, on a square lattice of this side
+#define MOTION_GATE_BLOCK_SAMPLES 3
+// Region side in blocks, giving a 16x9 motion mask
+#define MOTION_GATE_REGION_BLOCKS 4
+#define MOTION_GATE_REGION_COLS (MOTION_GATE_COLS / MOTION_GATE_REGION_BLOCKS)
+#define MOTION_GATE_REGION_ROWS (MOTION_GATE_ROWS / MOTION_GATE_REGION_BLOCKS)
+// The background follows the frame by 1/2^N per update
+#define MOTION_GATE_BG_SHIFT 4
+// Default thresholds.
+// Change of a block mean (8-bit levels) that counts as motion
+#define MOTION_GATE_THRESHOLD 12
+// Changed blocks that make a region active
+#define MOTION_GATE_MIN_BLOCKS 2
+// Detection keeps its normal schedule this long after the last motion...
+#define MOTION_GATE_HOLD_US 1000000
+// ...then only runs at this interval until motion returns
+#define MOTION_GATE_HEARTBEAT_US 2000000
+
+typedef struct {
+    uint32_t u32Threshold;
+    uint32_t u32MinBlocks;           // 1 to MOTION_GATE_REGION_BLOCKS^2
+    uint64_t u64HoldUs;
+    uint64_t u64HeartbeatUs;
+} MotionGateConfig_t;
+
+// Regions with motion on one update, small enough to travel with a frame
+typedef struct {
+    bool abRegion[MOTION_GATE_REGION_ROWS * MOTION_GATE_REGION_COLS];   // row-major
+    uint32_t u32Active;              // regions set in abRegion
+    cvtdl_bbox_t stActive;           // bounding box of the active regions, as fractions of the frame
+} MotionMask_t;
+
+typedef struct {
+    MotionGateConfig_t stConfig;
+    bool bInit;
+    uint16_t au16Background[MOTION_GATE_ROWS * MOTION_GATE_COLS];   // block means, 4 fractional bits
+    MotionMask_t stMask;             // of the last update
+    uint64_t u64LastMotionPTS;
+    uint64_t u64Frames;              // updates since start
+    uint64_t u64MotionFrames;        // updates with motion
+} MotionGate_t;
+
+void MotionGate_DefaultConfig(MotionGateConfig_t *pstConfig);
+
+// NULL pstConfig selects the defaults
+void MotionGate_Init(MotionGate_t *pstGate, const MotionGateConfig_t *pstConfig);
+
+// Replace the thresholds, keeping the background and the counters
+void MotionGate_SetConfig(MotionGate_t *pstGate, const MotionGateConfig_t *pstConfig);
+
+// Compare pstFrame (NV21 luma, or the green plane of planar BGR) with the
+// background, refresh the mask and fold the frame into the background.
+// Returns the number of active regions.
+uint32_t MotionGate_Update(MotionGate_t *pstGate, VIDEO_FRAME_INFO_S *pstFrame);
+
+// True once no motion was seen for u64HoldUs before u64PTS
+bool MotionGate_Idle(const MotionGate_t *pstGate, uint64_t u64PTS);
+
+// True when pstBox, in pixels of a pstFrame sized frame, touches an active region
+bool MotionGate_Overlaps(const MotionMask_t *pstMask, const cvtdl_bbox_t *pstBox, const SIZE_S *pstFrame);
+
+// True when every active region lies inside pstWindow, given in pixels of a
+// pstFrame sized frame
+bool MotionGate_Within(const MotionMask_t *pstMask, const RECT_S *pstWindow, const SIZE_S *pstFrame);
+
+#endif // MOTION_GATE_H
@@ -0,0 +1,48 @@
+#ifndef OSD_H
+#define OSD_H
+
+#include <stdint.h>
+
+#include "hal.h"
+#include "overlay.h"
+
+extern "C" {
+#include <cvi_comm.h>
+}
+
+// Region handles, unique system wide
+#define OSD_RGN_CANVAS 0
+#define OSD_RGN_CROSS_H 1
+#define OSD_RGN_CROSS_V 2
+
+// Overlays drawn by VPSS instead of the CPU: a full-frame ARGB1555 canvas
+// holding the face boxes and text, and two cover regions for the crosshair,
+// all on the encoder's own channel. The canvas is only redrawn when its
+// content changes; the frames themselves are never touched.
+typedef struct {
+    VPSS_GRP grp;
+    VPSS_CHN chn;
+    SIZE_S stSize;
+    bool bCanvas;
+    bool abCover[2];
+    bool bShow;
+    OverlayBatch_t stShown;        // content of the canvas on display
+    OverlayBatch_t astDrawn[2];    // content of each canvas buffer, to erase it
+    uint64_t au64Buffer[2];        // physical address of each buffer, 0 = not seen yet
+    uint32_t u32Updates;
+    uint32_t u32Unchanged;
+} Osd_t;
+
+// Create the regions on VPSS (grp, chn) for pstSize frames, with a crosshair of
+// u32Cross pixels each way and u32Thickness wide at the frame center
+CVI_S32 Osd_Init(Osd_t *pstOsd, VPSS_GRP grp, VPSS_CHN chn, const SIZE_S *pstSize, uint32_t u32Cross,
+                 uint32_t u32Thickness, const cvtdl_service_brush_t &brush);
+
+CVI_S32 Osd_Show(Osd_t *pstOsd, bool bShow);
+
+// Put the shapes and texts of pstBatch on the canvas, unless it already shows them
+CVI_S32 Osd_Update(Osd_t *pstOsd, const OverlayBatch_t *pstBatch);
+
+void Osd_Cleanup(Osd_t *pstOsd);
+
+#endif // OSD_H
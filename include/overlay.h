@@ -0,0 +1,97 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+
+extern "C" {
+#include <cvi_comm.h>
+}
+
+// Shapes one frame can carry; more are counted and dropped
+#define OVERLAY_MAX_SHAPES 128
+// Lines of text one frame can carry: the FPS line and per-face labels
+#define OVERLAY_MAX_TEXTS 16
+#define OVERLAY_TEXT_MAX 32
+// Built-in font cell, before scaling
+#define OVERLAY_FONT_WIDTH 5
+#define OVERLAY_FONT_HEIGHT 7
+
+typedef struct {
+    uint16_t u16Argb1555;      // for region canvases, alpha set
+    uint8_t u8Y;
+    uint8_t u8U;
+    uint8_t u8V;
+} OverlayColor_t;
+
+typedef enum {
+    OVERLAY_SHAPE_FILL = 0,    // solid rectangle
+    OVERLAY_SHAPE_BOX,         // rectangle outline
+} OverlayShapeType_t;
+
+// Frame pixels, on even coordinates so luma and chroma cover the same area
+typedef struct {
+    int16_t s16X0;
+    int16_t s16Y0;
+    int16_t s16X1;             // exclusive
+    int16_t s16Y1;
+    uint8_t u8Type;            // OverlayShapeType_t
+    uint8_t u8Thickness;       // BOX only, even
+    OverlayColor_t stColor;
+} OverlayShape_t;
+
+// A line of text, top left at (s16X, s16Y), OVERLAY_FONT_WIDTH + 1 pixels per
+// character times u8Scale
+typedef struct {
+    int16_t s16X;
+    int16_t s16Y;
+    uint8_t u8Scale;
+    OverlayColor_t stColor;
+    char szText[OVERLAY_TEXT_MAX];
+} OverlayText_t;
+
+// Everything drawn on one frame, collected first and rendered in one pass
+// over a single mapping of the frame. Fixed size, nothing is allocated.
+typedef struct {
+    OverlayShape_t astShape[OVERLAY_MAX_SHAPES];
+    uint32_t u32Count;
+    uint32_t u32Dropped;
+    OverlayText_t astText[OVERLAY_MAX_TEXTS];  // drawn after the shapes, see overlay_text.h
+    uint32_t u32TextCount;
+} OverlayBatch_t;
+
+// BT.601 limited range, as the encoder expects
+OverlayColor_t Overlay_Color(const cvtdl_service_brush_t &brush);
+
+void Overlay_Begin(OverlayBatch_t *pstBatch);
+
+// Outline of pstBox, u32Thickness pixels inside it
+void Overlay_AddBox(OverlayBatch_t *pstBatch, const cvtdl_bbox_t *pstBox, OverlayColor_t stColor,
+                    uint32_t u32Thickness);
+
+void Overlay_AddFill(OverlayBatch_t *pstBatch, int x0, int y0, int x1, int y1, OverlayColor_t stColor);
+
+// Two strokes of u32Thickness crossing at (x, y), u32Size pixels from it each way
+void Overlay_AddCrosshair(OverlayBatch_t *pstBatch, int x, int y, uint32_t u32Size, OverlayColor_t stColor,
+                          uint32_t u32Thickness);
+
+// Text of up to OVERLAY_TEXT_MAX - 1 characters, longer text is cut
+void Overlay_AddText(OverlayBatch_t *pstBatch, int x, int y, const char *pszText, OverlayColor_t stColor,
+                     uint32_t u32Scale);
+
+// Same shapes and texts, in the same order
+bool Overlay_Equal(const OverlayBatch_t *pstA, const OverlayBatch_t *pstB);
+
+// Draw the shapes, then the texts, of the batch on an NV21 or NV12 frame, mapping it once
+CVI_S32 Overlay_Render(const OverlayBatch_t *pstBatch, VIDEO_FRAME_INFO_S *pstFrame);
+
+// Draw the shapes and texts on an ARGB1555 canvas of pstSize pixels, or with
+// bErase make the pixels they cover transparent again
+void Overlay_RenderCanvas(const OverlayBatch_t *pstBatch, uint8_t *pu8Canvas, uint32_t u32Stride,
+                          const SIZE_S *pstSize, bool bErase);
+
+// Render u32Faces boxes and the crosshair on a 1080p NV21 frame, report the time per frame
+CVI_S32 Overlay_Benchmark(uint32_t u32Faces);
+
+#endif // OVERLAY_H
@@ -0,0 +1,47 @@
+#ifndef OVERLAY_TEXT_H
+#define OVERLAY_TEXT_H
+
+#include <stdint.h>
+
+#include "overlay.h"
+
+// Blit kernel, chosen at build time like the matcher's (MATCHER_KERNEL in
+// CMake): RVV (C906 vector unit), GENERIC (compiler vector extensions) or
+// SCALAR. Left unset, RVV is used when the compiler targets the vector unit
+// and GENERIC otherwise.
+#if !defined(OVERLAY_TEXT_KERNEL_RVV) && !defined(OVERLAY_TEXT_KERNEL_GENERIC) && \
+    !defined(OVERLAY_TEXT_KERNEL_SCALAR)
+#if defined(__riscv_vector)
+#define OVERLAY_TEXT_KERNEL_RVV
+#elif defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+#define OVERLAY_TEXT_KERNEL_GENERIC
+#else
+#define OVERLAY_TEXT_KERNEL_SCALAR
+#endif
+#endif
+
+// Rendered strings kept for reuse, two frames worth of OVERLAY_MAX_TEXTS; the
+// least recently drawn one is replaced
+#define OVERLAY_TEXT_CACHE_ENTRIES 32
+
+// 5x7 rows of c, leftmost pixel in bit 4. Lower case is drawn as upper case,
+// characters without a glyph as '?'.
+const uint8_t *OverlayText_Glyph(char c);
+
+// Blend pstText onto the planes of an NV21 (bVU) or NV12 frame of s32Width x
+// s32Height pixels. The string is rendered from the glyph atlas into a
+// luma and a chroma mask once, then only blitted until it changes.
+void OverlayText_Draw(const OverlayText_t *pstText, uint8_t *pu8Y, uint32_t u32StrideY, uint8_t *pu8C,
+                      uint32_t u32StrideC, int s32Width, int s32Height, bool bVU);
+
+// Same mask, on an ARGB1555 canvas
+void OverlayText_DrawCanvas(const OverlayText_t *pstText, uint8_t *pu8Canvas, uint32_t u32Stride,
+                            const SIZE_S *pstSize);
+
+const char *OverlayText_KernelName();
+
+// Draw u32Labels labels of up to 16 characters on a 1080p NV21 frame, from the
+// cache, with a render per draw, and per pixel; report glyphs per ms
+CVI_S32 OverlayText_Benchmark(uint32_t u32Labels);
+
+#endif // OVERLAY_TEXT_H
@@ -2,25 +2,86 @@
 #define SHARED_DATA_H
 
 #include <atomic>
-#include <pthread.h>
+#include <stdint.h>
 
 #include "cvi_tdl.h"
 
+// Capacity of one published face result; extra faces are dropped
+#define FACE_RESULT_MAX_FACES 32
+#define FACE_RESULT_MAX_PTS 5
 
-extern std::atomic<bool> g_bExit;
+// A preallocated face result. stMeta.info and the landmark pointers always
+// point into the slot itself, so readers can use stMeta like any cvtdl_face_t
+// without copying or freeing it. Features are not carried across.
+typedef struct {
+    cvtdl_face_t stMeta;
+    cvtdl_face_info_t astInfo[FACE_RESULT_MAX_FACES];
+    float afPtsX[FACE_RESULT_MAX_FACES][FACE_RESULT_MAX_PTS];
+    float afPtsY[FACE_RESULT_MAX_FACES][FACE_RESULT_MAX_PTS];
+    uint64_t u64PublishSeq;
+    uint64_t u64FramePTS;    // u64PTS of the frame the faces were detected on
+    uint32_t u32FrameSeq;    // u32TimeRef of that frame
+} FaceResultSlot_t;
+
+// Wait-free triple buffer between one writer and one reader. The writer fills
+// its back slot and swaps it with the middle one; the reader swaps its front
+// slot with the middle one only when something new was published.
+// Add one exchange per consumer to fan results out.
+typedef struct {
+    FaceResultSlot_t astSlot[3];
+    std::atomic<uint32_t> u32Middle;
+    uint32_t u32Back;
+    uint32_t u32Front;
+    uint64_t u64PublishSeq;
+    uint32_t u32Truncated;
+} FaceResultExchange_t;
+
+void FaceResult_Init(FaceResultExchange_t *pstExchange);
+
+// Writer side: copy pstFaceMeta into the back slot and publish it
+void FaceResult_Publish(FaceResultExchange_t *pstExchange, const cvtdl_face_t *pstFaceMeta,
+                        const VIDEO_FRAME_S *pstSrcFrame);
+
+// Reader side: latest published result, valid until the next acquire by the same reader
+FaceResultSlot_t *FaceResult_Acquire(FaceResultExchange_t *pstExchange);
+
+// Number of recent results kept for timestamp matching
+#define FACE_RESULT_HISTORY 8
 
-extern cvtdl_face_t g_stFaceMeta;
+// Ring of the most recent results, one writer and any number of readers.
+// Each entry is guarded by a seqlock (odd while being written), readers copy
+// the entry they want out and retry if the writer lapped them.
+typedef struct {
+    std::atomic<uint32_t> u32Lock;
+    FaceResultSlot_t stSlot;
+} FaceResultHistoryEntry_t;
 
-extern pthread_mutex_t g_ResultMutex;
+typedef struct {
+    FaceResultHistoryEntry_t astEntry[FACE_RESULT_HISTORY];
+    std::atomic<uint64_t> u64Count;
+    std::atomic<uint64_t> u64LatestPTS;
+} FaceResultHistory_t;
 
-extern float g_fCurrentFPS;
-extern pthread_mutex_t g_FPSMutex;
+void FaceResultHistory_Init(FaceResultHistory_t *pstHistory);
+
+void FaceResultHistory_Push(FaceResultHistory_t *pstHistory, const cvtdl_face_t *pstFaceMeta,
+                            const VIDEO_FRAME_S *pstSrcFrame);
+
+// PTS of the newest pushed result, 0 before the first push
+uint64_t FaceResultHistory_LatestPTS(FaceResultHistory_t *pstHistory);
+
+// Copy the result whose frame PTS is closest to u64PTS into pstOut.
+// Returns false when the history is empty.
+bool FaceResultHistory_FindNearest(FaceResultHistory_t *pstHistory, uint64_t u64PTS,
+                                   FaceResultSlot_t *pstOut);
+
+
+extern std::atomic<bool> g_bExit;
 
-#define LOCK_RESULT_MUTEX() pthread_mutex_lock(&g_ResultMutex)
-#define UNLOCK_RESULT_MUTEX() pthread_mutex_unlock(&g_ResultMutex)
+extern FaceResultExchange_t g_stFaceResults;
+extern FaceResultHistory_t g_stFaceHistory;
 
-#define LOCK_FPS_MUTEX() pthread_mutex_lock(&g_FPSMutex)
-#define UNLOCK_FPS_MUTEX() pthread_mutex_unlock(&g_FPSMutex)
+extern std::atomic<float> g_fCurrentFPS;
 
 void SharedData_Init();
 void SharedData_Cleanup();
@@ -0,0 +1,76 @@
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+extern "C" {
+#include <cvi_comm.h>
+}
+
+#define STARTUP_MAX_STEPS 16
+// Bytes read per call while prefetching a file
+#define STARTUP_PREFETCH_CHUNK (256 * 1024)
+
+typedef CVI_S32 (*StartupStepFn_t)(void *pArgs);
+
+typedef enum {
+    STARTUP_STEP_PENDING = 0,
+    STARTUP_STEP_RUNNING,
+    STARTUP_STEP_DONE,
+    STARTUP_STEP_FAILED,
+    STARTUP_STEP_SKIPPED       // a step it depends on did not complete
+} StartupStepState_t;
+
+typedef struct {
+    const char *pszName;
+    StartupStepFn_t pfnRun;
+    void *pArgs;
+    uint32_t u32After;         // mask of the steps that must be done first
+    bool bOptional;            // a failure does not fail the start-up
+    StartupStepState_t enState;
+    CVI_S32 s32Result;
+    uint64_t u64StartUs;       // since Startup_Init
+    uint64_t u64EndUs;
+} StartupStep_t;
+
+// Start-up steps with their dependencies. Startup_Run runs every step on its
+// own thread as soon as the steps it depends on are done, so independent
+// steps overlap.
+typedef struct {
+    StartupStep_t astStep[STARTUP_MAX_STEPS];
+    uint32_t u32Count;
+    uint64_t u64OriginUs;      // CLOCK_MONOTONIC at Startup_Init
+    uint64_t u64BootUs;        // CLOCK_BOOTTIME at Startup_Init, time since power-on
+    uint64_t u64EndUs;         // all steps finished, since Startup_Init
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} Startup_t;
+
+void Startup_Init(Startup_t *pstStartup);
+
+// Add a step running after the steps of u32After (masks from earlier
+// Startup_AddStep calls). Returns the step's own mask, 0 if full.
+uint32_t Startup_AddStep(Startup_t *pstStartup, const char *pszName, StartupStepFn_t pfnRun, void *pArgs,
+                         uint32_t u32After, bool bOptional);
+
+// Run all steps and wait for them. Fails if a required step failed or was
+// skipped; the steps done are left for the caller to undo.
+CVI_S32 Startup_Run(Startup_t *pstStartup);
+
+// The steps of u32Steps all completed
+bool Startup_Done(const Startup_t *pstStartup, uint32_t u32Steps);
+
+// Per-step timing: start, duration and outcome, and the time saved by overlapping
+void Startup_Report(const Startup_t *pstStartup);
+
+void Startup_Destroy(Startup_t *pstStartup);
+
+// Read the files of the NULL-terminated ppszPaths into the page cache, so a
+// later load is served from memory. Missing or empty paths are ignored.
+CVI_S32 Startup_PrefetchFiles(const char *const *ppszPaths);
+
+// Milliseconds since power-on (CLOCK_BOOTTIME)
+uint64_t Startup_SinceBootMs();
+
+#endif // STARTUP_H
@@ -0,0 +1,69 @@
+#ifndef STREAM_PUMP_H
+#define STREAM_PUMP_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+extern "C" {
+#include <cvi_comm.h>
+#include "middleware_utils.h"
+}
+
+#define STREAM_PUMP_MAX_SINKS 4
+// Packets per encoded frame, SPS/PPS/SEI and the slices
+#define STREAM_PUMP_MAX_PACKS 8
+// Encoded frames fetched in one wake-up before they are handed out
+#define STREAM_PUMP_POOL_FRAMES 4
+// Pause after a wake-up that found no frame
+#define STREAM_PUMP_SPURIOUS_BACKOFF_US 1000
+
+// Called on the pump thread for every encoded frame, in encoding order. The
+// packets stay valid until the call returns.
+typedef CVI_S32 (*StreamPumpWrite_t)(void *pCtx, VENC_STREAM_S *pstStream);
+
+typedef struct {
+    const char *pszName;
+    StreamPumpWrite_t pfnWrite;
+    void *pCtx;
+    uint64_t u64Errors;
+} StreamPumpSink_t;
+
+// Fetches the encoded frames on its own thread as soon as the encoder's fd
+// turns readable, so HAL_Encoder_SendFrame never waits for a frame to be
+// retrieved. Packet descriptors live in a pool allocated with the pump.
+typedef struct {
+    SAMPLE_TDL_MW_CONTEXT *pstMWContext;
+    StreamPumpSink_t astSink[STREAM_PUMP_MAX_SINKS];
+    uint32_t u32Sinks;
+    VENC_PACK_S aastPack[STREAM_PUMP_POOL_FRAMES][STREAM_PUMP_MAX_PACKS];
+    VENC_STREAM_S astStream[STREAM_PUMP_POOL_FRAMES];
+    int s32EpollFd;
+    int s32WakeFd;                 // eventfd, stops the thread
+    uint64_t u64Frames;
+    uint64_t u64Packets;
+    uint64_t u64Bytes;
+    uint32_t u32MaxDrained;        // most frames fetched in one wake-up
+    uint64_t u64Spurious;          // wake-ups that found no frame
+    CVI_S32 s32Error;              // the thread stopped on it, and set g_bExit
+    bool bStopped;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;           // a frame was handed out, or the thread stopped
+    pthread_t thread;
+    bool bThreadStarted;
+} StreamPump_t;
+
+void StreamPump_Init(StreamPump_t *pstPump, SAMPLE_TDL_MW_CONTEXT *pstMWContext);
+
+// Sinks are called in the order they were added; add them before the start
+CVI_S32 StreamPump_AddSink(StreamPump_t *pstPump, const char *pszName, StreamPumpWrite_t pfnWrite, void *pCtx);
+
+CVI_S32 StreamPump_Start(StreamPump_t *pstPump);
+
+// Wake and join the pump thread, frames still in the encoder are left there
+void StreamPump_Stop(StreamPump_t *pstPump);
+
+// Wait for a frame after the *pu64Seen first ones to be handed out, and set
+// *pu64Seen to the frames handed out so far
+CVI_S32 StreamPump_WaitFrame(StreamPump_t *pstPump, uint64_t *pu64Seen, CVI_S32 s32MilliSec);
+
+#endif // STREAM_PUMP_H
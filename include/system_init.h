@@ -7,12 +7,99 @@ extern "C" {
 #include "middleware_utils.h"
 }
 
+// VPSS Grp0 channel read by the frame broker
+#define SYSTEM_VPSS_CHN VPSS_CHN0
+// VB pool handed to the TDL SDK for its preprocessing output
+#define SYSTEM_TDL_VBPOOL 1
+#define SYSTEM_TDL_VBPOOL_BLKS 3
+// Blocks of the shared frame pool, at most FRAME_BROKER_DEPTH
+#define SYSTEM_SHARED_VBPOOL_BLKS 5
+
+// Encoded stream defaults
+#define SYSTEM_VENC_WIDTH 1920
+#define SYSTEM_VENC_HEIGHT 1080
+#define SYSTEM_VENC_BITRATE_KBPS 8000
+#define SYSTEM_VENC_FPS 30
+#define SYSTEM_RTSP_PORT 554
+
+// VPSS Grp0 channel producing detector input in SYSTEM_DETECT_MODEL_CHN mode
+#define SYSTEM_DETECT_VPSS_CHN VPSS_CHN1
+// TDL_PIPELINE_DEPTH frames held by the detector, plus the one VPSS writes
+#define SYSTEM_DETECT_VBPOOL_BLKS 4
+// Input geometry of scrfd_det_face_432_768_INT8_cv181x.cvimodel
+#define SYSTEM_DETECT_WIDTH 768
+#define SYSTEM_DETECT_HEIGHT 432
+
+// VPSS Grp0 channel cropping the window around the crosshair for the center
+// ROI detector (SYSTEM_DETECT_MODEL_CHN mode only)
+#define SYSTEM_ROI_VPSS_CHN VPSS_CHN2
+#define SYSTEM_ROI_VBPOOL 2
+#define SYSTEM_ROI_VBPOOL_BLKS 3
+// Input geometry of the ROI detector model (a 320x320 SCRFD export)
+#define SYSTEM_ROI_WIDTH 320
+#define SYSTEM_ROI_HEIGHT 320
+// Window cropped around the crosshair, in shared frame pixels
+#define SYSTEM_ROI_WINDOW_WIDTH 480
+#define SYSTEM_ROI_WINDOW_HEIGHT 480
+
+// Extra VPSS Grp0 channel feeding only the encoder, so region overlays
+// (HAL_Osd_*) never reach the frames the detector and recognizer read. It
+// takes the first channel after the ones above.
+#define SYSTEM_ENCODE_VBPOOL_BLKS 3
+// Channels of VPSS device 1, which Grp0 runs on in dual mode (sc_v1..sc_v3)
+#define SYSTEM_VPSS_MAX_CHNS 3
+
+typedef enum {
+    SYSTEM_DETECT_SHARED,     // detect on the shared 1080p frame, the SDK resizes it through SYSTEM_TDL_VBPOOL
+    SYSTEM_DETECT_MODEL_CHN   // detect on SYSTEM_DETECT_VPSS_CHN, scaled and normalized by VPSS
+} SystemDetectInput_t;
+
+typedef enum {
+    SYSTEM_RC_CBR,            // always spends u32VencBitrateKbps
+    SYSTEM_RC_VBR             // u32VencBitrateKbps is the ceiling, QP offsets lower the rate
+} SystemRateControl_t;
+
+// Everything but stSensorSize and stMWConfig is set by the caller before SystemInit_All
 typedef struct {
     SIZE_S stSensorSize;
-    SIZE_S stVencSize;
+    SIZE_S stVencSize;                   // shared frame and encoded stream
+    uint32_t u32VencBitrateKbps;
+    SystemRateControl_t enVencRc;
+    uint32_t u32RtspPort;
+    SystemDetectInput_t enDetectInput;
+    SIZE_S stDetectSize;                 // model input size, SYSTEM_DETECT_MODEL_CHN only
+    bool bCenterRoi;                     // also produce SYSTEM_ROI_VPSS_CHN, SYSTEM_DETECT_MODEL_CHN only
+    SIZE_S stRoiSize;                    // ROI model input size
+    SIZE_S stRoiWindow;                  // window around the crosshair, in shared frame pixels
+    bool bEncodeChn;                     // also produce an encoder-only channel, cleared if none is left
+    VPSS_CHN encodeChn;                  // set by SystemInit_All when bEncodeChn
+    uint32_t u32SharedBlks;              // VB blocks per pool, see the SYSTEM_*_BLKS defaults
+    uint32_t u32DetectBlks;
+    uint32_t u32RoiBlks;
+    uint32_t u32TdlBlks;
+    uint32_t u32EncodeBlks;
     SAMPLE_TDL_MW_CONFIG_S stMWConfig;
 } SystemConfig_t;
 
+// The ROI window centered in a pstFrame sized frame, on even coordinates
+static inline RECT_S SystemInit_CenterWindow(const SIZE_S *pstFrame, const SIZE_S *pstWindow) {
+    RECT_S stRect;
+    stRect.u32Width = (pstWindow->u32Width < pstFrame->u32Width ? pstWindow->u32Width : pstFrame->u32Width) & ~1u;
+    stRect.u32Height = (pstWindow->u32Height < pstFrame->u32Height ? pstWindow->u32Height : pstFrame->u32Height) & ~1u;
+    stRect.s32X = (CVI_S32)((pstFrame->u32Width - stRect.u32Width) / 2) & ~1;
+    stRect.s32Y = (CVI_S32)((pstFrame->u32Height - stRect.u32Height) / 2) & ~1;
+    return stRect;
+}
+
+// The channel after the detect and ROI channels in use, -1 when the group has none left
+static inline VPSS_CHN SystemInit_EncodeChn(const SystemConfig_t *pstConfig) {
+    int s32Used = 1;
+    if (pstConfig->enDetectInput == SYSTEM_DETECT_MODEL_CHN) {
+        s32Used = pstConfig->bCenterRoi ? 3 : 2;
+    }
+    return s32Used < SYSTEM_VPSS_MAX_CHNS ? (VPSS_CHN)s32Used : (VPSS_CHN)-1;
+}
+
 CVI_S32 SystemInit_GetSensorConfig(SystemConfig_t *pstConfig);
 CVI_S32 SystemInit_SetupVBPool(SystemConfig_t *pstConfig);
 CVI_S32 SystemInit_SetupVPSS(SystemConfig_t *pstConfig);
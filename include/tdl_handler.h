@@ -3,16 +3,69 @@
 
 #include "button_handler.h"
 #include "cvi_tdl.h"
+#include "face_gallery.h"
+#include "face_index.h"
+#include "face_quality.h"
+#include "face_recognizer.h"
+#include "frame_broker.h"
+#include "hal.h"
+#include "motion_gate.h"
+#include "overlay.h"
 
 extern "C" {
 #include <cvi_comm.h>
 }
 
+struct LiveConfigStore;
+
+// Detection runs on one of every N input frames, the tracker fills in the rest.
+// N follows the measured inference time and face motion, up to this bound
+// (also used while no face is in view).
+#define TDL_DETECT_INTERVAL_MAX 8
+// Drift, in box sizes, the tracker may accumulate between two detections
+#define TDL_TRACK_MAX_DRIFT 0.25f
+// With a center ROI detector the whole frame is still detected on at least
+// one of every N frames, the window around the crosshair on the others
+#define TDL_ROI_FULL_INTERVAL 4
+// Bound for the configurable intervals above
+#define TDL_INTERVAL_LIMIT 64
+// How long the detector waits for the shared frame it needs a face crop from
+#define TDL_CROP_WAIT_MS 100
+
+// Detection cadence, defaults from the TDL_ and MOTION_GATE_ defines
+typedef struct {
+    uint32_t u32IntervalMax;
+    float fTrackMaxDrift;
+    uint32_t u32RoiFullInterval;
+    MotionGateConfig_t stMotion;
+} TDLDetectConfig_t;
+
 typedef struct {
     cvitdl_handle_t tdlHandle;
     cvitdl_service_handle_t serviceHandle;
     const char *modelPath;
     ButtonHandler_t *buttonHandler;
+    FrameBroker_t *pstFrameBroker;
+    FaceRecognizer_t *pstRecognizer;  // optional, embeds the best crop of each track
+    const FaceGallery_t *pstGallery;  // optional, names the embedded tracks
+    const FaceIndex_t *pstIndex;      // optional, searched instead of scanning pstGallery
+    FaceQuality_t stQuality;          // gate ahead of cropping, recognition and the published results
+    bool bDetectChn;          // detect on a model-sized VPSS channel instead of the shared frame
+    VPSS_CHN detectChn;
+    SIZE_S stFrameSize;       // size of the shared frame, detections are rescaled to it
+    uint64_t u64CenterTrackId; // track highlighted at the crosshair, kept while it stays near
+    cvitdl_handle_t roiHandle; // optional center ROI detector, reads SYSTEM_ROI_VPSS_CHN
+    RECT_S stRoiRect;          // window it sees, in shared frame pixels
+    uint64_t u64RoiDetects;
+    float fRoiInferMs;         // running mean of the ROI inference time
+    TDLDetectConfig_t stDetect;
+    MotionGate_t stMotion;     // idles detection on still scenes, fed the detector input
+    uint64_t u64IdleSkips;     // detections skipped while the scene was still
+    uint64_t u64StillFaces;    // new faces dropped for lying in still regions
+    uint32_t au32Cpus[3];      // CPU masks of the acquisition, inference and post threads, 0 = not pinned
+    struct LiveConfigStore *pstLive; // optional, thresholds, cadence and quality changed while running
+    float fModelScore;         // the detector's own thresholds, used for a live value of 0
+    float fModelNms;
 } TDLHandler_t;
 
 CVI_S32 TDLHandler_Init(TDLHandler_t *pstHandler, const char *modelPath);
@@ -24,31 +77,55 @@ CVI_S32 TDLHandler_DetectFace(TDLHandler_t *pstHandler,
                               VIDEO_FRAME_INFO_S *pstFrame, 
                               cvtdl_face_t *pstFaceMeta);
 
-CVI_S32 TDLHandler_DrawFaceRect(TDLHandler_t *pstHandler,
-                                cvtdl_face_t *pstFaceMeta,
-                                VIDEO_FRAME_INFO_S *pstFrame);
+// Queue a box per face on pstBatch, red for the face at the crosshair, blue
+// for the others
+CVI_S32 TDLHandler_AddFaceRects(TDLHandler_t *pstHandler,
+                                const cvtdl_face_t *pstFaceMeta,
+                                const VIDEO_FRAME_INFO_S *pstFrame,
+                                OverlayBatch_t *pstBatch);
 
 void *TDLHandler_ThreadRoutine(void *pHandle);
 
 void TDLHandler_SetButtonHandler(TDLHandler_t *pstHandler, ButtonHandler_t *buttonHandler);
 
+void TDLHandler_SetFrameBroker(TDLHandler_t *pstHandler, FrameBroker_t *pstFrameBroker);
+
+void TDLHandler_SetRecognizer(TDLHandler_t *pstHandler, FaceRecognizer_t *pstRecognizer);
+
+void TDLHandler_SetGallery(TDLHandler_t *pstHandler, const FaceGallery_t *pstGallery);
+
+void TDLHandler_SetIndex(TDLHandler_t *pstHandler, const FaceIndex_t *pstIndex);
+
+// Replace the default quality gate thresholds, before the thread starts
+void TDLHandler_SetQualityConfig(TDLHandler_t *pstHandler, const FaceQualityConfig_t *pstConfig);
+
+void TDLHandler_DefaultDetectConfig(TDLDetectConfig_t *pstConfig);
+
+// Replace the default detection cadence, before the thread starts
+void TDLHandler_SetDetectConfig(TDLHandler_t *pstHandler, const TDLDetectConfig_t *pstConfig);
+
+// Pin the pipeline threads, before the thread starts
+void TDLHandler_SetThreadCpus(TDLHandler_t *pstHandler, uint32_t u32AcquireCpus, uint32_t u32InferCpus,
+                              uint32_t u32PostCpus);
+
+// Follow the detector thresholds, cadence and quality gate of pstLive, before the thread starts
+void TDLHandler_SetLiveConfig(TDLHandler_t *pstHandler, struct LiveConfigStore *pstLive);
+
+// Select the detector input according to pstConfig->enDetectInput
+CVI_S32 TDLHandler_ConfigureInput(TDLHandler_t *pstHandler, const SystemConfig_t *pstConfig);
+
+// Open the center ROI detector (an SCRFD export at pstConfig->stRoiSize) and
+// crop SYSTEM_ROI_VPSS_CHN to the window around the crosshair. Needs
+// pstConfig->bCenterRoi.
+CVI_S32 TDLHandler_ConfigureRoi(TDLHandler_t *pstHandler, const SystemConfig_t *pstConfig, const char *modelPath);
+
 CVI_S32 TDLHandler_CapturePhoto(VIDEO_FRAME_INFO_S *pstFrame, const char *filepath);
 
 static inline void CVI_Mmap(VIDEO_FRAME_INFO_S *pstFrame, bool unmap = false){
-    size_t image_size = pstFrame->stVFrame.u32Length[0] + pstFrame->stVFrame.u32Length[1] +
-                    pstFrame->stVFrame.u32Length[2];
     if (!unmap) {
-        pstFrame->stVFrame.pu8VirAddr[0] =
-            (uint8_t *)CVI_SYS_Mmap(pstFrame->stVFrame.u64PhyAddr[0], image_size);
-        pstFrame->stVFrame.pu8VirAddr[1] =
-            pstFrame->stVFrame.pu8VirAddr[0] + pstFrame->stVFrame.u32Length[0];
-        pstFrame->stVFrame.pu8VirAddr[2] =
-            pstFrame->stVFrame.pu8VirAddr[1] + pstFrame->stVFrame.u32Length[1];
+        HAL_FrameSource_Mmap(pstFrame);
     } else {
-        CVI_SYS_Munmap(pstFrame->stVFrame.pu8VirAddr[0], image_size);
-        pstFrame->stVFrame.pu8VirAddr[0] = NULL;
-        pstFrame->stVFrame.pu8VirAddr[1] = NULL;
-        pstFrame->stVFrame.pu8VirAddr[2] = NULL;
+        HAL_FrameSource_Munmap(pstFrame);
     }
 }
 
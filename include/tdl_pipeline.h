@@ -0,0 +1,93 @@
+#ifndef TDL_PIPELINE_H
+#define TDL_PIPELINE_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+#include "frame_broker.h"
+#include "motion_gate.h"
+
+extern "C" {
+#include <cvi_comm.h>
+}
+
+// Detector input frames held by the pipeline: one being acquired and up to
+// two in flight behind it, in inference or post-processing
+#define TDL_PIPELINE_DEPTH 3
+
+// A job moves through the stages in this order and is freed by the last one
+typedef enum {
+    TDL_JOB_FREE = 0,
+    TDL_JOB_ACQUIRED,
+    TDL_JOB_INFERRED,
+} TDLJobState_t;
+
+// One detector input frame and everything the stages hand each other about it.
+// The stage holding a job owns all of it.
+typedef struct {
+    uint64_t u64AcquireUs;           // when the frame entered the pipeline
+
+    // acquisition
+    FrameBrokerSlot_t *pstSlot;      // NULL when the frame comes from the model-sized channel
+    FrameBrokerSlot_t *pstCropSlot;  // shared frame of the same PTS, held for the crops of a detection
+    VIDEO_FRAME_INFO_S stFrame;
+    uint64_t u64PTS;
+    bool bDetect;                    // full-frame detection scheduled
+    bool bIdle;                      // the motion gate idled the scene
+    MotionMask_t stMotion;
+    uint64_t u64MotionFrames;        // motion gate counters after this frame
+    uint64_t u64GateFrames;
+
+    // inference
+    CVI_S32 s32Result;
+    cvtdl_face_t stFaceMeta;         // full-frame or ROI detections, in shared frame pixels
+    cvtdl_tracker_t stTrackerMeta;   // DeepSORT result of a full-frame detection
+    uint32_t u32Detected;            // faces the detector returned, freed with stFaceMeta
+    uint32_t u32StillFaces;          // of those, new faces dropped in still regions
+    float fInferMs;
+    bool bRoi;                       // stFaceMeta holds window detections
+    uint64_t u64RoiPTS;
+    uint64_t u64RoiDetects;          // window detector counters after this frame
+    float fRoiInferMs;
+} TDLJob_t;
+
+typedef struct {
+    TDLJob_t astJob[TDL_PIPELINE_DEPTH];
+    TDLJobState_t aenState[TDL_PIPELINE_DEPTH];   // under mutex
+    bool bClosed;                    // no more frames will be acquired
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    // statistics, each written by one stage only
+    uint64_t u64Frames;              // frames acquired
+    uint64_t u64Detects;             // full-frame detections
+    uint64_t u64InferUs;             // time the detectors were busy
+    uint64_t u64StallUs;             // acquisition waiting for a free job
+    uint64_t u64LatencyUs;           // acquisition to release, summed over the frames
+    uint64_t u64CropMisses;          // post: detections whose shared frame was gone for the crops
+    uint64_t u64StartUs;
+    uint64_t u64EndUs;
+} TDLPipeline_t;
+
+void TDLPipeline_Init(TDLPipeline_t *pstPipe);
+
+void TDLPipeline_Destroy(TDLPipeline_t *pstPipe);
+
+// Wait for the job at *pu32Cursor to reach enState and advance the cursor.
+// Each stage walks the ring with its own cursor, so frames pass every stage
+// in acquisition order. NULL once the pipeline is closed and drained for
+// this stage.
+TDLJob_t *TDLPipeline_Wait(TDLPipeline_t *pstPipe, uint32_t *pu32Cursor, TDLJobState_t enState);
+
+// Hand pstJob to the next stage
+void TDLPipeline_Advance(TDLPipeline_t *pstPipe, TDLJob_t *pstJob, TDLJobState_t enNext);
+
+// Called by acquisition after its last job; the other stages finish the jobs
+// in flight and then get NULL
+void TDLPipeline_Close(TDLPipeline_t *pstPipe);
+
+// Print frames/s, detections/s, detector utilization, stalls, latency and crop misses
+void TDLPipeline_PrintStats(const TDLPipeline_t *pstPipe);
+
+#endif // TDL_PIPELINE_H
@@ -0,0 +1,129 @@
+#ifndef TRACK_STORE_H
+#define TRACK_STORE_H
+
+#include <stdint.h>
+
+#include "cvi_tdl.h"
+#include "face_quality.h"
+#include "shared_data.h"
+
+extern "C" {
+#include <cvi_comm.h>
+}
+
+#define TRACK_STORE_MAX FACE_RESULT_MAX_FACES
+// Side of the square face crop kept per track (the recognition input size)
+#define TRACK_STORE_CROP_SIZE 112
+// Area around the box included in the crop, relative to the longer box side
+#define TRACK_STORE_CROP_SCALE 1.25f
+// A new crop (and embedding) is only taken when the quality beats the kept
+// one by this much, the box side changed by this factor since the crop, or
+// the crop is older than the TTL
+#define TRACK_STORE_QUALITY_MARGIN 0.05f
+#define TRACK_STORE_SCALE_CHANGE 1.5f
+#define TRACK_STORE_FEATURE_TTL_US 2000000
+// Largest face embedding cached per track
+#define TRACK_STORE_FEATURE_DIM 128
+// Tracks not seen for this long are forgotten
+#define TRACK_STORE_EXPIRE_US 3000000
+
+// Why a track's crop was (re)taken
+typedef enum {
+    TRACK_REFRESH_NEW = 0,
+    TRACK_REFRESH_QUALITY,
+    TRACK_REFRESH_SCALE,
+    TRACK_REFRESH_TTL,
+    TRACK_REFRESH_COUNT,
+} TrackRefresh_t;
+
+// Everything known about one tracked face, keyed by the tracker's unique_id.
+// Geometry is in the coordinates of the shared (encoded) frame.
+typedef struct {
+    uint64_t u64Id;                  // 0 = entry unused
+    cvtdl_trk_state_type_t enState;
+    cvtdl_bbox_t stBox;              // last detected box
+    uint64_t u64FirstPTS;
+    uint64_t u64LastPTS;
+    uint32_t u32Hits;                // detections matched to the track
+    FaceQualityVerdict_t enQuality;  // gate verdict of the last detection
+
+    // best-quality crop, BGR packed, TRACK_STORE_CROP_SIZE squared
+    float fBestQuality;
+    bool bCropPending;               // the last detection wants a new crop
+    TrackRefresh_t enCropReason;
+    bool bHasCrop;
+    uint64_t u64CropPTS;
+    float fCropSide;                 // box side when the crop was taken
+    uint32_t u32CropPts;
+    float afCropPtsX[FACE_RESULT_MAX_PTS];   // landmarks in crop pixels
+    float afCropPtsY[FACE_RESULT_MAX_PTS];
+    uint8_t au8Crop[TRACK_STORE_CROP_SIZE * TRACK_STORE_CROP_SIZE * 3];
+
+    // embedding of the crop taken at u64FeaturePTS, int8 L2-normalized
+    bool bHasFeature;
+    uint64_t u64FeaturePTS;
+    uint64_t u64FeatureRequestPTS;   // crop currently being embedded, 0 if none
+    uint32_t u32FeatureDim;
+    int8_t as8Feature[TRACK_STORE_FEATURE_DIM];
+    // quality-weighted mean of every embedding of the track, matched
+    // against the gallery instead of the last one alone
+    float afFusedSum[TRACK_STORE_FEATURE_DIM];
+    uint32_t u32Fused;
+    int8_t as8Fused[TRACK_STORE_FEATURE_DIM];
+
+    // attributes computed once per track by later stages
+    bool bAttrValid;
+    char szName[128];
+    float fRecogScore;
+} TrackState_t;
+
+typedef struct {
+    TrackState_t astEntry[TRACK_STORE_MAX];
+    uint32_t u32Crops;               // crops taken since start
+    uint32_t au32Refresh[TRACK_REFRESH_COUNT];  // crops taken, by reason
+    uint32_t u32Requests;            // embeddings requested since start
+    uint32_t u32Features;            // embeddings received since start
+    uint64_t u64Tracks;              // tracks seen since start
+    // embedding cache: a lookup per tracked face per frame, a hit when the
+    // track already has an embedding
+    uint64_t u64Lookups;
+    uint64_t u64Hits;
+    uint8_t au8Scratch[TRACK_STORE_CROP_SIZE * TRACK_STORE_CROP_SIZE * 3];  // crop being checked
+} TrackStore_t;
+
+void TrackStore_Init(TrackStore_t *pstStore);
+
+// Record the faces detected at u64PTS, once the tracker assigned their
+// unique_id (faces without one are ignored) and forget expired tracks.
+// penVerdict (NULL if none) holds the quality gate verdict of each face;
+// faces that failed it never want a crop. Returns the number of tracks that
+// want a new crop.
+uint32_t TrackStore_Update(TrackStore_t *pstStore, const cvtdl_face_t *pstFaceMeta,
+                           const cvtdl_tracker_t *pstTracker, uint64_t u64PTS,
+                           const FaceQualityVerdict_t *penVerdict);
+
+// Take the pending crops from pstFrame, the shared frame the faces of the
+// last update were detected on (NV21 or planar BGR). With pstQuality, a
+// crop too blurred to embed is dropped and the track keeps its previous one.
+void TrackStore_TakeCrops(TrackStore_t *pstStore, const cvtdl_face_t *pstFaceMeta,
+                          VIDEO_FRAME_INFO_S *pstFrame, FaceQuality_t *pstQuality);
+
+// NULL when the track is unknown or expired
+TrackState_t *TrackStore_Find(TrackStore_t *pstStore, uint64_t u64Id);
+
+// TrackStore_Find for a face shown on a frame, counted as an embedding cache lookup
+TrackState_t *TrackStore_Lookup(TrackStore_t *pstStore, uint64_t u64Id);
+
+// Store the embedding of the crop taken at u64CropPTS with quality
+// fQuality, and fold it into the fused embedding
+void TrackStore_AddFeature(TrackStore_t *pstStore, TrackState_t *pstEntry, const int8_t *ps8Feature,
+                           uint32_t u32Dim, uint64_t u64CropPTS, float fQuality);
+
+// Embedding cache hit rate in [0, 1], and inferences saved compared with
+// embedding every tracked face on every frame
+float TrackStore_HitRate(const TrackStore_t *pstStore);
+uint64_t TrackStore_Saved(const TrackStore_t *pstStore);
+
+uint32_t TrackStore_Count(const TrackStore_t *pstStore);
+
+#endif // TRACK_STORE_H
@@ -2,6 +2,10 @@
 #define VENC_HANDLER_H
 
 #include "cvi_tdl.h"
+#include "encoder_roi.h"
+#include "osd.h"
+#include "stream_pump.h"
+#include "system_init.h"
 #include "tdl_handler.h"
 
 extern "C" {
@@ -10,14 +14,59 @@ extern "C" {
 #include "middleware_utils.h"
 }
 
+// Upper bound for frames held back while waiting for their detection result
+#define VENC_MAX_DELAY_FRAMES 3
+#define VENC_SKEW_REPORT_FRAMES 300
+#define VENC_PATH_REPORT_FRAMES 300
+// How long the encoder waits for the detector to finish reading a frame before
+// drawing on it, one frame period; after that the frame is sent without overlay
+#define VENC_WRITE_LOCK_MS (1000 / SYSTEM_VENC_FPS)
+// How long a frame may wait for room in the encoder's input queue, 0 = drop it at once
+#define VENC_SEND_TIMEOUT_MS 0
+
+typedef enum {
+    VENC_OVERLAY_LATEST,   // draw the newest result, no added latency
+    VENC_OVERLAY_ALIGNED   // draw the result detected on the same (or nearest) frame by PTS
+} VENCOverlayMode_t;
+
+typedef enum {
+    VENC_OVERLAY_CPU,      // drawn into the shared frames before encoding
+    VENC_OVERLAY_OSD       // VPSS region overlays on an encoder-only channel, see osd.h
+} VENCOverlayBackend_t;
+
+typedef enum {
+    VENC_PATH_COPY,        // this thread takes each frame from VPSS and sends it to VENC
+    VENC_PATH_BIND         // VPSS feeds VENC in the SYS layer, needs VENC_OVERLAY_OSD
+} VENCEncodePath_t;
+
+struct LiveConfigStore;
+
 typedef struct {
     SAMPLE_TDL_MW_CONTEXT *pstMWContext;
     TDLHandler_t *pstTDLHandler;
+    FrameBroker_t *pstFrameBroker;
+    VENCOverlayMode_t enOverlayMode;
+    uint32_t u32MaxDelayFrames;    // aligned mode: frames the encoder may wait for a result
+    uint32_t u32BitrateKbps;       // the channel was set up with
+    SIZE_S stVencSize;             // of the encoded frames
+    EncoderRoiConfig_t stEncoderRoi; // at start, pstLive changes it
+    struct LiveConfigStore *pstLive; // optional, overlay and rate changed while running
+    Osd_t *pstOsd;                 // NULL = CPU overlays on the broker's frames
+    VPSS_CHN encodeChn;            // with pstOsd, the channel the regions are attached to
+    bool bBind;                    // with pstOsd, bind encodeChn to VENC instead of sending its frames
+    StreamPump_t *pstPump;         // fetches and sends the encoded frames
 } VENCHandler_t;
 
 void *VENCHandler_ThreadRoutine(void *pArgs);
 
+// Queue pstFrame for encoding, the stream pump sends its packets. A full
+// encoder drops the frame instead of waiting.
 CVI_S32 VENCHandler_SendFrameRTSP(VIDEO_FRAME_INFO_S *pstFrame, 
                                   SAMPLE_TDL_MW_CONTEXT *pstMWContext);
 
+// Stream pump sinks: RTSP (pCtx is the SAMPLE_TDL_MW_CONTEXT), and the encode
+// path and bitrate report (pCtx unused), which must come after the RTSP sink
+CVI_S32 VENCHandler_RtspSink(void *pCtx, VENC_STREAM_S *pstStream);
+CVI_S32 VENCHandler_MetricsSink(void *pCtx, VENC_STREAM_S *pstStream);
+
 #endif // VENC_HANDLER_H
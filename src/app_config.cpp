@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include "json/json.hpp"
+#include "app_config.h"
+#include "face_recognizer.h"
+#include "frame_broker.h"
+#include "motion_gate.h"
+#include "tdl_pipeline.h"
+
+using nlohmann::json;
+
+static const char *const kDetectInputNames[] = {"shared", "model_channel"};
+static const char *const kOverlayModeNames[] = {"latest", "aligned"};
+static const char *const kOverlayBackendNames[] = {"cpu", "osd"};
+static const char *const kEncodePathNames[] = {"copy", "bind"};
+static const char *const kRateControlNames[] = {"cbr", "vbr"};
+static const char *const kThreadNames[APP_THREAD_COUNT] = {
+    "venc", "tdl_acquire", "tdl_infer", "tdl_post", "frame_broker", "recognizer", "button", "stream_pump",
+};
+
+void AppConfig_DefaultConfig(AppConfig_t *pstConfig) {
+    std::memset(pstConfig, 0, sizeof(AppConfig_t));
+    std::strncpy(pstConfig->szRecogParam, FACE_RECOG_PARAM_PATH, APP_CONFIG_PATH_MAX - 1);
+    std::strncpy(pstConfig->szRecogModel, FACE_RECOG_MODEL_PATH, APP_CONFIG_PATH_MAX - 1);
+    pstConfig->enDetectInput = SYSTEM_DETECT_MODEL_CHN;
+    pstConfig->stVencSize.u32Width = SYSTEM_VENC_WIDTH;
+    pstConfig->stVencSize.u32Height = SYSTEM_VENC_HEIGHT;
+    pstConfig->u32VencBitrateKbps = SYSTEM_VENC_BITRATE_KBPS;
+    pstConfig->enVencRc = SYSTEM_RC_CBR;
+    pstConfig->u32RtspPort = SYSTEM_RTSP_PORT;
+    pstConfig->stDetectSize.u32Width = SYSTEM_DETECT_WIDTH;
+    pstConfig->stDetectSize.u32Height = SYSTEM_DETECT_HEIGHT;
+    pstConfig->stRoiSize.u32Width = SYSTEM_ROI_WIDTH;
+    pstConfig->stRoiSize.u32Height = SYSTEM_ROI_HEIGHT;
+    pstConfig->stRoiWindow.u32Width = SYSTEM_ROI_WINDOW_WIDTH;
+    pstConfig->stRoiWindow.u32Height = SYSTEM_ROI_WINDOW_HEIGHT;
+    pstConfig->u32SharedBlks = SYSTEM_SHARED_VBPOOL_BLKS;
+    pstConfig->u32DetectBlks = SYSTEM_DETECT_VBPOOL_BLKS;
+    pstConfig->u32RoiBlks = SYSTEM_ROI_VBPOOL_BLKS;
+    pstConfig->u32TdlBlks = SYSTEM_TDL_VBPOOL_BLKS;
+    pstConfig->u32EncodeBlks = SYSTEM_ENCODE_VBPOOL_BLKS;
+    pstConfig->s32ButtonPin = 21;
+    pstConfig->s32LedPin = 25;
+    TDLHandler_DefaultDetectConfig(&pstConfig->stDetect);
+    FaceQuality_DefaultConfig(&pstConfig->stQuality);
+    pstConfig->bOverlay = true;
+    pstConfig->enOverlayMode = VENC_OVERLAY_ALIGNED;
+    pstConfig->enOverlayBackend = VENC_OVERLAY_CPU;
+    pstConfig->enEncodePath = VENC_PATH_COPY;
+    EncoderRoi_DefaultConfig(&pstConfig->stEncoderRoi);
+    pstConfig->u32MaxDelayFrames = 2;
+}
+
+// Shared frames held at once: the encoder keeps up to max_delay_frames + 1
+// waiting for their results (the broker retains as many), a detector reading
+// the shared frames holds one per pipeline stage, and VPSS writes one more.
+// The crop frames of a model-sized input are among the ones the encoder holds.
+static uint32_t AppConfig_MinSharedBlks(const AppConfig_t *pstConfig) {
+    uint32_t u32Blks = std::max<uint32_t>(pstConfig->u32MaxDelayFrames + 1, FRAME_BROKER_RETAIN) + 1;
+    if (pstConfig->enDetectInput == SYSTEM_DETECT_SHARED) {
+        u32Blks += TDL_PIPELINE_DEPTH;
+    }
+    return u32Blks;
+}
+
+// Problems are counted and reported as "<file>: <json path> <message>", so
+// one run lists all of them
+typedef struct {
+    const char *path;
+    uint32_t u32Errors;
+} AppConfigParse_t;
+
+static void AppConfig_Error(AppConfigParse_t *pstParse, const std::string &key, const std::string &message) {
+    std::cerr << pstParse->path << ": " << key << " " << message << std::endl;
+    pstParse->u32Errors++;
+}
+
+static std::string AppConfig_Key(const std::string &section, const char *key) {
+    return section.empty() ? std::string(key) : section + "." + key;
+}
+
+static void AppConfig_CheckKeys(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                                const char *const *known, size_t count) {
+    for (json::const_iterator it = object.begin(); it != object.end(); ++it) {
+        bool bKnown = false;
+        for (size_t i = 0; i < count && !bKnown; i++) {
+            bKnown = it.key() == known[i];
+        }
+        if (!bKnown) {
+            std::cerr << pstParse->path << ": unknown key " << AppConfig_Key(section, it.key().c_str())
+                      << " ignored" << std::endl;
+        }
+    }
+}
+
+// parent[key] when present and an object, NULL otherwise
+static const json *AppConfig_Section(AppConfigParse_t *pstParse, const json &parent, const std::string &section,
+                                     const char *key, const char *const *known, size_t count) {
+    json::const_iterator it = parent.find(key);
+    if (it == parent.end()) {
+        return NULL;
+    }
+    const std::string name = AppConfig_Key(section, key);
+    if (!it->is_object()) {
+        AppConfig_Error(pstParse, name, "must be an object, got " + it->dump());
+        return NULL;
+    }
+    AppConfig_CheckKeys(pstParse, *it, name, known, count);
+    return &*it;
+}
+
+// The readers below leave *pValue alone when key is absent or invalid
+
+static void AppConfig_ReadU32(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                              const char *key, uint32_t u32Min, uint32_t u32Max, uint32_t *pu32Value) {
+    json::const_iterator it = object.find(key);
+    if (it == object.end()) {
+        return;
+    }
+    if (it->is_number_unsigned() && it->get<uint64_t>() >= u32Min && it->get<uint64_t>() <= u32Max) {
+        *pu32Value = (uint32_t)it->get<uint64_t>();
+        return;
+    }
+    AppConfig_Error(pstParse, AppConfig_Key(section, key),
+                    "must be an integer from " + std::to_string(u32Min) + " to " + std::to_string(u32Max) +
+                        ", got " + it->dump());
+}
+
+static void AppConfig_ReadEven(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                               const char *key, uint32_t u32Min, uint32_t u32Max, uint32_t *pu32Value) {
+    uint32_t u32Value = *pu32Value;
+    AppConfig_ReadU32(pstParse, object, section, key, u32Min, u32Max, &u32Value);
+    if (u32Value & 1) {
+        // VPSS and the VB pools work on even sizes
+        AppConfig_Error(pstParse, AppConfig_Key(section, key), "must be even, got " + std::to_string(u32Value));
+        return;
+    }
+    *pu32Value = u32Value;
+}
+
+static void AppConfig_ReadS32(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                              const char *key, int s32Min, int s32Max, int *ps32Value) {
+    json::const_iterator it = object.find(key);
+    if (it == object.end()) {
+        return;
+    }
+    if (it->is_number_integer() && it->get<int64_t>() >= s32Min && it->get<int64_t>() <= s32Max) {
+        *ps32Value = (int)it->get<int64_t>();
+        return;
+    }
+    AppConfig_Error(pstParse, AppConfig_Key(section, key),
+                    "must be an integer from " + std::to_string(s32Min) + " to " + std::to_string(s32Max) +
+                        ", got " + it->dump());
+}
+
+static void AppConfig_ReadFloat(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                                const char *key, float fMin, float fMax, float *pfValue) {
+    json::const_iterator it = object.find(key);
+    if (it == object.end()) {
+        return;
+    }
+    if (it->is_number() && it->get<double>() >= fMin && it->get<double>() <= fMax) {
+        *pfValue = (float)it->get<double>();
+        return;
+    }
+    std::ostringstream message;
+    message << "must be a number from " << fMin << " to " << fMax << ", got " << it->dump();
+    AppConfig_Error(pstParse, AppConfig_Key(section, key), message.str());
+}
+
+static void AppConfig_ReadBool(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                               const char *key, bool *pbValue) {
+    json::const_iterator it = object.find(key);
+    if (it == object.end()) {
+        return;
+    }
+    if (it->is_boolean()) {
+        *pbValue = it->get<bool>();
+        return;
+    }
+    AppConfig_Error(pstParse, AppConfig_Key(section, key), "must be true or false, got " + it->dump());
+}
+
+static void AppConfig_ReadString(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                                 const char *key, char *szValue, size_t size) {
+    json::const_iterator it = object.find(key);
+    if (it == object.end()) {
+        return;
+    }
+    if (!it->is_string()) {
+        AppConfig_Error(pstParse, AppConfig_Key(section, key), "must be a string, got " + it->dump());
+    } else if (it->get_ref<const std::string &>().size() >= size) {
+        AppConfig_Error(pstParse, AppConfig_Key(section, key),
+                        "is longer than " + std::to_string(size - 1) + " characters");
+    } else {
+        std::strncpy(szValue, it->get_ref<const std::string &>().c_str(), size);
+    }
+}
+
+static void AppConfig_ReadEnum(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                               const char *key, const char *const *names, int count, int *ps32Value) {
+    json::const_iterator it = object.find(key);
+    if (it == object.end()) {
+        return;
+    }
+    for (int i = 0; i < count && it->is_string(); i++) {
+        if (it->get_ref<const std::string &>() == names[i]) {
+            *ps32Value = i;
+            return;
+        }
+    }
+    std::string message = "must be one of";
+    for (int i = 0; i < count; i++) {
+        message += std::string(i ? ", \"" : " \"") + names[i] + "\"";
+    }
+    AppConfig_Error(pstParse, AppConfig_Key(section, key), message + ", got " + it->dump());
+}
+
+// A list of CPU indices, [] for no pinning
+static void AppConfig_ReadCpus(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                               const char *key, uint32_t *pu32Cpus) {
+    json::const_iterator it = object.find(key);
+    if (it == object.end()) {
+        return;
+    }
+    uint32_t u32Cpus = 0;
+    bool bValid = it->is_array();
+    for (size_t i = 0; bValid && i < it->size(); i++) {
+        const json &cpu = (*it)[i];
+        bValid = cpu.is_number_unsigned() && cpu.get<uint64_t>() < APP_CONFIG_MAX_CPUS;
+        if (bValid) {
+            u32Cpus |= 1u << cpu.get<uint64_t>();
+        }
+    }
+    if (!bValid) {
+        AppConfig_Error(pstParse, AppConfig_Key(section, key),
+                        "must be a list of CPU numbers below " + std::to_string(APP_CONFIG_MAX_CPUS) + ", got " +
+                            it->dump());
+        return;
+    }
+    *pu32Cpus = u32Cpus;
+}
+
+static void AppConfig_ReadSize(AppConfigParse_t *pstParse, const json &object, const std::string &section,
+                               const char *keyWidth, const char *keyHeight, uint32_t u32Max, SIZE_S *pstSize) {
+    AppConfig_ReadEven(pstParse, object, section, keyWidth, 32, u32Max, &pstSize->u32Width);
+    AppConfig_ReadEven(pstParse, object, section, keyHeight, 32, u32Max, &pstSize->u32Height);
+}
+
+static void AppConfig_ParseModels(AppConfigParse_t *pstParse, const json &root, AppConfig_t *pstConfig) {
+    static const char *const known[] = {"detect", "roi", "recognizer_param", "recognizer_model"};
+    const json *pSection = AppConfig_Section(pstParse, root, "", "models", known, 4);
+    if (!pSection) {
+        return;
+    }
+    AppConfig_ReadString(pstParse, *pSection, "models", "detect", pstConfig->szDetectModel, APP_CONFIG_PATH_MAX);
+    AppConfig_ReadString(pstParse, *pSection, "models", "roi", pstConfig->szRoiModel, APP_CONFIG_PATH_MAX);
+    AppConfig_ReadString(pstParse, *pSection, "models", "recognizer_param", pstConfig->szRecogParam,
+                         APP_CONFIG_PATH_MAX);
+    AppConfig_ReadString(pstParse, *pSection, "models", "recognizer_model", pstConfig->szRecogModel,
+                         APP_CONFIG_PATH_MAX);
+}
+
+static void AppConfig_ParseSystem(AppConfigParse_t *pstParse, const json &root, AppConfig_t *pstConfig) {
+    static const char *const known[] = {"width", "height", "bitrate_kbps", "gop", "detect_input",
+                                        "detect_width", "detect_height", "encode_path", "rate_control"};
+    const json *pSection = AppConfig_Section(pstParse, root, "", "video", known, 9);
+    if (pSection) {
+        AppConfig_ReadSize(pstParse, *pSection, "video", "width", "height", 4096, &pstConfig->stVencSize);
+        AppConfig_ReadU32(pstParse, *pSection, "video", "bitrate_kbps", 100, 50000, &pstConfig->u32VencBitrateKbps);
+        AppConfig_ReadU32(pstParse, *pSection, "video", "gop", 0, 600, &pstConfig->u32VencGop);
+        int s32Input = (int)pstConfig->enDetectInput;
+        AppConfig_ReadEnum(pstParse, *pSection, "video", "detect_input", kDetectInputNames, 2, &s32Input);
+        pstConfig->enDetectInput = (SystemDetectInput_t)s32Input;
+        AppConfig_ReadSize(pstParse, *pSection, "video", "detect_width", "detect_height", 4096,
+                           &pstConfig->stDetectSize);
+        int s32Path = (int)pstConfig->enEncodePath;
+        AppConfig_ReadEnum(pstParse, *pSection, "video", "encode_path", kEncodePathNames, 2, &s32Path);
+        pstConfig->enEncodePath = (VENCEncodePath_t)s32Path;
+        int s32Rc = (int)pstConfig->enVencRc;
+        AppConfig_ReadEnum(pstParse, *pSection, "video", "rate_control", kRateControlNames, 2, &s32Rc);
+        pstConfig->enVencRc = (SystemRateControl_t)s32Rc;
+    }
+
+    static const char *const knownRoi[] = {"width", "height", "window_width", "window_height"};
+    pSection = AppConfig_Section(pstParse, root, "", "roi", knownRoi, 4);
+    if (pSection) {
+        AppConfig_ReadSize(pstParse, *pSection, "roi", "width", "height", 4096, &pstConfig->stRoiSize);
+        AppConfig_ReadSize(pstParse, *pSection, "roi", "window_width", "window_height", 4096,
+                           &pstConfig->stRoiWindow);
+    }
+
+    static const char *const knownRtsp[] = {"port"};
+    pSection = AppConfig_Section(pstParse, root, "", "rtsp", knownRtsp, 1);
+    if (pSection) {
+        AppConfig_ReadU32(pstParse, *pSection, "rtsp", "port", 1, 65535, &pstConfig->u32RtspPort);
+    }
+
+    static const char *const knownPools[] = {"shared", "detect", "roi", "tdl", "encode"};
+    pSection = AppConfig_Section(pstParse, root, "", "pools", knownPools, 5);
+    if (pSection) {
+        // the broker tracks every block of the shared pool, the lower bound
+        // depends on the overlay and detector input, see AppConfig_MinSharedBlks;
+        // the detect pool needs one block per pipeline stage plus the one VPSS writes
+        AppConfig_ReadU32(pstParse, *pSection, "pools", "shared", FRAME_BROKER_RETAIN + 1, FRAME_BROKER_DEPTH,
+                          &pstConfig->u32SharedBlks);
+        AppConfig_ReadU32(pstParse, *pSection, "pools", "detect", TDL_PIPELINE_DEPTH + 1, 16,
+                          &pstConfig->u32DetectBlks);
+        AppConfig_ReadU32(pstParse, *pSection, "pools", "roi", 2, 16, &pstConfig->u32RoiBlks);
+        AppConfig_ReadU32(pstParse, *pSection, "pools", "tdl", 1, 16, &pstConfig->u32TdlBlks);
+        AppConfig_ReadU32(pstParse, *pSection, "pools", "encode", 2, 16, &pstConfig->u32EncodeBlks);
+    }
+
+    static const char *const knownGpio[] = {"button", "led"};
+    pSection = AppConfig_Section(pstParse, root, "", "gpio", knownGpio, 2);
+    if (pSection) {
+        AppConfig_ReadS32(pstParse, *pSection, "gpio", "button", 0, 255, &pstConfig->s32ButtonPin);
+        AppConfig_ReadS32(pstParse, *pSection, "gpio", "led", 0, 255, &pstConfig->s32LedPin);
+    }
+}
+
+static void AppConfig_ParsePipeline(AppConfigParse_t *pstParse, const json &root, AppConfig_t *pstConfig) {
+    static const char *const known[] = {"score_threshold", "nms_threshold", "interval_max", "track_max_drift",
+                                        "roi_full_interval", "motion"};
+    const json *pSection = AppConfig_Section(pstParse, root, "", "detection", known, 6);
+    if (pSection) {
+        AppConfig_ReadFloat(pstParse, *pSection, "detection", "score_threshold", 0.0f, 1.0f,
+                            &pstConfig->fScoreThreshold);
+        AppConfig_ReadFloat(pstParse, *pSection, "detection", "nms_threshold", 0.0f, 1.0f,
+                            &pstConfig->fNmsThreshold);
+        TDLDetectConfig_t *pstDetect = &pstConfig->stDetect;
+        AppConfig_ReadU32(pstParse, *pSection, "detection", "interval_max", 1, TDL_INTERVAL_LIMIT,
+                          &pstDetect->u32IntervalMax);
+        AppConfig_ReadFloat(pstParse, *pSection, "detection", "track_max_drift", 0.01f, 4.0f,
+                            &pstDetect->fTrackMaxDrift);
+        AppConfig_ReadU32(pstParse, *pSection, "detection", "roi_full_interval", 1, TDL_INTERVAL_LIMIT,
+                          &pstDetect->u32RoiFullInterval);
+
+        static const char *const knownMotion[] = {"threshold", "min_blocks", "hold_ms", "heartbeat_ms"};
+        const json *pMotion = AppConfig_Section(pstParse, *pSection, "detection", "motion", knownMotion, 4);
+        if (pMotion) {
+            MotionGateConfig_t *pstMotion = &pstDetect->stMotion;
+            uint32_t u32HoldMs = (uint32_t)(pstMotion->u64HoldUs / 1000);
+            uint32_t u32HeartbeatMs = (uint32_t)(pstMotion->u64HeartbeatUs / 1000);
+            AppConfig_ReadU32(pstParse, *pMotion, "detection.motion", "threshold", 1, 255, &pstMotion->u32Threshold);
+            AppConfig_ReadU32(pstParse, *pMotion, "detection.motion", "min_blocks", 1,
+                              MOTION_GATE_REGION_BLOCKS * MOTION_GATE_REGION_BLOCKS, &pstMotion->u32MinBlocks);
+            AppConfig_ReadU32(pstParse, *pMotion, "detection.motion", "hold_ms", 0, 600000, &u32HoldMs);
+            AppConfig_ReadU32(pstParse, *pMotion, "detection.motion", "heartbeat_ms", 100, 600000, &u32HeartbeatMs);
+            pstMotion->u64HoldUs = (uint64_t)u32HoldMs * 1000;
+            pstMotion->u64HeartbeatUs = (uint64_t)u32HeartbeatMs * 1000;
+        }
+    }
+
+    static const char *const knownQuality[] = {"min_score", "min_side", "max_yaw", "max_pitch", "max_roll",
+                                               "min_sharpness", "gate_metadata"};
+    pSection = AppConfig_Section(pstParse, root, "", "quality", knownQuality, 7);
+    if (pSection) {
+        FaceQualityConfig_t *pstQuality = &pstConfig->stQuality;
+        AppConfig_ReadFloat(pstParse, *pSection, "quality", "min_score", 0.0f, 1.0f, &pstQuality->fMinScore);
+        AppConfig_ReadFloat(pstParse, *pSection, "quality", "min_side", 0.0f, 4096.0f, &pstQuality->fMinSide);
+        AppConfig_ReadFloat(pstParse, *pSection, "quality", "max_yaw", 0.0f, 180.0f, &pstQuality->fMaxYaw);
+        AppConfig_ReadFloat(pstParse, *pSection, "quality", "max_pitch", 0.0f, 180.0f, &pstQuality->fMaxPitch);
+        AppConfig_ReadFloat(pstParse, *pSection, "quality", "max_roll", 0.0f, 180.0f, &pstQuality->fMaxRoll);
+        AppConfig_ReadFloat(pstParse, *pSection, "quality", "min_sharpness", 0.0f, 100000.0f,
+                            &pstQuality->fMinSharpness);
+        AppConfig_ReadBool(pstParse, *pSection, "quality", "gate_metadata", &pstQuality->bGateMetadata);
+    }
+
+    static const char *const knownOverlay[] = {"enabled", "mode", "max_delay_frames", "backend"};
+    pSection = AppConfig_Section(pstParse, root, "", "overlay", knownOverlay, 4);
+    if (pSection) {
+        AppConfig_ReadBool(pstParse, *pSection, "overlay", "enabled", &pstConfig->bOverlay);
+        int s32Mode = (int)pstConfig->enOverlayMode;
+        AppConfig_ReadEnum(pstParse, *pSection, "overlay", "mode", kOverlayModeNames, 2, &s32Mode);
+        pstConfig->enOverlayMode = (VENCOverlayMode_t)s32Mode;
+        int s32Backend = (int)pstConfig->enOverlayBackend;
+        AppConfig_ReadEnum(pstParse, *pSection, "overlay", "backend", kOverlayBackendNames, 2, &s32Backend);
+        pstConfig->enOverlayBackend = (VENCOverlayBackend_t)s32Backend;
+        AppConfig_ReadU32(pstParse, *pSection, "overlay", "max_delay_frames", 0, VENC_MAX_DELAY_FRAMES,
+                          &pstConfig->u32MaxDelayFrames);
+    }
+
+    static const char *const knownRoi[] = {"enabled", "face_qp", "background_qp", "background_fps", "margin"};
+    pSection = AppConfig_Section(pstParse, root, "", "encoder_roi", knownRoi, 5);
+    if (pSection) {
+        EncoderRoiConfig_t *pstRoi = &pstConfig->stEncoderRoi;
+        AppConfig_ReadBool(pstParse, *pSection, "encoder_roi", "enabled", &pstRoi->bEnabled);
+        AppConfig_ReadS32(pstParse, *pSection, "encoder_roi", "face_qp", -51, 0, &pstRoi->s32FaceQp);
+        AppConfig_ReadS32(pstParse, *pSection, "encoder_roi", "background_qp", 0, 51, &pstRoi->s32BackgroundQp);
+        AppConfig_ReadU32(pstParse, *pSection, "encoder_roi", "background_fps", 0, SYSTEM_VENC_FPS,
+                          &pstRoi->u32BackgroundFps);
+        AppConfig_ReadFloat(pstParse, *pSection, "encoder_roi", "margin", 0.0f, 2.0f, &pstRoi->fMargin);
+    }
+
+    pSection = AppConfig_Section(pstParse, root, "", "threads", kThreadNames, APP_THREAD_COUNT);
+    if (pSection) {
+        for (int i = 0; i < APP_THREAD_COUNT; i++) {
+            AppConfig_ReadCpus(pstParse, *pSection, "threads", kThreadNames[i], &pstConfig->au32Cpus[i]);
+        }
+    }
+}
+
+CVI_S32 AppConfig_Load(AppConfig_t *pstConfig, const char *path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        if (errno == ENOENT) {
+            std::cout << "No " << path << ", using the built-in configuration" << std::endl;
+            return CVI_SUCCESS;
+        }
+        std::cerr << "Cannot read " << path << ": " << std::strerror(errno) << std::endl;
+        return CVI_FAILURE;
+    }
+
+    json root;
+    try {
+        // comments are allowed, a site file may explain its tuning
+        root = json::parse(file, nullptr, true, true);
+    } catch (const json::parse_error &e) {
+        std::cerr << path << ": " << e.what() << std::endl;
+        return CVI_FAILURE;
+    }
+    if (!root.is_object()) {
+        std::cerr << path << ": must hold a JSON object, got " << root.type_name() << std::endl;
+        return CVI_FAILURE;
+    }
+
+    AppConfigParse_t stParse = {path, 0};
+    static const char *const known[] = {"models", "video", "roi", "rtsp", "pools", "gpio",
+                                        "detection", "quality", "overlay", "encoder_roi", "threads"};
+    AppConfig_CheckKeys(&stParse, root, "", known, 11);
+    AppConfig_ParseModels(&stParse, root, pstConfig);
+    AppConfig_ParseSystem(&stParse, root, pstConfig);
+    AppConfig_ParsePipeline(&stParse, root, pstConfig);
+    if (pstConfig->szRoiModel[0] && pstConfig->enDetectInput != SYSTEM_DETECT_MODEL_CHN) {
+        AppConfig_Error(&stParse, "models.roi", "needs video.detect_input \"model_channel\"");
+    }
+    if (pstConfig->enEncodePath == VENC_PATH_BIND && pstConfig->enOverlayBackend != VENC_OVERLAY_OSD) {
+        // bound frames never reach the CPU, overlays can only be regions
+        AppConfig_Error(&stParse, "video.encode_path", "\"bind\" needs overlay.backend \"osd\"");
+    }
+    uint32_t u32MinShared = AppConfig_MinSharedBlks(pstConfig);
+    if (pstConfig->u32SharedBlks < u32MinShared) {
+        // VPSS would run out of blocks while the encoder and detector hold theirs
+        AppConfig_Error(&stParse, "pools.shared",
+                        "must be at least " + std::to_string(u32MinShared) + " for overlay.max_delay_frames " +
+                            std::to_string(pstConfig->u32MaxDelayFrames) + " and video.detect_input \"" +
+                            kDetectInputNames[pstConfig->enDetectInput] + "\"");
+    }
+    if (pstConfig->stEncoderRoi.s32BackgroundQp != 0 && pstConfig->stEncoderRoi.u32BackgroundFps != 0) {
+        // a background region covers the frame, nothing would be left to skip
+        AppConfig_Error(&stParse, "encoder_roi.background_fps", "needs encoder_roi.background_qp 0");
+    }
+    if (stParse.u32Errors > 0) {
+        std::cerr << stParse.u32Errors << " error(s) in " << path << std::endl;
+        return CVI_FAILURE;
+    }
+    std::cout << "Configuration loaded from " << path << std::endl;
+    return CVI_SUCCESS;
+}
+
+void AppConfig_ToSystem(const AppConfig_t *pstConfig, SystemConfig_t *pstSystem) {
+    pstSystem->stVencSize = pstConfig->stVencSize;
+    pstSystem->u32VencBitrateKbps = pstConfig->u32VencBitrateKbps;
+    pstSystem->enVencRc = pstConfig->enVencRc;
+    pstSystem->u32RtspPort = pstConfig->u32RtspPort;
+    pstSystem->enDetectInput = pstConfig->enDetectInput;
+    pstSystem->stDetectSize = pstConfig->stDetectSize;
+    pstSystem->bCenterRoi = pstConfig->szRoiModel[0] != '\0';
+    pstSystem->stRoiSize = pstConfig->stRoiSize;
+    pstSystem->stRoiWindow = pstConfig->stRoiWindow;
+    pstSystem->u32SharedBlks = pstConfig->u32SharedBlks;
+    pstSystem->u32DetectBlks = pstConfig->u32DetectBlks;
+    pstSystem->u32RoiBlks = pstConfig->u32RoiBlks;
+    pstSystem->u32TdlBlks = pstConfig->u32TdlBlks;
+    pstSystem->bEncodeChn = pstConfig->enOverlayBackend == VENC_OVERLAY_OSD;
+    pstSystem->encodeChn = -1;
+    pstSystem->u32EncodeBlks = pstConfig->u32EncodeBlks;
+}
+
+void AppConfig_ToLive(const AppConfig_t *pstConfig, LiveConfig_t *pstLive) {
+    std::memset(pstLive, 0, sizeof(LiveConfig_t));
+    pstLive->fScoreThreshold = pstConfig->fScoreThreshold;
+    pstLive->fNmsThreshold = pstConfig->fNmsThreshold;
+    pstLive->stDetect = pstConfig->stDetect;
+    pstLive->stQuality = pstConfig->stQuality;
+    pstLive->u32VencBitrateKbps = pstConfig->u32VencBitrateKbps;
+    pstLive->u32VencGop = pstConfig->u32VencGop;
+    pstLive->stEncoderRoi = pstConfig->stEncoderRoi;
+    pstLive->bOverlay = pstConfig->bOverlay;
+    pstLive->enOverlayMode = pstConfig->enOverlayMode;
+    pstLive->u32MaxDelayFrames = pstConfig->u32MaxDelayFrames;
+}
+
+static bool AppConfig_DetectEqual(const TDLDetectConfig_t *pstA, const TDLDetectConfig_t *pstB) {
+    return pstA->u32IntervalMax == pstB->u32IntervalMax && pstA->fTrackMaxDrift == pstB->fTrackMaxDrift &&
+           pstA->u32RoiFullInterval == pstB->u32RoiFullInterval &&
+           pstA->stMotion.u32Threshold == pstB->stMotion.u32Threshold &&
+           pstA->stMotion.u32MinBlocks == pstB->stMotion.u32MinBlocks &&
+           pstA->stMotion.u64HoldUs == pstB->stMotion.u64HoldUs &&
+           pstA->stMotion.u64HeartbeatUs == pstB->stMotion.u64HeartbeatUs;
+}
+
+static bool AppConfig_QualityEqual(const FaceQualityConfig_t *pstA, const FaceQualityConfig_t *pstB) {
+    return pstA->fMinScore == pstB->fMinScore && pstA->fMinSide == pstB->fMinSide &&
+           pstA->fMaxYaw == pstB->fMaxYaw && pstA->fMaxPitch == pstB->fMaxPitch &&
+           pstA->fMaxRoll == pstB->fMaxRoll && pstA->fMinSharpness == pstB->fMinSharpness &&
+           pstA->bGateMetadata == pstB->bGateMetadata;
+}
+
+// Compared by value: padding bytes are not, and 0.0 equals -0.0
+bool AppConfig_LiveEqual(const LiveConfig_t *pstA, const LiveConfig_t *pstB) {
+    return pstA->fScoreThreshold == pstB->fScoreThreshold && pstA->fNmsThreshold == pstB->fNmsThreshold &&
+           AppConfig_DetectEqual(&pstA->stDetect, &pstB->stDetect) &&
+           AppConfig_QualityEqual(&pstA->stQuality, &pstB->stQuality) &&
+           pstA->u32VencBitrateKbps == pstB->u32VencBitrateKbps && pstA->u32VencGop == pstB->u32VencGop &&
+           EncoderRoi_ConfigEqual(&pstA->stEncoderRoi, &pstB->stEncoderRoi) && pstA->bOverlay == pstB->bOverlay &&
+           pstA->enOverlayMode == pstB->enOverlayMode && pstA->u32MaxDelayFrames == pstB->u32MaxDelayFrames;
+}
+
+void AppConfig_PinThread(pthread_t thread, uint32_t u32Cpus, const char *name) {
+    if (u32Cpus == 0) {
+        return;
+    }
+    cpu_set_t stSet;
+    CPU_ZERO(&stSet);
+    for (int i = 0; i < APP_CONFIG_MAX_CPUS; i++) {
+        if (u32Cpus & (1u << i)) {
+            CPU_SET(i, &stSet);
+        }
+    }
+    int s32Err = pthread_setaffinity_np(thread, sizeof(stSet), &stSet);
+    if (s32Err != 0) {
+        std::cerr << "Cannot pin the " << name << " thread to CPU mask 0x" << std::hex << u32Cpus << std::dec
+                  << ": " << std::strerror(s32Err) << std::endl;
+        return;
+    }
+    std::cout << "Pinned the " << name << " thread to CPU mask 0x" << std::hex << u32Cpus << std::dec << std::endl;
+}
@@ -5,6 +5,7 @@
 #include <sys/time.h>
 #include "button_handler.h"
 #include "shared_data.h"
+#include "hal.h"
 
 // Long press threshold: 2 seconds (2,000,000 microseconds)
 #define LONG_PRESS_THRESHOLD_US 2000000
@@ -21,24 +22,23 @@ int ButtonHandler_Init(ButtonHandler_t *handler, int buttonPin, int ledPin) {
     handler->pressType = BUTTON_PRESS_NONE;
     handler->longPressThreshold = LONG_PRESS_THRESHOLD_US;
     
-    if (wiringXSetup("milkv_duo256m", NULL) == -1) {
+    if (HAL_Gpio_Setup() == -1) {
         std::cerr << "Failed to init wiringX" << std::endl;
-        wiringXGC();
         return -1;
     }
     
-    pinMode(handler->ledPin, PINMODE_OUTPUT);
-    pinMode(handler->buttonPin, PINMODE_INPUT);
-    if (wiringXValidGPIO(handler->ledPin) != 0) {
+    HAL_Gpio_PinMode(handler->ledPin, PINMODE_OUTPUT);
+    HAL_Gpio_PinMode(handler->buttonPin, PINMODE_INPUT);
+    if (HAL_Gpio_ValidGPIO(handler->ledPin) != 0) {
         std::cerr << "Invalid GPIO " << handler->ledPin << " (LED)" << std::endl;
         return -1;
     }
-    if (wiringXValidGPIO(handler->buttonPin) != 0) {
+    if (HAL_Gpio_ValidGPIO(handler->buttonPin) != 0) {
         std::cerr << "Invalid GPIO " << handler->buttonPin << " (Button)" << std::endl;
         return -1;
     }
     
-    digitalWrite(handler->ledPin, LOW);
+    HAL_Gpio_DigitalWrite(handler->ledPin, LOW);
     
     handler->initialized = true;
     std::cout << "Button handler initialized (Button=" << handler->buttonPin 
@@ -49,8 +49,8 @@ int ButtonHandler_Init(ButtonHandler_t *handler, int buttonPin, int ledPin) {
 
 void ButtonHandler_Cleanup(ButtonHandler_t *handler) {
     if (handler && handler->initialized) {
-        digitalWrite(handler->ledPin, LOW);
-        wiringXGC();
+        HAL_Gpio_DigitalWrite(handler->ledPin, LOW);
+        HAL_Gpio_Release();
         handler->initialized = false;
         std::cout << "Button handler cleaned up" << std::endl;
     }
@@ -88,11 +88,11 @@ void *ButtonHandler_ThreadRoutine(void *pHandle) {
     std::cout << "Long press (>2s): Special function" << std::endl;
     
     while (!g_bExit) {
-        current_state = digitalRead(handler->buttonPin);
+        current_state = HAL_Gpio_DigitalRead(handler->buttonPin);
         
         if (last_state == HIGH && current_state == LOW) {
             usleep(30000); 
-            if (digitalRead(handler->buttonPin) == LOW) {
+            if (HAL_Gpio_DigitalRead(handler->buttonPin) == LOW) {
                 gettimeofday(&press_start_time, NULL);
                 button_was_pressed = true;
                 std::cout << "Button pressed..." << std::endl;
@@ -102,7 +102,7 @@ void *ButtonHandler_ThreadRoutine(void *pHandle) {
         if (last_state == LOW && current_state == HIGH) {
             usleep(30000);
             
-            if (digitalRead(handler->buttonPin) == HIGH && button_was_pressed) {
+            if (HAL_Gpio_DigitalRead(handler->buttonPin) == HIGH && button_was_pressed) {
                 gettimeofday(&press_end_time, NULL);
                 button_was_pressed = false;
                 
@@ -110,7 +110,7 @@ void *ButtonHandler_ThreadRoutine(void *pHandle) {
                                    (press_end_time.tv_usec - press_start_time.tv_usec);
                 
                 led_state = !led_state;
-                digitalWrite(handler->ledPin, led_state ? HIGH : LOW);
+                HAL_Gpio_DigitalWrite(handler->ledPin, led_state ? HIGH : LOW);
                 
                 if (press_duration_us >= handler->longPressThreshold) {
                     // long press
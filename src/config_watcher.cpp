@@ -0,0 +1,156 @@
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "config_watcher.h"
+
+// Settings only read at start-up that differ from the running ones
+static void ConfigWatcher_ReportRestart(const AppConfig_t *pstOld, const AppConfig_t *pstNew) {
+    const char *apszChanged[8];
+    int n = 0;
+    if (std::strcmp(pstOld->szDetectModel, pstNew->szDetectModel) != 0 ||
+        std::strcmp(pstOld->szRoiModel, pstNew->szRoiModel) != 0 ||
+        std::strcmp(pstOld->szRecogParam, pstNew->szRecogParam) != 0 ||
+        std::strcmp(pstOld->szRecogModel, pstNew->szRecogModel) != 0) {
+        apszChanged[n++] = "models";
+    }
+    if (pstOld->enDetectInput != pstNew->enDetectInput || pstOld->enVencRc != pstNew->enVencRc ||
+        std::memcmp(&pstOld->stVencSize, &pstNew->stVencSize, sizeof(SIZE_S)) != 0 ||
+        std::memcmp(&pstOld->stDetectSize, &pstNew->stDetectSize, sizeof(SIZE_S)) != 0) {
+        apszChanged[n++] = "video size, input and rate control";
+    }
+    if (std::memcmp(&pstOld->stRoiSize, &pstNew->stRoiSize, sizeof(SIZE_S)) != 0 ||
+        std::memcmp(&pstOld->stRoiWindow, &pstNew->stRoiWindow, sizeof(SIZE_S)) != 0) {
+        apszChanged[n++] = "roi";
+    }
+    if (pstOld->u32RtspPort != pstNew->u32RtspPort) {
+        apszChanged[n++] = "rtsp";
+    }
+    if (pstOld->u32SharedBlks != pstNew->u32SharedBlks || pstOld->u32DetectBlks != pstNew->u32DetectBlks ||
+        pstOld->u32RoiBlks != pstNew->u32RoiBlks || pstOld->u32TdlBlks != pstNew->u32TdlBlks ||
+        pstOld->u32EncodeBlks != pstNew->u32EncodeBlks) {
+        apszChanged[n++] = "pools";
+    }
+    if (pstOld->enOverlayBackend != pstNew->enOverlayBackend || pstOld->enEncodePath != pstNew->enEncodePath) {
+        apszChanged[n++] = "overlay backend and encode path";
+    }
+    if (pstOld->s32ButtonPin != pstNew->s32ButtonPin || pstOld->s32LedPin != pstNew->s32LedPin) {
+        apszChanged[n++] = "gpio";
+    }
+    if (std::memcmp(pstOld->au32Cpus, pstNew->au32Cpus, sizeof(pstOld->au32Cpus)) != 0) {
+        apszChanged[n++] = "threads";
+    }
+    for (int i = 0; i < n; i++) {
+        std::cout << "Config watcher: " << apszChanged[i] << " changes take effect after a restart" << std::endl;
+    }
+}
+
+static void ConfigWatcher_Reload(ConfigWatcher_t *pstWatcher) {
+    if (access(pstWatcher->szPath, F_OK) != 0) {
+        // removed or renamed away, keep running as is
+        return;
+    }
+    AppConfig_t stConfig;
+    AppConfig_DefaultConfig(&stConfig);
+    if (AppConfig_Load(&stConfig, pstWatcher->szPath) != CVI_SUCCESS) {
+        std::cerr << "Config watcher: keeping the running configuration" << std::endl;
+        return;
+    }
+    ConfigWatcher_ReportRestart(&pstWatcher->stStarted, &stConfig);
+
+    LiveConfig_t stNew;
+    AppConfig_ToLive(&stConfig, &stNew);
+    if (AppConfig_LiveEqual(&pstWatcher->stLive, &stNew)) {
+        return;
+    }
+    pstWatcher->stLive = stNew;
+    LiveConfig_Publish(pstWatcher->pstStore, &stNew);
+    pstWatcher->u32Reloads++;
+    std::cout << "Config watcher: live settings updated" << std::endl;
+}
+
+static void *ConfigWatcher_ThreadRoutine(void *pArgs) {
+    ConfigWatcher_t *pstWatcher = static_cast<ConfigWatcher_t *>(pArgs);
+    // events carry the name of the file within the directory
+    alignas(struct inotify_event) char buf[4096];
+    while (!pstWatcher->bStop) {
+        struct pollfd stPoll = {pstWatcher->s32Fd, POLLIN, 0};
+        int s32Ready = poll(&stPoll, 1, CONFIG_WATCHER_POLL_MS);
+        if (s32Ready <= 0) {
+            if (s32Ready < 0 && errno != EINTR) {
+                std::cerr << "Config watcher: poll failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
+            continue;
+        }
+        ssize_t len = read(pstWatcher->s32Fd, buf, sizeof(buf));
+        bool bChanged = false;
+        for (ssize_t off = 0; off < len;) {
+            const struct inotify_event *pstEvent = reinterpret_cast<const struct inotify_event *>(buf + off);
+            bChanged |= pstEvent->len > 0 && std::strcmp(pstEvent->name, pstWatcher->pszName) == 0;
+            off += sizeof(struct inotify_event) + pstEvent->len;
+        }
+        if (bChanged) {
+            ConfigWatcher_Reload(pstWatcher);
+        }
+    }
+    return nullptr;
+}
+
+CVI_S32 ConfigWatcher_Start(ConfigWatcher_t *pstWatcher, const char *path, const AppConfig_t *pstLoaded,
+                            LiveConfigStore_t *pstStore) {
+    if (!pstWatcher || !path || !pstLoaded || !pstStore || std::strlen(path) >= APP_CONFIG_PATH_MAX) {
+        return CVI_FAILURE;
+    }
+    std::strncpy(pstWatcher->szPath, path, APP_CONFIG_PATH_MAX);
+    pstWatcher->stStarted = *pstLoaded;
+    AppConfig_ToLive(pstLoaded, &pstWatcher->stLive);
+    pstWatcher->pstStore = pstStore;
+    pstWatcher->bStop = false;
+    pstWatcher->bThreadStarted = false;
+    pstWatcher->u32Reloads = 0;
+
+    // Watch the directory: editors and deployment tools often replace the
+    // file by renaming a new one over it, which a watch on the file misses
+    char szDir[APP_CONFIG_PATH_MAX];
+    const char *pszSlash = std::strrchr(pstWatcher->szPath, '/');
+    if (pszSlash) {
+        size_t len = pszSlash == pstWatcher->szPath ? 1 : (size_t)(pszSlash - pstWatcher->szPath);
+        std::memcpy(szDir, pstWatcher->szPath, len);
+        szDir[len] = '\0';
+        pstWatcher->pszName = pszSlash + 1;
+    } else {
+        std::strcpy(szDir, ".");
+        pstWatcher->pszName = pstWatcher->szPath;
+    }
+
+    pstWatcher->s32Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (pstWatcher->s32Fd < 0 || inotify_add_watch(pstWatcher->s32Fd, szDir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        std::cerr << "Config watcher: cannot watch " << szDir << ": " << std::strerror(errno) << std::endl;
+        if (pstWatcher->s32Fd >= 0) {
+            close(pstWatcher->s32Fd);
+        }
+        return CVI_FAILURE;
+    }
+    if (pthread_create(&pstWatcher->thread, nullptr, ConfigWatcher_ThreadRoutine, pstWatcher) != 0) {
+        std::cerr << "Failed to create config watcher thread" << std::endl;
+        close(pstWatcher->s32Fd);
+        return CVI_FAILURE;
+    }
+    pstWatcher->bThreadStarted = true;
+    std::cout << "Config watcher: watching " << path << " for live changes" << std::endl;
+    return CVI_SUCCESS;
+}
+
+void ConfigWatcher_Stop(ConfigWatcher_t *pstWatcher) {
+    if (!pstWatcher || !pstWatcher->bThreadStarted) {
+        return;
+    }
+    pstWatcher->bStop = true;
+    pthread_join(pstWatcher->thread, nullptr);
+    pstWatcher->bThreadStarted = false;
+    close(pstWatcher->s32Fd);
+    std::cout << "Config watcher stopped: " << pstWatcher->u32Reloads << " live update(s)" << std::endl;
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "encoder_roi.h"
+#include "hal.h"
+
+// Face boxes considered per frame, the rest are left to the rate control
+#define ENCODER_ROI_MAX_FACES 32
+
+void EncoderRoi_DefaultConfig(EncoderRoiConfig_t *pstConfig) {
+    pstConfig->bEnabled = false;
+    pstConfig->s32FaceQp = ENCODER_ROI_FACE_QP;
+    pstConfig->s32BackgroundQp = ENCODER_ROI_BACKGROUND_QP;
+    pstConfig->u32BackgroundFps = 0;
+    pstConfig->fMargin = ENCODER_ROI_MARGIN;
+}
+
+bool EncoderRoi_ConfigEqual(const EncoderRoiConfig_t *pstA, const EncoderRoiConfig_t *pstB) {
+    return pstA->bEnabled == pstB->bEnabled && pstA->s32FaceQp == pstB->s32FaceQp &&
+           pstA->s32BackgroundQp == pstB->s32BackgroundQp && pstA->u32BackgroundFps == pstB->u32BackgroundFps &&
+           pstA->fMargin == pstB->fMargin;
+}
+
+void EncoderRoi_Init(EncoderRoi_t *pstRoi, SAMPLE_TDL_MW_CONTEXT *pstMWContext, const SIZE_S *pstSize,
+                     uint32_t u32Fps, const EncoderRoiConfig_t *pstConfig) {
+    std::memset(pstRoi, 0, sizeof(EncoderRoi_t));
+    pstRoi->pstMWContext = pstMWContext;
+    pstRoi->stSize = *pstSize;
+    pstRoi->u32Fps = u32Fps;
+    if (pstConfig) {
+        pstRoi->stConfig = *pstConfig;
+    } else {
+        EncoderRoi_DefaultConfig(&pstRoi->stConfig);
+    }
+    pstRoi->bDirty = true;
+}
+
+void EncoderRoi_SetConfig(EncoderRoi_t *pstRoi, const EncoderRoiConfig_t *pstConfig) {
+    if (pstConfig->bEnabled != pstRoi->stConfig.bEnabled) {
+        std::cout << "Encoder ROI " << (pstConfig->bEnabled ? "on" : "off") << std::endl;
+    }
+    pstRoi->stConfig = *pstConfig;
+    pstRoi->bDirty = true;
+}
+
+static uint64_t EncoderRoi_Area(const RECT_S *pstRect) {
+    return (uint64_t)pstRect->u32Width * pstRect->u32Height;
+}
+
+static RECT_S EncoderRoi_Union(const RECT_S *pstA, const RECT_S *pstB) {
+    int32_t x1 = std::min(pstA->s32X, pstB->s32X);
+    int32_t y1 = std::min(pstA->s32Y, pstB->s32Y);
+    int32_t x2 = std::max(pstA->s32X + (int32_t)pstA->u32Width, pstB->s32X + (int32_t)pstB->u32Width);
+    int32_t y2 = std::max(pstA->s32Y + (int32_t)pstA->u32Height, pstB->s32Y + (int32_t)pstB->u32Height);
+    RECT_S stRect = {x1, y1, (uint32_t)(x2 - x1), (uint32_t)(y2 - y1)};
+    return stRect;
+}
+
+// Face box grown by the margin, snapped outwards to the macroblock grid and
+// clamped to the frame; false when nothing of it is left
+static bool EncoderRoi_FaceRect(const EncoderRoi_t *pstRoi, const cvtdl_bbox_t *pstBox, RECT_S *pstRect) {
+    float fGrowX = (pstBox->x2 - pstBox->x1) * pstRoi->stConfig.fMargin;
+    float fGrowY = (pstBox->y2 - pstBox->y1) * pstRoi->stConfig.fMargin;
+    int32_t s32W = (int32_t)pstRoi->stSize.u32Width;
+    int32_t s32H = (int32_t)pstRoi->stSize.u32Height;
+    int32_t x1 = std::max(0, (int32_t)(pstBox->x1 - fGrowX) / ENCODER_ROI_ALIGN * ENCODER_ROI_ALIGN);
+    int32_t y1 = std::max(0, (int32_t)(pstBox->y1 - fGrowY) / ENCODER_ROI_ALIGN * ENCODER_ROI_ALIGN);
+    int32_t x2 = std::min(s32W, ((int32_t)(pstBox->x2 + fGrowX) + ENCODER_ROI_ALIGN - 1) / ENCODER_ROI_ALIGN *
+                                    ENCODER_ROI_ALIGN);
+    int32_t y2 = std::min(s32H, ((int32_t)(pstBox->y2 + fGrowY) + ENCODER_ROI_ALIGN - 1) / ENCODER_ROI_ALIGN *
+                                    ENCODER_ROI_ALIGN);
+    if (x2 <= x1 || y2 <= y1) {
+        return false;
+    }
+    pstRect->s32X = x1;
+    pstRect->s32Y = y1;
+    pstRect->u32Width = (uint32_t)(x2 - x1);
+    pstRect->u32Height = (uint32_t)(y2 - y1);
+    return true;
+}
+
+// Merge the pair whose bounding box adds the least area until u32Slots are left
+static uint32_t EncoderRoi_Merge(RECT_S *pstRects, uint32_t u32Count, uint32_t u32Slots) {
+    while (u32Count > u32Slots) {
+        uint32_t u32BestA = 0, u32BestB = 1;
+        int64_t s64BestCost = INT64_MAX;
+        for (uint32_t a = 0; a < u32Count; a++) {
+            for (uint32_t b = a + 1; b < u32Count; b++) {
+                RECT_S stUnion = EncoderRoi_Union(&pstRects[a], &pstRects[b]);
+                int64_t s64Cost = (int64_t)EncoderRoi_Area(&stUnion) - (int64_t)EncoderRoi_Area(&pstRects[a]) -
+                                  (int64_t)EncoderRoi_Area(&pstRects[b]);
+                if (s64Cost < s64BestCost) {
+                    s64BestCost = s64Cost;
+                    u32BestA = a;
+                    u32BestB = b;
+                }
+            }
+        }
+        pstRects[u32BestA] = EncoderRoi_Union(&pstRects[u32BestA], &pstRects[u32BestB]);
+        pstRects[u32BestB] = pstRects[--u32Count];
+    }
+    return u32Count;
+}
+
+// Send region u32Index unless VENC already has it
+static void EncoderRoi_Set(EncoderRoi_t *pstRoi, uint32_t u32Index, bool bEnable, const RECT_S *pstRect,
+                           int32_t s32Qp) {
+    bool bSame = bEnable == pstRoi->abEnabled[u32Index] &&
+                 (!bEnable || (std::memcmp(pstRect, &pstRoi->astRect[u32Index], sizeof(RECT_S)) == 0 &&
+                               s32Qp == pstRoi->as32Qp[u32Index]));
+    if (bSame && !pstRoi->bDirty) {
+        return;
+    }
+    pstRoi->u32Calls++;
+    CVI_S32 s32Ret = HAL_Encoder_SetRoi(pstRoi->pstMWContext, u32Index, bEnable, bEnable ? pstRect : NULL, s32Qp);
+    if (s32Ret != CVI_SUCCESS) {
+        if (pstRoi->u32Errors++ == 0) {
+            std::cerr << "Cannot set encoder ROI " << u32Index << ", ret=0x" << std::hex << s32Ret << std::dec
+                      << std::endl;
+        }
+        pstRoi->bRetry = true;
+        return;
+    }
+    pstRoi->abEnabled[u32Index] = bEnable;
+    if (bEnable) {
+        pstRoi->astRect[u32Index] = *pstRect;
+        pstRoi->as32Qp[u32Index] = s32Qp;
+    }
+}
+
+static void EncoderRoi_SetBackgroundFps(EncoderRoi_t *pstRoi, uint32_t u32Fps) {
+    if (u32Fps == pstRoi->u32BackgroundFps && !pstRoi->bDirty) {
+        return;
+    }
+    CVI_S32 s32Ret = HAL_Encoder_SetRoiBgFrameRate(pstRoi->pstMWContext, pstRoi->u32Fps,
+                                                   u32Fps ? u32Fps : pstRoi->u32Fps);
+    if (s32Ret != CVI_SUCCESS) {
+        if (pstRoi->u32Errors++ == 0) {
+            std::cerr << "Cannot set the encoder background frame rate, ret=0x" << std::hex << s32Ret << std::dec
+                      << std::endl;
+        }
+        pstRoi->bRetry = true;
+        return;
+    }
+    pstRoi->u32BackgroundFps = u32Fps;
+}
+
+static void EncoderRoi_Report(EncoderRoi_t *pstRoi) {
+    uint64_t u64FrameArea = (uint64_t)pstRoi->stSize.u32Width * pstRoi->stSize.u32Height;
+    std::cout << "=== Encoder ROI ===" << std::endl;
+    std::cout << "Frames: " << pstRoi->u32Frames << ", with faces: " << pstRoi->u32FaceFrames
+              << ", merged: " << pstRoi->u32MergedFrames << std::endl;
+    std::cout << "Face regions avg: " << (float)pstRoi->u64Regions / pstRoi->u32Frames << ", covering "
+              << 100.0f * pstRoi->u64RegionArea / pstRoi->u32Frames / u64FrameArea << "% of the frame" << std::endl;
+    std::cout << "Regions sent: " << pstRoi->u32Calls << ", errors: " << pstRoi->u32Errors << std::endl;
+    std::cout << "===================" << std::endl;
+    pstRoi->u32Frames = 0;
+    pstRoi->u32FaceFrames = 0;
+    pstRoi->u32MergedFrames = 0;
+    pstRoi->u64Regions = 0;
+    pstRoi->u64RegionArea = 0;
+    pstRoi->u32Calls = 0;
+    pstRoi->u32Errors = 0;
+}
+
+void EncoderRoi_Update(EncoderRoi_t *pstRoi, const cvtdl_face_t *pstFaceMeta) {
+    const EncoderRoiConfig_t *pstConfig = &pstRoi->stConfig;
+    if (!pstConfig->bEnabled) {
+        if (pstRoi->bDirty) {
+            EncoderRoi_Cleanup(pstRoi);
+        }
+        return;
+    }
+
+    RECT_S astFace[ENCODER_ROI_MAX_FACES];
+    uint32_t u32Faces = 0;
+    for (uint32_t i = 0; pstFaceMeta && i < pstFaceMeta->size && u32Faces < ENCODER_ROI_MAX_FACES; i++) {
+        u32Faces += EncoderRoi_FaceRect(pstRoi, &pstFaceMeta->info[i].bbox, &astFace[u32Faces]);
+    }
+    bool bBackground = pstConfig->s32BackgroundQp != 0;
+    uint32_t u32First = bBackground ? 1 : 0;
+    uint32_t u32Regions = EncoderRoi_Merge(astFace, u32Faces, VENC_MAX_ROI_NUM - u32First);
+
+    pstRoi->bRetry = false;
+    if (bBackground) {
+        RECT_S stFrame = {0, 0, pstRoi->stSize.u32Width, pstRoi->stSize.u32Height};
+        EncoderRoi_Set(pstRoi, 0, true, &stFrame, pstConfig->s32BackgroundQp);
+    }
+    for (uint32_t i = u32First; i < VENC_MAX_ROI_NUM; i++) {
+        bool bFace = i - u32First < u32Regions;
+        EncoderRoi_Set(pstRoi, i, bFace, bFace ? &astFace[i - u32First] : NULL, pstConfig->s32FaceQp);
+    }
+    EncoderRoi_SetBackgroundFps(pstRoi, pstConfig->u32BackgroundFps);
+    pstRoi->bDirty = pstRoi->bRetry;
+
+    pstRoi->u32Frames++;
+    pstRoi->u32FaceFrames += u32Faces > 0;
+    pstRoi->u32MergedFrames += u32Regions < u32Faces;
+    pstRoi->u64Regions += u32Regions;
+    for (uint32_t i = 0; i < u32Regions; i++) {
+        pstRoi->u64RegionArea += EncoderRoi_Area(&astFace[i]);
+    }
+    if (pstRoi->u32Frames >= ENCODER_ROI_REPORT_FRAMES) {
+        EncoderRoi_Report(pstRoi);
+    }
+}
+
+void EncoderRoi_Cleanup(EncoderRoi_t *pstRoi) {
+    // only what VENC holds
+    pstRoi->bDirty = false;
+    pstRoi->bRetry = false;
+    for (uint32_t i = 0; i < VENC_MAX_ROI_NUM; i++) {
+        EncoderRoi_Set(pstRoi, i, false, NULL, 0);
+    }
+    EncoderRoi_SetBackgroundFps(pstRoi, 0);
+    pstRoi->bDirty = pstRoi->bRetry;
+}
@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "face_gallery.h"
+
+static uint64_t FaceGallery_NowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static uint64_t FaceGallery_AlignUp(uint64_t u64Value, uint64_t u64Align) {
+    return (u64Value + u64Align - 1) / u64Align * u64Align;
+}
+
+float FaceGallery_Norm(const int8_t *ps8Feature, uint32_t u32Dim) {
+    int32_t s32Sum = 0;
+    for (uint32_t i = 0; i < u32Dim; i++) {
+        s32Sum += (int32_t)ps8Feature[i] * ps8Feature[i];
+    }
+    return sqrtf((float)s32Sum);
+}
+
+// Header of an empty gallery with room for u32Capacity rows
+static void FaceGallery_Layout(FaceGalleryHeader_t *pstHeader, uint32_t u32Dim, uint32_t u32Capacity) {
+    std::memset(pstHeader, 0, sizeof(FaceGalleryHeader_t));
+    pstHeader->u32Magic = FACE_GALLERY_MAGIC;
+    pstHeader->u32Version = FACE_GALLERY_VERSION;
+    pstHeader->u32Dim = u32Dim;
+    pstHeader->u32Stride = (uint32_t)FaceGallery_AlignUp(u32Dim, FACE_GALLERY_ALIGN);
+    pstHeader->u32Capacity = u32Capacity;
+    pstHeader->u32NextId = 1;
+    pstHeader->u32NameLen = FACE_GALLERY_NAME_LEN;
+    pstHeader->u64FeatureOffset = FACE_GALLERY_HEADER_SIZE;
+    pstHeader->u64NormOffset = FaceGallery_AlignUp(pstHeader->u64FeatureOffset +
+                                                   (uint64_t)u32Capacity * pstHeader->u32Stride, FACE_GALLERY_ALIGN);
+    pstHeader->u64SlotOffset = FaceGallery_AlignUp(pstHeader->u64NormOffset + (uint64_t)u32Capacity * sizeof(float),
+                                                   FACE_GALLERY_ALIGN);
+    pstHeader->u64FileSize = FaceGallery_AlignUp(pstHeader->u64SlotOffset +
+                                                 (uint64_t)u32Capacity * sizeof(FaceGallerySlot_t),
+                                                 FACE_GALLERY_HEADER_SIZE);
+}
+
+// Point the section pointers into the mapping
+static void FaceGallery_Attach(FaceGallery_t *pstGallery, uint8_t *pu8Map, size_t mapSize) {
+    pstGallery->pu8Map = pu8Map;
+    pstGallery->mapSize = mapSize;
+    pstGallery->pstHeader = (FaceGalleryHeader_t *)pu8Map;
+    pstGallery->ps8Features = (int8_t *)(pu8Map + pstGallery->pstHeader->u64FeatureOffset);
+    pstGallery->pfNorm = (float *)(pu8Map + pstGallery->pstHeader->u64NormOffset);
+    pstGallery->pstSlots = (FaceGallerySlot_t *)(pu8Map + pstGallery->pstHeader->u64SlotOffset);
+    pstGallery->u32Dim = pstGallery->pstHeader->u32Dim;
+    pstGallery->u32Stride = pstGallery->pstHeader->u32Stride;
+    pstGallery->u32Count = pstGallery->pstHeader->u32Count;
+    pstGallery->u32Capacity = pstGallery->pstHeader->u32Capacity;
+}
+
+static bool FaceGallery_Valid(const FaceGalleryHeader_t *pstHeader, size_t fileSize, uint32_t u32Dim) {
+    FaceGalleryHeader_t stExpected;
+    FaceGallery_Layout(&stExpected, u32Dim, pstHeader->u32Capacity);
+    return pstHeader->u32Magic == FACE_GALLERY_MAGIC && pstHeader->u32Version == FACE_GALLERY_VERSION &&
+           pstHeader->u32Dim == u32Dim && pstHeader->u32NameLen == FACE_GALLERY_NAME_LEN &&
+           pstHeader->u64FeatureOffset == stExpected.u64FeatureOffset &&
+           pstHeader->u64NormOffset == stExpected.u64NormOffset &&
+           pstHeader->u64SlotOffset == stExpected.u64SlotOffset &&
+           pstHeader->u64FileSize == stExpected.u64FileSize && pstHeader->u64FileSize <= fileSize &&
+           pstHeader->u32Count <= pstHeader->u32Capacity && pstHeader->u32Live <= pstHeader->u32Count;
+}
+
+CVI_S32 FaceGallery_Init(FaceGallery_t *pstGallery, uint32_t u32Dim) {
+    std::memset(pstGallery, 0, sizeof(FaceGallery_t));
+    pstGallery->s32Fd = -1;
+    FaceGalleryHeader_t stHeader;
+    FaceGallery_Layout(&stHeader, u32Dim, FACE_GALLERY_INITIAL_CAPACITY);
+    void *pMap = mmap(NULL, stHeader.u64FileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pMap == MAP_FAILED) {
+        return CVI_FAILURE;
+    }
+    std::memcpy(pMap, &stHeader, sizeof(stHeader));
+    FaceGallery_Attach(pstGallery, (uint8_t *)pMap, stHeader.u64FileSize);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceGallery_Open(FaceGallery_t *pstGallery, const char *path, uint32_t u32Dim, bool bCreate) {
+    std::memset(pstGallery, 0, sizeof(FaceGallery_t));
+    pstGallery->s32Fd = -1;
+    int s32Fd = open(path, O_RDWR | (bCreate ? O_CREAT : 0), 0644);
+    if (s32Fd < 0) {
+        if (errno != ENOENT) {
+            std::cerr << "Failed to open gallery " << path << ": " << strerror(errno) << std::endl;
+        }
+        return CVI_FAILURE;
+    }
+    struct stat st;
+    if (fstat(s32Fd, &st) != 0) {
+        close(s32Fd);
+        return CVI_FAILURE;
+    }
+    if (st.st_size == 0) {
+        // new file: write the empty layout, the sections stay sparse until used
+        FaceGalleryHeader_t stHeader;
+        FaceGallery_Layout(&stHeader, u32Dim, FACE_GALLERY_INITIAL_CAPACITY);
+        if (ftruncate(s32Fd, stHeader.u64FileSize) != 0 ||
+            pwrite(s32Fd, &stHeader, sizeof(stHeader), 0) != (ssize_t)sizeof(stHeader)) {
+            std::cerr << "Failed to create gallery " << path << ": " << strerror(errno) << std::endl;
+            close(s32Fd);
+            return CVI_FAILURE;
+        }
+        st.st_size = stHeader.u64FileSize;
+    }
+
+    FaceGalleryHeader_t stHeader;
+    if (pread(s32Fd, &stHeader, sizeof(stHeader), 0) != (ssize_t)sizeof(stHeader) ||
+        !FaceGallery_Valid(&stHeader, st.st_size, u32Dim)) {
+        std::cerr << "Gallery " << path << " is not a " << u32Dim << "-byte feature gallery" << std::endl;
+        close(s32Fd);
+        return CVI_FAILURE;
+    }
+    void *pMap = mmap(NULL, stHeader.u64FileSize, PROT_READ | PROT_WRITE, MAP_SHARED, s32Fd, 0);
+    if (pMap == MAP_FAILED) {
+        std::cerr << "Failed to map gallery " << path << ": " << strerror(errno) << std::endl;
+        close(s32Fd);
+        return CVI_FAILURE;
+    }
+    // the matcher streams the used rows, start reading them in the background
+    madvise(pMap, stHeader.u64FeatureOffset + (uint64_t)stHeader.u32Count * stHeader.u32Stride, MADV_WILLNEED);
+
+    pstGallery->s32Fd = s32Fd;
+    snprintf(pstGallery->szPath, sizeof(pstGallery->szPath), "%s", path);
+    FaceGallery_Attach(pstGallery, (uint8_t *)pMap, stHeader.u64FileSize);
+    return CVI_SUCCESS;
+}
+
+void FaceGallery_Close(FaceGallery_t *pstGallery) {
+    if (pstGallery->pu8Map) {
+        if (pstGallery->s32Fd >= 0) {
+            msync(pstGallery->pu8Map, pstGallery->mapSize, MS_SYNC);
+        }
+        munmap(pstGallery->pu8Map, pstGallery->mapSize);
+    }
+    if (pstGallery->s32Fd >= 0) {
+        close(pstGallery->s32Fd);
+    }
+    std::memset(pstGallery, 0, sizeof(FaceGallery_t));
+    pstGallery->s32Fd = -1;
+}
+
+// Move every section to a layout with twice the rows. A file is rebuilt next
+// to the old one and renamed over it, so a crash leaves one of the two intact.
+static CVI_S32 FaceGallery_Grow(FaceGallery_t *pstGallery) {
+    const FaceGalleryHeader_t *pstOld = pstGallery->pstHeader;
+    FaceGalleryHeader_t stHeader;
+    FaceGallery_Layout(&stHeader, pstOld->u32Dim, pstOld->u32Capacity * 2);
+    stHeader.u32Count = pstOld->u32Count;
+    stHeader.u32Live = pstOld->u32Live;
+    stHeader.u32FreeHead = pstOld->u32FreeHead;
+    stHeader.u32NextId = pstOld->u32NextId;
+
+    int s32Fd = -1;
+    std::string tmpPath = std::string(pstGallery->szPath) + ".tmp";
+    void *pMap;
+    if (pstGallery->s32Fd >= 0) {
+        s32Fd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (s32Fd < 0 || ftruncate(s32Fd, stHeader.u64FileSize) != 0) {
+            std::cerr << "Failed to grow gallery " << pstGallery->szPath << ": " << strerror(errno) << std::endl;
+            if (s32Fd >= 0) {
+                close(s32Fd);
+                unlink(tmpPath.c_str());
+            }
+            return CVI_FAILURE;
+        }
+        pMap = mmap(NULL, stHeader.u64FileSize, PROT_READ | PROT_WRITE, MAP_SHARED, s32Fd, 0);
+    } else {
+        pMap = mmap(NULL, stHeader.u64FileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (pMap == MAP_FAILED) {
+        if (s32Fd >= 0) {
+            close(s32Fd);
+            unlink(tmpPath.c_str());
+        }
+        return CVI_FAILURE;
+    }
+
+    uint8_t *pu8Map = (uint8_t *)pMap;
+    std::memcpy(pu8Map, &stHeader, sizeof(stHeader));
+    std::memcpy(pu8Map + stHeader.u64FeatureOffset, pstGallery->ps8Features,
+                (size_t)stHeader.u32Count * stHeader.u32Stride);
+    std::memcpy(pu8Map + stHeader.u64NormOffset, pstGallery->pfNorm, sizeof(float) * stHeader.u32Count);
+    std::memcpy(pu8Map + stHeader.u64SlotOffset, pstGallery->pstSlots,
+                sizeof(FaceGallerySlot_t) * stHeader.u32Count);
+
+    if (s32Fd >= 0) {
+        if (msync(pMap, stHeader.u64FileSize, MS_SYNC) != 0 || rename(tmpPath.c_str(), pstGallery->szPath) != 0) {
+            std::cerr << "Failed to replace gallery " << pstGallery->szPath << ": " << strerror(errno) << std::endl;
+            munmap(pMap, stHeader.u64FileSize);
+            close(s32Fd);
+            unlink(tmpPath.c_str());
+            return CVI_FAILURE;
+        }
+        close(pstGallery->s32Fd);
+        pstGallery->s32Fd = s32Fd;
+    }
+    munmap(pstGallery->pu8Map, pstGallery->mapSize);
+    FaceGallery_Attach(pstGallery, pu8Map, stHeader.u64FileSize);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceGallery_Add(FaceGallery_t *pstGallery, const int8_t *ps8Feature, const char *name,
+                        uint32_t *pu32Id) {
+    FaceGalleryHeader_t *pstHeader = pstGallery->pstHeader;
+    if (!pstHeader || !ps8Feature) {
+        return CVI_FAILURE;
+    }
+    if (pstHeader->u32FreeHead == 0 && pstHeader->u32Count == pstHeader->u32Capacity) {
+        if (FaceGallery_Grow(pstGallery) != CVI_SUCCESS) {
+            return CVI_FAILURE;
+        }
+        pstHeader = pstGallery->pstHeader;
+    }
+
+    uint32_t u32Row;
+    bool bReused = pstHeader->u32FreeHead != 0;
+    if (bReused) {
+        u32Row = pstHeader->u32FreeHead - 1;
+    } else {
+        u32Row = pstHeader->u32Count;
+    }
+
+    // fill the row first, then link it in through the slot and the header
+    int8_t *ps8Row = pstGallery->ps8Features + (size_t)u32Row * pstGallery->u32Stride;
+    std::memcpy(ps8Row, ps8Feature, pstGallery->u32Dim);
+    std::memset(ps8Row + pstGallery->u32Dim, 0, pstGallery->u32Stride - pstGallery->u32Dim);
+    FaceGallerySlot_t *pstSlot = &pstGallery->pstSlots[u32Row];
+    uint32_t u32NextFree = pstSlot->u32NextFree;
+    snprintf(pstSlot->szName, sizeof(pstSlot->szName), "%s", name ? name : "");
+    pstSlot->u32NextFree = 0;
+    pstSlot->u32Id = pstHeader->u32NextId++;
+    pstGallery->pfNorm[u32Row] = FaceGallery_Norm(ps8Feature, pstGallery->u32Dim);
+
+    if (bReused) {
+        pstHeader->u32FreeHead = u32NextFree;
+    } else {
+        pstHeader->u32Count++;
+    }
+    pstHeader->u32Live++;
+    pstGallery->u32Count = pstHeader->u32Count;
+    if (pu32Id) {
+        *pu32Id = pstSlot->u32Id;
+    }
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceGallery_Remove(FaceGallery_t *pstGallery, uint32_t u32Id) {
+    FaceGalleryHeader_t *pstHeader = pstGallery->pstHeader;
+    if (!pstHeader || u32Id == 0) {
+        return CVI_FAILURE;
+    }
+    for (uint32_t i = 0; i < pstHeader->u32Count; i++) {
+        FaceGallerySlot_t *pstSlot = &pstGallery->pstSlots[i];
+        if (pstSlot->u32Id != u32Id) {
+            continue;
+        }
+        // a zero norm keeps the row out of every match before it is unlinked
+        pstGallery->pfNorm[i] = 0.0f;
+        std::memset(pstGallery->ps8Features + (size_t)i * pstGallery->u32Stride, 0, pstGallery->u32Stride);
+        std::memset(pstSlot->szName, 0, sizeof(pstSlot->szName));
+        pstSlot->u32Id = 0;
+        pstSlot->u32NextFree = pstHeader->u32FreeHead;
+        pstHeader->u32FreeHead = i + 1;
+        pstHeader->u32Live--;
+        return CVI_SUCCESS;
+    }
+    return CVI_FAILURE;
+}
+
+int FaceGallery_ImportDir(FaceGallery_t *pstGallery, const char *szDir, uint32_t *pu32Sdk) {
+    DIR *pDir = opendir(szDir);
+    if (!pDir) {
+        return -1;
+    }
+    std::vector<std::string> files;
+    struct dirent *pstEntry;
+    while ((pstEntry = readdir(pDir)) != NULL) {
+        if (pstEntry->d_name[0] != '.') {
+            files.push_back(pstEntry->d_name);
+        }
+    }
+    closedir(pDir);
+    std::sort(files.begin(), files.end());
+
+    std::vector<int8_t> feature(pstGallery->u32Dim);
+    int s32Added = 0;
+    uint32_t u32Sdk = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        std::string path = std::string(szDir) + "/" + files[i];
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        if (st.st_size == FACE_GALLERY_SDK_FEATURE_SIZE && pstGallery->u32Dim != FACE_GALLERY_SDK_FEATURE_SIZE) {
+            if (u32Sdk++ == 0) {
+                std::cerr << "Skipping " << path << ": a " << FACE_GALLERY_SDK_FEATURE_SIZE
+                          << "-byte SDK feature, which cannot be matched with " << pstGallery->u32Dim
+                          << "-byte embeddings" << std::endl;
+            }
+            continue;
+        }
+        if ((uint64_t)st.st_size != pstGallery->u32Dim) {
+            std::cerr << "Skipping " << path << ": " << st.st_size << " bytes, expected "
+                      << pstGallery->u32Dim << std::endl;
+            continue;
+        }
+        FILE *fp = fopen(path.c_str(), "rb");
+        if (!fp) {
+            continue;
+        }
+        size_t read = fread(feature.data(), 1, feature.size(), fp);
+        fclose(fp);
+        if (read != feature.size()) {
+            continue;
+        }
+        std::string name = files[i].substr(0, files[i].rfind('.'));
+        if (FaceGallery_Add(pstGallery, feature.data(), name.c_str(), NULL) != CVI_SUCCESS) {
+            break;
+        }
+        s32Added++;
+    }
+    if (pu32Sdk) {
+        *pu32Sdk = u32Sdk;
+    }
+    return s32Added;
+}
+
+CVI_S32 FaceGallery_Benchmark(uint32_t u32Identities, uint32_t u32Dim) {
+    const char *path = "gallery_bench.db";
+    unlink(path);
+    FaceGallery_t stGallery;
+    if (u32Identities == 0 || FaceGallery_Open(&stGallery, path, u32Dim, true) != CVI_SUCCESS) {
+        return CVI_FAILURE;
+    }
+
+    srand(1);
+    std::vector<int8_t> feature(u32Dim);
+    char name[FACE_GALLERY_NAME_LEN];
+    CVI_S32 s32Ret = CVI_SUCCESS;
+    uint64_t u64Start = FaceGallery_NowUs();
+    for (uint32_t i = 0; i < u32Identities && s32Ret == CVI_SUCCESS; i++) {
+        for (uint32_t d = 0; d < u32Dim; d++) {
+            feature[d] = (int8_t)(rand() % 255 - 127);
+        }
+        snprintf(name, sizeof(name), "person_%u", i);
+        s32Ret = FaceGallery_Add(&stGallery, feature.data(), name, NULL);
+    }
+    uint64_t u64EnrollUs = FaceGallery_NowUs() - u64Start;
+    FaceGallery_Close(&stGallery);
+
+    u64Start = FaceGallery_NowUs();
+    s32Ret = s32Ret == CVI_SUCCESS ? FaceGallery_Open(&stGallery, path, u32Dim, false) : s32Ret;
+    uint64_t u64OpenUs = FaceGallery_NowUs() - u64Start;
+    if (s32Ret != CVI_SUCCESS) {
+        unlink(path);
+        return s32Ret;
+    }
+    uint32_t u32Capacity = stGallery.u32Capacity;
+
+    // delete every 10th identity, then enroll as many again: rows are reused
+    uint32_t u32Removed = 0;
+    u64Start = FaceGallery_NowUs();
+    for (uint32_t u32Id = 1; u32Id <= u32Identities; u32Id += 10) {
+        if (FaceGallery_Remove(&stGallery, u32Id) == CVI_SUCCESS) {
+            u32Removed++;
+        }
+    }
+    uint64_t u64RemoveUs = FaceGallery_NowUs() - u64Start;
+    u64Start = FaceGallery_NowUs();
+    for (uint32_t i = 0; i < u32Removed && s32Ret == CVI_SUCCESS; i++) {
+        snprintf(name, sizeof(name), "returning_%u", i);
+        s32Ret = FaceGallery_Add(&stGallery, feature.data(), name, NULL);
+    }
+    uint64_t u64ReaddUs = FaceGallery_NowUs() - u64Start;
+    bool bReused = stGallery.u32Count == u32Identities && stGallery.u32Capacity == u32Capacity;
+    uint32_t u32Live = FaceGallery_Live(&stGallery);
+    size_t fileSize = stGallery.mapSize;
+    FaceGallery_Close(&stGallery);
+    unlink(path);
+
+    std::cout << "=== Gallery Benchmark ===" << std::endl;
+    std::cout << "Identities: " << u32Identities << ", dim: " << u32Dim << ", file: "
+              << fileSize / 1024 << " KB" << std::endl;
+    std::cout << "Enroll: " << u64EnrollUs / 1000.0 << " ms (" << (double)u64EnrollUs / u32Identities
+              << " us/identity)" << std::endl;
+    std::cout << "Open: " << u64OpenUs / 1000.0 << " ms" << std::endl;
+    std::cout << "Delete " << u32Removed << ": " << u64RemoveUs / 1000.0 << " ms, re-enroll: "
+              << u64ReaddUs / 1000.0 << " ms, rows reused: " << (bReused ? "yes" : "no")
+              << ", live: " << u32Live << std::endl;
+    std::cout << "=========================" << std::endl;
+    return s32Ret == CVI_SUCCESS && bReused ? CVI_SUCCESS : CVI_FAILURE;
+}
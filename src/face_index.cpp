@@ -0,0 +1,722 @@
+#include <algorithm>
+#include <iostream>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/time.h>
+#include <unistd.h>
+#include "face_index.h"
+
+// Bounds of the per-query scratch
+#define FACE_INDEX_MAX_SUBQUANTIZERS 32
+#define FACE_INDEX_MAX_RERANK 256
+// Rows sampled to train the coarse centroids, per list
+#define FACE_INDEX_TRAIN_PER_LIST 40
+// Rows sampled to train the PQ codebooks
+#define FACE_INDEX_TRAIN_PQ (32 * FACE_INDEX_PQ_CODES)
+#define FACE_INDEX_NO_LIST UINT32_MAX
+
+typedef struct {
+    uint32_t u32Magic;
+    uint32_t u32Version;
+    uint32_t u32Dim;
+    uint32_t u32Lists;
+    uint32_t u32Mode;
+    uint32_t u32SubQuantizers;
+    uint32_t u32Rows;           // gallery rows covered, one record each
+    uint32_t u32Reserved;
+} FaceIndexFileHeader_t;
+
+static uint64_t FaceIndex_NowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+void FaceIndex_DefaultConfig(FaceIndexConfig_t *pstConfig) {
+    pstConfig->u32Lists = 0;
+    pstConfig->u32Probes = 16;
+    pstConfig->u32SubQuantizers = 16;
+    pstConfig->u32Rerank = 64;
+    pstConfig->u32MemCapKB = FACE_INDEX_MEM_CAP_KB;
+}
+
+static float FaceIndex_DotF(const float *pfA, const float *pfB, uint32_t n) {
+    float fSum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        fSum += pfA[i] * pfB[i];
+    }
+    return fSum;
+}
+
+static float FaceIndex_L2F(const float *pfA, const float *pfB, uint32_t n) {
+    float fSum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        float d = pfA[i] - pfB[i];
+        fSum += d * d;
+    }
+    return fSum;
+}
+
+static void FaceIndex_ToFloat(const int8_t *ps8Row, uint32_t u32Dim, float *pfOut) {
+    for (uint32_t d = 0; d < u32Dim; d++) {
+        pfOut[d] = ps8Row[d];
+    }
+}
+
+static void FaceIndex_Normalize(float *pfVec, uint32_t u32Dim) {
+    float fNorm = sqrtf(FaceIndex_DotF(pfVec, pfVec, u32Dim));
+    if (fNorm > 0.0f) {
+        for (uint32_t d = 0; d < u32Dim; d++) {
+            pfVec[d] /= fNorm;
+        }
+    }
+}
+
+// Closest of u32Count centers: largest inner product with unit centers
+// (bSpherical) or smallest squared distance
+static uint32_t FaceIndex_Nearest(const float *pfVec, const float *pfCenters, uint32_t u32Count,
+                                  uint32_t u32Dim, bool bSpherical) {
+    uint32_t u32Best = 0;
+    float fBest = bSpherical ? -FLT_MAX : FLT_MAX;
+    for (uint32_t c = 0; c < u32Count; c++) {
+        const float *pfCenter = pfCenters + (size_t)c * u32Dim;
+        float fValue = bSpherical ? FaceIndex_DotF(pfVec, pfCenter, u32Dim) : FaceIndex_L2F(pfVec, pfCenter, u32Dim);
+        if (bSpherical ? fValue > fBest : fValue < fBest) {
+            fBest = fValue;
+            u32Best = c;
+        }
+    }
+    return u32Best;
+}
+
+// Lloyd's k-means over u32Count vectors with a fixed seed. Spherical
+// k-means keeps the centers at unit length (cosine clustering).
+static void FaceIndex_KMeans(const float *pfData, uint32_t u32Count, uint32_t u32Dim, uint32_t u32K,
+                             bool bSpherical, float *pfCenters) {
+    for (uint32_t c = 0; c < u32K; c++) {
+        std::memcpy(pfCenters + (size_t)c * u32Dim, pfData + (size_t)((uint64_t)c * u32Count / u32K) * u32Dim,
+                    sizeof(float) * u32Dim);
+    }
+    std::vector<uint32_t> assign(u32Count);
+    std::vector<float> sums((size_t)u32K * u32Dim);
+    std::vector<uint32_t> sizes(u32K);
+    uint32_t u32Seed = 12345;
+    for (int iter = 0; iter < FACE_INDEX_KMEANS_ITERS; iter++) {
+        std::fill(sums.begin(), sums.end(), 0.0f);
+        std::fill(sizes.begin(), sizes.end(), 0);
+        for (uint32_t i = 0; i < u32Count; i++) {
+            const float *pfVec = pfData + (size_t)i * u32Dim;
+            assign[i] = FaceIndex_Nearest(pfVec, pfCenters, u32K, u32Dim, bSpherical);
+            float *pfSum = &sums[(size_t)assign[i] * u32Dim];
+            for (uint32_t d = 0; d < u32Dim; d++) {
+                pfSum[d] += pfVec[d];
+            }
+            sizes[assign[i]]++;
+        }
+        for (uint32_t c = 0; c < u32K; c++) {
+            float *pfCenter = pfCenters + (size_t)c * u32Dim;
+            if (sizes[c] == 0) {
+                // empty cluster: restart it on some other vector
+                u32Seed = u32Seed * 1103515245u + 12345u;
+                std::memcpy(pfCenter, pfData + (size_t)(u32Seed % u32Count) * u32Dim, sizeof(float) * u32Dim);
+            } else {
+                for (uint32_t d = 0; d < u32Dim; d++) {
+                    pfCenter[d] = sums[(size_t)c * u32Dim + d] / sizes[c];
+                }
+            }
+            if (bSpherical) {
+                FaceIndex_Normalize(pfCenter, u32Dim);
+            }
+        }
+    }
+}
+
+static uint32_t FaceIndex_SubDim(const FaceIndex_t *pstIndex) {
+    return pstIndex->u32Dim / pstIndex->stConfig.u32SubQuantizers;
+}
+
+static void FaceIndex_Encode(const FaceIndex_t *pstIndex, const float *pfRow, uint8_t *pu8Codes) {
+    uint32_t u32M = pstIndex->stConfig.u32SubQuantizers;
+    uint32_t u32Sub = FaceIndex_SubDim(pstIndex);
+    for (uint32_t m = 0; m < u32M; m++) {
+        const float *pfBook = &pstIndex->codebooks[(size_t)m * FACE_INDEX_PQ_CODES * u32Sub];
+        pu8Codes[m] = (uint8_t)FaceIndex_Nearest(pfRow + m * u32Sub, pfBook, FACE_INDEX_PQ_CODES, u32Sub, false);
+    }
+}
+
+static size_t FaceIndex_Estimate(FaceIndexMode_t enMode, uint32_t u32Rows, uint32_t u32Lists, uint32_t u32Dim,
+                                 uint32_t u32Stride, uint32_t u32M) {
+    size_t bytes = (size_t)u32Lists * u32Dim * sizeof(float) + (size_t)u32Rows * 2 * sizeof(uint32_t);
+    if (enMode == FACE_INDEX_FLAT) {
+        return bytes + (size_t)u32Rows * u32Stride;
+    }
+    return bytes + (size_t)u32Rows * u32M + (size_t)FACE_INDEX_PQ_CODES * u32Dim * sizeof(float);
+}
+
+// Lists, mode and PQ size for u32Rows within the memory cap
+static CVI_S32 FaceIndex_Plan(FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, uint32_t u32Rows) {
+    FaceIndexConfig_t *pstConfig = &pstIndex->stConfig;
+    pstIndex->u32Dim = pstGallery->u32Dim;
+    pstIndex->u32Lists = pstConfig->u32Lists ? pstConfig->u32Lists : (uint32_t)sqrtf((float)u32Rows);
+    pstIndex->u32Lists = std::max<uint32_t>(1, std::min(pstIndex->u32Lists, u32Rows));
+    pstConfig->u32Probes = std::max<uint32_t>(1, std::min(pstConfig->u32Probes, pstIndex->u32Lists));
+    pstConfig->u32Rerank = std::max<uint32_t>(1, std::min<uint32_t>(pstConfig->u32Rerank, FACE_INDEX_MAX_RERANK));
+
+    size_t cap = (size_t)pstConfig->u32MemCapKB * 1024;
+    pstIndex->enMode = FACE_INDEX_FLAT;
+    if (cap == 0 || FaceIndex_Estimate(FACE_INDEX_FLAT, u32Rows, pstIndex->u32Lists, pstGallery->u32Dim,
+                                       pstGallery->u32Stride, 0) <= cap) {
+        return CVI_SUCCESS;
+    }
+    pstIndex->enMode = FACE_INDEX_PQ;
+    uint32_t u32M = std::min<uint32_t>(pstConfig->u32SubQuantizers, FACE_INDEX_MAX_SUBQUANTIZERS);
+    while (u32M > 1 && (pstGallery->u32Dim % u32M != 0 ||
+                        FaceIndex_Estimate(FACE_INDEX_PQ, u32Rows, pstIndex->u32Lists, pstGallery->u32Dim,
+                                           pstGallery->u32Stride, u32M) > cap)) {
+        u32M--;
+    }
+    pstConfig->u32SubQuantizers = u32M;
+    if (FaceIndex_Estimate(FACE_INDEX_PQ, u32Rows, pstIndex->u32Lists, pstGallery->u32Dim,
+                           pstGallery->u32Stride, u32M) > cap) {
+        std::cerr << "Face index for " << u32Rows << " rows does not fit " << pstConfig->u32MemCapKB
+                  << " KB" << std::endl;
+        return CVI_FAILURE;
+    }
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceIndex_Build(FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, const FaceIndexConfig_t *pstConfig) {
+    std::vector<uint32_t> live;
+    for (uint32_t r = 0; r < pstGallery->u32Count; r++) {
+        if (pstGallery->pfNorm[r] > 0.0f) {
+            live.push_back(r);
+        }
+    }
+    if (live.empty()) {
+        return CVI_FAILURE;
+    }
+    pstIndex->stConfig = *pstConfig;
+    if (FaceIndex_Plan(pstIndex, pstGallery, (uint32_t)live.size()) != CVI_SUCCESS) {
+        return CVI_FAILURE;
+    }
+    const uint32_t u32Dim = pstIndex->u32Dim;
+
+    // coarse centroids on an evenly spread sample of unit-length rows
+    uint32_t u32Train = std::min<uint32_t>((uint32_t)live.size(), pstIndex->u32Lists * FACE_INDEX_TRAIN_PER_LIST);
+    std::vector<float> sample((size_t)u32Train * u32Dim);
+    for (uint32_t i = 0; i < u32Train; i++) {
+        uint32_t r = live[(size_t)((uint64_t)i * live.size() / u32Train)];
+        FaceIndex_ToFloat(FaceGallery_Row(pstGallery, r), u32Dim, &sample[(size_t)i * u32Dim]);
+        FaceIndex_Normalize(&sample[(size_t)i * u32Dim], u32Dim);
+    }
+    pstIndex->centroids.assign((size_t)pstIndex->u32Lists * u32Dim, 0.0f);
+    FaceIndex_KMeans(sample.data(), u32Train, u32Dim, pstIndex->u32Lists, true, pstIndex->centroids.data());
+
+    // PQ codebooks on the raw rows, one k-means per subspace
+    pstIndex->codebooks.clear();
+    if (pstIndex->enMode == FACE_INDEX_PQ) {
+        uint32_t u32M = pstIndex->stConfig.u32SubQuantizers;
+        uint32_t u32Sub = FaceIndex_SubDim(pstIndex);
+        uint32_t u32PqTrain = std::min<uint32_t>((uint32_t)live.size(), FACE_INDEX_TRAIN_PQ);
+        u32PqTrain = std::max<uint32_t>(u32PqTrain, std::min<uint32_t>((uint32_t)live.size(), FACE_INDEX_PQ_CODES));
+        std::vector<float> rows((size_t)u32PqTrain * u32Dim);
+        for (uint32_t i = 0; i < u32PqTrain; i++) {
+            uint32_t r = live[(size_t)((uint64_t)i * live.size() / u32PqTrain)];
+            FaceIndex_ToFloat(FaceGallery_Row(pstGallery, r), u32Dim, &rows[(size_t)i * u32Dim]);
+        }
+        pstIndex->codebooks.assign((size_t)u32M * FACE_INDEX_PQ_CODES * u32Sub, 0.0f);
+        std::vector<float> subspace((size_t)u32PqTrain * u32Sub);
+        for (uint32_t m = 0; m < u32M; m++) {
+            for (uint32_t i = 0; i < u32PqTrain; i++) {
+                std::memcpy(&subspace[(size_t)i * u32Sub], &rows[(size_t)i * u32Dim + m * u32Sub],
+                            sizeof(float) * u32Sub);
+            }
+            uint32_t u32K = std::min<uint32_t>(FACE_INDEX_PQ_CODES, u32PqTrain);
+            FaceIndex_KMeans(subspace.data(), u32PqTrain, u32Sub, u32K, false,
+                             &pstIndex->codebooks[(size_t)m * FACE_INDEX_PQ_CODES * u32Sub]);
+            // unused codewords when there are fewer training rows than codes
+            for (uint32_t c = u32K; c < FACE_INDEX_PQ_CODES; c++) {
+                float *pfCode = &pstIndex->codebooks[((size_t)m * FACE_INDEX_PQ_CODES + c) * u32Sub];
+                std::fill(pfCode, pfCode + u32Sub, FLT_MAX / 4);
+            }
+        }
+    }
+
+    pstIndex->lists.assign(pstIndex->u32Lists, FaceIndexList_t());
+    pstIndex->rowList.assign(pstGallery->u32Count, FACE_INDEX_NO_LIST);
+    pstIndex->u32Rows = 0;
+    for (size_t i = 0; i < live.size(); i++) {
+        FaceIndex_Insert(pstIndex, pstGallery, live[i]);
+    }
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceIndex_Insert(FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, uint32_t u32Row) {
+    if (u32Row >= pstGallery->u32Count || pstGallery->pfNorm[u32Row] == 0.0f || pstIndex->lists.empty()) {
+        return CVI_FAILURE;
+    }
+    if (u32Row >= pstIndex->rowList.size()) {
+        pstIndex->rowList.resize(pstGallery->u32Count, FACE_INDEX_NO_LIST);
+    }
+    if (pstIndex->rowList[u32Row] != FACE_INDEX_NO_LIST) {
+        FaceIndex_Remove(pstIndex, u32Row);
+    }
+    float afRow[FACE_MATCHER_MAX_DIM];
+    float afUnit[FACE_MATCHER_MAX_DIM];
+    FaceIndex_ToFloat(FaceGallery_Row(pstGallery, u32Row), pstIndex->u32Dim, afRow);
+    std::memcpy(afUnit, afRow, sizeof(float) * pstIndex->u32Dim);
+    FaceIndex_Normalize(afUnit, pstIndex->u32Dim);
+    uint32_t u32List = FaceIndex_Nearest(afUnit, pstIndex->centroids.data(), pstIndex->u32Lists,
+                                         pstIndex->u32Dim, true);
+
+    FaceIndexList_t *pstList = &pstIndex->lists[u32List];
+    pstList->rows.push_back(u32Row);
+    if (pstIndex->enMode == FACE_INDEX_PQ) {
+        uint8_t au8Codes[FACE_INDEX_MAX_SUBQUANTIZERS];
+        FaceIndex_Encode(pstIndex, afRow, au8Codes);
+        pstList->codes.insert(pstList->codes.end(), au8Codes, au8Codes + pstIndex->stConfig.u32SubQuantizers);
+    }
+    pstIndex->rowList[u32Row] = u32List;
+    pstIndex->u32Rows++;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceIndex_Remove(FaceIndex_t *pstIndex, uint32_t u32Row) {
+    if (u32Row >= pstIndex->rowList.size() || pstIndex->rowList[u32Row] == FACE_INDEX_NO_LIST) {
+        return CVI_FAILURE;
+    }
+    FaceIndexList_t *pstList = &pstIndex->lists[pstIndex->rowList[u32Row]];
+    size_t pos = std::find(pstList->rows.begin(), pstList->rows.end(), u32Row) - pstList->rows.begin();
+    size_t last = pstList->rows.size() - 1;
+    uint32_t u32M = pstIndex->enMode == FACE_INDEX_PQ ? pstIndex->stConfig.u32SubQuantizers : 0;
+    // swap with the last entry, list order does not matter
+    pstList->rows[pos] = pstList->rows[last];
+    pstList->rows.pop_back();
+    if (u32M) {
+        std::memmove(&pstList->codes[pos * u32M], &pstList->codes[last * u32M], u32M);
+        pstList->codes.resize(last * u32M);
+    }
+    pstIndex->rowList[u32Row] = FACE_INDEX_NO_LIST;
+    pstIndex->u32Rows--;
+    return CVI_SUCCESS;
+}
+
+// Score one query over the probed lists into pstTopK, returns the kept count
+static uint32_t FaceIndex_Search(const FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery,
+                                 const int8_t *ps8Query, float fNormQ, uint32_t u32TopK, FaceMatch_t *pstTopK) {
+    const uint32_t u32Dim = pstIndex->u32Dim;
+    float afQuery[FACE_MATCHER_MAX_DIM];
+    FaceIndex_ToFloat(ps8Query, u32Dim, afQuery);
+
+    // the u32Probes lists whose centroids are closest
+    const uint32_t u32Probes = pstIndex->stConfig.u32Probes;
+    std::vector<FaceMatch_t> probes(u32Probes);
+    uint32_t u32Probed = 0;
+    for (uint32_t l = 0; l < pstIndex->u32Lists; l++) {
+        FaceMatch_t stList;
+        stList.u32Index = l;
+        stList.fScore = FaceIndex_DotF(afQuery, &pstIndex->centroids[(size_t)l * u32Dim], u32Dim);
+        FaceMatcher_Offer(probes.data(), &u32Probed, u32Probes, &stList);
+    }
+
+    uint32_t u32Kept = 0;
+    if (pstIndex->enMode == FACE_INDEX_FLAT) {
+        for (uint32_t p = 0; p < u32Probed; p++) {
+            const FaceIndexList_t *pstList = &pstIndex->lists[probes[p].u32Index];
+            for (size_t i = 0; i < pstList->rows.size(); i++) {
+                uint32_t r = pstList->rows[i];
+                FaceMatch_t stMatch;
+                stMatch.u32Index = r;
+                stMatch.fScore = (float)FaceMatcher_Dot(ps8Query, FaceGallery_Row(pstGallery, r),
+                                                        pstGallery->u32Stride) / (fNormQ * pstGallery->pfNorm[r]);
+                FaceMatcher_Offer(pstTopK, &u32Kept, u32TopK, &stMatch);
+            }
+        }
+        return u32Kept;
+    }
+
+    // PQ: inner product of the query with every codeword, then a row's
+    // approximate inner product is one table lookup per subquantizer
+    const uint32_t u32M = pstIndex->stConfig.u32SubQuantizers;
+    const uint32_t u32Sub = FaceIndex_SubDim(pstIndex);
+    std::vector<float> table((size_t)u32M * FACE_INDEX_PQ_CODES);
+    for (uint32_t m = 0; m < u32M; m++) {
+        for (uint32_t c = 0; c < FACE_INDEX_PQ_CODES; c++) {
+            table[(size_t)m * FACE_INDEX_PQ_CODES + c] =
+                FaceIndex_DotF(afQuery + m * u32Sub,
+                               &pstIndex->codebooks[((size_t)m * FACE_INDEX_PQ_CODES + c) * u32Sub], u32Sub);
+        }
+    }
+    const uint32_t u32Rerank = std::max(pstIndex->stConfig.u32Rerank, u32TopK);
+    FaceMatch_t astCandidate[FACE_INDEX_MAX_RERANK + FACE_MATCHER_MAX_TOPK];
+    uint32_t u32Candidates = 0;
+    for (uint32_t p = 0; p < u32Probed; p++) {
+        const FaceIndexList_t *pstList = &pstIndex->lists[probes[p].u32Index];
+        const uint8_t *pu8Codes = pstList->codes.data();
+        for (size_t i = 0; i < pstList->rows.size(); i++, pu8Codes += u32M) {
+            float fDot = 0.0f;
+            for (uint32_t m = 0; m < u32M; m++) {
+                fDot += table[(size_t)m * FACE_INDEX_PQ_CODES + pu8Codes[m]];
+            }
+            FaceMatch_t stMatch;
+            stMatch.u32Index = pstList->rows[i];
+            stMatch.fScore = fDot / pstGallery->pfNorm[stMatch.u32Index];
+            FaceMatcher_Offer(astCandidate, &u32Candidates, u32Rerank, &stMatch);
+        }
+    }
+    // exact scores for the short list, which touches only u32Rerank gallery rows
+    for (uint32_t i = 0; i < u32Candidates; i++) {
+        uint32_t r = astCandidate[i].u32Index;
+        FaceMatch_t stMatch;
+        stMatch.u32Index = r;
+        stMatch.fScore = (float)FaceMatcher_Dot(ps8Query, FaceGallery_Row(pstGallery, r), pstGallery->u32Stride) /
+                         (fNormQ * pstGallery->pfNorm[r]);
+        FaceMatcher_Offer(pstTopK, &u32Kept, u32TopK, &stMatch);
+    }
+    return u32Kept;
+}
+
+CVI_S32 FaceIndex_Query(const FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery,
+                        const int8_t *const *pps8Queries, uint32_t u32Queries, uint32_t u32TopK,
+                        float fThreshold, FaceMatch_t *pstMatches, uint32_t *pu32Sizes) {
+    if (!pstIndex || pstIndex->lists.empty() || !pstGallery || pstGallery->u32Dim != pstIndex->u32Dim ||
+        u32Queries > FACE_MATCHER_MAX_QUERIES || u32TopK == 0 || u32TopK > FACE_MATCHER_MAX_TOPK) {
+        return CVI_FAILURE;
+    }
+    int8_t as8Query[FACE_MATCHER_MAX_DIM] __attribute__((aligned(FACE_GALLERY_ALIGN)));
+    for (uint32_t q = 0; q < u32Queries; q++) {
+        // padded like the gallery rows, for the match kernel
+        std::memcpy(as8Query, pps8Queries[q], pstGallery->u32Dim);
+        std::memset(as8Query + pstGallery->u32Dim, 0, pstGallery->u32Stride - pstGallery->u32Dim);
+        float fNormQ = FaceGallery_Norm(as8Query, pstGallery->u32Dim);
+        FaceMatch_t *pstTopK = pstMatches + (size_t)q * u32TopK;
+        uint32_t u32Kept = fNormQ > 0.0f ? FaceIndex_Search(pstIndex, pstGallery, as8Query, fNormQ, u32TopK, pstTopK) : 0;
+        pu32Sizes[q] = FaceMatcher_Finish(pstTopK, u32Kept, fThreshold);
+    }
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceIndex_Save(const FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, const char *path) {
+    std::string tmpPath = std::string(path) + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp) {
+        return CVI_FAILURE;
+    }
+    FaceIndexFileHeader_t stHeader;
+    std::memset(&stHeader, 0, sizeof(stHeader));
+    stHeader.u32Magic = FACE_INDEX_MAGIC;
+    stHeader.u32Version = FACE_INDEX_VERSION;
+    stHeader.u32Dim = pstIndex->u32Dim;
+    stHeader.u32Lists = pstIndex->u32Lists;
+    stHeader.u32Mode = pstIndex->enMode;
+    stHeader.u32SubQuantizers = pstIndex->enMode == FACE_INDEX_PQ ? pstIndex->stConfig.u32SubQuantizers : 0;
+    stHeader.u32Rows = pstGallery->u32Count;
+    bool bOk = fwrite(&stHeader, sizeof(stHeader), 1, fp) == 1 &&
+               fwrite(pstIndex->centroids.data(), sizeof(float), pstIndex->centroids.size(), fp) ==
+                   pstIndex->centroids.size() &&
+               fwrite(pstIndex->codebooks.data(), sizeof(float), pstIndex->codebooks.size(), fp) ==
+                   pstIndex->codebooks.size();
+
+    // one record per gallery row: slot ID, list and codes
+    std::vector<uint8_t> empty(stHeader.u32SubQuantizers, 0);
+    for (uint32_t r = 0; r < pstGallery->u32Count && bOk; r++) {
+        uint32_t u32List = r < pstIndex->rowList.size() ? pstIndex->rowList[r] : FACE_INDEX_NO_LIST;
+        uint32_t au32Record[2] = {pstGallery->pstSlots[r].u32Id, u32List};
+        const uint8_t *pu8Codes = empty.data();
+        if (u32List != FACE_INDEX_NO_LIST && stHeader.u32SubQuantizers) {
+            const FaceIndexList_t *pstList = &pstIndex->lists[u32List];
+            size_t pos = std::find(pstList->rows.begin(), pstList->rows.end(), r) - pstList->rows.begin();
+            pu8Codes = &pstList->codes[pos * stHeader.u32SubQuantizers];
+        }
+        bOk = fwrite(au32Record, sizeof(au32Record), 1, fp) == 1 &&
+              fwrite(pu8Codes, 1, stHeader.u32SubQuantizers, fp) == stHeader.u32SubQuantizers;
+    }
+    bOk = fclose(fp) == 0 && bOk;
+    if (!bOk || rename(tmpPath.c_str(), path) != 0) {
+        unlink(tmpPath.c_str());
+        std::cerr << "Failed to save face index " << path << std::endl;
+        return CVI_FAILURE;
+    }
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceIndex_Load(FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery, const char *path,
+                       const FaceIndexConfig_t *pstConfig) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return CVI_FAILURE;
+    }
+    FaceIndexFileHeader_t stHeader;
+    bool bOk = fread(&stHeader, sizeof(stHeader), 1, fp) == 1 && stHeader.u32Magic == FACE_INDEX_MAGIC &&
+               stHeader.u32Version == FACE_INDEX_VERSION && stHeader.u32Dim == pstGallery->u32Dim &&
+               stHeader.u32Dim <= FACE_MATCHER_MAX_DIM && stHeader.u32Lists > 0 &&
+               stHeader.u32SubQuantizers <= FACE_INDEX_MAX_SUBQUANTIZERS &&
+               (stHeader.u32Mode == FACE_INDEX_FLAT ||
+                (stHeader.u32Mode == FACE_INDEX_PQ && stHeader.u32SubQuantizers > 0 &&
+                 stHeader.u32Dim % stHeader.u32SubQuantizers == 0));
+    if (bOk) {
+        pstIndex->stConfig = *pstConfig;
+        pstIndex->enMode = (FaceIndexMode_t)stHeader.u32Mode;
+        pstIndex->u32Dim = stHeader.u32Dim;
+        pstIndex->u32Lists = stHeader.u32Lists;
+        pstIndex->stConfig.u32SubQuantizers = stHeader.u32SubQuantizers;
+        pstIndex->stConfig.u32Probes = std::max<uint32_t>(1, std::min(pstConfig->u32Probes, stHeader.u32Lists));
+        pstIndex->stConfig.u32Rerank =
+            std::max<uint32_t>(1, std::min<uint32_t>(pstConfig->u32Rerank, FACE_INDEX_MAX_RERANK));
+        pstIndex->centroids.resize((size_t)stHeader.u32Lists * stHeader.u32Dim);
+        pstIndex->codebooks.resize((size_t)stHeader.u32SubQuantizers * FACE_INDEX_PQ_CODES *
+                                   (stHeader.u32SubQuantizers ? stHeader.u32Dim / stHeader.u32SubQuantizers : 0));
+        bOk = fread(pstIndex->centroids.data(), sizeof(float), pstIndex->centroids.size(), fp) ==
+                  pstIndex->centroids.size() &&
+              fread(pstIndex->codebooks.data(), sizeof(float), pstIndex->codebooks.size(), fp) ==
+                  pstIndex->codebooks.size();
+    }
+    if (!bOk) {
+        fclose(fp);
+        std::cerr << "Face index " << path << " does not match the gallery, rebuilding" << std::endl;
+        return CVI_FAILURE;
+    }
+
+    pstIndex->lists.assign(pstIndex->u32Lists, FaceIndexList_t());
+    pstIndex->rowList.assign(pstGallery->u32Count, FACE_INDEX_NO_LIST);
+    pstIndex->u32Rows = 0;
+    uint32_t u32Reindexed = 0;
+    std::vector<uint8_t> codes(stHeader.u32SubQuantizers);
+    for (uint32_t r = 0; r < pstGallery->u32Count; r++) {
+        uint32_t au32Record[2] = {0, FACE_INDEX_NO_LIST};
+        if (r < stHeader.u32Rows && (fread(au32Record, sizeof(au32Record), 1, fp) != 1 ||
+                                     fread(codes.data(), 1, codes.size(), fp) != codes.size())) {
+            bOk = false;
+            break;
+        }
+        bool bLive = pstGallery->pfNorm[r] > 0.0f;
+        // the record still describes this row: same identity, still enrolled
+        if (bLive && au32Record[0] != 0 && au32Record[0] == pstGallery->pstSlots[r].u32Id &&
+            au32Record[1] < pstIndex->u32Lists) {
+            FaceIndexList_t *pstList = &pstIndex->lists[au32Record[1]];
+            pstList->rows.push_back(r);
+            pstList->codes.insert(pstList->codes.end(), codes.begin(), codes.end());
+            pstIndex->rowList[r] = au32Record[1];
+            pstIndex->u32Rows++;
+        } else if (bLive) {
+            FaceIndex_Insert(pstIndex, pstGallery, r);
+            u32Reindexed++;
+        }
+    }
+    fclose(fp);
+    if (!bOk) {
+        std::cerr << "Face index " << path << " is truncated, rebuilding" << std::endl;
+        return CVI_FAILURE;
+    }
+    if (u32Reindexed > 0) {
+        std::cout << "Face index: " << u32Reindexed << " rows changed since " << path << " was saved" << std::endl;
+    }
+    return CVI_SUCCESS;
+}
+
+size_t FaceIndex_MemoryBytes(const FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery) {
+    size_t bytes = (pstIndex->centroids.size() + pstIndex->codebooks.size()) * sizeof(float) +
+                   pstIndex->rowList.size() * sizeof(uint32_t);
+    for (size_t l = 0; l < pstIndex->lists.size(); l++) {
+        bytes += pstIndex->lists[l].rows.size() * sizeof(uint32_t) + pstIndex->lists[l].codes.size();
+    }
+    if (pstIndex->enMode == FACE_INDEX_FLAT) {
+        bytes += (size_t)pstIndex->u32Rows * pstGallery->u32Stride;
+    }
+    return bytes;
+}
+
+// Identities around shared centers, like embeddings of similar-looking people
+static void FaceIndex_RandomGallery(FaceGallery_t *pstGallery, uint32_t u32Identities) {
+    const uint32_t u32Dim = pstGallery->u32Dim;
+    uint32_t u32Centers = std::max<uint32_t>(16, u32Identities / 100);
+    std::vector<int8_t> centers((size_t)u32Centers * u32Dim);
+    for (size_t i = 0; i < centers.size(); i++) {
+        centers[i] = (int8_t)(rand() % 255 - 127);
+    }
+    std::vector<int8_t> feature(u32Dim);
+    for (uint32_t i = 0; i < u32Identities; i++) {
+        const int8_t *ps8Center = &centers[(size_t)(rand() % u32Centers) * u32Dim];
+        for (uint32_t d = 0; d < u32Dim; d++) {
+            int value = ps8Center[d] / 2 + rand() % 161 - 80;
+            feature[d] = (int8_t)std::min(std::max(value, -127), 127);
+        }
+        FaceGallery_Add(pstGallery, feature.data(), NULL, NULL);
+    }
+}
+
+typedef CVI_S32 (*FaceIndexSearch_t)(const FaceIndex_t *, const FaceGallery_t *, const int8_t *const *, uint32_t,
+                                     uint32_t, float, FaceMatch_t *, uint32_t *);
+
+static CVI_S32 FaceIndex_BruteForce(const FaceIndex_t *pstIndex, const FaceGallery_t *pstGallery,
+                                    const int8_t *const *pps8Queries, uint32_t u32Queries, uint32_t u32TopK,
+                                    float fThreshold, FaceMatch_t *pstMatches, uint32_t *pu32Sizes) {
+    (void)pstIndex;
+    return FaceMatcher_Match(pstGallery, pps8Queries, u32Queries, u32TopK, fThreshold, pstMatches, pu32Sizes);
+}
+
+// All queries in batches, results in pstMatches (u32TopK per query); returns queries/s
+static double FaceIndex_RunQueries(FaceIndexSearch_t pfnSearch, const FaceIndex_t *pstIndex,
+                                   const FaceGallery_t *pstGallery, const std::vector<int8_t> &queries,
+                                   uint32_t u32Queries, uint32_t u32TopK, FaceMatch_t *pstMatches) {
+    const int8_t *aps8Batch[FACE_MATCHER_MAX_QUERIES];
+    uint32_t au32Size[FACE_MATCHER_MAX_QUERIES];
+    uint64_t u64Start = FaceIndex_NowUs();
+    for (uint32_t q0 = 0; q0 < u32Queries; q0 += FACE_MATCHER_MAX_QUERIES) {
+        uint32_t n = std::min<uint32_t>(FACE_MATCHER_MAX_QUERIES, u32Queries - q0);
+        for (uint32_t i = 0; i < n; i++) {
+            aps8Batch[i] = &queries[(size_t)(q0 + i) * pstGallery->u32Dim];
+        }
+        pfnSearch(pstIndex, pstGallery, aps8Batch, n, u32TopK, 0.0f, pstMatches + (size_t)q0 * u32TopK, au32Size);
+    }
+    uint64_t u64Elapsed = std::max<uint64_t>(1, FaceIndex_NowUs() - u64Start);
+    return u32Queries * 1000000.0 / u64Elapsed;
+}
+
+// Share of the exact top-k found, and how often the exact best came first
+static void FaceIndex_Recall(const std::vector<FaceMatch_t> &exact, const std::vector<FaceMatch_t> &approx,
+                             uint32_t u32Queries, uint32_t u32TopK, double *pdRecallK, double *pdRecall1) {
+    uint32_t u32Found = 0, u32First = 0;
+    for (uint32_t q = 0; q < u32Queries; q++) {
+        const FaceMatch_t *pstExact = &exact[(size_t)q * u32TopK];
+        const FaceMatch_t *pstApprox = &approx[(size_t)q * u32TopK];
+        for (uint32_t i = 0; i < u32TopK; i++) {
+            for (uint32_t j = 0; j < u32TopK; j++) {
+                if (pstExact[i].u32Index == pstApprox[j].u32Index) {
+                    u32Found++;
+                    break;
+                }
+            }
+        }
+        u32First += pstExact[0].u32Index == pstApprox[0].u32Index;
+    }
+    *pdRecallK = (double)u32Found / (u32Queries * u32TopK);
+    *pdRecall1 = (double)u32First / u32Queries;
+}
+
+CVI_S32 FaceIndex_Benchmark(uint32_t u32Identities, uint32_t u32Dim, uint32_t u32MemCapKB) {
+    if (u32Identities < FACE_INDEX_PQ_CODES || u32Dim == 0 || u32Dim > FACE_MATCHER_MAX_DIM) {
+        std::cerr << "Index benchmark needs at least " << FACE_INDEX_PQ_CODES << " identities of 1.."
+                  << FACE_MATCHER_MAX_DIM << " dimensions" << std::endl;
+        return CVI_FAILURE;
+    }
+    FaceGallery_t stGallery;
+    if (FaceGallery_Init(&stGallery, u32Dim) != CVI_SUCCESS) {
+        return CVI_FAILURE;
+    }
+    srand(1);
+    FaceIndex_RandomGallery(&stGallery, u32Identities);
+
+    // queries are noisy copies of enrolled identities
+    const uint32_t u32Queries = 512;
+    const uint32_t u32TopK = 5;
+    std::vector<int8_t> queries((size_t)u32Queries * u32Dim);
+    for (uint32_t q = 0; q < u32Queries; q++) {
+        const int8_t *ps8Row = FaceGallery_Row(&stGallery, (uint32_t)rand() % u32Identities);
+        for (uint32_t d = 0; d < u32Dim; d++) {
+            int value = ps8Row[d] + rand() % 61 - 30;
+            queries[(size_t)q * u32Dim + d] = (int8_t)std::min(std::max(value, -127), 127);
+        }
+    }
+
+    FaceIndex_t stIndex;
+    std::vector<FaceMatch_t> exact((size_t)u32Queries * u32TopK), approx(exact.size());
+    double dExactQps = FaceIndex_RunQueries(FaceIndex_BruteForce, &stIndex, &stGallery, queries, u32Queries,
+                                            u32TopK, exact.data());
+
+    FaceIndexConfig_t stConfig;
+    FaceIndex_DefaultConfig(&stConfig);
+    stConfig.u32MemCapKB = u32MemCapKB;
+    uint64_t u64Start = FaceIndex_NowUs();
+    if (FaceIndex_Build(&stIndex, &stGallery, &stConfig) != CVI_SUCCESS) {
+        FaceGallery_Close(&stGallery);
+        return CVI_FAILURE;
+    }
+    double dBuildMs = (FaceIndex_NowUs() - u64Start) / 1000.0;
+
+    std::cout << "=== Index Benchmark ===" << std::endl;
+    std::cout << "Identities: " << u32Identities << ", dim: " << u32Dim << ", lists: " << stIndex.u32Lists
+              << ", mode: " << (stIndex.enMode == FACE_INDEX_PQ ? "PQ" : "FLAT");
+    if (stIndex.enMode == FACE_INDEX_PQ) {
+        std::cout << " (" << stIndex.stConfig.u32SubQuantizers << " bytes/row, rerank "
+                  << stIndex.stConfig.u32Rerank << ")";
+    }
+    std::cout << std::endl;
+    std::cout << "Build: " << dBuildMs << " ms, RAM: " << FaceIndex_MemoryBytes(&stIndex, &stGallery) / 1024
+              << " KB (cap " << u32MemCapKB << " KB, 0 = none)" << std::endl;
+    std::cout << "Linear scan: " << dExactQps << " queries/s" << std::endl;
+
+    static const uint32_t au32Probes[] = {4, 8, 16, 32};
+    for (size_t i = 0; i < sizeof(au32Probes) / sizeof(au32Probes[0]); i++) {
+        stIndex.stConfig.u32Probes = std::min(au32Probes[i], stIndex.u32Lists);
+        double dQps = FaceIndex_RunQueries(FaceIndex_Query, &stIndex, &stGallery, queries, u32Queries, u32TopK,
+                                           approx.data());
+        double dRecallK, dRecall1;
+        FaceIndex_Recall(exact, approx, u32Queries, u32TopK, &dRecallK, &dRecall1);
+        std::cout << "Probes " << stIndex.stConfig.u32Probes << ": " << dQps << " queries/s ("
+                  << dQps / dExactQps << "x), recall@1 " << dRecall1 << ", recall@" << u32TopK << " "
+                  << dRecallK << std::endl;
+    }
+
+    // save, reload, then delete and enroll identities incrementally
+    const char *path = "index_bench" FACE_INDEX_SUFFIX;
+    FaceIndex_t stLoaded;
+    CVI_S32 s32Ret = FaceIndex_Save(&stIndex, &stGallery, path);
+    if (s32Ret == CVI_SUCCESS) {
+        s32Ret = FaceIndex_Load(&stLoaded, &stGallery, path, &stIndex.stConfig);
+    }
+    unlink(path);
+    std::vector<FaceMatch_t> reloaded(exact.size());
+    if (s32Ret == CVI_SUCCESS) {
+        FaceIndex_RunQueries(FaceIndex_Query, &stIndex, &stGallery, queries, u32Queries, u32TopK, approx.data());
+        FaceIndex_RunQueries(FaceIndex_Query, &stLoaded, &stGallery, queries, u32Queries, u32TopK, reloaded.data());
+        bool bSame = true;
+        for (size_t i = 0; i < approx.size(); i++) {
+            bSame = bSame && approx[i].u32Index == reloaded[i].u32Index;
+        }
+        std::cout << "Save/load: " << (bSame ? "identical results" : "RESULTS DIFFER") << std::endl;
+        s32Ret = bSame ? CVI_SUCCESS : CVI_FAILURE;
+    }
+
+    const uint32_t u32Churn = std::min<uint32_t>(100, u32Identities / 10);
+    for (uint32_t i = 0; i < u32Churn; i++) {
+        uint32_t r = i * 7;
+        FaceGallery_Remove(&stGallery, stGallery.pstSlots[r].u32Id);
+        FaceIndex_Remove(&stLoaded, r);
+    }
+    uint32_t u32Found = 0, u32Leaked = 0;
+    for (uint32_t i = 0; i < u32Churn && s32Ret == CVI_SUCCESS; i++) {
+        uint32_t u32Id = 0;
+        const int8_t *ps8Query = &queries[(size_t)i * u32Dim];
+        FaceGallery_Add(&stGallery, ps8Query, "new", &u32Id);
+        uint32_t r = 0;
+        while (stGallery.pstSlots[r].u32Id != u32Id) {
+            r++;
+        }
+        FaceIndex_Insert(&stLoaded, &stGallery, r);
+        FaceMatch_t astMatch[FACE_MATCHER_MAX_TOPK];
+        uint32_t u32Size = 0;
+        FaceIndex_Query(&stLoaded, &stGallery, &ps8Query, 1, 1, 0.0f, astMatch, &u32Size);
+        u32Found += u32Size > 0 && astMatch[0].u32Index == r;
+    }
+    for (uint32_t q = 0; q < u32Queries && s32Ret == CVI_SUCCESS; q++) {
+        FaceMatch_t astMatch[FACE_MATCHER_MAX_TOPK];
+        uint32_t u32Size = 0;
+        const int8_t *ps8Query = &queries[(size_t)q * u32Dim];
+        FaceIndex_Query(&stLoaded, &stGallery, &ps8Query, 1, u32TopK, 0.0f, astMatch, &u32Size);
+        for (uint32_t k = 0; k < u32Size; k++) {
+            u32Leaked += stGallery.pfNorm[astMatch[k].u32Index] == 0.0f;
+        }
+    }
+    if (s32Ret == CVI_SUCCESS) {
+        std::cout << "Incremental: " << u32Churn << " deleted (" << u32Leaked << " returned after delete), "
+                  << u32Found << "/" << u32Churn << " inserted found first" << std::endl;
+    }
+    std::cout << "=======================" << std::endl;
+    FaceGallery_Close(&stGallery);
+    return s32Ret;
+}
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sys/time.h>
+#include "face_matcher.h"
+#include "hal.h"
+
+#if defined(FACE_MATCHER_KERNEL_RVV)
+#include <riscv_vector.h>
+#endif
+
+static uint64_t FaceMatcher_NowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+// All kernels compute the exact int32 inner product of two rows of n bytes,
+// n a multiple of FACE_GALLERY_ALIGN, so their results are bit-identical.
+
+// Kept scalar, so it doubles as the baseline the SIMD kernels are measured against
+#if defined(__GNUC__) && !defined(__clang__)
+__attribute__((optimize("no-tree-vectorize")))
+#endif
+static int32_t FaceMatcher_DotScalar(const int8_t *ps8A, const int8_t *ps8B, uint32_t n) {
+    int32_t s32Sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        s32Sum += (int32_t)ps8A[i] * ps8B[i];
+    }
+    return s32Sum;
+}
+
+#if defined(FACE_MATCHER_KERNEL_RVV)
+// Widening multiply to int16 and widening reduction to int32, 64 bytes per
+// step with LMUL=4 on the C906's 128-bit vectors
+static int32_t FaceMatcher_DotKernel(const int8_t *ps8A, const int8_t *ps8B, uint32_t n) {
+    vint32m1_t vSum = vmv_v_x_i32m1(0, vsetvl_e32m1(1));
+    size_t vl;
+    for (uint32_t i = 0; i < n; i += vl) {
+        vl = vsetvl_e8m4(n - i);
+        vint16m8_t vProd = vwmul_vv_i16m8(vle8_v_i8m4(ps8A + i, vl), vle8_v_i8m4(ps8B + i, vl), vl);
+        vSum = vwredsum_vs_i16m8_i32m1(vSum, vProd, vSum, vl);
+    }
+    return vmv_x_s_i32m1_i32(vSum);
+}
+#elif defined(FACE_MATCHER_KERNEL_GENERIC)
+typedef int8_t FaceMatcherS8x16_t __attribute__((vector_size(16)));
+typedef int16_t FaceMatcherS16x16_t __attribute__((vector_size(32)));
+typedef int32_t FaceMatcherS32x16_t __attribute__((vector_size(64)));
+
+// int8 x int8 always fits int16, the sums are kept in int32 lanes
+static int32_t FaceMatcher_DotKernel(const int8_t *ps8A, const int8_t *ps8B, uint32_t n) {
+    FaceMatcherS32x16_t vSum = {};
+    for (uint32_t i = 0; i < n; i += sizeof(FaceMatcherS8x16_t)) {
+        FaceMatcherS8x16_t vA, vB;
+        std::memcpy(&vA, ps8A + i, sizeof(vA));
+        std::memcpy(&vB, ps8B + i, sizeof(vB));
+        FaceMatcherS16x16_t vProd = __builtin_convertvector(vA, FaceMatcherS16x16_t) *
+                                    __builtin_convertvector(vB, FaceMatcherS16x16_t);
+        vSum += __builtin_convertvector(vProd, FaceMatcherS32x16_t);
+    }
+    int32_t s32Sum = 0;
+    for (uint32_t k = 0; k < 16; k++) {
+        s32Sum += vSum[k];
+    }
+    return s32Sum;
+}
+#else
+#define FaceMatcher_DotKernel FaceMatcher_DotScalar
+#endif
+
+typedef int32_t (*FaceMatcherDot_t)(const int8_t *, const int8_t *, uint32_t);
+
+const char *FaceMatcher_KernelName() {
+#if defined(FACE_MATCHER_KERNEL_RVV)
+    return "RVV";
+#elif defined(FACE_MATCHER_KERNEL_GENERIC)
+    return "GENERIC";
+#else
+    return "SCALAR";
+#endif
+}
+
+// Ordering of the top-k heap: lower score, then higher index, is worse, so
+// the result is the same as a full sort whatever order rows arrive in
+static inline bool FaceMatcher_Worse(const FaceMatch_t &a, const FaceMatch_t &b) {
+    return a.fScore < b.fScore || (a.fScore == b.fScore && a.u32Index > b.u32Index);
+}
+
+int32_t FaceMatcher_Dot(const int8_t *ps8A, const int8_t *ps8B, uint32_t n) {
+    return FaceMatcher_DotKernel(ps8A, ps8B, n);
+}
+
+// Min-heap of the k best, the worst kept match at the root
+static void FaceMatcher_HeapOffer(FaceMatch_t *pstHeap, uint32_t *pu32Size, uint32_t u32TopK,
+                                  const FaceMatch_t &stMatch) {
+    uint32_t i;
+    if (*pu32Size < u32TopK) {
+        i = (*pu32Size)++;
+        while (i > 0 && FaceMatcher_Worse(stMatch, pstHeap[(i - 1) / 2])) {
+            pstHeap[i] = pstHeap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        pstHeap[i] = stMatch;
+        return;
+    }
+    if (!FaceMatcher_Worse(pstHeap[0], stMatch)) {
+        return;
+    }
+    i = 0;
+    for (;;) {
+        uint32_t c = 2 * i + 1;
+        if (c >= u32TopK) {
+            break;
+        }
+        if (c + 1 < u32TopK && FaceMatcher_Worse(pstHeap[c + 1], pstHeap[c])) {
+            c++;
+        }
+        if (!FaceMatcher_Worse(pstHeap[c], stMatch)) {
+            break;
+        }
+        pstHeap[i] = pstHeap[c];
+        i = c;
+    }
+    pstHeap[i] = stMatch;
+}
+
+static bool FaceMatcher_Better(const FaceMatch_t &a, const FaceMatch_t &b) {
+    return FaceMatcher_Worse(b, a);
+}
+
+void FaceMatcher_Offer(FaceMatch_t *pstTopK, uint32_t *pu32Size, uint32_t u32TopK, const FaceMatch_t *pstMatch) {
+    FaceMatcher_HeapOffer(pstTopK, pu32Size, u32TopK, *pstMatch);
+}
+
+uint32_t FaceMatcher_Finish(FaceMatch_t *pstTopK, uint32_t u32Size, float fThreshold) {
+    std::sort(pstTopK, pstTopK + u32Size, FaceMatcher_Better);
+    uint32_t u32Kept = 0;
+    while (u32Kept < u32Size && (fThreshold <= 0.0f || pstTopK[u32Kept].fScore >= fThreshold)) {
+        u32Kept++;
+    }
+    return u32Kept;
+}
+
+static CVI_S32 FaceMatcher_Search(const FaceGallery_t *pstGallery, const int8_t *const *pps8Queries,
+                                  uint32_t u32Queries, uint32_t u32TopK, float fThreshold,
+                                  FaceMatch_t *pstMatches, uint32_t *pu32Sizes, FaceMatcherDot_t pfnDot) {
+    if (!pstGallery || !pps8Queries || !pstMatches || !pu32Sizes || u32Queries > FACE_MATCHER_MAX_QUERIES ||
+        u32TopK == 0 || u32TopK > FACE_MATCHER_MAX_TOPK || pstGallery->u32Stride > FACE_MATCHER_MAX_DIM) {
+        return CVI_FAILURE;
+    }
+
+    // queries padded like the gallery rows
+    const uint32_t u32Stride = pstGallery->u32Stride;
+    int8_t as8Query[FACE_MATCHER_MAX_QUERIES][FACE_MATCHER_MAX_DIM] __attribute__((aligned(FACE_GALLERY_ALIGN)));
+    float afNorm[FACE_MATCHER_MAX_QUERIES];
+    uint32_t au32Kept[FACE_MATCHER_MAX_QUERIES] = {0};
+    for (uint32_t q = 0; q < u32Queries; q++) {
+        std::memcpy(as8Query[q], pps8Queries[q], pstGallery->u32Dim);
+        std::memset(as8Query[q] + pstGallery->u32Dim, 0, u32Stride - pstGallery->u32Dim);
+        afNorm[q] = FaceGallery_Norm(as8Query[q], pstGallery->u32Dim);
+    }
+
+    for (uint32_t r0 = 0; r0 < pstGallery->u32Count; r0 += FACE_MATCHER_BLOCK_ROWS) {
+        uint32_t r1 = std::min<uint32_t>(r0 + FACE_MATCHER_BLOCK_ROWS, pstGallery->u32Count);
+        for (uint32_t q = 0; q < u32Queries; q++) {
+            FaceMatch_t *pstHeap = pstMatches + (size_t)q * u32TopK;
+            for (uint32_t r = r0; r < r1; r++) {
+                if (pstGallery->pfNorm[r] == 0.0f) {
+                    // deleted row
+                    continue;
+                }
+                int32_t s32Dot = pfnDot(as8Query[q], FaceGallery_Row(pstGallery, r), u32Stride);
+                float fDenom = afNorm[q] * pstGallery->pfNorm[r];
+                FaceMatch_t stMatch;
+                stMatch.u32Index = r;
+                stMatch.fScore = fDenom > 0.0f ? (float)s32Dot / fDenom : 0.0f;
+                FaceMatcher_HeapOffer(pstHeap, &au32Kept[q], u32TopK, stMatch);
+            }
+        }
+    }
+
+    for (uint32_t q = 0; q < u32Queries; q++) {
+        pu32Sizes[q] = FaceMatcher_Finish(pstMatches + (size_t)q * u32TopK, au32Kept[q], fThreshold);
+    }
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceMatcher_Match(const FaceGallery_t *pstGallery, const int8_t *const *pps8Queries,
+                          uint32_t u32Queries, uint32_t u32TopK, float fThreshold,
+                          FaceMatch_t *pstMatches, uint32_t *pu32Sizes) {
+    return FaceMatcher_Search(pstGallery, pps8Queries, u32Queries, u32TopK, fThreshold,
+                              pstMatches, pu32Sizes, FaceMatcher_DotKernel);
+}
+
+// Average time of one full batch, over at least a second
+static double FaceMatcher_TimeBatches(const FaceGallery_t *pstGallery, const int8_t *ps8Queries,
+                                      uint32_t u32Batches, uint32_t u32TopK, FaceMatcherDot_t pfnDot) {
+    const int8_t *aps8Batch[FACE_MATCHER_MAX_QUERIES];
+    FaceMatch_t astMatch[FACE_MATCHER_MAX_QUERIES * FACE_MATCHER_MAX_TOPK];
+    uint32_t au32Size[FACE_MATCHER_MAX_QUERIES];
+    uint32_t u32Runs = 0;
+    uint64_t u64Start = FaceMatcher_NowUs();
+    uint64_t u64Elapsed = 0;
+    while (u64Elapsed < 1000000 || u32Runs < 10) {
+        for (uint32_t q = 0; q < FACE_MATCHER_MAX_QUERIES; q++) {
+            aps8Batch[q] = ps8Queries + ((size_t)(u32Runs % u32Batches) * FACE_MATCHER_MAX_QUERIES + q) *
+                                            pstGallery->u32Dim;
+        }
+        FaceMatcher_Search(pstGallery, aps8Batch, FACE_MATCHER_MAX_QUERIES, u32TopK, 0.0f, astMatch,
+                           au32Size, pfnDot);
+        u32Runs++;
+        u64Elapsed = FaceMatcher_NowUs() - u64Start;
+    }
+    return u64Elapsed / 1000.0 / u32Runs;
+}
+
+CVI_S32 FaceMatcher_Benchmark(uint32_t u32Identities, uint32_t u32Dim) {
+    if (u32Identities == 0 || u32Dim == 0 || u32Dim > FACE_MATCHER_MAX_DIM) {
+        std::cerr << "Matcher benchmark needs 1.." << FACE_MATCHER_MAX_DIM << " dimensions" << std::endl;
+        return CVI_FAILURE;
+    }
+    FaceGallery_t stGallery;
+    if (FaceGallery_Init(&stGallery, u32Dim) != CVI_SUCCESS) {
+        return CVI_FAILURE;
+    }
+    srand(1);
+    std::vector<int8_t> feature(u32Dim);
+    for (uint32_t i = 0; i < u32Identities; i++) {
+        for (uint32_t d = 0; d < u32Dim; d++) {
+            feature[d] = (int8_t)(rand() % 255 - 127);
+        }
+        if (FaceGallery_Add(&stGallery, feature.data(), NULL, NULL) != CVI_SUCCESS) {
+            FaceGallery_Close(&stGallery);
+            return CVI_FAILURE;
+        }
+    }
+
+    // every query is a noisy copy of a known identity
+    const uint32_t u32Batches = 16;
+    std::vector<int8_t> queries((size_t)u32Batches * FACE_MATCHER_MAX_QUERIES * u32Dim);
+    std::vector<uint32_t> truth(u32Batches * FACE_MATCHER_MAX_QUERIES);
+    for (size_t q = 0; q < truth.size(); q++) {
+        truth[q] = (uint32_t)rand() % u32Identities;
+        const int8_t *ps8Row = FaceGallery_Row(&stGallery, truth[q]);
+        for (uint32_t d = 0; d < u32Dim; d++) {
+            int value = ps8Row[d] + rand() % 81 - 40;
+            queries[q * u32Dim + d] = (int8_t)std::min(std::max(value, -127), 127);
+        }
+    }
+    const int8_t *aps8Batch[FACE_MATCHER_MAX_QUERIES];
+    FaceMatch_t astMatch[FACE_MATCHER_MAX_QUERIES * FACE_MATCHER_MAX_TOPK];
+    FaceMatch_t astRef[FACE_MATCHER_MAX_QUERIES * FACE_MATCHER_MAX_TOPK];
+    uint32_t au32Size[FACE_MATCHER_MAX_QUERIES], au32RefSize[FACE_MATCHER_MAX_QUERIES];
+    const uint32_t u32TopK = 5;
+
+    // correctness against the scalar reference, bit for bit
+    bool bExact = true;
+    uint32_t u32Hits = 0;
+    for (uint32_t b = 0; b < u32Batches; b++) {
+        for (uint32_t q = 0; q < FACE_MATCHER_MAX_QUERIES; q++) {
+            aps8Batch[q] = &queries[((size_t)b * FACE_MATCHER_MAX_QUERIES + q) * u32Dim];
+        }
+        FaceMatcher_Match(&stGallery, aps8Batch, FACE_MATCHER_MAX_QUERIES, u32TopK, 0.0f, astMatch, au32Size);
+        FaceMatcher_Search(&stGallery, aps8Batch, FACE_MATCHER_MAX_QUERIES, u32TopK, 0.0f, astRef,
+                           au32RefSize, FaceMatcher_DotScalar);
+        for (uint32_t q = 0; q < FACE_MATCHER_MAX_QUERIES; q++) {
+            bExact = bExact && au32Size[q] == au32RefSize[q];
+            for (uint32_t k = 0; k < au32RefSize[q] && bExact; k++) {
+                const FaceMatch_t &a = astMatch[q * u32TopK + k];
+                const FaceMatch_t &r = astRef[q * u32TopK + k];
+                bExact = a.u32Index == r.u32Index && std::memcmp(&a.fScore, &r.fScore, sizeof(float)) == 0;
+            }
+            if (au32Size[q] > 0 && astMatch[q * u32TopK].u32Index == truth[b * FACE_MATCHER_MAX_QUERIES + q]) {
+                u32Hits++;
+            }
+        }
+    }
+
+    // and against the SDK's own matcher, which the simulator does not have
+    const char *szSdk = "n/a";
+    bool bSdkExact = true;
+    std::vector<int8_t> packed((size_t)u32Identities * u32Dim);
+    for (uint32_t i = 0; i < u32Identities; i++) {
+        std::memcpy(&packed[(size_t)i * u32Dim], FaceGallery_Row(&stGallery, i), u32Dim);
+    }
+    void *pRef = NULL;
+    if (HAL_RefMatcher_Open(&pRef, packed.data(), u32Identities, u32Dim) == CVI_SUCCESS) {
+        uint32_t au32RefIndex[FACE_MATCHER_MAX_TOPK];
+        float afRefScore[FACE_MATCHER_MAX_TOPK];
+        for (uint32_t b = 0; b < u32Batches && bSdkExact; b++) {
+            for (uint32_t q = 0; q < FACE_MATCHER_MAX_QUERIES; q++) {
+                aps8Batch[q] = &queries[((size_t)b * FACE_MATCHER_MAX_QUERIES + q) * u32Dim];
+            }
+            FaceMatcher_Match(&stGallery, aps8Batch, FACE_MATCHER_MAX_QUERIES, u32TopK, 0.0f, astMatch, au32Size);
+            for (uint32_t q = 0; q < FACE_MATCHER_MAX_QUERIES && bSdkExact; q++) {
+                uint32_t u32RefSize = 0;
+                bSdkExact = HAL_RefMatcher_Match(pRef, aps8Batch[q], u32TopK, au32RefIndex, afRefScore,
+                                                 &u32RefSize) == CVI_SUCCESS && u32RefSize == au32Size[q];
+                for (uint32_t k = 0; k < u32RefSize && bSdkExact; k++) {
+                    // equal scores may come in either order
+                    const FaceMatch_t &a = astMatch[q * u32TopK + k];
+                    bool bTie = (k > 0 && afRefScore[k - 1] == afRefScore[k]) ||
+                                (k + 1 < u32RefSize && afRefScore[k + 1] == afRefScore[k]);
+                    bSdkExact = std::memcmp(&a.fScore, &afRefScore[k], sizeof(float)) == 0 &&
+                                (a.u32Index == au32RefIndex[k] || bTie);
+                }
+            }
+        }
+        HAL_RefMatcher_Close(pRef);
+        szSdk = bSdkExact ? "bit-exact" : "MISMATCH";
+    } else if (std::strcmp(HAL_GetBackendName(), "sim") != 0) {
+        szSdk = "unavailable";
+        bSdkExact = false;
+    }
+
+    double dBatchMs = FaceMatcher_TimeBatches(&stGallery, queries.data(), u32Batches, u32TopK, FaceMatcher_DotKernel);
+    double dScalarMs = FaceMatcher_TimeBatches(&stGallery, queries.data(), u32Batches, u32TopK, FaceMatcher_DotScalar);
+    FaceGallery_Close(&stGallery);
+
+    double dQueries = FACE_MATCHER_MAX_QUERIES * 1000.0 / dBatchMs;
+    std::cout << "=== Matcher Benchmark ===" << std::endl;
+    std::cout << "Kernel: " << FaceMatcher_KernelName() << ", identities: " << u32Identities
+              << ", dim: " << u32Dim << ", batch: " << FACE_MATCHER_MAX_QUERIES << ", top-" << u32TopK << std::endl;
+    std::cout << "Batch time: " << dBatchMs << " ms, " << dQueries << " queries/s, "
+              << dQueries * u32Identities / 1e6 << " M scores/s" << std::endl;
+    std::cout << "Scalar kernel: " << dScalarMs << " ms per batch, speedup " << dScalarMs / dBatchMs << "x" << std::endl;
+    std::cout << "Top-1 hits: " << u32Hits << "/" << truth.size() << ", scalar reference: "
+              << (bExact ? "bit-exact" : "MISMATCH") << ", SDK matcher: " << szSdk << std::endl;
+    std::cout << "=========================" << std::endl;
+    return bExact && bSdkExact ? CVI_SUCCESS : CVI_FAILURE;
+}
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include "face_quality.h"
+#include "hal.h"
+
+static const float kRadToDeg = 57.29578f;
+
+void FaceQuality_DefaultConfig(FaceQualityConfig_t *pstConfig) {
+    pstConfig->fMinScore = FACE_QUALITY_MIN_SCORE;
+    pstConfig->fMinSide = FACE_QUALITY_MIN_SIDE;
+    pstConfig->fMaxYaw = FACE_QUALITY_MAX_YAW;
+    pstConfig->fMaxPitch = FACE_QUALITY_MAX_PITCH;
+    pstConfig->fMaxRoll = FACE_QUALITY_MAX_ROLL;
+    pstConfig->fMinSharpness = FACE_QUALITY_MIN_SHARPNESS;
+    pstConfig->bGateMetadata = true;
+}
+
+void FaceQuality_Init(FaceQuality_t *pstQuality, const FaceQualityConfig_t *pstConfig) {
+    std::memset(pstQuality, 0, sizeof(FaceQuality_t));
+    if (pstConfig) {
+        pstQuality->stConfig = *pstConfig;
+    } else {
+        FaceQuality_DefaultConfig(&pstQuality->stConfig);
+    }
+}
+
+void FaceQuality_SetConfig(FaceQuality_t *pstQuality, const FaceQualityConfig_t *pstConfig) {
+    pstQuality->stConfig = *pstConfig;
+}
+
+static float FaceQuality_Side(const cvtdl_bbox_t *pstBox) {
+    return std::min(pstBox->x2 - pstBox->x1, pstBox->y2 - pstBox->y1);
+}
+
+// The checks that need only the box, shared with the metadata filter
+static FaceQualityVerdict_t FaceQuality_CheckBox(const FaceQualityConfig_t *pstConfig, const cvtdl_bbox_t *pstBox) {
+    if (pstConfig->fMinScore > 0.0f && pstBox->score < pstConfig->fMinScore) {
+        return FACE_QUALITY_SCORE;
+    }
+    if (pstConfig->fMinSide > 0.0f && FaceQuality_Side(pstBox) < pstConfig->fMinSide) {
+        return FACE_QUALITY_SIZE;
+    }
+    return FACE_QUALITY_OK;
+}
+
+static bool FaceQuality_Exceeds(float fAngle, float fMaxDeg) {
+    return fMaxDeg > 0.0f && std::fabs(fAngle) * kRadToDeg > fMaxDeg;
+}
+
+FaceQualityVerdict_t FaceQuality_CheckFace(FaceQuality_t *pstQuality, cvtdl_face_info_t *pstInfo) {
+    const FaceQualityConfig_t *pstConfig = &pstQuality->stConfig;
+    pstQuality->u64Faces++;
+
+    // pose_score: 1 frontal, 0 at the largest yaw/pitch allowed
+    std::memset(&pstInfo->head_pose, 0, sizeof(pstInfo->head_pose));
+    bool bPose = HAL_Detector_FaceAngle(&pstInfo->pts, &pstInfo->head_pose) == CVI_SUCCESS;
+    float fYaw = pstConfig->fMaxYaw > 0.0f ? std::fabs(pstInfo->head_pose.yaw) * kRadToDeg / pstConfig->fMaxYaw : 0.0f;
+    float fPitch =
+        pstConfig->fMaxPitch > 0.0f ? std::fabs(pstInfo->head_pose.pitch) * kRadToDeg / pstConfig->fMaxPitch : 0.0f;
+    pstInfo->pose_score = bPose ? std::max(0.0f, 1.0f - std::max(fYaw, fPitch)) : 0.0f;
+    float fSize = pstConfig->fMinSide > 0.0f ? std::min(FaceQuality_Side(&pstInfo->bbox) / (2.0f * pstConfig->fMinSide), 1.0f)
+                                             : 1.0f;
+    pstInfo->face_quality = pstInfo->bbox.score * fSize * (bPose ? pstInfo->pose_score : 1.0f);
+
+    FaceQualityVerdict_t enVerdict = FaceQuality_CheckBox(pstConfig, &pstInfo->bbox);
+    // without landmarks the pose is unknown and not held against the face
+    if (enVerdict == FACE_QUALITY_OK && bPose &&
+        (FaceQuality_Exceeds(pstInfo->head_pose.yaw, pstConfig->fMaxYaw) ||
+         FaceQuality_Exceeds(pstInfo->head_pose.pitch, pstConfig->fMaxPitch) ||
+         FaceQuality_Exceeds(pstInfo->head_pose.roll, pstConfig->fMaxRoll))) {
+        enVerdict = FACE_QUALITY_POSE;
+    }
+    pstQuality->au64Rejects[enVerdict]++;
+    return enVerdict;
+}
+
+// Variance of the 4-neighbour Laplacian of the luma, over the central half
+// of the crop where the face is
+float FaceQuality_Sharpness(const uint8_t *pu8Bgr, uint32_t u32Side) {
+    const uint32_t u32Begin = u32Side / 4 + 1;
+    const uint32_t u32End = u32Side - u32Side / 4 - 1;
+    if (u32End <= u32Begin) {
+        return 0.0f;
+    }
+    double dSum = 0.0, dSquares = 0.0;
+    uint32_t u32Count = 0;
+    for (uint32_t y = u32Begin; y < u32End; y++) {
+        for (uint32_t x = u32Begin; x < u32End; x++) {
+            const uint8_t *p = pu8Bgr + ((size_t)y * u32Side + x) * 3;
+            const ptrdiff_t row = (ptrdiff_t)u32Side * 3;
+            // luma approximated as (B + 2G + R) / 4
+            int c = p[0] + 2 * p[1] + p[2];
+            int l = p[-3] + 2 * p[-2] + p[-1];
+            int r = p[3] + 2 * p[4] + p[5];
+            int u = p[-row] + 2 * p[1 - row] + p[2 - row];
+            int d = p[row] + 2 * p[1 + row] + p[2 + row];
+            double dLap = (l + r + u + d - 4 * c) / 4.0;
+            dSum += dLap;
+            dSquares += dLap * dLap;
+            u32Count++;
+        }
+    }
+    double dMean = dSum / u32Count;
+    return (float)(dSquares / u32Count - dMean * dMean);
+}
+
+FaceQualityVerdict_t FaceQuality_CheckCrop(FaceQuality_t *pstQuality, const uint8_t *pu8Bgr, uint32_t u32Side) {
+    pstQuality->u64Crops++;
+    if (pstQuality->stConfig.fMinSharpness > 0.0f &&
+        FaceQuality_Sharpness(pu8Bgr, u32Side) < pstQuality->stConfig.fMinSharpness) {
+        pstQuality->au64Rejects[FACE_QUALITY_BLUR]++;
+        return FACE_QUALITY_BLUR;
+    }
+    return FACE_QUALITY_OK;
+}
+
+uint32_t FaceQuality_FilterMetadata(FaceQuality_t *pstQuality, cvtdl_face_t *pstFaceMeta) {
+    if (!pstQuality->stConfig.bGateMetadata || !pstFaceMeta->info) {
+        return 0;
+    }
+    uint32_t u32Kept = 0;
+    for (uint32_t i = 0; i < pstFaceMeta->size; i++) {
+        if (FaceQuality_CheckBox(&pstQuality->stConfig, &pstFaceMeta->info[i].bbox) != FACE_QUALITY_OK) {
+            continue;
+        }
+        if (u32Kept != i) {
+            pstFaceMeta->info[u32Kept] = pstFaceMeta->info[i];
+        }
+        u32Kept++;
+    }
+    uint32_t u32Dropped = pstFaceMeta->size - u32Kept;
+    pstFaceMeta->size = u32Kept;
+    pstQuality->u64MetadataDrops += u32Dropped;
+    return u32Dropped;
+}
+
+const char *FaceQuality_VerdictName(FaceQualityVerdict_t enVerdict) {
+    static const char *const s_aszName[FACE_QUALITY_COUNT] = {"ok", "score", "size", "pose", "blur"};
+    return enVerdict < FACE_QUALITY_COUNT ? s_aszName[enVerdict] : "unknown";
+}
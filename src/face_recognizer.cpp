@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "face_recognizer.h"
+#include "hal.h"
+
+// Landmark positions of an aligned 112x112 face (ArcFace template), in the
+// SCRFD order: eyes, nose, mouth corners
+static const float kAlignX[5] = {38.2946f, 73.5318f, 56.0252f, 41.5493f, 70.7299f};
+static const float kAlignY[5] = {51.6963f, 51.5014f, 71.7366f, 92.3655f, 92.2041f};
+
+static uint64_t FaceRecognizer_NowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static void FaceRecognizer_SampleBilinear(const uint8_t *pu8Src, float x, float y, uint8_t *pu8Dst) {
+    const int size = TRACK_STORE_CROP_SIZE;
+    if (x < 0.0f || y < 0.0f || x > size - 1 || y > size - 1) {
+        pu8Dst[0] = pu8Dst[1] = pu8Dst[2] = 0;
+        return;
+    }
+    int x0 = std::min((int)x, size - 2);
+    int y0 = std::min((int)y, size - 2);
+    float fx = x - x0;
+    float fy = y - y0;
+    const uint8_t *p00 = pu8Src + ((size_t)y0 * size + x0) * 3;
+    const uint8_t *p10 = p00 + 3;
+    const uint8_t *p01 = p00 + size * 3;
+    const uint8_t *p11 = p01 + 3;
+    for (int c = 0; c < 3; c++) {
+        float top = p00[c] + (p10[c] - p00[c]) * fx;
+        float bottom = p01[c] + (p11[c] - p01[c]) * fx;
+        pu8Dst[c] = (uint8_t)(top + (bottom - top) * fy + 0.5f);
+    }
+}
+
+// Warp the crop so its landmarks land on the template. The similarity
+// transform (scale, rotation, shift) is the least-squares fit, written with
+// complex numbers: template = a * landmark + b.
+static void FaceRecognizer_Align(const FaceRecogInput_t *pstInput, uint8_t *pu8Aligned) {
+    const int size = TRACK_STORE_CROP_SIZE;
+    uint32_t n = std::min<uint32_t>(pstInput->u32Pts, 5);
+    if (n < 2) {
+        // nothing to align on, use the crop as is
+        std::memcpy(pu8Aligned, pstInput->au8Crop, sizeof(pstInput->au8Crop));
+        return;
+    }
+
+    float sx = 0.0f, sy = 0.0f, dx = 0.0f, dy = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        sx += pstInput->afPtsX[i];
+        sy += pstInput->afPtsY[i];
+        dx += kAlignX[i];
+        dy += kAlignY[i];
+    }
+    sx /= n;
+    sy /= n;
+    dx /= n;
+    dy /= n;
+
+    float fNumRe = 0.0f, fNumIm = 0.0f, fDen = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        float px = pstInput->afPtsX[i] - sx;
+        float py = pstInput->afPtsY[i] - sy;
+        float qx = kAlignX[i] - dx;
+        float qy = kAlignY[i] - dy;
+        fNumRe += qx * px + qy * py;
+        fNumIm += qy * px - qx * py;
+        fDen += px * px + py * py;
+    }
+    float fNorm = fNumRe * fNumRe + fNumIm * fNumIm;
+    if (fDen <= 0.0f || fNorm <= 0.0f) {
+        std::memcpy(pu8Aligned, pstInput->au8Crop, sizeof(pstInput->au8Crop));
+        return;
+    }
+    float ar = fNumRe / fDen;
+    float ai = fNumIm / fDen;
+    float br = dx - (ar * sx - ai * sy);
+    float bi = dy - (ar * sy + ai * sx);
+
+    // inverse map: landmark = (template - b) / a
+    float fInv = 1.0f / (ar * ar + ai * ai);
+    for (int v = 0; v < size; v++) {
+        for (int u = 0; u < size; u++) {
+            float qr = u - br;
+            float qi = v - bi;
+            float x = (qr * ar + qi * ai) * fInv;
+            float y = (qi * ar - qr * ai) * fInv;
+            FaceRecognizer_SampleBilinear(pstInput->au8Crop, x, y, pu8Aligned + ((size_t)v * size + u) * 3);
+        }
+    }
+}
+
+static void FaceRecognizer_Quantize(const float *pfFeature, int8_t *ps8Feature) {
+    float fNorm = 0.0f;
+    for (int i = 0; i < FACE_RECOG_FEATURE_DIM; i++) {
+        fNorm += pfFeature[i] * pfFeature[i];
+    }
+    float fScale = fNorm > 0.0f ? 127.0f / sqrtf(fNorm) : 0.0f;
+    for (int i = 0; i < FACE_RECOG_FEATURE_DIM; i++) {
+        float v = roundf(pfFeature[i] * fScale);
+        ps8Feature[i] = (int8_t)std::min(std::max(v, -127.0f), 127.0f);
+    }
+}
+
+// Align and embed every face of the job in one network pass
+static CVI_S32 FaceRecognizer_RunJob(FaceRecognizer_t *pstRecog, FaceRecogJob_t *pstJob) {
+    const uint8_t *apu8Faces[FACE_RECOG_MAX_BATCH];
+    for (uint32_t i = 0; i < pstJob->u32Count; i++) {
+        FaceRecognizer_Align(&pstJob->astInput[i], pstRecog->au8Aligned[i]);
+        apu8Faces[i] = pstRecog->au8Aligned[i];
+    }
+
+    CVI_S32 s32Ret = HAL_Recognizer_Extract(pstRecog->pNet, apu8Faces, pstJob->u32Count,
+                                            &pstRecog->afFeatures[0][0], FACE_RECOG_FEATURE_DIM);
+
+    pstJob->stFaces.size = s32Ret == CVI_SUCCESS ? pstJob->u32Count : 0;
+    pstJob->stFaces.width = TRACK_STORE_CROP_SIZE;
+    pstJob->stFaces.height = TRACK_STORE_CROP_SIZE;
+    pstJob->stFaces.info = pstJob->astInfo;
+    pstJob->stFaces.dms = NULL;
+    for (uint32_t i = 0; i < pstJob->stFaces.size; i++) {
+        cvtdl_face_info_t *pstInfo = &pstJob->astInfo[i];
+        std::memset(pstInfo, 0, sizeof(cvtdl_face_info_t));
+        pstInfo->unique_id = pstJob->astInput[i].u64TrackId;
+        FaceRecognizer_Quantize(pstRecog->afFeatures[i], pstJob->as8Feature[i]);
+        pstInfo->feature.ptr = pstJob->as8Feature[i];
+        pstInfo->feature.size = FACE_RECOG_FEATURE_DIM;
+        pstInfo->feature.type = TYPE_INT8;
+    }
+    return s32Ret;
+}
+
+static void *FaceRecognizer_ThreadRoutine(void *pArgs) {
+    FaceRecognizer_t *pstRecog = static_cast<FaceRecognizer_t *>(pArgs);
+    // Linux nice values are per thread
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), FACE_RECOG_NICE);
+
+    pthread_mutex_lock(&pstRecog->mutex);
+    while (!pstRecog->bStop) {
+        FaceRecogJob_t *pstJob = NULL;
+        for (int i = 0; i < FACE_RECOG_JOBS; i++) {
+            if (pstRecog->astJob[i].enState == FACE_RECOG_JOB_QUEUED) {
+                pstJob = &pstRecog->astJob[i];
+                break;
+            }
+        }
+        if (!pstJob) {
+            pthread_cond_wait(&pstRecog->cond, &pstRecog->mutex);
+            continue;
+        }
+        pstJob->enState = FACE_RECOG_JOB_RUNNING;
+        pthread_mutex_unlock(&pstRecog->mutex);
+
+        uint64_t u64Start = FaceRecognizer_NowUs();
+        CVI_S32 s32Ret = FaceRecognizer_RunJob(pstRecog, pstJob);
+        uint64_t u64Elapsed = FaceRecognizer_NowUs() - u64Start;
+        if (s32Ret != CVI_SUCCESS) {
+            std::cerr << "Face recognition failed, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+        }
+
+        pthread_mutex_lock(&pstRecog->mutex);
+        pstJob->s32Result = s32Ret;
+        pstJob->enState = FACE_RECOG_JOB_DONE;
+        pstRecog->u64Embeddings += pstJob->stFaces.size;
+        pstRecog->u64Batches++;
+        pstRecog->u64BusyUs += u64Elapsed;
+    }
+    pthread_mutex_unlock(&pstRecog->mutex);
+    return nullptr;
+}
+
+CVI_S32 FaceRecognizer_Start(FaceRecognizer_t *pstRecog, const char *paramPath, const char *modelPath) {
+    if (!pstRecog || !paramPath || !modelPath) {
+        return CVI_FAILURE;
+    }
+    std::memset(pstRecog, 0, sizeof(FaceRecognizer_t));
+    CVI_S32 s32Ret = HAL_Recognizer_Open(&pstRecog->pNet, paramPath, modelPath);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    pthread_mutex_init(&pstRecog->mutex, NULL);
+    pthread_cond_init(&pstRecog->cond, NULL);
+
+    if (pthread_create(&pstRecog->thread, nullptr, FaceRecognizer_ThreadRoutine, pstRecog) != 0) {
+        std::cerr << "Failed to create face recognizer thread" << std::endl;
+        pthread_cond_destroy(&pstRecog->cond);
+        pthread_mutex_destroy(&pstRecog->mutex);
+        HAL_Recognizer_Close(pstRecog->pNet);
+        pstRecog->pNet = NULL;
+        return CVI_FAILURE;
+    }
+    pstRecog->bThreadStarted = true;
+    std::cout << "Face recognizer started: " << paramPath << ", batch up to "
+              << FACE_RECOG_MAX_BATCH << " faces" << std::endl;
+    return CVI_SUCCESS;
+}
+
+void FaceRecognizer_Stop(FaceRecognizer_t *pstRecog) {
+    if (!pstRecog || !pstRecog->bThreadStarted) {
+        return;
+    }
+    pthread_mutex_lock(&pstRecog->mutex);
+    pstRecog->bStop = true;
+    pthread_cond_broadcast(&pstRecog->cond);
+    pthread_mutex_unlock(&pstRecog->mutex);
+    pthread_join(pstRecog->thread, nullptr);
+    pstRecog->bThreadStarted = false;
+
+    double dBusy = pstRecog->u64BusyUs / 1000000.0;
+    std::cout << "Face recognizer stopped: embeddings=" << pstRecog->u64Embeddings
+              << ", batches=" << pstRecog->u64Batches
+              << ", rejected=" << pstRecog->u64Rejected;
+    if (pstRecog->u64Embeddings > 0 && dBusy > 0.0) {
+        std::cout << ", " << pstRecog->u64Embeddings / dBusy << " embeddings/s";
+    }
+    std::cout << std::endl;
+
+    HAL_Recognizer_Close(pstRecog->pNet);
+    pstRecog->pNet = NULL;
+    pthread_cond_destroy(&pstRecog->cond);
+    pthread_mutex_destroy(&pstRecog->mutex);
+}
+
+FaceRecogJob_t *FaceRecognizer_GetFreeJob(FaceRecognizer_t *pstRecog) {
+    FaceRecogJob_t *pstJob = NULL;
+    pthread_mutex_lock(&pstRecog->mutex);
+    for (int i = 0; i < FACE_RECOG_JOBS; i++) {
+        if (pstRecog->astJob[i].enState == FACE_RECOG_JOB_FREE) {
+            pstJob = &pstRecog->astJob[i];
+            pstJob->u32Count = 0;
+            break;
+        }
+    }
+    if (!pstJob) {
+        pstRecog->u64Rejected++;
+    }
+    pthread_mutex_unlock(&pstRecog->mutex);
+    return pstJob;
+}
+
+void FaceRecognizer_Submit(FaceRecognizer_t *pstRecog, FaceRecogJob_t *pstJob) {
+    pthread_mutex_lock(&pstRecog->mutex);
+    pstJob->enState = pstJob->u32Count > 0 ? FACE_RECOG_JOB_QUEUED : FACE_RECOG_JOB_FREE;
+    pthread_cond_broadcast(&pstRecog->cond);
+    pthread_mutex_unlock(&pstRecog->mutex);
+}
+
+FaceRecogJob_t *FaceRecognizer_PollDone(FaceRecognizer_t *pstRecog) {
+    FaceRecogJob_t *pstJob = NULL;
+    pthread_mutex_lock(&pstRecog->mutex);
+    for (int i = 0; i < FACE_RECOG_JOBS; i++) {
+        if (pstRecog->astJob[i].enState == FACE_RECOG_JOB_DONE) {
+            pstJob = &pstRecog->astJob[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pstRecog->mutex);
+    return pstJob;
+}
+
+void FaceRecognizer_Recycle(FaceRecognizer_t *pstRecog, FaceRecogJob_t *pstJob) {
+    pthread_mutex_lock(&pstRecog->mutex);
+    pstJob->enState = FACE_RECOG_JOB_FREE;
+    pthread_mutex_unlock(&pstRecog->mutex);
+}
+
+CVI_S32 FaceRecognizer_ExtractFile(const char *paramPath, const char *modelPath, const char *facePath,
+                                   const char *featurePath) {
+    static uint8_t s_au8Face[HAL_RECOGNIZER_INPUT_SIZE * HAL_RECOGNIZER_INPUT_SIZE * 3];
+    FILE *fp = fopen(facePath, "rb");
+    size_t read = fp ? fread(s_au8Face, 1, sizeof(s_au8Face), fp) : 0;
+    bool bExtra = fp && fgetc(fp) != EOF;
+    if (fp) {
+        fclose(fp);
+    }
+    if (read != sizeof(s_au8Face) || bExtra) {
+        std::cerr << facePath << " is not a " << HAL_RECOGNIZER_INPUT_SIZE << "x" << HAL_RECOGNIZER_INPUT_SIZE
+                  << " BGR24 face" << std::endl;
+        return CVI_FAILURE;
+    }
+
+    void *pNet = NULL;
+    CVI_S32 s32Ret = HAL_Recognizer_Open(&pNet, paramPath, modelPath);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    const uint8_t *apu8Faces[1] = {s_au8Face};
+    float afFeature[FACE_RECOG_FEATURE_DIM];
+    s32Ret = HAL_Recognizer_Extract(pNet, apu8Faces, 1, afFeature, FACE_RECOG_FEATURE_DIM);
+    HAL_Recognizer_Close(pNet);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Cannot embed " << facePath << ", ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+        return s32Ret;
+    }
+
+    int8_t as8Feature[FACE_RECOG_FEATURE_DIM];
+    FaceRecognizer_Quantize(afFeature, as8Feature);
+    fp = fopen(featurePath, "wb");
+    bool bWritten = fp && fwrite(as8Feature, 1, sizeof(as8Feature), fp) == sizeof(as8Feature);
+    if (fp && fclose(fp) != 0) {
+        bWritten = false;
+    }
+    if (!bWritten) {
+        std::cerr << "Cannot write " << featurePath << std::endl;
+        return CVI_FAILURE;
+    }
+    std::cout << "Wrote the " << FACE_RECOG_FEATURE_DIM << "-byte feature of " << facePath << " to " << featurePath
+              << std::endl;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 FaceRecognizer_Benchmark(const char *paramPath, const char *modelPath, uint32_t u32Faces) {
+    static FaceRecognizer_t s_stRecog;
+    static FaceRecogJob_t s_stJob;
+    std::memset(&s_stRecog, 0, sizeof(s_stRecog));
+    CVI_S32 s32Ret = HAL_Recognizer_Open(&s_stRecog.pNet, paramPath, modelPath);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+
+    // textured faces with landmarks at the template, so alignment is exercised too
+    std::memset(&s_stJob, 0, sizeof(s_stJob));
+    for (int i = 0; i < FACE_RECOG_MAX_BATCH; i++) {
+        FaceRecogInput_t *pstInput = &s_stJob.astInput[i];
+        pstInput->u64TrackId = i + 1;
+        pstInput->u32Pts = 5;
+        for (int p = 0; p < 5; p++) {
+            pstInput->afPtsX[p] = kAlignX[p] * 0.9f + 5.0f + i;
+            pstInput->afPtsY[p] = kAlignY[p] * 0.9f + 5.0f;
+        }
+        for (size_t b = 0; b < sizeof(pstInput->au8Crop); b++) {
+            pstInput->au8Crop[b] = (uint8_t)((b * 31 + i * 17) ^ (b >> 7));
+        }
+    }
+
+    // one untimed pass to warm up the allocators
+    s_stJob.u32Count = 1;
+    FaceRecognizer_RunJob(&s_stRecog, &s_stJob);
+
+    uint32_t u32Done = 0;
+    uint64_t u64Start = FaceRecognizer_NowUs();
+    while (u32Done < u32Faces && s32Ret == CVI_SUCCESS) {
+        s_stJob.u32Count = std::min<uint32_t>(u32Faces - u32Done, FACE_RECOG_MAX_BATCH);
+        s32Ret = FaceRecognizer_RunJob(&s_stRecog, &s_stJob);
+        u32Done += s_stJob.u32Count;
+    }
+    double dElapsed = (FaceRecognizer_NowUs() - u64Start) / 1000000.0;
+    HAL_Recognizer_Close(s_stRecog.pNet);
+
+    std::cout << "=== Recognizer Benchmark ===" << std::endl;
+    std::cout << "Backend: " << HAL_GetBackendName() << ", faces: " << u32Done
+              << ", batch: " << FACE_RECOG_MAX_BATCH << std::endl;
+    if (dElapsed > 0.0) {
+        std::cout << "Throughput: " << u32Done / dElapsed << " embeddings/s ("
+                  << dElapsed * 1000.0 / std::max<uint32_t>(u32Done, 1) << " ms/face)" << std::endl;
+    }
+    std::cout << "============================" << std::endl;
+    return s32Ret;
+}
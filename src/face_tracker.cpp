@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "face_tracker.h"
+
+static void FaceTracker_BoxToState(const cvtdl_bbox_t *pstBox, float afState[4]) {
+    afState[0] = (pstBox->x1 + pstBox->x2) / 2.0f;
+    afState[1] = (pstBox->y1 + pstBox->y2) / 2.0f;
+    afState[2] = pstBox->x2 - pstBox->x1;
+    afState[3] = pstBox->y2 - pstBox->y1;
+}
+
+static void FaceTracker_StateToBox(const float afState[4], cvtdl_bbox_t *pstBox) {
+    pstBox->x1 = afState[0] - afState[2] / 2.0f;
+    pstBox->y1 = afState[1] - afState[3] / 2.0f;
+    pstBox->x2 = afState[0] + afState[2] / 2.0f;
+    pstBox->y2 = afState[1] + afState[3] / 2.0f;
+}
+
+static float FaceTracker_Elapsed(const FaceTrack_t *pstTrack, uint64_t u64PTS) {
+    if (u64PTS <= pstTrack->u64PTS) {
+        return 0.0f;
+    }
+    uint64_t u64Dt = std::min<uint64_t>(u64PTS - pstTrack->u64PTS, FACE_TRACKER_MAX_PREDICT_US);
+    return (float)u64Dt / 1000000.0f;
+}
+
+static void FaceTracker_Extrapolate(const FaceTrack_t *pstTrack, uint64_t u64PTS, float afState[4]) {
+    float dt = FaceTracker_Elapsed(pstTrack, u64PTS);
+    for (int i = 0; i < 4; i++) {
+        afState[i] = pstTrack->afState[i] + pstTrack->afVelocity[i] * dt;
+    }
+    afState[2] = std::max(afState[2], 1.0f);
+    afState[3] = std::max(afState[3], 1.0f);
+}
+
+static float FaceTracker_IoU(const cvtdl_bbox_t *a, const cvtdl_bbox_t *b) {
+    float w = std::min(a->x2, b->x2) - std::max(a->x1, b->x1);
+    float h = std::min(a->y2, b->y2) - std::max(a->y1, b->y1);
+    if (w <= 0.0f || h <= 0.0f) {
+        return 0.0f;
+    }
+    float inter = w * h;
+    float areaA = (a->x2 - a->x1) * (a->y2 - a->y1);
+    float areaB = (b->x2 - b->x1) * (b->y2 - b->y1);
+    return inter / (areaA + areaB - inter);
+}
+
+static void FaceTracker_SetLandmarks(FaceTrack_t *pstTrack, const cvtdl_face_info_t *pstInfo) {
+    pstTrack->u32Pts = 0;
+    if (!pstInfo->pts.x || !pstInfo->pts.y) {
+        return;
+    }
+    const cvtdl_bbox_t *pstBox = &pstInfo->bbox;
+    float w = std::max(pstBox->x2 - pstBox->x1, 1.0f);
+    float h = std::max(pstBox->y2 - pstBox->y1, 1.0f);
+    pstTrack->u32Pts = std::min<uint32_t>(pstInfo->pts.size, FACE_RESULT_MAX_PTS);
+    for (uint32_t i = 0; i < pstTrack->u32Pts; i++) {
+        pstTrack->afPtsU[i] = (pstInfo->pts.x[i] - pstBox->x1) / w;
+        pstTrack->afPtsV[i] = (pstInfo->pts.y[i] - pstBox->y1) / h;
+    }
+}
+
+static void FaceTracker_Correct(FaceTrack_t *pstTrack, const cvtdl_face_info_t *pstInfo, uint64_t u64PTS) {
+    float dt = FaceTracker_Elapsed(pstTrack, u64PTS);
+    float afPredicted[4];
+    float afMeasured[4];
+    FaceTracker_Extrapolate(pstTrack, u64PTS, afPredicted);
+    FaceTracker_BoxToState(&pstInfo->bbox, afMeasured);
+    for (int i = 0; i < 4; i++) {
+        float fResidual = afMeasured[i] - afPredicted[i];
+        if (pstTrack->u32Hits == 1) {
+            // second sighting: take the velocity from the two detections
+            pstTrack->afState[i] = afMeasured[i];
+            pstTrack->afVelocity[i] = dt > 0.0f ? fResidual / dt : 0.0f;
+            continue;
+        }
+        pstTrack->afState[i] = afPredicted[i] + FACE_TRACKER_ALPHA * fResidual;
+        if (dt > 0.0f) {
+            pstTrack->afVelocity[i] += FACE_TRACKER_BETA * fResidual / dt;
+        }
+    }
+    pstTrack->u64PTS = u64PTS;
+    pstTrack->u32Misses = 0;
+    pstTrack->u32Hits++;
+    pstTrack->fScore = pstInfo->bbox.score;
+    if (pstInfo->unique_id != 0) {
+        pstTrack->u64UniqueId = pstInfo->unique_id;
+    }
+    FaceTracker_SetLandmarks(pstTrack, pstInfo);
+}
+
+void FaceTracker_Init(FaceTracker_t *pstTracker) {
+    std::memset(pstTracker, 0, sizeof(FaceTracker_t));
+    pstTracker->stOut.info = pstTracker->astOutInfo;
+}
+
+static bool FaceTracker_Inside(const cvtdl_bbox_t *pstBox, const cvtdl_bbox_t *pstWindow, float fMargin) {
+    return pstBox->x1 >= pstWindow->x1 + fMargin && pstBox->y1 >= pstWindow->y1 + fMargin &&
+           pstBox->x2 <= pstWindow->x2 - fMargin && pstBox->y2 <= pstWindow->y2 - fMargin;
+}
+
+// pstWindow: the part of the frame the detections cover, NULL for all of it.
+// Tracks not predicted entirely inside of it are not aged, detections at its
+// edge are ignored.
+static void FaceTracker_UpdateIn(FaceTracker_t *pstTracker, const cvtdl_face_t *pstFaceMeta, uint64_t u64PTS,
+                                 const cvtdl_bbox_t *pstWindow) {
+    uint32_t u32Dets = pstFaceMeta->info ? std::min<uint32_t>(pstFaceMeta->size, FACE_TRACKER_MAX_TRACKS) : 0;
+    bool abDetUsed[FACE_TRACKER_MAX_TRACKS] = {false};
+    bool abTrackUsed[FACE_TRACKER_MAX_TRACKS] = {false};
+    cvtdl_bbox_t astPredicted[FACE_TRACKER_MAX_TRACKS];
+    // may match but never miss
+    bool abOutside[FACE_TRACKER_MAX_TRACKS] = {false};
+
+    for (int t = 0; t < FACE_TRACKER_MAX_TRACKS; t++) {
+        if (pstTracker->astTrack[t].bActive) {
+            float afState[4];
+            FaceTracker_Extrapolate(&pstTracker->astTrack[t], u64PTS, afState);
+            FaceTracker_StateToBox(afState, &astPredicted[t]);
+            abOutside[t] = pstWindow && !FaceTracker_Inside(&astPredicted[t], pstWindow, 0.0f);
+        }
+    }
+    if (pstWindow) {
+        for (uint32_t d = 0; d < u32Dets; d++) {
+            abDetUsed[d] = !FaceTracker_Inside(&pstFaceMeta->info[d].bbox, pstWindow, FACE_TRACKER_WINDOW_MARGIN);
+        }
+    }
+
+    // Detections the detector-side tracker already identified
+    for (uint32_t d = 0; d < u32Dets; d++) {
+        if (pstFaceMeta->info[d].unique_id == 0) {
+            continue;
+        }
+        for (int t = 0; t < FACE_TRACKER_MAX_TRACKS; t++) {
+            if (pstTracker->astTrack[t].bActive && !abTrackUsed[t] &&
+                pstTracker->astTrack[t].u64UniqueId == pstFaceMeta->info[d].unique_id) {
+                FaceTracker_Correct(&pstTracker->astTrack[t], &pstFaceMeta->info[d], u64PTS);
+                abTrackUsed[t] = true;
+                abDetUsed[d] = true;
+                break;
+            }
+        }
+    }
+
+    // Greedy association of the rest, best overlap first
+    while (true) {
+        float fBest = FACE_TRACKER_IOU_MATCH;
+        int bestTrack = -1;
+        int bestDet = -1;
+        for (int t = 0; t < FACE_TRACKER_MAX_TRACKS; t++) {
+            if (!pstTracker->astTrack[t].bActive || abTrackUsed[t]) {
+                continue;
+            }
+            for (uint32_t d = 0; d < u32Dets; d++) {
+                uint64_t u64Id = pstFaceMeta->info[d].unique_id;
+                // never hand a track over to a different identity
+                if (abDetUsed[d] || (u64Id != 0 && pstTracker->astTrack[t].u64UniqueId != 0 &&
+                                     u64Id != pstTracker->astTrack[t].u64UniqueId)) {
+                    continue;
+                }
+                float fIoU = FaceTracker_IoU(&astPredicted[t], &pstFaceMeta->info[d].bbox);
+                if (fIoU >= fBest) {
+                    fBest = fIoU;
+                    bestTrack = t;
+                    bestDet = (int)d;
+                }
+            }
+        }
+        if (bestTrack < 0) {
+            break;
+        }
+        abTrackUsed[bestTrack] = true;
+        abDetUsed[bestDet] = true;
+
+        FaceTracker_Correct(&pstTracker->astTrack[bestTrack], &pstFaceMeta->info[bestDet], u64PTS);
+    }
+
+    // Age out tracks without a detection
+    for (int t = 0; t < FACE_TRACKER_MAX_TRACKS; t++) {
+        FaceTrack_t *pstTrack = &pstTracker->astTrack[t];
+        if (pstTrack->bActive && !abTrackUsed[t] && !abOutside[t] && ++pstTrack->u32Misses > FACE_TRACKER_MAX_MISSES) {
+            pstTrack->bActive = false;
+        }
+    }
+
+    // Start new tracks, at rest
+    for (uint32_t d = 0; d < u32Dets; d++) {
+        if (abDetUsed[d]) {
+            continue;
+        }
+        for (int t = 0; t < FACE_TRACKER_MAX_TRACKS; t++) {
+            FaceTrack_t *pstTrack = &pstTracker->astTrack[t];
+            if (!pstTrack->bActive) {
+                std::memset(pstTrack, 0, sizeof(FaceTrack_t));
+                pstTrack->bActive = true;
+                pstTrack->u32Hits = 1;
+                pstTrack->u64PTS = u64PTS;
+                pstTrack->u64UniqueId = pstFaceMeta->info[d].unique_id;
+                pstTrack->fScore = pstFaceMeta->info[d].bbox.score;
+                FaceTracker_BoxToState(&pstFaceMeta->info[d].bbox, pstTrack->afState);
+                FaceTracker_SetLandmarks(pstTrack, &pstFaceMeta->info[d]);
+                break;
+            }
+        }
+    }
+
+    pstTracker->stOut.width = pstFaceMeta->width;
+    pstTracker->stOut.height = pstFaceMeta->height;
+    pstTracker->stOut.rescale_type = pstFaceMeta->rescale_type;
+}
+
+void FaceTracker_Update(FaceTracker_t *pstTracker, const cvtdl_face_t *pstFaceMeta, uint64_t u64PTS) {
+    FaceTracker_UpdateIn(pstTracker, pstFaceMeta, u64PTS, NULL);
+}
+
+void FaceTracker_UpdateWindow(FaceTracker_t *pstTracker, const cvtdl_face_t *pstFaceMeta, uint64_t u64PTS,
+                              const cvtdl_bbox_t *pstWindow) {
+    FaceTracker_UpdateIn(pstTracker, pstFaceMeta, u64PTS, pstWindow);
+}
+
+cvtdl_face_t *FaceTracker_Predict(FaceTracker_t *pstTracker, uint64_t u64PTS) {
+    cvtdl_face_t *pstOut = &pstTracker->stOut;
+    pstOut->size = 0;
+    pstOut->info = pstTracker->astOutInfo;
+    pstOut->dms = NULL;
+
+    for (int t = 0; t < FACE_TRACKER_MAX_TRACKS; t++) {
+        const FaceTrack_t *pstTrack = &pstTracker->astTrack[t];
+        // tracks that missed the last detection are not drawn
+        if (!pstTrack->bActive || pstTrack->u32Misses > 0) {
+            continue;
+        }
+        uint32_t n = pstOut->size++;
+        cvtdl_face_info_t *pstInfo = &pstTracker->astOutInfo[n];
+        std::memset(pstInfo, 0, sizeof(cvtdl_face_info_t));
+
+        float afState[4];
+        FaceTracker_Extrapolate(pstTrack, u64PTS, afState);
+        FaceTracker_StateToBox(afState, &pstInfo->bbox);
+        pstInfo->bbox.score = pstTrack->fScore;
+        pstInfo->unique_id = pstTrack->u64UniqueId;
+        pstInfo->score = pstTrack->fScore;
+
+        pstInfo->pts.x = pstTracker->afOutPtsX[n];
+        pstInfo->pts.y = pstTracker->afOutPtsY[n];
+        pstInfo->pts.size = pstTrack->u32Pts;
+        for (uint32_t i = 0; i < pstTrack->u32Pts; i++) {
+            pstInfo->pts.x[i] = pstInfo->bbox.x1 + pstTrack->afPtsU[i] * afState[2];
+            pstInfo->pts.y[i] = pstInfo->bbox.y1 + pstTrack->afPtsV[i] * afState[3];
+        }
+    }
+    return pstOut;
+}
+
+uint32_t FaceTracker_ActiveCount(const FaceTracker_t *pstTracker) {
+    uint32_t u32Count = 0;
+    for (int t = 0; t < FACE_TRACKER_MAX_TRACKS; t++) {
+        if (pstTracker->astTrack[t].bActive && pstTracker->astTrack[t].u32Misses == 0) {
+            u32Count++;
+        }
+    }
+    return u32Count;
+}
+
+float FaceTracker_Motion(const FaceTracker_t *pstTracker) {
+    float fMotion = 0.0f;
+    for (int t = 0; t < FACE_TRACKER_MAX_TRACKS; t++) {
+        const FaceTrack_t *pstTrack = &pstTracker->astTrack[t];
+        if (!pstTrack->bActive || pstTrack->u32Misses > 0) {
+            continue;
+        }
+        // a single detection says nothing about speed yet
+        if (pstTrack->u32Hits < 2) {
+            fMotion = std::max(fMotion, FACE_TRACKER_NEW_TRACK_MOTION);
+            continue;
+        }
+        float fSpeed = std::sqrt(pstTrack->afVelocity[0] * pstTrack->afVelocity[0] +
+                                 pstTrack->afVelocity[1] * pstTrack->afVelocity[1]);
+        float fSize = std::max(std::max(pstTrack->afState[2], pstTrack->afState[3]), 1.0f);
+        fMotion = std::max(fMotion, fSpeed / fSize);
+    }
+    return fMotion;
+}
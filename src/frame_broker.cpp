@@ -0,0 +1,231 @@
+#include <iostream>
+#include <cstring>
+#include <time.h>
+#include "frame_broker.h"
+#include "shared_data.h"
+#include "hal.h"
+
+static void FrameBroker_Deadline(struct timespec *pstTs, CVI_S32 s32MilliSec) {
+    clock_gettime(CLOCK_REALTIME, pstTs);
+    pstTs->tv_sec += s32MilliSec / 1000;
+    pstTs->tv_nsec += (long)(s32MilliSec % 1000) * 1000000L;
+    if (pstTs->tv_nsec >= 1000000000L) {
+        pstTs->tv_sec++;
+        pstTs->tv_nsec -= 1000000000L;
+    }
+}
+
+// Called with the mutex held
+static void FrameBroker_ReturnIfUnused(FrameBroker_t *pstBroker, FrameBrokerSlot_t *pstSlot) {
+    if (pstSlot->u64Seq != 0 && pstSlot->s32Ref == 0 && !pstSlot->bRetained) {
+        HAL_FrameSource_ReleaseFrame(pstBroker->grp, pstBroker->chn, &pstSlot->stFrame);
+        pstSlot->u64Seq = 0;
+        pstSlot->bWriteLocked = false;
+    }
+}
+
+static void *FrameBroker_ThreadRoutine(void *pArgs) {
+    FrameBroker_t *pstBroker = static_cast<FrameBroker_t *>(pArgs);
+    VIDEO_FRAME_INFO_S stFrame;
+
+    while (!g_bExit) {
+        CVI_S32 s32Ret = HAL_FrameSource_GetFrame(pstBroker->grp, pstBroker->chn, &stFrame, 2000);
+        if (s32Ret != CVI_SUCCESS) {
+            std::cerr << "CVI_VPSS_GetChnFrame chn" << pstBroker->chn << " failed with 0x"
+                      << std::hex << s32Ret << std::dec << std::endl;
+            pthread_mutex_lock(&pstBroker->mutex);
+            pstBroker->s32Error = s32Ret;
+            pthread_mutex_unlock(&pstBroker->mutex);
+            break;
+        }
+
+        pthread_mutex_lock(&pstBroker->mutex);
+        FrameBrokerSlot_t *pstFree = NULL;
+        for (int i = 0; i < FRAME_BROKER_DEPTH; i++) {
+            if (pstBroker->astSlot[i].u64Seq == 0) {
+                pstFree = &pstBroker->astSlot[i];
+                break;
+            }
+        }
+        if (!pstFree) {
+            // every slot is still held by consumers
+            pstBroker->u64Dropped++;
+            HAL_FrameSource_ReleaseFrame(pstBroker->grp, pstBroker->chn, &stFrame);
+            pthread_mutex_unlock(&pstBroker->mutex);
+            continue;
+        }
+
+        pstFree->stFrame = stFrame;
+        pstFree->u64Seq = ++pstBroker->u64Seq;
+        pstFree->s32Ref = 0;
+        pstFree->bRetained = true;
+        pstFree->bWriteLocked = false;
+
+        for (int i = 0; i < FRAME_BROKER_DEPTH; i++) {
+            FrameBrokerSlot_t *pstSlot = &pstBroker->astSlot[i];
+            if (pstSlot->bRetained && pstSlot->u64Seq + FRAME_BROKER_RETAIN <= pstBroker->u64Seq) {
+                pstSlot->bRetained = false;
+                FrameBroker_ReturnIfUnused(pstBroker, pstSlot);
+            }
+        }
+        pthread_cond_broadcast(&pstBroker->cond);
+        pthread_mutex_unlock(&pstBroker->mutex);
+    }
+
+    pthread_mutex_lock(&pstBroker->mutex);
+    pstBroker->bStopped = true;
+    pthread_cond_broadcast(&pstBroker->cond);
+    pthread_mutex_unlock(&pstBroker->mutex);
+    return nullptr;
+}
+
+CVI_S32 FrameBroker_Start(FrameBroker_t *pstBroker, VPSS_GRP grp, VPSS_CHN chn) {
+    if (!pstBroker) {
+        return CVI_FAILURE;
+    }
+    std::memset(pstBroker->astSlot, 0, sizeof(pstBroker->astSlot));
+    pstBroker->grp = grp;
+    pstBroker->chn = chn;
+    pstBroker->u64Seq = 0;
+    pstBroker->u64Dropped = 0;
+    pstBroker->s32Error = CVI_SUCCESS;
+    pstBroker->bStopped = false;
+    pthread_mutex_init(&pstBroker->mutex, NULL);
+    pthread_cond_init(&pstBroker->cond, NULL);
+
+    if (pthread_create(&pstBroker->thread, nullptr, FrameBroker_ThreadRoutine, pstBroker) != 0) {
+        std::cerr << "Failed to create frame broker thread" << std::endl;
+        pthread_cond_destroy(&pstBroker->cond);
+        pthread_mutex_destroy(&pstBroker->mutex);
+        pstBroker->bThreadStarted = false;
+        return CVI_FAILURE;
+    }
+    pstBroker->bThreadStarted = true;
+    std::cout << "Frame broker started on VPSS Grp(" << grp << ") Chn(" << chn << ")" << std::endl;
+    return CVI_SUCCESS;
+}
+
+void FrameBroker_Stop(FrameBroker_t *pstBroker) {
+    if (!pstBroker || !pstBroker->bThreadStarted) {
+        return;
+    }
+    pthread_join(pstBroker->thread, nullptr);
+    pstBroker->bThreadStarted = false;
+
+    pthread_mutex_lock(&pstBroker->mutex);
+    for (int i = 0; i < FRAME_BROKER_DEPTH; i++) {
+        FrameBrokerSlot_t *pstSlot = &pstBroker->astSlot[i];
+        if (pstSlot->s32Ref != 0) {
+            std::cerr << "Frame broker: frame " << pstSlot->u64Seq << " still held by "
+                      << pstSlot->s32Ref << " consumer(s)" << std::endl;
+        }
+        pstSlot->bRetained = false;
+        pstSlot->s32Ref = 0;
+        FrameBroker_ReturnIfUnused(pstBroker, pstSlot);
+    }
+    pthread_mutex_unlock(&pstBroker->mutex);
+
+    std::cout << "Frame broker stopped: frames=" << pstBroker->u64Seq
+              << ", dropped=" << pstBroker->u64Dropped << std::endl;
+    pthread_cond_destroy(&pstBroker->cond);
+    pthread_mutex_destroy(&pstBroker->mutex);
+}
+
+CVI_S32 FrameBroker_Acquire(FrameBroker_t *pstBroker, uint64_t *pu64Cursor, bool bLatest,
+                            FrameBrokerSlot_t **ppstSlot, CVI_S32 s32MilliSec) {
+    struct timespec stDeadline;
+    FrameBroker_Deadline(&stDeadline, s32MilliSec);
+
+    pthread_mutex_lock(&pstBroker->mutex);
+    while (true) {
+        FrameBrokerSlot_t *pstBest = NULL;
+        for (int i = 0; i < FRAME_BROKER_DEPTH; i++) {
+            FrameBrokerSlot_t *pstSlot = &pstBroker->astSlot[i];
+            if (!pstSlot->bRetained || pstSlot->bWriteLocked || pstSlot->u64Seq <= *pu64Cursor) {
+                continue;
+            }
+            if (!pstBest || (bLatest ? pstSlot->u64Seq > pstBest->u64Seq
+                                     : pstSlot->u64Seq < pstBest->u64Seq)) {
+                pstBest = pstSlot;
+            }
+        }
+        if (pstBest) {
+            pstBest->s32Ref++;
+            *pu64Cursor = pstBest->u64Seq;
+            *ppstSlot = pstBest;
+            pthread_mutex_unlock(&pstBroker->mutex);
+            return CVI_SUCCESS;
+        }
+        if (pstBroker->bStopped) {
+            CVI_S32 s32Ret = pstBroker->s32Error != CVI_SUCCESS ? pstBroker->s32Error : CVI_FAILURE;
+            pthread_mutex_unlock(&pstBroker->mutex);
+            return s32Ret;
+        }
+        if (pthread_cond_timedwait(&pstBroker->cond, &pstBroker->mutex, &stDeadline) != 0) {
+            pthread_mutex_unlock(&pstBroker->mutex);
+            return CVI_ERR_VPSS_BUF_EMPTY;
+        }
+    }
+}
+
+CVI_S32 FrameBroker_AcquirePTS(FrameBroker_t *pstBroker, uint64_t u64PTS,
+                               FrameBrokerSlot_t **ppstSlot, CVI_S32 s32MilliSec) {
+    struct timespec stDeadline;
+    FrameBroker_Deadline(&stDeadline, s32MilliSec);
+
+    pthread_mutex_lock(&pstBroker->mutex);
+    while (true) {
+        bool bPassed = false;
+        for (int i = 0; i < FRAME_BROKER_DEPTH; i++) {
+            FrameBrokerSlot_t *pstSlot = &pstBroker->astSlot[i];
+            if (pstSlot->u64Seq == 0) {
+                continue;
+            }
+            uint64_t u64SlotPTS = pstSlot->stFrame.stVFrame.u64PTS;
+            // also frames only kept alive by other consumers
+            if (u64SlotPTS == u64PTS && !pstSlot->bWriteLocked) {
+                pstSlot->s32Ref++;
+                *ppstSlot = pstSlot;
+                pthread_mutex_unlock(&pstBroker->mutex);
+                return CVI_SUCCESS;
+            }
+            bPassed = bPassed || u64SlotPTS >= u64PTS;
+        }
+        if (bPassed || pstBroker->bStopped) {
+            pthread_mutex_unlock(&pstBroker->mutex);
+            return CVI_FAILURE;
+        }
+        if (pthread_cond_timedwait(&pstBroker->cond, &pstBroker->mutex, &stDeadline) != 0) {
+            pthread_mutex_unlock(&pstBroker->mutex);
+            return CVI_ERR_VPSS_BUF_EMPTY;
+        }
+    }
+}
+
+void FrameBroker_Release(FrameBroker_t *pstBroker, FrameBrokerSlot_t *pstSlot) {
+    pthread_mutex_lock(&pstBroker->mutex);
+    if (pstSlot->s32Ref > 0) {
+        pstSlot->s32Ref--;
+    }
+    FrameBroker_ReturnIfUnused(pstBroker, pstSlot);
+    pthread_cond_broadcast(&pstBroker->cond);
+    pthread_mutex_unlock(&pstBroker->mutex);
+}
+
+CVI_S32 FrameBroker_LockForWrite(FrameBroker_t *pstBroker, FrameBrokerSlot_t *pstSlot,
+                                 CVI_S32 s32MilliSec) {
+    struct timespec stDeadline;
+    FrameBroker_Deadline(&stDeadline, s32MilliSec);
+
+    pthread_mutex_lock(&pstBroker->mutex);
+    // stop handing the frame out first, then wait for current readers
+    pstSlot->bWriteLocked = true;
+    while (pstSlot->s32Ref > 1) {
+        if (pthread_cond_timedwait(&pstBroker->cond, &pstBroker->mutex, &stDeadline) != 0) {
+            pthread_mutex_unlock(&pstBroker->mutex);
+            return CVI_FAILURE;
+        }
+    }
+    pthread_mutex_unlock(&pstBroker->mutex);
+    return CVI_SUCCESS;
+}
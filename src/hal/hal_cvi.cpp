@@ -0,0 +1,564 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include "hal.h"
+
+extern "C" {
+#include <cvi_region.h>
+#include <cvi_sys.h>
+#include <cvi_venc.h>
+#include <cvi_vpss.h>
+#include "middleware_utils.h"
+}
+
+const char *HAL_GetBackendName() {
+    return "cvi";
+}
+
+CVI_S32 HAL_System_Init(SystemConfig_t *pstConfig, SAMPLE_TDL_MW_CONTEXT *pstMWContext) {
+    return SystemInit_All(pstConfig, pstMWContext);
+}
+
+void HAL_System_Cleanup(SAMPLE_TDL_MW_CONTEXT *pstMWContext) {
+    SystemInit_Cleanup(pstMWContext);
+}
+
+CVI_S32 HAL_FrameSource_GetFrame(VPSS_GRP grp, VPSS_CHN chn, VIDEO_FRAME_INFO_S *pstFrame,
+                                 CVI_S32 s32MilliSec) {
+    return CVI_VPSS_GetChnFrame(grp, chn, pstFrame, s32MilliSec);
+}
+
+CVI_S32 HAL_FrameSource_ReleaseFrame(VPSS_GRP grp, VPSS_CHN chn, VIDEO_FRAME_INFO_S *pstFrame) {
+    return CVI_VPSS_ReleaseChnFrame(grp, chn, pstFrame);
+}
+
+static size_t HAL_FrameSize(VIDEO_FRAME_INFO_S *pstFrame) {
+    return pstFrame->stVFrame.u32Length[0] + pstFrame->stVFrame.u32Length[1] +
+           pstFrame->stVFrame.u32Length[2];
+}
+
+CVI_S32 HAL_FrameSource_SetCrop(VPSS_GRP grp, VPSS_CHN chn, const RECT_S *pstRect) {
+    VPSS_CROP_INFO_S stCropInfo;
+    std::memset(&stCropInfo, 0, sizeof(stCropInfo));
+    stCropInfo.bEnable = CVI_TRUE;
+    stCropInfo.enCropCoordinate = VPSS_CROP_ABS_COOR;
+    stCropInfo.stCropRect = *pstRect;
+    CVI_S32 s32Ret = CVI_VPSS_SetChnCrop(grp, chn, &stCropInfo);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "CVI_VPSS_SetChnCrop failed with 0x" << std::hex << s32Ret << std::endl;
+    }
+    return s32Ret;
+}
+
+void HAL_FrameSource_Mmap(VIDEO_FRAME_INFO_S *pstFrame) {
+    size_t image_size = HAL_FrameSize(pstFrame);
+    pstFrame->stVFrame.pu8VirAddr[0] =
+        (uint8_t *)CVI_SYS_Mmap(pstFrame->stVFrame.u64PhyAddr[0], image_size);
+    pstFrame->stVFrame.pu8VirAddr[1] =
+        pstFrame->stVFrame.pu8VirAddr[0] + pstFrame->stVFrame.u32Length[0];
+    pstFrame->stVFrame.pu8VirAddr[2] =
+        pstFrame->stVFrame.pu8VirAddr[1] + pstFrame->stVFrame.u32Length[1];
+}
+
+void HAL_FrameSource_Munmap(VIDEO_FRAME_INFO_S *pstFrame) {
+    CVI_SYS_Munmap(pstFrame->stVFrame.pu8VirAddr[0], HAL_FrameSize(pstFrame));
+    pstFrame->stVFrame.pu8VirAddr[0] = NULL;
+    pstFrame->stVFrame.pu8VirAddr[1] = NULL;
+    pstFrame->stVFrame.pu8VirAddr[2] = NULL;
+}
+
+CVI_S32 HAL_FrameSource_DumpFrame(const char *filepath, VIDEO_FRAME_INFO_S *pstFrame) {
+    return CVI_TDL_DumpVpssFrame(filepath, pstFrame);
+}
+
+CVI_S32 HAL_Detector_Open(cvitdl_handle_t *pTdlHandle, cvitdl_service_handle_t *pServiceHandle,
+                          const char *modelPath) {
+    // Create TDL handle and assign VPSS Grp1 Device 0 to TDL SDK
+    CVI_S32 s32Ret = CVI_TDL_CreateHandle2(pTdlHandle, 1, 0);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to create TDL handle, ret=0x" << std::hex << s32Ret << std::endl;
+        return s32Ret;
+    }
+
+    // Set VPSS timeout
+    CVI_TDL_SetVpssTimeout(*pTdlHandle, 1000);
+
+    // Create service handle
+    s32Ret = CVI_TDL_Service_CreateHandle(pServiceHandle, *pTdlHandle);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to create service handle, ret=0x" << std::hex << s32Ret << std::endl;
+        CVI_TDL_DestroyHandle(*pTdlHandle);
+        return s32Ret;
+    }
+
+    // Open face detection model
+    s32Ret = CVI_TDL_OpenModel(*pTdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, modelPath);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to open model, ret=0x" << std::hex << s32Ret << std::endl;
+        CVI_TDL_Service_DestroyHandle(*pServiceHandle);
+        CVI_TDL_DestroyHandle(*pTdlHandle);
+        return s32Ret;
+    }
+
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Detector_OpenRoi(cvitdl_handle_t *pTdlHandle, const char *modelPath) {
+    // VPSS Grp2 Device 0, Grp1 belongs to the main detector
+    CVI_S32 s32Ret = CVI_TDL_CreateHandle2(pTdlHandle, 2, 0);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to create ROI TDL handle, ret=0x" << std::hex << s32Ret << std::endl;
+        return s32Ret;
+    }
+    CVI_TDL_SetVpssTimeout(*pTdlHandle, 1000);
+
+    s32Ret = CVI_TDL_OpenModel(*pTdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, modelPath);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to open ROI model, ret=0x" << std::hex << s32Ret << std::endl;
+        CVI_TDL_DestroyHandle(*pTdlHandle);
+        *pTdlHandle = NULL;
+        return s32Ret;
+    }
+    return CVI_SUCCESS;
+}
+
+void HAL_Detector_Close(cvitdl_handle_t tdlHandle, cvitdl_service_handle_t serviceHandle) {
+    if (serviceHandle) {
+        CVI_TDL_Service_DestroyHandle(serviceHandle);
+    }
+    if (tdlHandle) {
+        CVI_TDL_DestroyHandle(tdlHandle);
+    }
+}
+
+CVI_S32 HAL_Detector_SetPreprocessPool(cvitdl_handle_t tdlHandle, CVI_U32 u32PoolId) {
+    CVI_S32 s32Ret = CVI_TDL_SetVBPool(tdlHandle, 0, u32PoolId);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to set VBPool, ret=0x" << std::hex << s32Ret << std::endl;
+    }
+    return s32Ret;
+}
+
+CVI_S32 HAL_Detector_BindInputChannel(cvitdl_handle_t tdlHandle, VPSS_GRP grp, VPSS_CHN chn,
+                                      const SIZE_S *pstSrcSize, const SIZE_S *pstChnSize) {
+    cvtdl_vpssconfig_t stVpssConfig;
+    CVI_S32 s32Ret = CVI_TDL_GetVpssChnConfig(tdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE,
+                                              pstSrcSize->u32Width, pstSrcSize->u32Height, 0,
+                                              &stVpssConfig);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to get model VPSS config, ret=0x" << std::hex << s32Ret << std::endl;
+        return s32Ret;
+    }
+
+    VPSS_CHN_ATTR_S *pstChnAttr = &stVpssConfig.chn_attr;
+    if (pstChnAttr->u32Width != pstChnSize->u32Width ||
+        pstChnAttr->u32Height != pstChnSize->u32Height) {
+        std::cerr << "Model input " << pstChnAttr->u32Width << "x" << pstChnAttr->u32Height
+                  << " does not match detect channel " << pstChnSize->u32Width << "x"
+                  << pstChnSize->u32Height << std::endl;
+        return CVI_FAILURE;
+    }
+    // the SDK exports depth 0, we pull the channel ourselves
+    pstChnAttr->u32Depth = 1;
+
+    s32Ret = CVI_VPSS_SetChnAttr(grp, chn, pstChnAttr);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "CVI_VPSS_SetChnAttr failed with 0x" << std::hex << s32Ret << std::endl;
+        return s32Ret;
+    }
+    s32Ret = CVI_VPSS_SetChnScaleCoefLevel(grp, chn, stVpssConfig.chn_coeff);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "CVI_VPSS_SetChnScaleCoefLevel failed with 0x" << std::hex << s32Ret << std::endl;
+        return s32Ret;
+    }
+
+    s32Ret = CVI_TDL_SetSkipVpssPreprocess(tdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, true);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to skip VPSS preprocess, ret=0x" << std::hex << s32Ret << std::endl;
+    }
+    return s32Ret;
+}
+
+CVI_S32 HAL_Detector_RescaleFaceMeta(const SIZE_S *pstDstSize, cvtdl_face_t *pstFaceMeta) {
+    // only the geometry of the destination frame is used
+    VIDEO_FRAME_INFO_S stDstFrame;
+    std::memset(&stDstFrame, 0, sizeof(stDstFrame));
+    stDstFrame.stVFrame.u32Width = pstDstSize->u32Width;
+    stDstFrame.stVFrame.u32Height = pstDstSize->u32Height;
+
+    if (pstFaceMeta->rescale_type == RESCALE_RB) {
+        return CVI_TDL_RescaleMetaRBCpp(&stDstFrame, pstFaceMeta);
+    }
+    return CVI_TDL_RescaleMetaCenterCpp(&stDstFrame, pstFaceMeta);
+}
+
+CVI_S32 HAL_Detector_DetectFace(cvitdl_handle_t tdlHandle, VIDEO_FRAME_INFO_S *pstFrame,
+                                cvtdl_face_t *pstFaceMeta) {
+    return CVI_TDL_FaceDetection(tdlHandle, pstFrame, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE,
+                                 pstFaceMeta);
+}
+
+CVI_S32 HAL_Detector_GetThresholds(cvitdl_handle_t tdlHandle, float *pfScore, float *pfNms) {
+    CVI_S32 s32Ret = CVI_TDL_GetModelThreshold(tdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, pfScore);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    return CVI_TDL_GetModelNmsThreshold(tdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, pfNms);
+}
+
+CVI_S32 HAL_Detector_SetThresholds(cvitdl_handle_t tdlHandle, float fScore, float fNms) {
+    CVI_S32 s32Ret = CVI_TDL_SetModelThreshold(tdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, fScore);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    return CVI_TDL_SetModelNmsThreshold(tdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, fNms);
+}
+
+void HAL_Detector_FreeFaceMeta(cvtdl_face_t *pstFaceMeta) {
+    CVI_TDL_Free(pstFaceMeta);
+}
+
+CVI_S32 HAL_Detector_FaceAngle(const cvtdl_pts_t *pstPts, cvtdl_head_pose_t *pstPose) {
+    return CVI_TDL_Service_FaceAngle(pstPts, pstPose);
+}
+
+CVI_S32 HAL_Tracker_Open(cvitdl_handle_t tdlHandle) {
+    // one ID counter, faces are the only tracked class
+    CVI_S32 s32Ret = CVI_TDL_DeepSORT_Init(tdlHandle, false);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to init DeepSORT, ret=0x" << std::hex << s32Ret << std::endl;
+        return s32Ret;
+    }
+
+    // No re-identification features are extracted, so matching falls back to
+    // box overlap. Detection runs on a subset of frames: allow a few misses.
+    cvtdl_deepsort_config_t stConfig;
+    CVI_TDL_DeepSORT_GetDefaultConfig(&stConfig);
+    stConfig.ktracker_conf.max_unmatched_num = 10;
+    stConfig.max_unmatched_times_for_bbox_matching = 10;
+    s32Ret = CVI_TDL_DeepSORT_SetConfig(tdlHandle, &stConfig, -1, false);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to set DeepSORT config, ret=0x" << std::hex << s32Ret << std::endl;
+    }
+    return s32Ret;
+}
+
+CVI_S32 HAL_Tracker_TrackFace(cvitdl_handle_t tdlHandle, cvtdl_face_t *pstFaceMeta,
+                              cvtdl_tracker_t *pstTracker) {
+    return CVI_TDL_DeepSORT_Face(tdlHandle, pstFaceMeta, pstTracker);
+}
+
+void HAL_Tracker_FreeResult(cvtdl_tracker_t *pstTracker) {
+    CVI_TDL_Free(pstTracker);
+}
+
+typedef struct {
+    cvitdl_handle_t tdlHandle;
+    cvitdl_service_handle_t serviceHandle;
+    std::vector<int8_t> rows;      // the SDK keeps a pointer to the registered array
+    uint32_t u32Dim;
+} HalRefMatcher_t;
+
+void HAL_RefMatcher_Close(void *pHandle) {
+    HalRefMatcher_t *pstRef = (HalRefMatcher_t *)pHandle;
+    if (!pstRef) {
+        return;
+    }
+    if (pstRef->serviceHandle) {
+        CVI_TDL_Service_DestroyHandle(pstRef->serviceHandle);
+    }
+    if (pstRef->tdlHandle) {
+        CVI_TDL_DestroyHandle(pstRef->tdlHandle);
+    }
+    delete pstRef;
+}
+
+CVI_S32 HAL_RefMatcher_Open(void **ppHandle, const int8_t *ps8Rows, uint32_t u32Rows, uint32_t u32Dim) {
+    HalRefMatcher_t *pstRef = new HalRefMatcher_t();
+    pstRef->rows.assign(ps8Rows, ps8Rows + (size_t)u32Rows * u32Dim);
+    pstRef->u32Dim = u32Dim;
+    *ppHandle = NULL;
+
+    CVI_S32 s32Ret = CVI_TDL_CreateHandle(&pstRef->tdlHandle);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to create reference TDL handle, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+        HAL_RefMatcher_Close(pstRef);
+        return s32Ret;
+    }
+    s32Ret = CVI_TDL_Service_CreateHandle(&pstRef->serviceHandle, pstRef->tdlHandle);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to create reference service handle, ret=0x" << std::hex << s32Ret << std::dec
+                  << std::endl;
+        HAL_RefMatcher_Close(pstRef);
+        return s32Ret;
+    }
+    cvtdl_service_feature_array_t stArray;
+    stArray.ptr = pstRef->rows.data();
+    stArray.feature_length = u32Dim;
+    stArray.data_num = u32Rows;
+    stArray.type = TYPE_INT8;
+    s32Ret = CVI_TDL_Service_RegisterFeatureArray(pstRef->serviceHandle, stArray, COS_SIMILARITY);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Failed to register reference features, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+        HAL_RefMatcher_Close(pstRef);
+        return s32Ret;
+    }
+    *ppHandle = pstRef;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_RefMatcher_Match(void *pHandle, const int8_t *ps8Query, uint32_t u32TopK, uint32_t *pu32Indices,
+                             float *pfScores, uint32_t *pu32Size) {
+    HalRefMatcher_t *pstRef = (HalRefMatcher_t *)pHandle;
+    cvtdl_face_info_t stInfo;
+    std::memset(&stInfo, 0, sizeof(stInfo));
+    stInfo.feature.ptr = (int8_t *)ps8Query;
+    stInfo.feature.size = pstRef->u32Dim;
+    stInfo.feature.type = TYPE_INT8;
+    return CVI_TDL_Service_FaceInfoMatching(pstRef->serviceHandle, &stInfo, u32TopK, 0.0f, pu32Indices, pfScores,
+                                            pu32Size);
+}
+
+static MMF_CHN_S HAL_Osd_Chn(VPSS_GRP grp, VPSS_CHN chn) {
+    MMF_CHN_S stChn;
+    stChn.enModId = CVI_ID_VPSS;
+    stChn.s32DevId = grp;
+    stChn.s32ChnId = chn;
+    return stChn;
+}
+
+CVI_S32 HAL_Osd_CreateCanvas(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, const SIZE_S *pstSize) {
+    RGN_ATTR_S stRegion;
+    std::memset(&stRegion, 0, sizeof(stRegion));
+    stRegion.enType = OVERLAY_RGN;
+    stRegion.unAttr.stOverlay.enPixelFormat = PIXEL_FORMAT_ARGB_1555;
+    stRegion.unAttr.stOverlay.u32BgColor = 0;
+    stRegion.unAttr.stOverlay.stSize = *pstSize;
+    stRegion.unAttr.stOverlay.u32CanvasNum = 2;
+    stRegion.unAttr.stOverlay.stCompressInfo.enOSDCompressMode = OSD_COMPRESS_MODE_NONE;
+    CVI_S32 s32Ret = CVI_RGN_Create(handle, &stRegion);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    RGN_CHN_ATTR_S stChnAttr;
+    std::memset(&stChnAttr, 0, sizeof(stChnAttr));
+    stChnAttr.bShow = CVI_TRUE;
+    stChnAttr.enType = OVERLAY_RGN;
+    stChnAttr.unChnAttr.stOverlayChn.stPoint.s32X = 0;
+    stChnAttr.unChnAttr.stOverlayChn.stPoint.s32Y = 0;
+    stChnAttr.unChnAttr.stOverlayChn.u32Layer = 0;
+    MMF_CHN_S stChn = HAL_Osd_Chn(grp, chn);
+    s32Ret = CVI_RGN_AttachToChn(handle, &stChn, &stChnAttr);
+    if (s32Ret != CVI_SUCCESS) {
+        CVI_RGN_Destroy(handle);
+    }
+    return s32Ret;
+}
+
+CVI_S32 HAL_Osd_GetCanvas(RGN_HANDLE handle, HalOsdCanvas_t *pstCanvas) {
+    RGN_CANVAS_INFO_S stInfo;
+    std::memset(&stInfo, 0, sizeof(stInfo));
+    CVI_S32 s32Ret = CVI_RGN_GetCanvasInfo(handle, &stInfo);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    pstCanvas->pu8Data = stInfo.pu8VirtAddr;
+    pstCanvas->u64PhyAddr = stInfo.u64PhyAddr;
+    pstCanvas->u32Stride = stInfo.u32Stride;
+    pstCanvas->stSize = stInfo.stSize;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Osd_UpdateCanvas(RGN_HANDLE handle) {
+    return CVI_RGN_UpdateCanvas(handle);
+}
+
+CVI_S32 HAL_Osd_CreateCover(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, const RECT_S *pstRect, CVI_U32 u32Rgb) {
+    RGN_ATTR_S stRegion;
+    std::memset(&stRegion, 0, sizeof(stRegion));
+    stRegion.enType = COVER_RGN;
+    CVI_S32 s32Ret = CVI_RGN_Create(handle, &stRegion);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    RGN_CHN_ATTR_S stChnAttr;
+    std::memset(&stChnAttr, 0, sizeof(stChnAttr));
+    stChnAttr.bShow = CVI_TRUE;
+    stChnAttr.enType = COVER_RGN;
+    stChnAttr.unChnAttr.stCoverChn.enCoverType = AREA_RECT;
+    stChnAttr.unChnAttr.stCoverChn.stRect = *pstRect;
+    stChnAttr.unChnAttr.stCoverChn.u32Color = u32Rgb;
+    stChnAttr.unChnAttr.stCoverChn.u32Layer = 0;
+    stChnAttr.unChnAttr.stCoverChn.enCoordinate = RGN_ABS_COOR;
+    MMF_CHN_S stChn = HAL_Osd_Chn(grp, chn);
+    s32Ret = CVI_RGN_AttachToChn(handle, &stChn, &stChnAttr);
+    if (s32Ret != CVI_SUCCESS) {
+        CVI_RGN_Destroy(handle);
+    }
+    return s32Ret;
+}
+
+CVI_S32 HAL_Osd_Show(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, bool bShow) {
+    MMF_CHN_S stChn = HAL_Osd_Chn(grp, chn);
+    RGN_CHN_ATTR_S stChnAttr;
+    CVI_S32 s32Ret = CVI_RGN_GetDisplayAttr(handle, &stChn, &stChnAttr);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    stChnAttr.bShow = bShow ? CVI_TRUE : CVI_FALSE;
+    return CVI_RGN_SetDisplayAttr(handle, &stChn, &stChnAttr);
+}
+
+void HAL_Osd_Destroy(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn) {
+    MMF_CHN_S stChn = HAL_Osd_Chn(grp, chn);
+    CVI_RGN_DetachFromChn(handle, &stChn);
+    CVI_RGN_Destroy(handle);
+}
+
+CVI_S32 HAL_Encoder_SendFrame(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VIDEO_FRAME_INFO_S *pstFrame,
+                              CVI_S32 s32MilliSec) {
+    return CVI_VENC_SendFrame(pstMWContext->u32VencChn, pstFrame, s32MilliSec);
+}
+
+CVI_S32 HAL_Encoder_GetFd(SAMPLE_TDL_MW_CONTEXT *pstMWContext) {
+    return CVI_VENC_GetFd(pstMWContext->u32VencChn);
+}
+
+CVI_S32 HAL_Encoder_QueryPacks(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 *pu32PackCount) {
+    VENC_CHN_STATUS_S stStat;
+    CVI_S32 s32Ret = CVI_VENC_QueryStatus(pstMWContext->u32VencChn, &stStat);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    *pu32PackCount = stStat.u32CurPacks;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Encoder_GetStream(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream,
+                              CVI_S32 s32MilliSec) {
+    return CVI_VENC_GetStream(pstMWContext->u32VencChn, pstStream, s32MilliSec);
+}
+
+CVI_S32 HAL_Encoder_ReleaseStream(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream) {
+    return CVI_VENC_ReleaseStream(pstMWContext->u32VencChn, pstStream);
+}
+
+static void HAL_Encoder_BindChns(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VPSS_GRP grp, VPSS_CHN chn,
+                                 MMF_CHN_S *pstSrc, MMF_CHN_S *pstDst) {
+    pstSrc->enModId = CVI_ID_VPSS;
+    pstSrc->s32DevId = grp;
+    pstSrc->s32ChnId = chn;
+    pstDst->enModId = CVI_ID_VENC;
+    pstDst->s32DevId = 0;
+    pstDst->s32ChnId = pstMWContext->u32VencChn;
+}
+
+CVI_S32 HAL_Encoder_Bind(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VPSS_GRP grp, VPSS_CHN chn) {
+    MMF_CHN_S stSrc, stDst;
+    HAL_Encoder_BindChns(pstMWContext, grp, chn, &stSrc, &stDst);
+    return CVI_SYS_Bind(&stSrc, &stDst);
+}
+
+void HAL_Encoder_Unbind(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VPSS_GRP grp, VPSS_CHN chn) {
+    MMF_CHN_S stSrc, stDst;
+    HAL_Encoder_BindChns(pstMWContext, grp, chn, &stSrc, &stDst);
+    CVI_S32 s32Ret = CVI_SYS_UnBind(&stSrc, &stDst);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "CVI_SYS_UnBind failed with 0x" << std::hex << s32Ret << std::dec << std::endl;
+    }
+}
+
+CVI_S32 HAL_Encoder_SetRoi(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32Index, bool bEnable,
+                           const RECT_S *pstRect, CVI_S32 s32Qp) {
+    VENC_ROI_ATTR_S stRoi;
+    std::memset(&stRoi, 0, sizeof(VENC_ROI_ATTR_S));
+    stRoi.u32Index = u32Index;
+    stRoi.bEnable = bEnable ? CVI_TRUE : CVI_FALSE;
+    stRoi.bAbsQp = CVI_FALSE;
+    stRoi.s32Qp = s32Qp;
+    if (pstRect) {
+        stRoi.stRect = *pstRect;
+    }
+    return CVI_VENC_SetRoiAttr(pstMWContext->u32VencChn, &stRoi);
+}
+
+CVI_S32 HAL_Encoder_SetRoiBgFrameRate(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32SrcFps, CVI_U32 u32DstFps) {
+    VENC_ROIBG_FRAME_RATE_S stRate;
+    stRate.s32SrcFrmRate = (CVI_S32)u32SrcFps;
+    stRate.s32DstFrmRate = (CVI_S32)u32DstFps;
+    return CVI_VENC_SetRoiBgFrameRate(pstMWContext->u32VencChn, &stRate);
+}
+
+CVI_S32 HAL_Encoder_SetRate(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32BitrateKbps, CVI_U32 u32Gop) {
+    VENC_CHN_ATTR_S stAttr;
+    CVI_S32 s32Ret = CVI_VENC_GetChnAttr(pstMWContext->u32VencChn, &stAttr);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+
+    // H.265 shares the H.264 rate control structures
+    VENC_RC_ATTR_S *pstRc = &stAttr.stRcAttr;
+    switch (pstRc->enRcMode) {
+    case VENC_RC_MODE_H264CBR:
+    case VENC_RC_MODE_H265CBR:
+        pstRc->stH264Cbr.u32BitRate = u32BitrateKbps;
+        pstRc->stH264Cbr.u32Gop = u32Gop ? u32Gop : pstRc->stH264Cbr.u32Gop;
+        break;
+    case VENC_RC_MODE_H264VBR:
+    case VENC_RC_MODE_H265VBR:
+        pstRc->stH264Vbr.u32MaxBitRate = u32BitrateKbps;
+        pstRc->stH264Vbr.u32Gop = u32Gop ? u32Gop : pstRc->stH264Vbr.u32Gop;
+        break;
+    case VENC_RC_MODE_H264AVBR:
+    case VENC_RC_MODE_H265AVBR:
+        pstRc->stH264AVbr.u32MaxBitRate = u32BitrateKbps;
+        pstRc->stH264AVbr.u32Gop = u32Gop ? u32Gop : pstRc->stH264AVbr.u32Gop;
+        break;
+    default:
+        return CVI_ERR_VENC_NOT_SUPPORT;
+    }
+    return CVI_VENC_SetChnAttr(pstMWContext->u32VencChn, &stAttr);
+}
+
+CVI_S32 HAL_StreamSink_Write(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream) {
+    CVI_RTSP_DATA data;
+    std::memset(&data, 0, sizeof(CVI_RTSP_DATA));
+
+    data.blockCnt = pstStream->u32PackCount;
+    for (CVI_U32 i = 0; i < pstStream->u32PackCount; i++) {
+        VENC_PACK_S *ppack = &pstStream->pstPack[i];
+        data.dataPtr[i] = ppack->pu8Addr + ppack->u32Offset;
+        data.dataLen[i] = ppack->u32Len - ppack->u32Offset;
+    }
+
+    return CVI_RTSP_WriteFrame(pstMWContext->pstRtspContext, pstMWContext->pstSession->video,
+                               &data);
+}
+
+int HAL_Gpio_Setup() {
+    if (wiringXSetup(const_cast<char *>("milkv_duo256m"), NULL) == -1) {
+        wiringXGC();
+        return -1;
+    }
+    return 0;
+}
+
+void HAL_Gpio_Release() {
+    wiringXGC();
+}
+
+int HAL_Gpio_PinMode(int pin, enum pinmode_t mode) {
+    return pinMode(pin, mode);
+}
+
+int HAL_Gpio_ValidGPIO(int pin) {
+    return wiringXValidGPIO(pin);
+}
+
+int HAL_Gpio_DigitalRead(int pin) {
+    return digitalRead(pin);
+}
+
+int HAL_Gpio_DigitalWrite(int pin, enum digital_value_t value) {
+    return digitalWrite(pin, value);
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <cstring>
+#include <net.h>
+#include "hal.h"
+
+// Threads per inference; the C906 runs Linux on a single core
+#define HAL_RECOGNIZER_THREADS 1
+
+// Blob names of models/mobilefacenet.param
+#define HAL_RECOGNIZER_INPUT_BLOB "data"
+#define HAL_RECOGNIZER_OUTPUT_BLOB "fc1"
+
+typedef struct {
+    ncnn::Net net;
+    // reused by every extractor, so steady-state inference does not allocate
+    ncnn::UnlockedPoolAllocator blobAllocator;
+    ncnn::PoolAllocator workspaceAllocator;
+} HalRecognizer_t;
+
+CVI_S32 HAL_Recognizer_Open(void **ppHandle, const char *paramPath, const char *modelPath) {
+    HalRecognizer_t *pstRecog = new HalRecognizer_t();
+    pstRecog->net.opt.num_threads = HAL_RECOGNIZER_THREADS;
+    pstRecog->net.opt.lightmode = true;
+    // only takes effect with a model quantized by ncnn2int8, fp32 models run as is
+    pstRecog->net.opt.use_int8_inference = true;
+    pstRecog->net.opt.use_packing_layout = true;
+    pstRecog->net.opt.blob_allocator = &pstRecog->blobAllocator;
+    pstRecog->net.opt.workspace_allocator = &pstRecog->workspaceAllocator;
+
+    if (pstRecog->net.load_param(paramPath) != 0) {
+        std::cerr << "Failed to load recognizer param " << paramPath << std::endl;
+        delete pstRecog;
+        return CVI_FAILURE;
+    }
+    if (pstRecog->net.load_model(modelPath) != 0) {
+        std::cerr << "Failed to load recognizer model " << modelPath << std::endl;
+        delete pstRecog;
+        return CVI_FAILURE;
+    }
+    *ppHandle = pstRecog;
+    return CVI_SUCCESS;
+}
+
+void HAL_Recognizer_Close(void *pHandle) {
+    HalRecognizer_t *pstRecog = static_cast<HalRecognizer_t *>(pHandle);
+    if (pstRecog) {
+        pstRecog->net.clear();
+        delete pstRecog;
+    }
+}
+
+CVI_S32 HAL_Recognizer_Extract(void *pHandle, const uint8_t *const *ppu8Faces, uint32_t u32Count,
+                               float *pfFeatures, uint32_t u32Dim) {
+    HalRecognizer_t *pstRecog = static_cast<HalRecognizer_t *>(pHandle);
+    if (!pstRecog || !ppu8Faces || !pfFeatures) {
+        return CVI_FAILURE;
+    }
+    // NCNN has no batch dimension: one extractor per face on the shared net
+    for (uint32_t i = 0; i < u32Count; i++) {
+        ncnn::Mat in = ncnn::Mat::from_pixels(ppu8Faces[i], ncnn::Mat::PIXEL_BGR2RGB,
+                                              HAL_RECOGNIZER_INPUT_SIZE, HAL_RECOGNIZER_INPUT_SIZE,
+                                              &pstRecog->blobAllocator);
+        ncnn::Extractor ex = pstRecog->net.create_extractor();
+        ex.input(HAL_RECOGNIZER_INPUT_BLOB, in);
+        ncnn::Mat out;
+        if (ex.extract(HAL_RECOGNIZER_OUTPUT_BLOB, out) != 0) {
+            std::cerr << "Recognizer inference failed" << std::endl;
+            return CVI_FAILURE;
+        }
+        ncnn::Mat flat = out.reshape(out.w * out.h * out.c);
+        uint32_t u32Size = (uint32_t)flat.w < u32Dim ? (uint32_t)flat.w : u32Dim;
+        float *pfDst = pfFeatures + (size_t)i * u32Dim;
+        std::memcpy(pfDst, (const float *)flat, sizeof(float) * u32Size);
+        std::memset(pfDst + u32Size, 0, sizeof(float) * (u32Dim - u32Size));
+    }
+    return CVI_SUCCESS;
+}
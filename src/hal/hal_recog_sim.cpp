@@ -0,0 +1,56 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "hal.h"
+
+// Stand-in for the NCNN recognizer: the embedding is a coarse luma thumbnail
+// of the face, so the same crop always maps to the same vector. SIM_RECOG_MS
+// emulates the per-face inference time.
+
+typedef struct {
+    uint32_t u32InferMs;
+} SimRecognizer_t;
+
+CVI_S32 HAL_Recognizer_Open(void **ppHandle, const char *paramPath, const char *modelPath) {
+    (void)paramPath;
+    (void)modelPath;
+    SimRecognizer_t *pstRecog = new SimRecognizer_t();
+    const char *value = getenv("SIM_RECOG_MS");
+    pstRecog->u32InferMs = (value && *value) ? (uint32_t)strtoul(value, NULL, 10) : 0;
+    std::cout << "Simulator recognizer: " << pstRecog->u32InferMs << " ms per face" << std::endl;
+    *ppHandle = pstRecog;
+    return CVI_SUCCESS;
+}
+
+void HAL_Recognizer_Close(void *pHandle) {
+    delete static_cast<SimRecognizer_t *>(pHandle);
+}
+
+CVI_S32 HAL_Recognizer_Extract(void *pHandle, const uint8_t *const *ppu8Faces, uint32_t u32Count,
+                               float *pfFeatures, uint32_t u32Dim) {
+    SimRecognizer_t *pstRecog = static_cast<SimRecognizer_t *>(pHandle);
+    if (!pstRecog || !ppu8Faces || !pfFeatures || u32Dim == 0) {
+        return CVI_FAILURE;
+    }
+    if (pstRecog->u32InferMs) {
+        usleep(pstRecog->u32InferMs * 1000 * u32Count);
+    }
+
+    // u32Dim cells of a near-square grid
+    uint32_t u32Cols = 1;
+    while (u32Cols * u32Cols < u32Dim) {
+        u32Cols++;
+    }
+    const uint32_t u32Size = HAL_RECOGNIZER_INPUT_SIZE;
+    for (uint32_t i = 0; i < u32Count; i++) {
+        float *pfDst = pfFeatures + (size_t)i * u32Dim;
+        for (uint32_t d = 0; d < u32Dim; d++) {
+            uint32_t x = (d % u32Cols) * u32Size / u32Cols + u32Size / u32Cols / 2;
+            uint32_t y = (d / u32Cols) * u32Size / u32Cols + u32Size / u32Cols / 2;
+            const uint8_t *pu8Bgr = ppu8Faces[i] + ((size_t)y * u32Size + x) * 3;
+            pfDst[d] = (0.114f * pu8Bgr[0] + 0.587f * pu8Bgr[1] + 0.299f * pu8Bgr[2]) / 255.0f - 0.5f;
+        }
+    }
+    return CVI_SUCCESS;
+}
@@ -0,0 +1,1434 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "hal.h"
+
+// Host simulator backend.
+//
+// Tunables (environment variables):
+//   SIM_WIDTH / SIM_HEIGHT  sensor and encoder frame size (SystemConfig_t::stVencSize); the
+//                           detect channel of SYSTEM_DETECT_MODEL_CHN produces stDetectSize
+//   SIM_FPS                 capture rate of the synthetic sensor (30)
+//   SIM_FRAMES              stop the frame source after N frames, 0 = run forever (0)
+//   SIM_INFER_MS            emulated TPU latency of one detection (0); a detector bound
+//                           to a channel takes it in proportion to the channel area
+//                           over SYSTEM_DETECT_WIDTH x SYSTEM_DETECT_HEIGHT
+//   SIM_BITRATE             emulated encoder bitrate in kbps (u32VencBitrateKbps)
+//   SIM_BRINGUP_MS          emulated VI/ISP/VPSS/VENC bring-up time of HAL_System_Init (0)
+//   SIM_LOAD_MS             emulated model load time of each detector opened (0)
+//   SIM_SINK_MS             emulated RTSP write time of each encoded frame (0); above
+//                           one frame period the encoder fills up and drops frames
+//
+// Encoded frames queue up to SIM_VENC_QUEUE deep until fetched, like the VENC
+// bitstream buffer; HAL_Encoder_GetFd is an eventfd readable while one waits.
+// A bound channel (HAL_Encoder_Bind) is encoded by a simulator thread.
+// In CBR (SystemConfig_t::enVencRc) every frame is sized for the bitrate. In
+// VBR a 16x16 macroblock in a region (HAL_Encoder_SetRoi) costs 2^(-qp/6) of
+// that, one outside the regions in a frame skipped by
+// HAL_Encoder_SetRoiBgFrameRate SIM_SKIP_MB_COST, and a frame never more
+// than the bitrate allows.
+//
+// Region overlays (HAL_Osd_*) are blended into the luma of the channel they
+// are attached to as its frames are delivered, like the VPSS hardware does.
+//
+// The detector "model path" may point to a text script with one face per line:
+//   <frame> <x1> <y1> <x2> <y2> [score]
+// Faces scoring under the detector's score threshold (0.5 until
+// HAL_Detector_SetThresholds) are not reported.
+// A line holding only <frame> adds no face. The script loops over its last
+// frame index. Any other path (e.g. a .cvimodel) selects the built-in script:
+// one face orbiting the crosshair and one crossing the frame horizontally.
+// The faces of the main detector's script are drawn on the frames as textured
+// squares over a still vertical gradient, so frames only change where a face
+// moves. Script coordinates are sensor pixels; a detector reading a cropped
+// channel (center ROI) only sees the faces inside the crop.
+
+#define SIM_VB_BLK_COUNT 5
+#define SIM_GOP 60
+#define SIM_SCORE_THRESHOLD 0.5f
+#define SIM_NMS_THRESHOLD 0.4f
+#define SIM_HEADER_PACKS 3
+#define SIM_VENC_QUEUE 4
+#define SIM_MAX_BITRATE_KBPS 50000
+#define SIM_MAX_REGIONS 8
+#define SIM_SKIP_MB_COST 0.05f
+
+typedef struct {
+    VENC_PACK_S astPack[1 + SIM_HEADER_PACKS];
+    CVI_U32 u32Packs;
+    CVI_U32 u32Seq;
+} SimVencFrame_t;
+
+typedef struct {
+    CVI_U8 *pu8Data;
+    bool bInUse;
+    std::vector<RECT_S> painted;     // face squares to erase before the block is reused
+} SimBlock_t;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    CVI_U32 u32Width;
+    CVI_U32 u32Height;
+    PIXEL_FORMAT_E enPixelFormat;
+    SimBlock_t astBlk[SIM_VB_BLK_COUNT];
+    bool bCrop;
+    RECT_S stCrop;
+    CVI_U64 u64NextSeq;
+    CVI_U64 u64Delivered;
+    CVI_U64 u64Dropped;
+} SimChannel_t;
+
+// Opaque pixels of a canvas row with the same luma
+typedef struct {
+    RECT_S stRect;                   // one row high
+    CVI_U8 u8Y;
+} SimOsdRun_t;
+
+typedef struct {
+    bool bUsed;
+    RGN_HANDLE handle;
+    RGN_TYPE_E enType;
+    VPSS_CHN chn;
+    bool bShow;
+    RECT_S stRect;                   // COVER_RGN
+    CVI_U8 u8Y;
+    SIZE_S stSize;                   // OVERLAY_RGN
+    std::vector<CVI_U16> canvas[2];
+    CVI_U32 u32Front;                // buffer on display
+    std::vector<SimOsdRun_t> runs;   // of the buffer on display
+} SimRegion_t;
+
+typedef struct {
+    CVI_U64 u64Seq;
+    cvtdl_bbox_t bbox;
+} SimScriptFace_t;
+
+typedef struct {
+    CVI_U64 u64Id;
+    cvtdl_bbox_t bbox;
+    CVI_U32 u32Hits;
+    CVI_U32 u32Misses;
+} SimTrack_t;
+
+typedef struct {
+    std::vector<SimScriptFace_t> faces;
+    CVI_U64 u64Period;
+    bool bBuiltin;
+    CVI_U32 u32InferMs;
+    float fScoreThreshold;
+    float fNmsThreshold;             // kept for HAL_Detector_GetThresholds, scripts hold no overlaps
+    std::vector<SimTrack_t> tracks;
+    CVI_U64 u64NextTrackId;
+} SimDetector_t;
+
+static struct {
+    CVI_U32 u32Width;
+    CVI_U32 u32Height;
+    CVI_U32 u32Fps;
+    CVI_U64 u64MaxFrames;
+    CVI_U32 u32InferMs;
+    CVI_U32 u32BitrateKbps;
+    CVI_U32 u32Gop;
+    bool bVbr;
+    CVI_U64 u64StartUs;
+    SimChannel_t astChn[VPSS_MAX_PHY_CHN_NUM];
+    SimDetector_t *pstScene;         // detector whose script is drawn on the frames
+
+    pthread_mutex_t osdMutex;
+    SimRegion_t astRegion[SIM_MAX_REGIONS];
+    CVI_U64 u64OsdUpdates;
+
+    pthread_mutex_t vencMutex;
+    pthread_cond_t vencCond;         // a frame was queued
+    pthread_cond_t vencSpaceCond;    // a frame was fetched
+    std::vector<CVI_U8> vencBuf;     // payload of every pack, sized for SIM_MAX_BITRATE_KBPS
+    SimVencFrame_t astQueue[SIM_VENC_QUEUE];
+    CVI_U32 u32QueueHead;
+    CVI_U32 u32Queued;
+    int s32VencFd;                   // eventfd, counts the queued frames
+    CVI_U64 u64EncodedFrames;
+    CVI_U64 u64VencDropped;          // submitted while the queue was full
+    bool bBound;
+    VPSS_CHN bindChn;
+    pthread_t bindThread;
+    bool abRoi[VENC_MAX_ROI_NUM];
+    RECT_S astRoi[VENC_MAX_ROI_NUM];
+    CVI_S32 as32RoiQp[VENC_MAX_ROI_NUM];
+    float fRoiCost;                  // macroblocks in a region, weighted by their QP, over all macroblocks
+    float fBgShare;                  // macroblocks outside the regions over all of them
+    CVI_U32 u32BgSrcFps;
+    CVI_U32 u32BgDstFps;
+    CVI_U64 u64SinkPackets;
+    CVI_U64 u64SinkBytes;
+    CVI_U32 u32SinkMs;
+} s_stSim;
+
+static CVI_U64 SimNowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (CVI_U64)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static CVI_U32 SimEnvU32(const char *name, CVI_U32 u32Default) {
+    const char *value = getenv(name);
+    if (!value || !*value) {
+        return u32Default;
+    }
+    return (CVI_U32)strtoul(value, NULL, 10);
+}
+
+static CVI_U32 SimAlign(CVI_U32 u32Value, CVI_U32 u32Align) {
+    return (u32Value + u32Align - 1) / u32Align * u32Align;
+}
+
+const char *HAL_GetBackendName() {
+    return "sim";
+}
+
+// Initial content of buffer row u32Row (planes follow each other)
+static CVI_U8 SimBackground(CVI_U32 u32Row) {
+    return u32Row < s_stSim.u32Height ? (CVI_U8)(16 + (u32Row * 200) / s_stSim.u32Height) : 128;
+}
+
+static CVI_U8 SimBrushLuma(float r, float g, float b) {
+    float y = 0.257f * r + 0.504f * g + 0.098f * b + 16.0f;
+    return (CVI_U8)(y < 0.0f ? 0.0f : (y > 255.0f ? 255.0f : y));
+}
+
+CVI_S32 HAL_System_Init(SystemConfig_t *pstConfig, SAMPLE_TDL_MW_CONTEXT *pstMWContext) {
+    std::memset(pstMWContext, 0, sizeof(SAMPLE_TDL_MW_CONTEXT));
+
+    s_stSim.u32Width = SimEnvU32("SIM_WIDTH", pstConfig->stVencSize.u32Width);
+    s_stSim.u32Height = SimEnvU32("SIM_HEIGHT", pstConfig->stVencSize.u32Height);
+    s_stSim.u32Fps = SimEnvU32("SIM_FPS", 30);
+    s_stSim.u64MaxFrames = SimEnvU32("SIM_FRAMES", 0);
+    s_stSim.u32InferMs = SimEnvU32("SIM_INFER_MS", 0);
+    s_stSim.u32BitrateKbps = std::min<CVI_U32>(SimEnvU32("SIM_BITRATE", pstConfig->u32VencBitrateKbps),
+                                               SIM_MAX_BITRATE_KBPS);
+    if (s_stSim.u32Width == 0 || s_stSim.u32Height == 0 || s_stSim.u32Fps == 0 ||
+        (s_stSim.u32Width & 1) || (s_stSim.u32Height & 1)) {
+        std::cerr << "Invalid simulator geometry " << s_stSim.u32Width << "x" << s_stSim.u32Height
+                  << "@" << s_stSim.u32Fps << std::endl;
+        return CVI_FAILURE;
+    }
+
+    pstConfig->stSensorSize.u32Width = s_stSim.u32Width;
+    pstConfig->stSensorSize.u32Height = s_stSim.u32Height;
+    pstConfig->stVencSize.u32Width = s_stSim.u32Width;
+    pstConfig->stVencSize.u32Height = s_stSim.u32Height;
+
+    CVI_U32 u32Stride = SimAlign(s_stSim.u32Width, DEFAULT_ALIGN);
+    size_t frameSize = (size_t)u32Stride * s_stSim.u32Height * 3 / 2;
+    for (int c = 0; c < VPSS_MAX_PHY_CHN_NUM; c++) {
+        SimChannel_t *pstChn = &s_stSim.astChn[c];
+        pthread_mutex_init(&pstChn->mutex, NULL);
+        pthread_cond_init(&pstChn->cond, NULL);
+        pstChn->u64NextSeq = 0;
+        pstChn->u64Delivered = 0;
+        pstChn->u64Dropped = 0;
+        pstChn->u32Width = s_stSim.u32Width;
+        pstChn->u32Height = s_stSim.u32Height;
+        pstChn->enPixelFormat = PIXEL_FORMAT_NV21;
+        pstChn->bCrop = false;
+        if (c == SYSTEM_DETECT_VPSS_CHN && pstConfig->enDetectInput == SYSTEM_DETECT_MODEL_CHN) {
+            // model input, planar BGR; fits the NV21 blocks as long as it is not larger than the sensor
+            pstChn->u32Width = std::min(pstConfig->stDetectSize.u32Width, s_stSim.u32Width);
+            pstChn->u32Height = std::min(pstConfig->stDetectSize.u32Height, s_stSim.u32Height);
+            pstChn->enPixelFormat = PIXEL_FORMAT_BGR_888_PLANAR;
+        }
+        if (c == SYSTEM_ROI_VPSS_CHN && pstConfig->bCenterRoi) {
+            if (pstConfig->enDetectInput != SYSTEM_DETECT_MODEL_CHN) {
+                std::cerr << "Center ROI needs the model-sized detect channel, disabled" << std::endl;
+                pstConfig->bCenterRoi = false;
+            } else {
+                pstChn->u32Width = std::min(pstConfig->stRoiSize.u32Width, s_stSim.u32Width);
+                pstChn->u32Height = std::min(pstConfig->stRoiSize.u32Height, s_stSim.u32Height);
+                pstChn->enPixelFormat = PIXEL_FORMAT_BGR_888_PLANAR;
+            }
+        }
+        // rows at the channel's own stride, as SimPaint erases them
+        CVI_U32 u32ChnStride = SimAlign(pstChn->u32Width, DEFAULT_ALIGN);
+        for (int b = 0; b < SIM_VB_BLK_COUNT; b++) {
+            // Vertical luma gradient, neutral chroma
+            CVI_U8 *pu8Data = (CVI_U8 *)malloc(frameSize);
+            if (!pu8Data) {
+                std::cerr << "Simulator out of memory" << std::endl;
+                return CVI_FAILURE;
+            }
+            for (size_t r = 0; r < frameSize / u32ChnStride; r++) {
+                std::memset(pu8Data + r * u32ChnStride, SimBackground((CVI_U32)r), u32ChnStride);
+            }
+            pstChn->astBlk[b].pu8Data = pu8Data;
+            pstChn->astBlk[b].bInUse = false;
+        }
+    }
+
+    if (pstConfig->bEncodeChn) {
+        // every channel produces full NV21 frames unless configured otherwise
+        pstConfig->encodeChn = SystemInit_EncodeChn(pstConfig);
+        if (pstConfig->encodeChn < 0) {
+            std::cerr << "No VPSS channel left for the encoder, region overlays disabled" << std::endl;
+            pstConfig->bEncodeChn = false;
+        }
+    }
+
+    pthread_mutex_init(&s_stSim.osdMutex, NULL);
+    s_stSim.u64OsdUpdates = 0;
+    pthread_mutex_init(&s_stSim.vencMutex, NULL);
+    pthread_cond_init(&s_stSim.vencCond, NULL);
+    pthread_cond_init(&s_stSim.vencSpaceCond, NULL);
+    s_stSim.u32Gop = SIM_GOP;
+    s_stSim.bVbr = pstConfig->enVencRc == SYSTEM_RC_VBR;
+    std::memset(s_stSim.abRoi, 0, sizeof(s_stSim.abRoi));
+    s_stSim.fRoiCost = 0.0f;
+    s_stSim.fBgShare = 1.0f;
+    s_stSim.u32BgSrcFps = 1;
+    s_stSim.u32BgDstFps = 1;
+    s_stSim.vencBuf.assign(SIM_MAX_BITRATE_KBPS * 1000 / 8 / s_stSim.u32Fps * 2 + 64, 0);
+    s_stSim.u32QueueHead = 0;
+    s_stSim.u32Queued = 0;
+    s_stSim.s32VencFd = eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE | EFD_CLOEXEC);
+    s_stSim.u64EncodedFrames = 0;
+    s_stSim.u64VencDropped = 0;
+    s_stSim.bBound = false;
+    s_stSim.u64SinkPackets = 0;
+    s_stSim.u64SinkBytes = 0;
+    s_stSim.u32SinkMs = SimEnvU32("SIM_SINK_MS", 0);
+    usleep(SimEnvU32("SIM_BRINGUP_MS", 0) * 1000);
+    s_stSim.u64StartUs = SimNowUs();
+
+    std::cout << "Simulator: " << s_stSim.u32Width << "x" << s_stSim.u32Height << "@"
+              << s_stSim.u32Fps << "fps NV21, " << SIM_VB_BLK_COUNT << " blocks/chn" << std::endl;
+    return CVI_SUCCESS;
+}
+
+void HAL_System_Cleanup(SAMPLE_TDL_MW_CONTEXT *pstMWContext) {
+    double elapsed = (SimNowUs() - s_stSim.u64StartUs) / 1000000.0;
+    std::cout << "=== Simulator Report ===" << std::endl;
+    std::cout << "Elapsed: " << elapsed << " s" << std::endl;
+    for (int c = 0; c < VPSS_MAX_PHY_CHN_NUM; c++) {
+        SimChannel_t *pstChn = &s_stSim.astChn[c];
+        if (pstChn->u64Delivered) {
+            std::cout << "VPSS chn" << c << ": delivered=" << pstChn->u64Delivered
+                      << " dropped=" << pstChn->u64Dropped
+                      << " fps=" << pstChn->u64Delivered / elapsed << std::endl;
+        }
+        for (int b = 0; b < SIM_VB_BLK_COUNT; b++) {
+            free(pstChn->astBlk[b].pu8Data);
+            pstChn->astBlk[b].pu8Data = NULL;
+        }
+        pthread_cond_destroy(&pstChn->cond);
+        pthread_mutex_destroy(&pstChn->mutex);
+    }
+    std::cout << "VENC: encoded=" << s_stSim.u64EncodedFrames << " dropped=" << s_stSim.u64VencDropped
+              << " fps=" << s_stSim.u64EncodedFrames / elapsed << std::endl;
+    std::cout << "Sink: packets=" << s_stSim.u64SinkPackets << " bytes=" << s_stSim.u64SinkBytes
+              << std::endl;
+    if (s_stSim.u64OsdUpdates) {
+        std::cout << "OSD: canvas updates=" << s_stSim.u64OsdUpdates << std::endl;
+    }
+    std::cout << "========================" << std::endl;
+    if (s_stSim.s32VencFd >= 0) {
+        close(s_stSim.s32VencFd);
+    }
+    pthread_cond_destroy(&s_stSim.vencCond);
+    pthread_cond_destroy(&s_stSim.vencSpaceCond);
+    pthread_mutex_destroy(&s_stSim.vencMutex);
+    pthread_mutex_destroy(&s_stSim.osdMutex);
+    (void)pstMWContext;
+}
+
+static void SimDetector_Faces(const SimDetector_t *pstDet, CVI_U64 u64Seq, std::vector<cvtdl_bbox_t> &boxes);
+
+// Sensor box to channel coordinates, through the channel crop. False when
+// less than half of the box is left.
+static bool SimChannel_MapBox(const SimChannel_t *pstChn, cvtdl_bbox_t *pstBox) {
+    RECT_S stView = {0, 0, s_stSim.u32Width, s_stSim.u32Height};
+    if (pstChn->bCrop) {
+        stView = pstChn->stCrop;
+    }
+    float fScaleX = (float)pstChn->u32Width / (float)stView.u32Width;
+    float fScaleY = (float)pstChn->u32Height / (float)stView.u32Height;
+    cvtdl_bbox_t box = *pstBox;
+    box.x1 = std::max(box.x1 - stView.s32X, 0.0f) * fScaleX;
+    box.x2 = std::min(box.x2 - stView.s32X, (float)stView.u32Width) * fScaleX;
+    box.y1 = std::max(box.y1 - stView.s32Y, 0.0f) * fScaleY;
+    box.y2 = std::min(box.y2 - stView.s32Y, (float)stView.u32Height) * fScaleY;
+    float fArea = (pstBox->x2 - pstBox->x1) * (pstBox->y2 - pstBox->y1) * fScaleX * fScaleY;
+    if (box.x2 <= box.x1 || box.y2 <= box.y1 || (box.x2 - box.x1) * (box.y2 - box.y1) < 0.5f * fArea) {
+        return false;
+    }
+    *pstBox = box;
+    return true;
+}
+
+// Draw (or erase) a face square on every luma/colour plane of a block
+static void SimPaint(const SimChannel_t *pstChn, CVI_U8 *pu8Data, const RECT_S *pstRect, bool bErase) {
+    CVI_U32 u32Stride = SimAlign(pstChn->u32Width, DEFAULT_ALIGN);
+    CVI_U32 u32Planes = pstChn->enPixelFormat == PIXEL_FORMAT_BGR_888_PLANAR ? 3 : 1;
+    for (CVI_U32 p = 0; p < u32Planes; p++) {
+        for (CVI_U32 y = (CVI_U32)pstRect->s32Y; y < pstRect->s32Y + pstRect->u32Height; y++) {
+            CVI_U32 u32Row = p * pstChn->u32Height + y;
+            CVI_U8 *pu8Row = pu8Data + (size_t)u32Row * u32Stride;
+            if (bErase) {
+                std::memset(pu8Row + pstRect->s32X, SimBackground(u32Row), pstRect->u32Width);
+                continue;
+            }
+            // 8x8 checker, sharp enough for the blur check
+            for (CVI_U32 x = (CVI_U32)pstRect->s32X; x < pstRect->s32X + pstRect->u32Width; x++) {
+                pu8Row[x] = (((x - pstRect->s32X) / 8 + (y - pstRect->s32Y) / 8) & 1) ? 210 : 40;
+            }
+        }
+    }
+}
+
+// Luma of the regions attached to chn on a block, erased with the scene
+static void SimOsd_Blend(VPSS_CHN chn, const SimChannel_t *pstChn, CVI_U8 *pu8Data, SimBlock_t *pstBlk) {
+    CVI_U32 u32Stride = SimAlign(pstChn->u32Width, DEFAULT_ALIGN);
+    pthread_mutex_lock(&s_stSim.osdMutex);
+    for (int i = 0; i < SIM_MAX_REGIONS; i++) {
+        const SimRegion_t *pstRgn = &s_stSim.astRegion[i];
+        if (!pstRgn->bUsed || pstRgn->chn != chn || !pstRgn->bShow) {
+            continue;
+        }
+        SimOsdRun_t stCover = {pstRgn->stRect, pstRgn->u8Y};
+        const SimOsdRun_t *pstRuns = pstRgn->enType == COVER_RGN ? &stCover : pstRgn->runs.data();
+        size_t n = pstRgn->enType == COVER_RGN ? 1 : pstRgn->runs.size();
+        for (size_t r = 0; r < n; r++) {
+            RECT_S stRect = pstRuns[r].stRect;
+            CVI_U32 u32X1 = std::min<CVI_U32>(stRect.s32X + stRect.u32Width, pstChn->u32Width);
+            CVI_U32 u32Y1 = std::min<CVI_U32>(stRect.s32Y + stRect.u32Height, pstChn->u32Height);
+            if ((CVI_U32)stRect.s32X >= u32X1 || (CVI_U32)stRect.s32Y >= u32Y1) {
+                continue;
+            }
+            stRect.u32Width = u32X1 - stRect.s32X;
+            stRect.u32Height = u32Y1 - stRect.s32Y;
+            for (CVI_U32 y = (CVI_U32)stRect.s32Y; y < u32Y1; y++) {
+                std::memset(pu8Data + (size_t)y * u32Stride + stRect.s32X, pstRuns[r].u8Y, stRect.u32Width);
+            }
+            pstBlk->painted.push_back(stRect);
+        }
+    }
+    pthread_mutex_unlock(&s_stSim.osdMutex);
+}
+
+CVI_S32 HAL_FrameSource_GetFrame(VPSS_GRP grp, VPSS_CHN chn, VIDEO_FRAME_INFO_S *pstFrame,
+                                 CVI_S32 s32MilliSec) {
+    if (grp != 0 || chn < 0 || chn >= VPSS_MAX_PHY_CHN_NUM || !pstFrame) {
+        return CVI_ERR_VPSS_ILLEGAL_PARAM;
+    }
+    SimChannel_t *pstChn = &s_stSim.astChn[chn];
+    CVI_U64 u64PeriodUs = 1000000ULL / s_stSim.u32Fps;
+    CVI_U64 u64DeadlineUs = SimNowUs() + (CVI_U64)(s32MilliSec < 0 ? 0 : s32MilliSec) * 1000;
+
+    pthread_mutex_lock(&pstChn->mutex);
+
+    // Like VPSS, a slow consumer only ever sees the newest frame
+    CVI_U64 u64Seq = pstChn->u64NextSeq;
+    CVI_U64 u64Latest = (SimNowUs() - s_stSim.u64StartUs) / u64PeriodUs;
+    if (u64Latest > u64Seq) {
+        pstChn->u64Dropped += u64Latest - u64Seq;
+        u64Seq = u64Latest;
+    }
+    if (s_stSim.u64MaxFrames && u64Seq >= s_stSim.u64MaxFrames) {
+        pthread_mutex_unlock(&pstChn->mutex);
+        return CVI_ERR_VPSS_BUF_EMPTY;
+    }
+
+    int blk = -1;
+    while (true) {
+        for (int b = 0; b < SIM_VB_BLK_COUNT; b++) {
+            if (!pstChn->astBlk[b].bInUse) {
+                blk = b;
+                break;
+            }
+        }
+        if (blk >= 0) {
+            break;
+        }
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 1000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&pstChn->cond, &pstChn->mutex, &ts);
+        if (SimNowUs() >= u64DeadlineUs) {
+            pthread_mutex_unlock(&pstChn->mutex);
+            return CVI_ERR_VPSS_BUF_EMPTY;
+        }
+    }
+    pstChn->astBlk[blk].bInUse = true;
+    pstChn->u64NextSeq = u64Seq + 1;
+    pstChn->u64Delivered++;
+    pthread_mutex_unlock(&pstChn->mutex);
+
+    CVI_U64 u64DueUs = s_stSim.u64StartUs + u64Seq * u64PeriodUs;
+    CVI_U64 u64NowUs = SimNowUs();
+    if (u64DueUs > u64NowUs) {
+        usleep(u64DueUs - u64NowUs);
+    }
+
+    CVI_U32 u32Stride = SimAlign(pstChn->u32Width, DEFAULT_ALIGN);
+    CVI_U8 *pu8Data = pstChn->astBlk[blk].pu8Data;
+
+    // The scene: erase the faces drawn when the block was last used, draw the current ones
+    SimBlock_t *pstBlk = &pstChn->astBlk[blk];
+    for (size_t i = 0; i < pstBlk->painted.size(); i++) {
+        SimPaint(pstChn, pu8Data, &pstBlk->painted[i], true);
+    }
+    pstBlk->painted.clear();
+    if (s_stSim.pstScene) {
+        std::vector<cvtdl_bbox_t> boxes;
+        SimDetector_Faces(s_stSim.pstScene, u64Seq, boxes);
+        for (size_t i = 0; i < boxes.size(); i++) {
+            if (!SimChannel_MapBox(pstChn, &boxes[i])) {
+                continue;
+            }
+            RECT_S stRect;
+            stRect.s32X = (CVI_S32)boxes[i].x1;
+            stRect.s32Y = (CVI_S32)boxes[i].y1;
+            stRect.u32Width = std::min((CVI_U32)boxes[i].x2, pstChn->u32Width) - stRect.s32X;
+            stRect.u32Height = std::min((CVI_U32)boxes[i].y2, pstChn->u32Height) - stRect.s32Y;
+            SimPaint(pstChn, pu8Data, &stRect, false);
+            pstBlk->painted.push_back(stRect);
+        }
+    }
+    if (pstChn->enPixelFormat == PIXEL_FORMAT_NV21) {
+        SimOsd_Blend(chn, pstChn, pu8Data, pstBlk);
+    }
+
+    std::memset(pstFrame, 0, sizeof(VIDEO_FRAME_INFO_S));
+    VIDEO_FRAME_S *pstV = &pstFrame->stVFrame;
+    pstV->u32Width = pstChn->u32Width;
+    pstV->u32Height = pstChn->u32Height;
+    pstV->enPixelFormat = pstChn->enPixelFormat;
+    pstV->u32Stride[0] = u32Stride;
+    pstV->u32Stride[1] = u32Stride;
+    pstV->u32Length[0] = u32Stride * pstChn->u32Height;
+    if (pstChn->enPixelFormat == PIXEL_FORMAT_BGR_888_PLANAR) {
+        pstV->u32Stride[2] = u32Stride;
+        pstV->u32Length[1] = pstV->u32Length[0];
+        pstV->u32Length[2] = pstV->u32Length[0];
+    } else {
+        pstV->u32Length[1] = u32Stride * pstChn->u32Height / 2;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (pstV->u32Length[i]) {
+            pstV->pu8VirAddr[i] = pu8Data + (size_t)pstV->u32Length[0] * i;
+            pstV->u64PhyAddr[i] = (CVI_U64)(uintptr_t)pstV->pu8VirAddr[i];
+        }
+    }
+    pstV->u32TimeRef = (CVI_U32)u64Seq;
+    pstV->u64PTS = u64DueUs;
+    pstFrame->u32PoolId = (CVI_U32)(chn * SIM_VB_BLK_COUNT + blk);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_FrameSource_ReleaseFrame(VPSS_GRP grp, VPSS_CHN chn, VIDEO_FRAME_INFO_S *pstFrame) {
+    if (grp != 0 || chn < 0 || chn >= VPSS_MAX_PHY_CHN_NUM || !pstFrame) {
+        return CVI_ERR_VPSS_ILLEGAL_PARAM;
+    }
+    SimChannel_t *pstChn = &s_stSim.astChn[chn];
+    CVI_S32 s32Ret = CVI_ERR_VPSS_ILLEGAL_PARAM;
+    pthread_mutex_lock(&pstChn->mutex);
+    for (int b = 0; b < SIM_VB_BLK_COUNT; b++) {
+        if ((CVI_U64)(uintptr_t)pstChn->astBlk[b].pu8Data == pstFrame->stVFrame.u64PhyAddr[0]) {
+            pstChn->astBlk[b].bInUse = false;
+            s32Ret = CVI_SUCCESS;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&pstChn->cond);
+    pthread_mutex_unlock(&pstChn->mutex);
+    return s32Ret;
+}
+
+CVI_S32 HAL_FrameSource_SetCrop(VPSS_GRP grp, VPSS_CHN chn, const RECT_S *pstRect) {
+    if (grp != 0 || chn < 0 || chn >= VPSS_MAX_PHY_CHN_NUM || !pstRect || pstRect->s32X < 0 ||
+        pstRect->s32Y < 0 || pstRect->u32Width == 0 || pstRect->u32Height == 0 ||
+        pstRect->s32X + pstRect->u32Width > s_stSim.u32Width ||
+        pstRect->s32Y + pstRect->u32Height > s_stSim.u32Height) {
+        return CVI_ERR_VPSS_ILLEGAL_PARAM;
+    }
+    SimChannel_t *pstChn = &s_stSim.astChn[chn];
+    pthread_mutex_lock(&pstChn->mutex);
+    pstChn->stCrop = *pstRect;
+    pstChn->bCrop = true;
+    pthread_mutex_unlock(&pstChn->mutex);
+    return CVI_SUCCESS;
+}
+
+void HAL_FrameSource_Mmap(VIDEO_FRAME_INFO_S *pstFrame) {
+    // Simulated frames live in process memory already
+    for (int i = 0; i < 3; i++) {
+        pstFrame->stVFrame.pu8VirAddr[i] = (CVI_U8 *)(uintptr_t)pstFrame->stVFrame.u64PhyAddr[i];
+    }
+}
+
+void HAL_FrameSource_Munmap(VIDEO_FRAME_INFO_S *pstFrame) {
+    (void)pstFrame;
+}
+
+CVI_S32 HAL_FrameSource_DumpFrame(const char *filepath, VIDEO_FRAME_INFO_S *pstFrame) {
+    FILE *fp = fopen(filepath, "wb");
+    if (!fp) {
+        return CVI_FAILURE;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (pstFrame->stVFrame.pu8VirAddr[i] && pstFrame->stVFrame.u32Length[i]) {
+            fwrite(pstFrame->stVFrame.pu8VirAddr[i], 1, pstFrame->stVFrame.u32Length[i], fp);
+        }
+    }
+    fclose(fp);
+    return CVI_SUCCESS;
+}
+
+static bool SimDetector_LoadScript(SimDetector_t *pstDet, const char *path) {
+    std::string strPath(path);
+    if (strPath.size() >= 9 && strPath.compare(strPath.size() - 9, 9, ".cvimodel") == 0) {
+        return false;
+    }
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream iss(line);
+        SimScriptFace_t face;
+        unsigned long long seq;
+        face.bbox.score = 0.9f;
+        if (!(iss >> seq)) {
+            std::cerr << "Simulator: bad script line: " << line << std::endl;
+            continue;
+        }
+        if (seq + 1 > pstDet->u64Period) {
+            pstDet->u64Period = seq + 1;
+        }
+        if (!(iss >> face.bbox.x1)) {
+            continue;   // frame without a face
+        }
+        if (!(iss >> face.bbox.y1 >> face.bbox.x2 >> face.bbox.y2)) {
+            std::cerr << "Simulator: bad script line: " << line << std::endl;
+            continue;
+        }
+        iss >> face.bbox.score;
+        face.u64Seq = seq;
+        pstDet->faces.push_back(face);
+    }
+    return pstDet->u64Period > 0;
+}
+
+static void SimDetector_BuiltinFaces(CVI_U64 u64Seq, std::vector<cvtdl_bbox_t> &boxes) {
+    float w = (float)s_stSim.u32Width;
+    float h = (float)s_stSim.u32Height;
+    float t = (float)u64Seq / (float)s_stSim.u32Fps;
+    float size = h / 6.0f;
+
+    cvtdl_bbox_t box;
+    float cx = w / 2.0f + 60.0f * cosf(t);
+    float cy = h / 2.0f + 60.0f * sinf(t);
+    box.x1 = cx - size / 2;
+    box.y1 = cy - size / 2;
+    box.x2 = cx + size / 2;
+    box.y2 = cy + size / 2;
+    box.score = 0.92f;
+    boxes.push_back(box);
+
+    float period = 8.0f;
+    float phase = fmodf(t, period) / period;
+    cx = size + phase * (w - 2 * size);
+    cy = h / 4.0f;
+    box.x1 = cx - size / 3;
+    box.y1 = cy - size / 3;
+    box.x2 = cx + size / 3;
+    box.y2 = cy + size / 3;
+    box.score = 0.81f;
+    boxes.push_back(box);
+}
+
+static SimDetector_t *SimDetector_Create(const char *modelPath) {
+    SimDetector_t *pstDet = new SimDetector_t();
+    pstDet->u64Period = 0;
+    pstDet->u32InferMs = s_stSim.u32InferMs;
+    pstDet->fScoreThreshold = SIM_SCORE_THRESHOLD;
+    pstDet->fNmsThreshold = SIM_NMS_THRESHOLD;
+    pstDet->bBuiltin = !SimDetector_LoadScript(pstDet, modelPath);
+    usleep(SimEnvU32("SIM_LOAD_MS", 0) * 1000);
+    std::cout << "Simulator detector: "
+              << (pstDet->bBuiltin ? std::string("built-in script")
+                                   : std::to_string(pstDet->faces.size()) + " scripted faces")
+              << std::endl;
+    return pstDet;
+}
+
+static void SimDetector_Faces(const SimDetector_t *pstDet, CVI_U64 u64Seq, std::vector<cvtdl_bbox_t> &boxes) {
+    if (pstDet->bBuiltin) {
+        SimDetector_BuiltinFaces(u64Seq, boxes);
+        return;
+    }
+    CVI_U64 u64Key = u64Seq % pstDet->u64Period;
+    for (size_t i = 0; i < pstDet->faces.size(); i++) {
+        if (pstDet->faces[i].u64Seq == u64Key) {
+            boxes.push_back(pstDet->faces[i].bbox);
+        }
+    }
+}
+
+CVI_S32 HAL_Detector_Open(cvitdl_handle_t *pTdlHandle, cvitdl_service_handle_t *pServiceHandle,
+                          const char *modelPath) {
+    SimDetector_t *pstDet = SimDetector_Create(modelPath);
+    s_stSim.pstScene = pstDet;
+    *pTdlHandle = pstDet;
+    *pServiceHandle = pstDet;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Detector_OpenRoi(cvitdl_handle_t *pTdlHandle, const char *modelPath) {
+    *pTdlHandle = SimDetector_Create(modelPath);
+    return CVI_SUCCESS;
+}
+
+void HAL_Detector_Close(cvitdl_handle_t tdlHandle, cvitdl_service_handle_t serviceHandle) {
+    (void)serviceHandle;
+    if (s_stSim.pstScene == tdlHandle) {
+        s_stSim.pstScene = NULL;
+    }
+    delete static_cast<SimDetector_t *>(tdlHandle);
+}
+
+CVI_S32 HAL_Detector_SetPreprocessPool(cvitdl_handle_t tdlHandle, CVI_U32 u32PoolId) {
+    (void)tdlHandle;
+    (void)u32PoolId;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Detector_BindInputChannel(cvitdl_handle_t tdlHandle, VPSS_GRP grp, VPSS_CHN chn,
+                                      const SIZE_S *pstSrcSize, const SIZE_S *pstChnSize) {
+    (void)pstSrcSize;
+    if (grp != 0 || chn < 0 || chn >= VPSS_MAX_PHY_CHN_NUM) {
+        return CVI_ERR_VPSS_ILLEGAL_PARAM;
+    }
+    SimChannel_t *pstChn = &s_stSim.astChn[chn];
+    if (pstChn->u32Width != pstChnSize->u32Width || pstChn->u32Height != pstChnSize->u32Height) {
+        std::cerr << "Simulator: detect channel is " << pstChn->u32Width << "x" << pstChn->u32Height
+                  << ", expected " << pstChnSize->u32Width << "x" << pstChnSize->u32Height
+                  << std::endl;
+        return CVI_FAILURE;
+    }
+    // a model of that input size
+    SimDetector_t *pstDet = static_cast<SimDetector_t *>(tdlHandle);
+    pstDet->u32InferMs = (CVI_U32)((CVI_U64)s_stSim.u32InferMs * pstChn->u32Width * pstChn->u32Height /
+                                   (SYSTEM_DETECT_WIDTH * SYSTEM_DETECT_HEIGHT));
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Detector_RescaleFaceMeta(const SIZE_S *pstDstSize, cvtdl_face_t *pstFaceMeta) {
+    if (pstFaceMeta->width == 0 || pstFaceMeta->height == 0) {
+        return CVI_FAILURE;
+    }
+    float fScaleX = (float)pstDstSize->u32Width / (float)pstFaceMeta->width;
+    float fScaleY = (float)pstDstSize->u32Height / (float)pstFaceMeta->height;
+    float fPadX = 0.0f;
+    float fPadY = 0.0f;
+    if (pstFaceMeta->rescale_type == RESCALE_CENTER || pstFaceMeta->rescale_type == RESCALE_RB) {
+        // aspect ratio was kept, undo the letterbox
+        float fScale = std::max(fScaleX, fScaleY);
+        if (pstFaceMeta->rescale_type == RESCALE_CENTER) {
+            fPadX = (pstFaceMeta->width - pstDstSize->u32Width / fScale) / 2.0f;
+            fPadY = (pstFaceMeta->height - pstDstSize->u32Height / fScale) / 2.0f;
+        }
+        fScaleX = fScale;
+        fScaleY = fScale;
+    }
+    for (uint32_t i = 0; i < pstFaceMeta->size; i++) {
+        cvtdl_face_info_t *pstInfo = &pstFaceMeta->info[i];
+        pstInfo->bbox.x1 = (pstInfo->bbox.x1 - fPadX) * fScaleX;
+        pstInfo->bbox.x2 = (pstInfo->bbox.x2 - fPadX) * fScaleX;
+        pstInfo->bbox.y1 = (pstInfo->bbox.y1 - fPadY) * fScaleY;
+        pstInfo->bbox.y2 = (pstInfo->bbox.y2 - fPadY) * fScaleY;
+        for (uint32_t j = 0; j < pstInfo->pts.size; j++) {
+            pstInfo->pts.x[j] = (pstInfo->pts.x[j] - fPadX) * fScaleX;
+            pstInfo->pts.y[j] = (pstInfo->pts.y[j] - fPadY) * fScaleY;
+        }
+    }
+    pstFaceMeta->width = pstDstSize->u32Width;
+    pstFaceMeta->height = pstDstSize->u32Height;
+    return CVI_SUCCESS;
+}
+
+static void SimDetector_FillLandmarks(cvtdl_face_info_t *pstInfo) {
+    // Eyes, nose and mouth corners, as SCRFD reports them
+    static const float kLandmarkX[5] = {0.30f, 0.70f, 0.50f, 0.35f, 0.65f};
+    static const float kLandmarkY[5] = {0.38f, 0.38f, 0.55f, 0.75f, 0.75f};
+    float w = pstInfo->bbox.x2 - pstInfo->bbox.x1;
+    float h = pstInfo->bbox.y2 - pstInfo->bbox.y1;
+    pstInfo->pts.size = 5;
+    pstInfo->pts.x = (float *)malloc(sizeof(float) * 5);
+    pstInfo->pts.y = (float *)malloc(sizeof(float) * 5);
+    for (int i = 0; i < 5; i++) {
+        pstInfo->pts.x[i] = pstInfo->bbox.x1 + kLandmarkX[i] * w;
+        pstInfo->pts.y[i] = pstInfo->bbox.y1 + kLandmarkY[i] * h;
+    }
+}
+
+CVI_S32 HAL_Detector_DetectFace(cvitdl_handle_t tdlHandle, VIDEO_FRAME_INFO_S *pstFrame,
+                                cvtdl_face_t *pstFaceMeta) {
+    SimDetector_t *pstDet = static_cast<SimDetector_t *>(tdlHandle);
+    if (!pstDet || !pstFrame || !pstFaceMeta) {
+        return CVI_FAILURE;
+    }
+    if (pstDet->u32InferMs) {
+        usleep(pstDet->u32InferMs * 1000);
+    }
+
+    std::vector<cvtdl_bbox_t> boxes;
+    SimDetector_Faces(pstDet, pstFrame->stVFrame.u32TimeRef, boxes);
+
+    // Scripts are in sensor coordinates, report them in the coordinates of the input frame;
+    // faces cut by a channel crop are only found with half of them inside
+    CVI_U32 u32Chn = pstFrame->u32PoolId / SIM_VB_BLK_COUNT;
+    const SimChannel_t *pstChn = &s_stSim.astChn[u32Chn < VPSS_MAX_PHY_CHN_NUM ? u32Chn : 0];
+    size_t n = 0;
+    for (size_t i = 0; i < boxes.size(); i++) {
+        if (boxes[i].score >= pstDet->fScoreThreshold && SimChannel_MapBox(pstChn, &boxes[i])) {
+            boxes[n++] = boxes[i];
+        }
+    }
+    boxes.resize(n);
+
+    pstFaceMeta->size = (uint32_t)boxes.size();
+    pstFaceMeta->width = pstFrame->stVFrame.u32Width;
+    pstFaceMeta->height = pstFrame->stVFrame.u32Height;
+    pstFaceMeta->rescale_type = RESCALE_CENTER;
+    pstFaceMeta->info = NULL;
+    pstFaceMeta->dms = NULL;
+    if (boxes.empty()) {
+        return CVI_SUCCESS;
+    }
+    pstFaceMeta->info = (cvtdl_face_info_t *)calloc(boxes.size(), sizeof(cvtdl_face_info_t));
+    for (size_t i = 0; i < boxes.size(); i++) {
+        pstFaceMeta->info[i].bbox = boxes[i];
+        pstFaceMeta->info[i].score = boxes[i].score;
+        SimDetector_FillLandmarks(&pstFaceMeta->info[i]);
+    }
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Detector_GetThresholds(cvitdl_handle_t tdlHandle, float *pfScore, float *pfNms) {
+    SimDetector_t *pstDet = static_cast<SimDetector_t *>(tdlHandle);
+    *pfScore = pstDet->fScoreThreshold;
+    *pfNms = pstDet->fNmsThreshold;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Detector_SetThresholds(cvitdl_handle_t tdlHandle, float fScore, float fNms) {
+    SimDetector_t *pstDet = static_cast<SimDetector_t *>(tdlHandle);
+    pstDet->fScoreThreshold = fScore;
+    pstDet->fNmsThreshold = fNms;
+    return CVI_SUCCESS;
+}
+
+void HAL_Detector_FreeFaceMeta(cvtdl_face_t *pstFaceMeta) {
+    if (pstFaceMeta->info) {
+        for (uint32_t i = 0; i < pstFaceMeta->size; i++) {
+            free(pstFaceMeta->info[i].pts.x);
+            free(pstFaceMeta->info[i].pts.y);
+            free(pstFaceMeta->info[i].feature.ptr);
+        }
+        free(pstFaceMeta->info);
+    }
+    pstFaceMeta->info = NULL;
+    pstFaceMeta->size = 0;
+}
+
+// Geometric estimate from eyes, nose and mouth corners: roll is the tilt of the
+// eye line, yaw the sideways and pitch the vertical offset of the nose
+CVI_S32 HAL_Detector_FaceAngle(const cvtdl_pts_t *pstPts, cvtdl_head_pose_t *pstPose) {
+    std::memset(pstPose, 0, sizeof(*pstPose));
+    if (!pstPts->x || !pstPts->y || pstPts->size < 5) {
+        return CVI_FAILURE;
+    }
+    float fEyeX = (pstPts->x[0] + pstPts->x[1]) / 2.0f;
+    float fEyeY = (pstPts->y[0] + pstPts->y[1]) / 2.0f;
+    float fMouthX = (pstPts->x[3] + pstPts->x[4]) / 2.0f;
+    float fMouthY = (pstPts->y[3] + pstPts->y[4]) / 2.0f;
+    float fEyeDist = hypotf(pstPts->x[1] - pstPts->x[0], pstPts->y[1] - pstPts->y[0]);
+    if (fEyeDist <= 0.0f) {
+        return CVI_FAILURE;
+    }
+    pstPose->roll = atan2f(pstPts->y[1] - pstPts->y[0], pstPts->x[1] - pstPts->x[0]);
+
+    // nose in the face frame: u along the eye line, v from the eyes towards the mouth
+    float c = cosf(pstPose->roll), s = sinf(pstPose->roll);
+    float dx = pstPts->x[2] - fEyeX, dy = pstPts->y[2] - fEyeY;
+    float u = (dx * c + dy * s) / fEyeDist;
+    float fFaceHeight = (fMouthX - fEyeX) * -s + (fMouthY - fEyeY) * c;
+    float v = fFaceHeight > 0.0f ? (dx * -s + dy * c) / fFaceHeight : 0.5f;
+    // a frontal nose sits halfway between eyes and mouth, a profile one half an eye distance aside
+    pstPose->yaw = asinf(std::min(std::max(2.0f * u, -1.0f), 1.0f));
+    pstPose->pitch = asinf(std::min(std::max(2.0f * (v - 0.5f), -1.0f), 1.0f));
+    pstPose->facialUnitNormalVector[0] = sinf(pstPose->yaw);
+    pstPose->facialUnitNormalVector[1] = -sinf(pstPose->pitch);
+    pstPose->facialUnitNormalVector[2] = cosf(pstPose->yaw) * cosf(pstPose->pitch);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Tracker_Open(cvitdl_handle_t tdlHandle) {
+    SimDetector_t *pstDet = static_cast<SimDetector_t *>(tdlHandle);
+    if (!pstDet) {
+        return CVI_FAILURE;
+    }
+    pstDet->tracks.clear();
+    pstDet->u64NextTrackId = 1;
+    return CVI_SUCCESS;
+}
+
+static float SimTracker_IoU(const cvtdl_bbox_t *a, const cvtdl_bbox_t *b) {
+    float w = std::min(a->x2, b->x2) - std::max(a->x1, b->x1);
+    float h = std::min(a->y2, b->y2) - std::max(a->y1, b->y1);
+    if (w <= 0.0f || h <= 0.0f) {
+        return 0.0f;
+    }
+    float inter = w * h;
+    return inter / ((a->x2 - a->x1) * (a->y2 - a->y1) + (b->x2 - b->x1) * (b->y2 - b->y1) - inter);
+}
+
+// SORT without the Kalman filter: greedy overlap matching against the last boxes
+CVI_S32 HAL_Tracker_TrackFace(cvitdl_handle_t tdlHandle, cvtdl_face_t *pstFaceMeta,
+                              cvtdl_tracker_t *pstTracker) {
+    static const CVI_U32 kMaxMisses = 10;
+    static const CVI_U32 kStableHits = 3;
+    SimDetector_t *pstDet = static_cast<SimDetector_t *>(tdlHandle);
+    if (!pstDet || !pstFaceMeta || !pstTracker) {
+        return CVI_FAILURE;
+    }
+    CVI_U32 u32Size = pstFaceMeta->info ? pstFaceMeta->size : 0;
+    pstTracker->size = u32Size;
+    pstTracker->info = u32Size ? (cvtdl_tracker_info_t *)calloc(u32Size, sizeof(cvtdl_tracker_info_t))
+                               : NULL;
+
+    std::vector<bool> abTrackUsed(pstDet->tracks.size(), false);
+    std::vector<bool> abFaceUsed(u32Size, false);
+    while (true) {
+        float fBest = 0.3f;
+        int bestTrack = -1;
+        int bestFace = -1;
+        for (size_t t = 0; t < pstDet->tracks.size(); t++) {
+            for (CVI_U32 f = 0; f < u32Size && !abTrackUsed[t]; f++) {
+                float fIoU = abFaceUsed[f] ? 0.0f
+                                           : SimTracker_IoU(&pstDet->tracks[t].bbox, &pstFaceMeta->info[f].bbox);
+                if (fIoU >= fBest) {
+                    fBest = fIoU;
+                    bestTrack = (int)t;
+                    bestFace = (int)f;
+                }
+            }
+        }
+        if (bestTrack < 0) {
+            break;
+        }
+        abTrackUsed[bestTrack] = true;
+        abFaceUsed[bestFace] = true;
+        SimTrack_t *pstTrack = &pstDet->tracks[bestTrack];
+        pstTrack->bbox = pstFaceMeta->info[bestFace].bbox;
+        pstTrack->u32Hits++;
+        pstTrack->u32Misses = 0;
+        pstFaceMeta->info[bestFace].unique_id = pstTrack->u64Id;
+        pstTracker->info[bestFace].state = pstTrack->u32Hits >= kStableHits ? CVI_TRACKER_STABLE
+                                                                            : CVI_TRACKER_UNSTABLE;
+    }
+
+    for (size_t t = pstDet->tracks.size(); t-- > 0;) {
+        if (!abTrackUsed[t] && ++pstDet->tracks[t].u32Misses > kMaxMisses) {
+            pstDet->tracks.erase(pstDet->tracks.begin() + t);
+        }
+    }
+    for (CVI_U32 f = 0; f < u32Size; f++) {
+        if (!abFaceUsed[f]) {
+            SimTrack_t stTrack;
+            stTrack.u64Id = pstDet->u64NextTrackId++;
+            stTrack.bbox = pstFaceMeta->info[f].bbox;
+            stTrack.u32Hits = 1;
+            stTrack.u32Misses = 0;
+            pstDet->tracks.push_back(stTrack);
+            pstFaceMeta->info[f].unique_id = stTrack.u64Id;
+            pstTracker->info[f].state = CVI_TRACKER_NEW;
+        }
+    }
+    for (CVI_U32 f = 0; f < u32Size; f++) {
+        pstTracker->info[f].id = pstFaceMeta->info[f].unique_id;
+        pstTracker->info[f].bbox = pstFaceMeta->info[f].bbox;
+    }
+    return CVI_SUCCESS;
+}
+
+void HAL_Tracker_FreeResult(cvtdl_tracker_t *pstTracker) {
+    free(pstTracker->info);
+    pstTracker->info = NULL;
+    pstTracker->size = 0;
+}
+
+// No SDK feature service to compare with
+CVI_S32 HAL_RefMatcher_Open(void **ppHandle, const int8_t *ps8Rows, uint32_t u32Rows, uint32_t u32Dim) {
+    (void)ps8Rows;
+    (void)u32Rows;
+    (void)u32Dim;
+    *ppHandle = NULL;
+    return CVI_FAILURE;
+}
+
+void HAL_RefMatcher_Close(void *pHandle) {
+    (void)pHandle;
+}
+
+CVI_S32 HAL_RefMatcher_Match(void *pHandle, const int8_t *ps8Query, uint32_t u32TopK, uint32_t *pu32Indices,
+                             float *pfScores, uint32_t *pu32Size) {
+    (void)pHandle;
+    (void)ps8Query;
+    (void)u32TopK;
+    (void)pu32Indices;
+    (void)pfScores;
+    *pu32Size = 0;
+    return CVI_FAILURE;
+}
+
+// Called with osdMutex held
+static SimRegion_t *SimOsd_Find(RGN_HANDLE handle) {
+    for (int i = 0; i < SIM_MAX_REGIONS; i++) {
+        if (s_stSim.astRegion[i].bUsed && s_stSim.astRegion[i].handle == handle) {
+            return &s_stSim.astRegion[i];
+        }
+    }
+    return NULL;
+}
+
+// Called with osdMutex held
+static SimRegion_t *SimOsd_Add(RGN_HANDLE handle, RGN_TYPE_E enType, VPSS_CHN chn) {
+    if (chn < 0 || chn >= VPSS_MAX_PHY_CHN_NUM || SimOsd_Find(handle)) {
+        return NULL;
+    }
+    for (int i = 0; i < SIM_MAX_REGIONS; i++) {
+        SimRegion_t *pstRgn = &s_stSim.astRegion[i];
+        if (!pstRgn->bUsed) {
+            pstRgn->bUsed = true;
+            pstRgn->handle = handle;
+            pstRgn->enType = enType;
+            pstRgn->chn = chn;
+            pstRgn->bShow = true;
+            pstRgn->runs.clear();
+            return pstRgn;
+        }
+    }
+    return NULL;
+}
+
+CVI_S32 HAL_Osd_CreateCanvas(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, const SIZE_S *pstSize) {
+    if (grp != 0 || !pstSize || pstSize->u32Width == 0 || pstSize->u32Height == 0) {
+        return CVI_ERR_RGN_ILLEGAL_PARAM;
+    }
+    pthread_mutex_lock(&s_stSim.osdMutex);
+    SimRegion_t *pstRgn = SimOsd_Add(handle, OVERLAY_RGN, chn);
+    if (pstRgn) {
+        pstRgn->stSize = *pstSize;
+        for (int b = 0; b < 2; b++) {
+            pstRgn->canvas[b].assign((size_t)pstSize->u32Width * pstSize->u32Height, 0);
+        }
+        pstRgn->u32Front = 0;
+    }
+    pthread_mutex_unlock(&s_stSim.osdMutex);
+    return pstRgn ? CVI_SUCCESS : CVI_ERR_RGN_ILLEGAL_PARAM;
+}
+
+CVI_S32 HAL_Osd_GetCanvas(RGN_HANDLE handle, HalOsdCanvas_t *pstCanvas) {
+    pthread_mutex_lock(&s_stSim.osdMutex);
+    SimRegion_t *pstRgn = SimOsd_Find(handle);
+    if (pstRgn && pstRgn->enType == OVERLAY_RGN) {
+        std::vector<CVI_U16> &back = pstRgn->canvas[1 - pstRgn->u32Front];
+        pstCanvas->pu8Data = (CVI_U8 *)back.data();
+        pstCanvas->u64PhyAddr = (CVI_U64)(uintptr_t)back.data();
+        pstCanvas->u32Stride = pstRgn->stSize.u32Width * sizeof(CVI_U16);
+        pstCanvas->stSize = pstRgn->stSize;
+    }
+    pthread_mutex_unlock(&s_stSim.osdMutex);
+    return pstRgn && pstRgn->enType == OVERLAY_RGN ? CVI_SUCCESS : CVI_ERR_RGN_UNEXIST;
+}
+
+CVI_S32 HAL_Osd_UpdateCanvas(RGN_HANDLE handle) {
+    pthread_mutex_lock(&s_stSim.osdMutex);
+    SimRegion_t *pstRgn = SimOsd_Find(handle);
+    if (!pstRgn || pstRgn->enType != OVERLAY_RGN) {
+        pthread_mutex_unlock(&s_stSim.osdMutex);
+        return CVI_ERR_RGN_UNEXIST;
+    }
+    pstRgn->u32Front = 1 - pstRgn->u32Front;
+    const CVI_U16 *pu16Canvas = pstRgn->canvas[pstRgn->u32Front].data();
+    pstRgn->runs.clear();
+    for (CVI_U32 y = 0; y < pstRgn->stSize.u32Height; y++) {
+        const CVI_U16 *pu16Row = pu16Canvas + (size_t)y * pstRgn->stSize.u32Width;
+        for (CVI_U32 x = 0; x < pstRgn->stSize.u32Width;) {
+            if (!(pu16Row[x] & 0x8000)) {
+                x++;
+                continue;
+            }
+            CVI_U32 x0 = x;
+            while (x < pstRgn->stSize.u32Width && pu16Row[x] == pu16Row[x0]) {
+                x++;
+            }
+            CVI_U16 p = pu16Row[x0];
+            SimOsdRun_t stRun;
+            stRun.stRect.s32X = (CVI_S32)x0;
+            stRun.stRect.s32Y = (CVI_S32)y;
+            stRun.stRect.u32Width = x - x0;
+            stRun.stRect.u32Height = 1;
+            stRun.u8Y = SimBrushLuma((float)((p >> 10 & 31) << 3), (float)((p >> 5 & 31) << 3),
+                                     (float)((p & 31) << 3));
+            pstRgn->runs.push_back(stRun);
+        }
+    }
+    s_stSim.u64OsdUpdates++;
+    pthread_mutex_unlock(&s_stSim.osdMutex);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Osd_CreateCover(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, const RECT_S *pstRect, CVI_U32 u32Rgb) {
+    if (grp != 0 || !pstRect || pstRect->s32X < 0 || pstRect->s32Y < 0) {
+        return CVI_ERR_RGN_ILLEGAL_PARAM;
+    }
+    pthread_mutex_lock(&s_stSim.osdMutex);
+    SimRegion_t *pstRgn = SimOsd_Add(handle, COVER_RGN, chn);
+    if (pstRgn) {
+        pstRgn->stRect = *pstRect;
+        pstRgn->u8Y = SimBrushLuma((float)(u32Rgb >> 16 & 0xff), (float)(u32Rgb >> 8 & 0xff), (float)(u32Rgb & 0xff));
+    }
+    pthread_mutex_unlock(&s_stSim.osdMutex);
+    return pstRgn ? CVI_SUCCESS : CVI_ERR_RGN_ILLEGAL_PARAM;
+}
+
+CVI_S32 HAL_Osd_Show(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn, bool bShow) {
+    pthread_mutex_lock(&s_stSim.osdMutex);
+    SimRegion_t *pstRgn = SimOsd_Find(handle);
+    bool bFound = pstRgn && grp == 0 && pstRgn->chn == chn;
+    if (bFound) {
+        pstRgn->bShow = bShow;
+    }
+    pthread_mutex_unlock(&s_stSim.osdMutex);
+    return bFound ? CVI_SUCCESS : CVI_ERR_RGN_UNEXIST;
+}
+
+void HAL_Osd_Destroy(RGN_HANDLE handle, VPSS_GRP grp, VPSS_CHN chn) {
+    (void)grp;
+    (void)chn;
+    pthread_mutex_lock(&s_stSim.osdMutex);
+    SimRegion_t *pstRgn = SimOsd_Find(handle);
+    if (pstRgn) {
+        pstRgn->bUsed = false;
+        pstRgn->runs.clear();
+        for (int b = 0; b < 2; b++) {
+            std::vector<CVI_U16>().swap(pstRgn->canvas[b]);
+        }
+    }
+    pthread_mutex_unlock(&s_stSim.osdMutex);
+}
+
+// Called with vencMutex held
+static CVI_S32 SimVenc_Encode(const VIDEO_FRAME_INFO_S *pstFrame) {
+    if (s_stSim.u32Queued == SIM_VENC_QUEUE) {
+        s_stSim.u64VencDropped++;
+        return CVI_ERR_VENC_BUF_FULL;
+    }
+    SimVencFrame_t *pstOut = &s_stSim.astQueue[(s_stSim.u32QueueHead + s_stSim.u32Queued) % SIM_VENC_QUEUE];
+    // One slice per frame, preceded by SPS/PPS/SEI at every IDR
+    size_t frameBytes = s_stSim.u32BitrateKbps * 1000 / 8 / s_stSim.u32Fps;
+    if (s_stSim.bVbr) {
+        CVI_U64 u64Phase = s_stSim.u64EncodedFrames % s_stSim.u32BgSrcFps;
+        // without a region the whole frame is foreground
+        bool bBgFrame = s_stSim.fBgShare == 1.0f ||
+                        (u64Phase * s_stSim.u32BgDstFps) % s_stSim.u32BgSrcFps < s_stSim.u32BgDstFps;
+        float fCost = s_stSim.fRoiCost + s_stSim.fBgShare * (bBgFrame ? 1.0f : SIM_SKIP_MB_COST);
+        frameBytes = (size_t)(frameBytes * std::min(fCost, 1.0f));
+    }
+    bool bIdr = (s_stSim.u64EncodedFrames % s_stSim.u32Gop) == 0;
+    CVI_U32 u32Packs = 0;
+    if (bIdr) {
+        for (int i = 0; i < SIM_HEADER_PACKS; i++) {
+            VENC_PACK_S *pstPack = &pstOut->astPack[u32Packs++];
+            std::memset(pstPack, 0, sizeof(VENC_PACK_S));
+            pstPack->pu8Addr = s_stSim.vencBuf.data();
+            pstPack->u32Len = 16;
+            pstPack->u64PTS = pstFrame->stVFrame.u64PTS;
+        }
+        frameBytes *= 2;
+    }
+    VENC_PACK_S *pstPack = &pstOut->astPack[u32Packs++];
+    std::memset(pstPack, 0, sizeof(VENC_PACK_S));
+    pstPack->pu8Addr = s_stSim.vencBuf.data();
+    pstPack->u32Len = (CVI_U32)frameBytes;
+    pstPack->u64PTS = pstFrame->stVFrame.u64PTS;
+    pstPack->bFrameEnd = CVI_TRUE;
+    // Touch the payload like a DMA write would
+    pstPack->pu8Addr[0] = (CVI_U8)pstFrame->stVFrame.u32TimeRef;
+    pstOut->u32Packs = u32Packs;
+    pstOut->u32Seq = (CVI_U32)s_stSim.u64EncodedFrames;
+    s_stSim.u32Queued++;
+    s_stSim.u64EncodedFrames++;
+    // a failed write only loses the poll wake-up, HAL_Encoder_GetStream still returns the frame
+    uint64_t u64One = 1;
+    ssize_t s64Ret = write(s_stSim.s32VencFd, &u64One, sizeof(u64One));
+    (void)s64Ret;
+    pthread_cond_broadcast(&s_stSim.vencCond);
+    return CVI_SUCCESS;
+}
+
+// CLOCK_REALTIME deadline s32MilliSec from now, -1 waits an hour
+static void SimVenc_Deadline(CVI_S32 s32MilliSec, struct timespec *pstTs) {
+    clock_gettime(CLOCK_REALTIME, pstTs);
+    CVI_U64 u64Ns = (CVI_U64)pstTs->tv_nsec + (CVI_U64)(s32MilliSec > 0 ? s32MilliSec : 3600000) * 1000000;
+    pstTs->tv_sec += u64Ns / 1000000000;
+    pstTs->tv_nsec = u64Ns % 1000000000;
+}
+
+CVI_S32 HAL_Encoder_SendFrame(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VIDEO_FRAME_INFO_S *pstFrame,
+                              CVI_S32 s32MilliSec) {
+    (void)pstMWContext;
+    pthread_mutex_lock(&s_stSim.vencMutex);
+    if (s_stSim.u32Queued == SIM_VENC_QUEUE && s32MilliSec != 0) {
+        struct timespec ts;
+        SimVenc_Deadline(s32MilliSec, &ts);
+        while (s_stSim.u32Queued == SIM_VENC_QUEUE) {
+            if (pthread_cond_timedwait(&s_stSim.vencSpaceCond, &s_stSim.vencMutex, &ts) != 0) {
+                break;
+            }
+        }
+    }
+    // still full: dropped with CVI_ERR_VENC_BUF_FULL
+    CVI_S32 s32Ret = SimVenc_Encode(pstFrame);
+    pthread_mutex_unlock(&s_stSim.vencMutex);
+    return s32Ret;
+}
+
+CVI_S32 HAL_Encoder_GetFd(SAMPLE_TDL_MW_CONTEXT *pstMWContext) {
+    (void)pstMWContext;
+    return s_stSim.s32VencFd;
+}
+
+CVI_S32 HAL_Encoder_QueryPacks(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 *pu32PackCount) {
+    (void)pstMWContext;
+    pthread_mutex_lock(&s_stSim.vencMutex);
+    *pu32PackCount = s_stSim.u32Queued ? s_stSim.astQueue[s_stSim.u32QueueHead].u32Packs : 0;
+    pthread_mutex_unlock(&s_stSim.vencMutex);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Encoder_GetStream(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream,
+                              CVI_S32 s32MilliSec) {
+    (void)pstMWContext;
+    pthread_mutex_lock(&s_stSim.vencMutex);
+    if (s_stSim.u32Queued == 0 && s32MilliSec != 0) {
+        struct timespec ts;
+        SimVenc_Deadline(s32MilliSec, &ts);
+        while (s_stSim.u32Queued == 0) {
+            if (pthread_cond_timedwait(&s_stSim.vencCond, &s_stSim.vencMutex, &ts) != 0) {
+                break;
+            }
+        }
+    }
+    if (s_stSim.u32Queued == 0) {
+        pthread_mutex_unlock(&s_stSim.vencMutex);
+        return CVI_ERR_VENC_BUF_EMPTY;
+    }
+    const SimVencFrame_t *pstIn = &s_stSim.astQueue[s_stSim.u32QueueHead];
+    std::memcpy(pstStream->pstPack, pstIn->astPack, sizeof(VENC_PACK_S) * pstIn->u32Packs);
+    pstStream->u32PackCount = pstIn->u32Packs;
+    pstStream->u32Seq = pstIn->u32Seq;
+    s_stSim.u32QueueHead = (s_stSim.u32QueueHead + 1) % SIM_VENC_QUEUE;
+    s_stSim.u32Queued--;
+    uint64_t u64Count;
+    ssize_t s64Ret = read(s_stSim.s32VencFd, &u64Count, sizeof(u64Count));
+    (void)s64Ret;
+    pthread_cond_broadcast(&s_stSim.vencSpaceCond);
+    pthread_mutex_unlock(&s_stSim.vencMutex);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Encoder_ReleaseStream(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream) {
+    (void)pstMWContext;
+    pstStream->u32PackCount = 0;
+    return CVI_SUCCESS;
+}
+
+// The encoder side of a bind: takes the channel's frames as VENC would
+static void *SimVenc_BindThread(void *pArgs) {
+    (void)pArgs;
+    VPSS_CHN chn = s_stSim.bindChn;
+    VIDEO_FRAME_INFO_S stFrame;
+    for (;;) {
+        pthread_mutex_lock(&s_stSim.vencMutex);
+        bool bBound = s_stSim.bBound;
+        pthread_mutex_unlock(&s_stSim.vencMutex);
+        if (!bBound) {
+            break;
+        }
+        if (HAL_FrameSource_GetFrame(0, chn, &stFrame, 100) != CVI_SUCCESS) {
+            continue;
+        }
+        pthread_mutex_lock(&s_stSim.vencMutex);
+        SimVenc_Encode(&stFrame);
+        pthread_mutex_unlock(&s_stSim.vencMutex);
+        HAL_FrameSource_ReleaseFrame(0, chn, &stFrame);
+    }
+    return NULL;
+}
+
+CVI_S32 HAL_Encoder_Bind(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VPSS_GRP grp, VPSS_CHN chn) {
+    (void)pstMWContext;
+    (void)grp;
+    if (chn < 0 || chn >= VPSS_MAX_PHY_CHN_NUM || s_stSim.bBound) {
+        return CVI_FAILURE;
+    }
+    s_stSim.bBound = true;
+    s_stSim.bindChn = chn;
+    if (pthread_create(&s_stSim.bindThread, NULL, SimVenc_BindThread, NULL) != 0) {
+        s_stSim.bBound = false;
+        return CVI_FAILURE;
+    }
+    return CVI_SUCCESS;
+}
+
+void HAL_Encoder_Unbind(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VPSS_GRP grp, VPSS_CHN chn) {
+    (void)pstMWContext;
+    (void)grp;
+    (void)chn;
+    pthread_mutex_lock(&s_stSim.vencMutex);
+    bool bBound = s_stSim.bBound;
+    s_stSim.bBound = false;
+    pthread_mutex_unlock(&s_stSim.vencMutex);
+    if (bBound) {
+        pthread_join(s_stSim.bindThread, NULL);
+    }
+}
+
+// Called with vencMutex held; sets fRoiCost and fBgShare from the regions
+static void SimVenc_UpdateRoiCost() {
+    CVI_U32 u32MbCols = SimAlign(s_stSim.u32Width, 16) / 16;
+    CVI_U32 u32MbRows = SimAlign(s_stSim.u32Height, 16) / 16;
+    double dRoiCost = 0.0;
+    CVI_U32 u32Bg = 0;
+    for (CVI_U32 r = 0; r < u32MbRows; r++) {
+        for (CVI_U32 c = 0; c < u32MbCols; c++) {
+            CVI_S32 s32X = (CVI_S32)(c * 16 + 8);
+            CVI_S32 s32Y = (CVI_S32)(r * 16 + 8);
+            int s32Roi = -1;
+            for (int i = VENC_MAX_ROI_NUM - 1; i >= 0 && s32Roi < 0; i--) {
+                const RECT_S *pstRect = &s_stSim.astRoi[i];
+                if (s_stSim.abRoi[i] && s32X >= pstRect->s32X && s32Y >= pstRect->s32Y &&
+                    s32X < pstRect->s32X + (CVI_S32)pstRect->u32Width &&
+                    s32Y < pstRect->s32Y + (CVI_S32)pstRect->u32Height) {
+                    s32Roi = i;
+                }
+            }
+            if (s32Roi < 0) {
+                u32Bg++;
+            } else {
+                dRoiCost += std::pow(2.0, -s_stSim.as32RoiQp[s32Roi] / 6.0);
+            }
+        }
+    }
+    CVI_U32 u32Mbs = u32MbCols * u32MbRows;
+    s_stSim.fRoiCost = (float)(dRoiCost / u32Mbs);
+    s_stSim.fBgShare = (float)u32Bg / u32Mbs;
+}
+
+CVI_S32 HAL_Encoder_SetRoi(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32Index, bool bEnable,
+                           const RECT_S *pstRect, CVI_S32 s32Qp) {
+    (void)pstMWContext;
+    if (u32Index >= VENC_MAX_ROI_NUM || s32Qp < -51 || s32Qp > 51 || (bEnable && !pstRect)) {
+        return CVI_ERR_VENC_ILLEGAL_PARAM;
+    }
+    pthread_mutex_lock(&s_stSim.vencMutex);
+    s_stSim.abRoi[u32Index] = bEnable;
+    if (pstRect) {
+        s_stSim.astRoi[u32Index] = *pstRect;
+    }
+    s_stSim.as32RoiQp[u32Index] = s32Qp;
+    SimVenc_UpdateRoiCost();
+    pthread_mutex_unlock(&s_stSim.vencMutex);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Encoder_SetRoiBgFrameRate(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32SrcFps, CVI_U32 u32DstFps) {
+    (void)pstMWContext;
+    if (u32SrcFps == 0 || u32DstFps == 0 || u32DstFps > u32SrcFps) {
+        return CVI_ERR_VENC_ILLEGAL_PARAM;
+    }
+    pthread_mutex_lock(&s_stSim.vencMutex);
+    s_stSim.u32BgSrcFps = u32SrcFps;
+    s_stSim.u32BgDstFps = u32DstFps;
+    pthread_mutex_unlock(&s_stSim.vencMutex);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_Encoder_SetRate(SAMPLE_TDL_MW_CONTEXT *pstMWContext, CVI_U32 u32BitrateKbps, CVI_U32 u32Gop) {
+    (void)pstMWContext;
+    pthread_mutex_lock(&s_stSim.vencMutex);
+    // queued packs keep their length, vencBuf holds any rate
+    s_stSim.u32BitrateKbps = std::min<CVI_U32>(u32BitrateKbps, SIM_MAX_BITRATE_KBPS);
+    s_stSim.u32Gop = u32Gop ? u32Gop : s_stSim.u32Gop;
+    pthread_mutex_unlock(&s_stSim.vencMutex);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 HAL_StreamSink_Write(SAMPLE_TDL_MW_CONTEXT *pstMWContext, VENC_STREAM_S *pstStream) {
+    (void)pstMWContext;
+    for (CVI_U32 i = 0; i < pstStream->u32PackCount; i++) {
+        s_stSim.u64SinkBytes += pstStream->pstPack[i].u32Len - pstStream->pstPack[i].u32Offset;
+    }
+    s_stSim.u64SinkPackets += pstStream->u32PackCount;
+    usleep(s_stSim.u32SinkMs * 1000);
+    return CVI_SUCCESS;
+}
+
+int HAL_Gpio_Setup() {
+    return 0;
+}
+
+void HAL_Gpio_Release() {}
+
+int HAL_Gpio_PinMode(int pin, enum pinmode_t mode) {
+    (void)pin;
+    (void)mode;
+    return 0;
+}
+
+int HAL_Gpio_ValidGPIO(int pin) {
+    return pin >= 0 ? 0 : -1;
+}
+
+int HAL_Gpio_DigitalRead(int pin) {
+    // Button is active low and never pressed
+    (void)pin;
+    return HIGH;
+}
+
+int HAL_Gpio_DigitalWrite(int pin, enum digital_value_t value) {
+    (void)pin;
+    (void)value;
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "live_config.h"
+
+void LiveConfig_Init(LiveConfigStore_t *pstStore, const LiveConfig_t *pstInitial) {
+    LiveConfig_t *pstFirst = new LiveConfig_t(*pstInitial);
+    pstFirst->u32Generation = 1;
+    pstStore->pstCurrent.store(pstFirst);
+    pstStore->u64Epoch.store(1);
+    for (int i = 0; i < LIVE_READER_COUNT; i++) {
+        pstStore->au64Seen[i].store(0);
+    }
+    pthread_mutex_init(&pstStore->mutex, NULL);
+    pstStore->retired.clear();
+}
+
+void LiveConfig_Destroy(LiveConfigStore_t *pstStore) {
+    for (size_t i = 0; i < pstStore->retired.size(); i++) {
+        delete pstStore->retired[i].first;
+    }
+    pstStore->retired.clear();
+    delete pstStore->pstCurrent.exchange(NULL);
+    pthread_mutex_destroy(&pstStore->mutex);
+}
+
+const LiveConfig_t *LiveConfig_Read(LiveConfigStore_t *pstStore, LiveConfigReader_t enReader) {
+    // announcing the epoch releases the previous snapshot; the one loaded
+    // next is at least as new as that epoch
+    pstStore->au64Seen[enReader].store(pstStore->u64Epoch.load());
+    return pstStore->pstCurrent.load();
+}
+
+void LiveConfig_Offline(LiveConfigStore_t *pstStore, LiveConfigReader_t enReader) {
+    pstStore->au64Seen[enReader].store(0);
+}
+
+// Free the snapshots no reader can still hold, under mutex
+static void LiveConfig_Reclaim(LiveConfigStore_t *pstStore) {
+    uint64_t u64Oldest = UINT64_MAX;
+    for (int i = 0; i < LIVE_READER_COUNT; i++) {
+        uint64_t u64Seen = pstStore->au64Seen[i].load();
+        if (u64Seen != 0 && u64Seen < u64Oldest) {
+            u64Oldest = u64Seen;
+        }
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < pstStore->retired.size(); i++) {
+        if (pstStore->retired[i].second <= u64Oldest) {
+            delete pstStore->retired[i].first;
+        } else {
+            pstStore->retired[n++] = pstStore->retired[i];
+        }
+    }
+    pstStore->retired.resize(n);
+}
+
+void LiveConfig_Publish(LiveConfigStore_t *pstStore, const LiveConfig_t *pstNext) {
+    pthread_mutex_lock(&pstStore->mutex);
+    LiveConfig_t *pstSnapshot = new LiveConfig_t(*pstNext);
+    const LiveConfig_t *pstOld = pstStore->pstCurrent.load();
+    pstSnapshot->u32Generation = pstOld->u32Generation + 1;
+    pstStore->pstCurrent.store(pstSnapshot);
+    // a reader announcing this epoch or a later one loads the new snapshot
+    uint64_t u64Epoch = pstStore->u64Epoch.fetch_add(1) + 1;
+    pstStore->retired.push_back(std::make_pair(pstOld, u64Epoch));
+    LiveConfig_Reclaim(pstStore);
+    pthread_mutex_unlock(&pstStore->mutex);
+}
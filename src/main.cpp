@@ -2,15 +2,270 @@
 #define LOG_LEVEL LOG_LEVEL_INFO
 
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <string>
 #include <signal.h>
+#include <unistd.h>
 #include <pthread.h>
 #include "shared_data.h"
 #include "system_init.h"
 #include "tdl_handler.h"
 #include "venc_handler.h"
 #include "button_handler.h"
+#include "frame_broker.h"
+#include "face_recognizer.h"
+#include "face_gallery.h"
+#include "face_matcher.h"
+#include "face_index.h"
+#include "hal.h"
+#include "app_config.h"
+#include "config_watcher.h"
+#include "live_config.h"
+#include "startup.h"
+#include "overlay.h"
+#include "overlay_text.h"
+#include "osd.h"
+#include "stream_pump.h"
+#include "draw_utils.h"
 
 
+// Enrollment commands on FACE_GALLERY_PATH, -1 if argv is not one
+static int GalleryCommand(int argc, char *argv[]) {
+  const char *cmd = argv[1];
+  bool bEnroll = argc == 4 && strcmp(cmd, "--enroll") == 0;
+  bool bRemove = argc == 3 && strcmp(cmd, "--remove") == 0;
+  bool bList = argc == 2 && strcmp(cmd, "--list") == 0;
+  if (!bEnroll && !bRemove && !bList) {
+    return -1;
+  }
+  FaceGallery_t stGallery;
+  if (FaceGallery_Open(&stGallery, FACE_GALLERY_PATH, FACE_RECOG_FEATURE_DIM, bEnroll) != CVI_SUCCESS) {
+    std::cerr << "Cannot open " << FACE_GALLERY_PATH << std::endl;
+    return 1;
+  }
+  CVI_S32 s32Ret = CVI_SUCCESS;
+  if (bEnroll) {
+    int8_t as8Feature[FACE_RECOG_FEATURE_DIM];
+    FILE *fp = fopen(argv[3], "rb");
+    size_t read = fp ? fread(as8Feature, 1, sizeof(as8Feature), fp) : 0;
+    bool bExtra = fp && fgetc(fp) != EOF;
+    if (fp) {
+      fclose(fp);
+    }
+    uint32_t u32Id = 0;
+    if (read != sizeof(as8Feature) || bExtra) {
+      std::cerr << argv[3] << " is not a " << FACE_RECOG_FEATURE_DIM << "-byte feature" << std::endl;
+      s32Ret = CVI_FAILURE;
+    } else if ((s32Ret = FaceGallery_Add(&stGallery, as8Feature, argv[2], &u32Id)) == CVI_SUCCESS) {
+      std::cout << "Enrolled " << argv[2] << " as ID " << u32Id << std::endl;
+    }
+  } else if (bRemove) {
+    s32Ret = FaceGallery_Remove(&stGallery, (uint32_t)strtoul(argv[2], NULL, 10));
+    std::cout << (s32Ret == CVI_SUCCESS ? "Removed ID " : "No identity with ID ") << argv[2] << std::endl;
+  } else {
+    for (uint32_t i = 0; i < stGallery.u32Count; i++) {
+      if (stGallery.pstSlots[i].u32Id != 0) {
+        std::cout << stGallery.pstSlots[i].u32Id << "\t" << stGallery.pstSlots[i].szName << std::endl;
+      }
+    }
+    std::cout << FaceGallery_Live(&stGallery) << " identities" << std::endl;
+  }
+  FaceGallery_Close(&stGallery);
+  return s32Ret == CVI_SUCCESS ? 0 : 1;
+}
+
+// Everything the start-up steps bring up, see main
+typedef struct {
+  const AppConfig_t *pstConfig;
+  SystemConfig_t *pstSystem;
+  SAMPLE_TDL_MW_CONTEXT *pstMWContext;
+  TDLHandler_t *pstTDLHandler;
+  ButtonHandler_t *pstButton;
+  FrameBroker_t *pstBroker;
+  FaceRecognizer_t *pstRecognizer;
+  FaceGallery_t *pstGallery;
+  FaceIndex_t *pstIndex;
+  Osd_t *pstOsd;
+  StreamPump_t *pstPump;
+  bool bRecognizer;          // started
+  bool bGallery;             // open with identities
+  bool bIndexed;
+  bool bOsd;                 // regions attached to the encoder-only channel
+} AppStart_t;
+
+static CVI_S32 AppStart_System(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  CVI_S32 s32Ret = HAL_System_Init(pstStart->pstSystem, pstStart->pstMWContext);
+  if (s32Ret != CVI_SUCCESS) {
+    std::cerr << "System initialization failed!" << std::endl;
+  }
+  return s32Ret;
+}
+
+// Warm the page cache with the model files while the system comes up, the
+// loads after it then read from memory instead of flash
+static CVI_S32 AppStart_Prefetch(void *pArgs) {
+  const AppConfig_t *pstConfig = static_cast<AppStart_t *>(pArgs)->pstConfig;
+  const char *const apszPaths[] = {pstConfig->szDetectModel, pstConfig->szRoiModel, NULL};
+  return Startup_PrefetchFiles(apszPaths);
+}
+
+static CVI_S32 AppStart_Gpio(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  if (ButtonHandler_Init(pstStart->pstButton, pstStart->pstConfig->s32ButtonPin,
+                         pstStart->pstConfig->s32LedPin) != 0) {
+    std::cerr << "Button handler initialization failed!" << std::endl;
+    return CVI_FAILURE;
+  }
+  return CVI_SUCCESS;
+}
+
+// Recognition is optional, detection and streaming run without it
+static CVI_S32 AppStart_Recognizer(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  const AppConfig_t *pstConfig = pstStart->pstConfig;
+  if (FaceRecognizer_Start(pstStart->pstRecognizer, pstConfig->szRecogParam, pstConfig->szRecogModel) != CVI_SUCCESS) {
+    std::cerr << "Face recognizer unavailable, running detection only" << std::endl;
+    return CVI_FAILURE;
+  }
+  AppConfig_PinThread(pstStart->pstRecognizer->thread, pstConfig->au32Cpus[APP_THREAD_RECOGNIZER], "face recognizer");
+  pstStart->bRecognizer = true;
+  return CVI_SUCCESS;
+}
+
+// Enrolled identities; without any, tracks are embedded but not named
+static CVI_S32 AppStart_Gallery(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  FaceGallery_t *pstGallery = pstStart->pstGallery;
+  CVI_S32 s32Ret = FaceGallery_Open(pstGallery, FACE_GALLERY_PATH, FACE_RECOG_FEATURE_DIM, false);
+  if (s32Ret != CVI_SUCCESS && access(FACE_GALLERY_PATH, F_OK) != 0 && access(FACE_GALLERY_DIR, F_OK) == 0 &&
+      FaceGallery_Open(pstGallery, FACE_GALLERY_PATH, FACE_RECOG_FEATURE_DIM, true) == CVI_SUCCESS) {
+    uint32_t u32Sdk = 0;
+    int s32Imported = FaceGallery_ImportDir(pstGallery, FACE_GALLERY_DIR, &u32Sdk);
+    std::cout << "Imported " << s32Imported << " identities from " << FACE_GALLERY_DIR << "/ into "
+              << FACE_GALLERY_PATH << std::endl;
+    if (u32Sdk > 0) {
+      std::cerr << u32Sdk << " SDK features in " << FACE_GALLERY_DIR << "/ were not imported. Enroll those "
+                << "identities again: --extract FACE_BGR FEATURE_FILE, then --enroll NAME FEATURE_FILE" << std::endl;
+    }
+    s32Ret = CVI_SUCCESS;
+  }
+  if (s32Ret == CVI_SUCCESS && FaceGallery_Live(pstGallery) > 0) {
+    std::cout << "Face gallery: " << FaceGallery_Live(pstGallery) << " identities in " << FACE_GALLERY_PATH
+              << ", " << FaceMatcher_KernelName() << " matcher" << std::endl;
+    pstStart->bGallery = true;
+  } else {
+    std::cout << "Face gallery: no identities in " << FACE_GALLERY_PATH << std::endl;
+  }
+  // Large galleries are searched through an ANN index saved next to them
+  if (s32Ret == CVI_SUCCESS && FaceGallery_Live(pstGallery) >= FACE_INDEX_MIN_IDENTITIES) {
+    FaceIndex_t *pstIndex = pstStart->pstIndex;
+    const std::string indexPath = std::string(FACE_GALLERY_PATH) + FACE_INDEX_SUFFIX;
+    FaceIndexConfig_t stIndexConfig;
+    FaceIndex_DefaultConfig(&stIndexConfig);
+    bool bIndexed = FaceIndex_Load(pstIndex, pstGallery, indexPath.c_str(), &stIndexConfig) == CVI_SUCCESS;
+    if (!bIndexed && FaceIndex_Build(pstIndex, pstGallery, &stIndexConfig) == CVI_SUCCESS) {
+      FaceIndex_Save(pstIndex, pstGallery, indexPath.c_str());
+      bIndexed = true;
+    }
+    if (bIndexed) {
+      std::cout << "Face index: " << pstIndex->u32Lists << " lists, "
+                << (pstIndex->enMode == FACE_INDEX_PQ ? "PQ" : "FLAT") << ", "
+                << FaceIndex_MemoryBytes(pstIndex, pstGallery) / 1024 << " KB" << std::endl;
+      pstStart->bIndexed = true;
+    } else {
+      std::cerr << "Face index unavailable, matching by linear scan" << std::endl;
+    }
+  }
+  return CVI_SUCCESS;
+}
+
+// The TDL handle needs SYS and VB, brought up with the system
+static CVI_S32 AppStart_Detector(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  const AppConfig_t *pstConfig = pstStart->pstConfig;
+  TDLHandler_t *pstHandler = pstStart->pstTDLHandler;
+  CVI_S32 s32Ret = TDLHandler_Init(pstHandler, pstConfig->szDetectModel);
+  if (s32Ret != CVI_SUCCESS) {
+    std::cerr << "TDL initialization failed!" << std::endl;
+    return s32Ret;
+  }
+  TDLHandler_SetDetectConfig(pstHandler, &pstConfig->stDetect);
+  TDLHandler_SetQualityConfig(pstHandler, &pstConfig->stQuality);
+  TDLHandler_SetThreadCpus(pstHandler, pstConfig->au32Cpus[APP_THREAD_TDL_ACQUIRE],
+                           pstConfig->au32Cpus[APP_THREAD_TDL_INFER], pstConfig->au32Cpus[APP_THREAD_TDL_POST]);
+  return CVI_SUCCESS;
+}
+
+static CVI_S32 AppStart_Input(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  CVI_S32 s32Ret = TDLHandler_ConfigureInput(pstStart->pstTDLHandler, pstStart->pstSystem);
+  if (s32Ret != CVI_SUCCESS) {
+    std::cerr << "TDL input configuration failed!" << std::endl;
+  }
+  return s32Ret;
+}
+
+static CVI_S32 AppStart_Roi(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  // the system may have turned it off
+  if (!pstStart->pstSystem->bCenterRoi) {
+    return CVI_SUCCESS;
+  }
+  if (TDLHandler_ConfigureRoi(pstStart->pstTDLHandler, pstStart->pstSystem, pstStart->pstConfig->szRoiModel) !=
+      CVI_SUCCESS) {
+    std::cerr << "Center ROI unavailable, detecting on full frames only" << std::endl;
+    return CVI_FAILURE;
+  }
+  return CVI_SUCCESS;
+}
+
+// Single VPSS channel shared by the TDL and encoder threads
+static CVI_S32 AppStart_Broker(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  CVI_S32 s32Ret = FrameBroker_Start(pstStart->pstBroker, 0, SYSTEM_VPSS_CHN);
+  if (s32Ret != CVI_SUCCESS) {
+    std::cerr << "Frame broker initialization failed!" << std::endl;
+    return s32Ret;
+  }
+  AppConfig_PinThread(pstStart->pstBroker->thread, pstStart->pstConfig->au32Cpus[APP_THREAD_FRAME_BROKER],
+                      "frame broker");
+  return CVI_SUCCESS;
+}
+
+// Region overlays when configured and the system found a channel for them,
+// CPU overlays otherwise
+static CVI_S32 AppStart_Osd(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  if (!pstStart->pstSystem->bEncodeChn) {
+    return CVI_SUCCESS;
+  }
+  if (Osd_Init(pstStart->pstOsd, 0, pstStart->pstSystem->encodeChn, &pstStart->pstSystem->stVencSize, 20,
+               BRUSH_GREEN.size, BRUSH_GREEN) != CVI_SUCCESS) {
+    std::cerr << "Region overlays unavailable" << std::endl;
+    return CVI_FAILURE;
+  }
+  pstStart->bOsd = true;
+  return CVI_SUCCESS;
+}
+
+// Encoded frames go out from their own thread: RTSP, then the encode path report
+static CVI_S32 AppStart_Pump(void *pArgs) {
+  AppStart_t *pstStart = static_cast<AppStart_t *>(pArgs);
+  StreamPump_t *pstPump = pstStart->pstPump;
+  StreamPump_Init(pstPump, pstStart->pstMWContext);
+  StreamPump_AddSink(pstPump, "rtsp", VENCHandler_RtspSink, pstStart->pstMWContext);
+  StreamPump_AddSink(pstPump, "metrics", VENCHandler_MetricsSink, NULL);
+  CVI_S32 s32Ret = StreamPump_Start(pstPump);
+  if (s32Ret != CVI_SUCCESS) {
+    return s32Ret;
+  }
+  AppConfig_PinThread(pstPump->thread, pstStart->pstConfig->au32Cpus[APP_THREAD_STREAM_PUMP], "stream pump");
+  return CVI_SUCCESS;
+}
+
 static void SampleHandleSig(CVI_S32 signo) {
   signal(SIGINT, SIG_IGN);
   signal(SIGTERM, SIG_IGN);
@@ -21,9 +276,83 @@ static void SampleHandleSig(CVI_S32 signo) {
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    std::cout << "\nUsage: " << argv[0] << " SCRFDFACE_MODEL_PATH.\n\n"
-              << "\tSCRFDFACE_MODEL_PATH, path to scrfdface model.\n" << std::endl;
+  if (argc == 4 && strcmp(argv[1], "--extract") == 0) {
+    return FaceRecognizer_ExtractFile(FACE_RECOG_PARAM_PATH, FACE_RECOG_MODEL_PATH, argv[2], argv[3]) == CVI_SUCCESS
+               ? 0 : -1;
+  }
+  if (argc == 3 && strcmp(argv[1], "--bench-recognizer") == 0) {
+    return FaceRecognizer_Benchmark(FACE_RECOG_PARAM_PATH, FACE_RECOG_MODEL_PATH,
+                                    (uint32_t)strtoul(argv[2], NULL, 10)) == CVI_SUCCESS ? 0 : -1;
+  }
+  if ((argc == 3 || argc == 4) && strcmp(argv[1], "--bench-matcher") == 0) {
+    uint32_t u32Dim = argc == 4 ? (uint32_t)strtoul(argv[3], NULL, 10) : FACE_RECOG_FEATURE_DIM;
+    return FaceMatcher_Benchmark((uint32_t)strtoul(argv[2], NULL, 10), u32Dim) == CVI_SUCCESS ? 0 : -1;
+  }
+  if ((argc == 3 || argc == 4) && strcmp(argv[1], "--bench-gallery") == 0) {
+    uint32_t u32Dim = argc == 4 ? (uint32_t)strtoul(argv[3], NULL, 10) : FACE_RECOG_FEATURE_DIM;
+    return FaceGallery_Benchmark((uint32_t)strtoul(argv[2], NULL, 10), u32Dim) == CVI_SUCCESS ? 0 : -1;
+  }
+  if (argc >= 3 && argc <= 5 && strcmp(argv[1], "--bench-index") == 0) {
+    uint32_t u32Dim = argc >= 4 ? (uint32_t)strtoul(argv[3], NULL, 10) : FACE_RECOG_FEATURE_DIM;
+    uint32_t u32CapKB = argc == 5 ? (uint32_t)strtoul(argv[4], NULL, 10) : FACE_INDEX_MEM_CAP_KB;
+    return FaceIndex_Benchmark((uint32_t)strtoul(argv[2], NULL, 10), u32Dim, u32CapKB) == CVI_SUCCESS ? 0 : -1;
+  }
+  if (argc == 3 && strcmp(argv[1], "--bench-overlay") == 0) {
+    return Overlay_Benchmark((uint32_t)strtoul(argv[2], NULL, 10)) == CVI_SUCCESS ? 0 : -1;
+  }
+  if (argc == 3 && strcmp(argv[1], "--bench-text") == 0) {
+    return OverlayText_Benchmark((uint32_t)strtoul(argv[2], NULL, 10)) == CVI_SUCCESS ? 0 : -1;
+  }
+  if (argc >= 2) {
+    int s32Command = GalleryCommand(argc, argv);
+    if (s32Command >= 0) {
+      return s32Command;
+    }
+  }
+  AppConfig_t stAppConfig;
+  AppConfig_DefaultConfig(&stAppConfig);
+  bool bUsage = argc > 3 || (argc >= 2 && argv[1][0] == '-');
+  if (!bUsage && AppConfig_Load(&stAppConfig, APP_CONFIG_PATH) != CVI_SUCCESS) {
+    return -1;
+  }
+  // the watcher compares reloads against the file, not the command line
+  static AppConfig_t s_stFileConfig;
+  s_stFileConfig = stAppConfig;
+  // models given on the command line replace the configured ones
+  if (!bUsage && argc >= 2) {
+    strncpy(stAppConfig.szDetectModel, argv[1], APP_CONFIG_PATH_MAX - 1);
+    stAppConfig.szRoiModel[0] = '\0';
+  }
+  if (!bUsage && argc == 3) {
+    strncpy(stAppConfig.szRoiModel, argv[2], APP_CONFIG_PATH_MAX - 1);
+  }
+  if (bUsage || stAppConfig.szDetectModel[0] == '\0') {
+    std::cout << "\nUsage: " << argv[0] << " [SCRFDFACE_MODEL_PATH [ROI_MODEL_PATH]]\n"
+              << "       " << argv[0] << " --bench-recognizer FACES\n"
+              << "       " << argv[0] << " --bench-matcher IDENTITIES [DIM]\n"
+              << "       " << argv[0] << " --bench-gallery IDENTITIES [DIM]\n"
+              << "       " << argv[0] << " --bench-index IDENTITIES [DIM] [CAP_KB]\n"
+              << "       " << argv[0] << " --bench-overlay FACES\n"
+              << "       " << argv[0] << " --bench-text LABELS\n"
+              << "       " << argv[0] << " --extract FACE_BGR FEATURE_FILE\n"
+              << "       " << argv[0] << " --enroll NAME FEATURE_FILE | --remove ID | --list\n\n"
+              << "\tSettings are read from " << APP_CONFIG_PATH << " in the working directory, if present.\n"
+              << "\tSCRFDFACE_MODEL_PATH, path to scrfdface model, models.detect of " << APP_CONFIG_PATH << " by default.\n"
+              << "\tROI_MODEL_PATH, scrfdface model with a " << stAppConfig.stRoiSize.u32Width << "x"
+              << stAppConfig.stRoiSize.u32Height << " input, detects on the " << stAppConfig.stRoiWindow.u32Width
+              << "x" << stAppConfig.stRoiWindow.u32Height
+              << " window around the crosshair between full-frame detections (models.roi).\n"
+              << "\tFACES, number of faces to embed with " << FACE_RECOG_PARAM_PATH << ".\n"
+              << "\tIDENTITIES, gallery size to match against (DIM bytes each, default "
+              << FACE_RECOG_FEATURE_DIM << ").\n"
+              << "\tCAP_KB, index RAM above which rows are product quantized (default "
+              << FACE_INDEX_MEM_CAP_KB << ", 0 = no cap).\n"
+              << "\tFACES (--bench-overlay), face boxes drawn with the crosshair on a 1080p frame.\n"
+              << "\tLABELS, per-face text labels drawn on a 1080p frame.\n"
+              << "\tFACE_BGR, aligned face as raw BGR24, " << HAL_RECOGNIZER_INPUT_SIZE << "x"
+              << HAL_RECOGNIZER_INPUT_SIZE << ", embedded into FEATURE_FILE.\n"
+              << "\tNAME, FEATURE_FILE, identity enrolled in " << FACE_GALLERY_PATH << " with its "
+              << FACE_RECOG_FEATURE_DIM << "-byte int8 feature.\n" << std::endl;
     return -1;
   }
 
@@ -35,59 +364,153 @@ int main(int argc, char *argv[]) {
   SystemConfig_t stSystemConfig;
   SAMPLE_TDL_MW_CONTEXT stMWContext;
 
-  CVI_S32 s32Ret = SystemInit_All(&stSystemConfig, &stMWContext);
-  if (s32Ret != CVI_SUCCESS) {
-    std::cerr << "System initialization failed!" << std::endl;
-    SharedData_Cleanup();
-    return -1;
-  }
+  // By default the detector reads a VPSS channel at the SCRFD input size and,
+  // with a second model, a VPSS crop around the crosshair
+  AppConfig_ToSystem(&stAppConfig, &stSystemConfig);
 
   TDLHandler_t stTDLHandler;
-  s32Ret = TDLHandler_Init(&stTDLHandler, argv[1]);
+  ButtonHandler_t stButtonHandler;
+  FrameBroker_t stFrameBroker;
+  static FaceRecognizer_t s_stRecognizer;
+  static FaceGallery_t s_stGallery;
+  static FaceIndex_t s_stIndex;
+  static Osd_t s_stOsd;
+  static StreamPump_t s_stPump;
+  AppStart_t stStart;
+  std::memset(&stStart, 0, sizeof(stStart));
+  stStart.pstConfig = &stAppConfig;
+  stStart.pstSystem = &stSystemConfig;
+  stStart.pstMWContext = &stMWContext;
+  stStart.pstTDLHandler = &stTDLHandler;
+  stStart.pstButton = &stButtonHandler;
+  stStart.pstBroker = &stFrameBroker;
+  stStart.pstRecognizer = &s_stRecognizer;
+  stStart.pstGallery = &s_stGallery;
+  stStart.pstIndex = &s_stIndex;
+  stStart.pstOsd = &s_stOsd;
+  stStart.pstPump = &s_stPump;
+
+  // VI/ISP bring-up, the model files, GPIO, the recognizer and the gallery
+  // are independent of each other; the detector needs the system up
+  static Startup_t s_stStartup;
+  Startup_Init(&s_stStartup);
+  uint32_t u32System = Startup_AddStep(&s_stStartup, "system", AppStart_System, &stStart, 0, false);
+  Startup_AddStep(&s_stStartup, "model prefetch", AppStart_Prefetch, &stStart, 0, true);
+  uint32_t u32Gpio = Startup_AddStep(&s_stStartup, "gpio", AppStart_Gpio, &stStart, 0, false);
+  Startup_AddStep(&s_stStartup, "recognizer", AppStart_Recognizer, &stStart, 0, true);
+  Startup_AddStep(&s_stStartup, "gallery", AppStart_Gallery, &stStart, 0, true);
+  uint32_t u32Detector = Startup_AddStep(&s_stStartup, "detector", AppStart_Detector, &stStart, u32System, false);
+  uint32_t u32Input = Startup_AddStep(&s_stStartup, "detect input", AppStart_Input, &stStart, u32Detector, false);
+  // The center ROI is a fast path, full-frame detection works without it
+  Startup_AddStep(&s_stStartup, "center roi", AppStart_Roi, &stStart, u32Input, true);
+  uint32_t u32Broker = Startup_AddStep(&s_stStartup, "frame broker", AppStart_Broker, &stStart, u32System, false);
+  Startup_AddStep(&s_stStartup, "osd", AppStart_Osd, &stStart, u32System, false);
+  uint32_t u32Pump = Startup_AddStep(&s_stStartup, "stream pump", AppStart_Pump, &stStart, u32System, false);
+
+  CVI_S32 s32Ret = Startup_Run(&s_stStartup);
+  Startup_Report(&s_stStartup);
   if (s32Ret != CVI_SUCCESS) {
-    std::cerr << "TDL initialization failed!" << std::endl;
-    SystemInit_Cleanup(&stMWContext);
+    std::cerr << "Start-up failed!" << std::endl;
+    if (stStart.bRecognizer) {
+      FaceRecognizer_Stop(&s_stRecognizer);
+    }
+    if (Startup_Done(&s_stStartup, u32Broker)) {
+      FrameBroker_Stop(&stFrameBroker);
+    }
+    if (Startup_Done(&s_stStartup, u32Gpio)) {
+      ButtonHandler_Cleanup(&stButtonHandler);
+    }
+    if (Startup_Done(&s_stStartup, u32Detector)) {
+      TDLHandler_Cleanup(&stTDLHandler);
+    }
+    FaceGallery_Close(&s_stGallery);
+    if (stStart.bOsd) {
+      Osd_Cleanup(&s_stOsd);
+    }
+    if (Startup_Done(&s_stStartup, u32Pump)) {
+      StreamPump_Stop(&s_stPump);
+    }
+    if (Startup_Done(&s_stStartup, u32System)) {
+      HAL_System_Cleanup(&stMWContext);
+    }
+    Startup_Destroy(&s_stStartup);
     SharedData_Cleanup();
     return -1;
   }
+  Startup_Destroy(&s_stStartup);
 
-  // Initialize button handler (button pin 21, LED pin 25)
-  ButtonHandler_t stButtonHandler;
-  s32Ret = ButtonHandler_Init(&stButtonHandler, 21, 25);
-  if (s32Ret != 0) {
-    std::cerr << "Button handler initialization failed!" << std::endl;
-    TDLHandler_Cleanup(&stTDLHandler);
-    SystemInit_Cleanup(&stMWContext);
-    SharedData_Cleanup();
-    return -1;
-  }
-  
   // link button handler to TDL handler
   TDLHandler_SetButtonHandler(&stTDLHandler, &stButtonHandler);
+  TDLHandler_SetFrameBroker(&stTDLHandler, &stFrameBroker);
+  if (stStart.bRecognizer) {
+    TDLHandler_SetRecognizer(&stTDLHandler, &s_stRecognizer);
+  }
+  if (stStart.bGallery) {
+    TDLHandler_SetGallery(&stTDLHandler, &s_stGallery);
+  }
+  if (stStart.bIndexed) {
+    TDLHandler_SetIndex(&stTDLHandler, &s_stIndex);
+  }
+
+  // Thresholds, cadence, quality, overlay and bitrate follow config.json while running
+  static LiveConfigStore_t s_stLive;
+  LiveConfig_t stLiveConfig;
+  AppConfig_ToLive(&stAppConfig, &stLiveConfig);
+  LiveConfig_Init(&s_stLive, &stLiveConfig);
+  TDLHandler_SetLiveConfig(&stTDLHandler, &s_stLive);
 
   VENCHandler_t stVencArgs;
   stVencArgs.pstMWContext = &stMWContext;
   stVencArgs.pstTDLHandler = &stTDLHandler;
+  stVencArgs.pstFrameBroker = &stFrameBroker;
+  stVencArgs.enOverlayMode = stAppConfig.enOverlayMode;
+  stVencArgs.u32MaxDelayFrames = stAppConfig.u32MaxDelayFrames;
+  stVencArgs.u32BitrateKbps = stAppConfig.u32VencBitrateKbps;
+  stVencArgs.stVencSize = stSystemConfig.stVencSize;
+  stVencArgs.stEncoderRoi = stAppConfig.stEncoderRoi;
+  stVencArgs.pstLive = &s_stLive;
+  stVencArgs.pstOsd = stStart.bOsd ? &s_stOsd : NULL;
+  stVencArgs.encodeChn = stSystemConfig.encodeChn;
+  stVencArgs.bBind = stStart.bOsd && stAppConfig.enEncodePath == VENC_PATH_BIND;
+  stVencArgs.pstPump = &s_stPump;
 
   pthread_t stVencThread, stTDLThread, stButtonThread;
   pthread_create(&stVencThread, nullptr, VENCHandler_ThreadRoutine, &stVencArgs);
   pthread_create(&stTDLThread, nullptr, TDLHandler_ThreadRoutine, &stTDLHandler);
   pthread_create(&stButtonThread, nullptr, ButtonHandler_ThreadRoutine, &stButtonHandler);
+  AppConfig_PinThread(stVencThread, stAppConfig.au32Cpus[APP_THREAD_VENC], "VENC");
+  AppConfig_PinThread(stButtonThread, stAppConfig.au32Cpus[APP_THREAD_BUTTON], "button");
+
+  static ConfigWatcher_t s_stWatcher;
+  if (ConfigWatcher_Start(&s_stWatcher, APP_CONFIG_PATH, &s_stFileConfig, &s_stLive) != CVI_SUCCESS) {
+    std::cerr << "Config watcher unavailable, " << APP_CONFIG_PATH << " changes need a restart" << std::endl;
+  }
 
   std::cout << "=== Face Detection Application Started ===" << std::endl;
-  std::cout << "Press button (GPIO 21) to capture photo" << std::endl;
-  std::cout << "LED (GPIO 25) indicates button press" << std::endl;
+  std::cout << "Press button (GPIO " << stAppConfig.s32ButtonPin << ") to capture photo" << std::endl;
+  std::cout << "LED (GPIO " << stAppConfig.s32LedPin << ") indicates button press" << std::endl;
   std::cout << "Press Ctrl+C to stop..." << std::endl;
 
   pthread_join(stVencThread, nullptr);
   pthread_join(stTDLThread, nullptr);
+  // pipeline threads may stop on their own (e.g. frame source error), release the button thread
+  g_bExit = true;
   pthread_join(stButtonThread, nullptr);
+  ConfigWatcher_Stop(&s_stWatcher);
+  FaceRecognizer_Stop(&s_stRecognizer);
+  FrameBroker_Stop(&stFrameBroker);
 
   std::cout << "=== Cleaning up resources ===" << std::endl;
 
   ButtonHandler_Cleanup(&stButtonHandler);
   TDLHandler_Cleanup(&stTDLHandler);
-  SystemInit_Cleanup(&stMWContext);
+  FaceGallery_Close(&s_stGallery);
+  LiveConfig_Destroy(&s_stLive);
+  StreamPump_Stop(&s_stPump);
+  if (stStart.bOsd) {
+    Osd_Cleanup(&s_stOsd);
+  }
+  HAL_System_Cleanup(&stMWContext);
   SharedData_Cleanup();
 
   std::cout << "=== Application exited gracefully ===" << std::endl;
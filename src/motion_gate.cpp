@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "motion_gate.h"
+#include "hal.h"
+
+void MotionGate_DefaultConfig(MotionGateConfig_t *pstConfig) {
+    pstConfig->u32Threshold = MOTION_GATE_THRESHOLD;
+    pstConfig->u32MinBlocks = MOTION_GATE_MIN_BLOCKS;
+    pstConfig->u64HoldUs = MOTION_GATE_HOLD_US;
+    pstConfig->u64HeartbeatUs = MOTION_GATE_HEARTBEAT_US;
+}
+
+void MotionGate_Init(MotionGate_t *pstGate, const MotionGateConfig_t *pstConfig) {
+    std::memset(pstGate, 0, sizeof(MotionGate_t));
+    if (pstConfig) {
+        pstGate->stConfig = *pstConfig;
+    } else {
+        MotionGate_DefaultConfig(&pstGate->stConfig);
+    }
+}
+
+void MotionGate_SetConfig(MotionGate_t *pstGate, const MotionGateConfig_t *pstConfig) {
+    pstGate->stConfig = *pstConfig;
+}
+
+// Mean of a MOTION_GATE_BLOCK_SAMPLES squared lattice centered in each block
+static void MotionGate_BlockMeans(const VIDEO_FRAME_S *pstV, uint8_t *pu8Means) {
+    // luma, or green as its stand-in on planar BGR
+    const uint8_t *pu8Plane = pstV->enPixelFormat == PIXEL_FORMAT_BGR_888_PLANAR ? pstV->pu8VirAddr[1]
+                                                                                 : pstV->pu8VirAddr[0];
+    const uint32_t u32Stride = pstV->u32Stride[0];
+    for (uint32_t by = 0; by < MOTION_GATE_ROWS; by++) {
+        for (uint32_t bx = 0; bx < MOTION_GATE_COLS; bx++) {
+            uint32_t u32Sum = 0;
+            for (uint32_t sy = 0; sy < MOTION_GATE_BLOCK_SAMPLES; sy++) {
+                uint32_t y = (uint32_t)(((uint64_t)by * MOTION_GATE_BLOCK_SAMPLES + sy) * 2 + 1) * pstV->u32Height /
+                             (2 * MOTION_GATE_ROWS * MOTION_GATE_BLOCK_SAMPLES);
+                const uint8_t *pu8Row = pu8Plane + (size_t)y * u32Stride;
+                for (uint32_t sx = 0; sx < MOTION_GATE_BLOCK_SAMPLES; sx++) {
+                    uint32_t x = (uint32_t)(((uint64_t)bx * MOTION_GATE_BLOCK_SAMPLES + sx) * 2 + 1) *
+                                 pstV->u32Width / (2 * MOTION_GATE_COLS * MOTION_GATE_BLOCK_SAMPLES);
+                    u32Sum += pu8Row[x];
+                }
+            }
+            pu8Means[by * MOTION_GATE_COLS + bx] =
+                (uint8_t)(u32Sum / (MOTION_GATE_BLOCK_SAMPLES * MOTION_GATE_BLOCK_SAMPLES));
+        }
+    }
+}
+
+uint32_t MotionGate_Update(MotionGate_t *pstGate, VIDEO_FRAME_INFO_S *pstFrame) {
+    uint8_t au8Means[MOTION_GATE_ROWS * MOTION_GATE_COLS];
+    HAL_FrameSource_Mmap(pstFrame);
+    MotionGate_BlockMeans(&pstFrame->stVFrame, au8Means);
+    HAL_FrameSource_Munmap(pstFrame);
+
+    uint64_t u64PTS = pstFrame->stVFrame.u64PTS;
+    pstGate->u64Frames++;
+    if (!pstGate->bInit) {
+        // the first frame only sets the background; all of it counts as moving
+        // so the faces already in view are picked up
+        for (int i = 0; i < MOTION_GATE_ROWS * MOTION_GATE_COLS; i++) {
+            pstGate->au16Background[i] = (uint16_t)(au8Means[i] << 4);
+        }
+        MotionMask_t *pstMask = &pstGate->stMask;
+        for (int i = 0; i < MOTION_GATE_REGION_ROWS * MOTION_GATE_REGION_COLS; i++) {
+            pstMask->abRegion[i] = true;
+        }
+        pstMask->u32Active = MOTION_GATE_REGION_ROWS * MOTION_GATE_REGION_COLS;
+        pstMask->stActive.x2 = 1.0f;
+        pstMask->stActive.y2 = 1.0f;
+        pstGate->bInit = true;
+        pstGate->u64LastMotionPTS = u64PTS;
+        pstGate->u64MotionFrames++;
+        return pstMask->u32Active;
+    }
+
+    uint8_t au8Changed[MOTION_GATE_REGION_ROWS * MOTION_GATE_REGION_COLS] = {0};
+    for (int i = 0; i < MOTION_GATE_ROWS * MOTION_GATE_COLS; i++) {
+        int s32Diff = ((int)au8Means[i] << 4) - (int)pstGate->au16Background[i];
+        if (std::abs(s32Diff) > (int)(pstGate->stConfig.u32Threshold << 4)) {
+            int by = i / MOTION_GATE_COLS;
+            int bx = i % MOTION_GATE_COLS;
+            au8Changed[(by / MOTION_GATE_REGION_BLOCKS) * MOTION_GATE_REGION_COLS + bx / MOTION_GATE_REGION_BLOCKS]++;
+        }
+        // steps rounded up, so the background reaches a still frame exactly
+        pstGate->au16Background[i] = (uint16_t)((int)pstGate->au16Background[i] +
+                                                (s32Diff + (s32Diff > 0 ? 1 : -1) * ((1 << MOTION_GATE_BG_SHIFT) - 1)) /
+                                                    (1 << MOTION_GATE_BG_SHIFT));
+    }
+
+    MotionMask_t *pstMask = &pstGate->stMask;
+    int x1 = MOTION_GATE_REGION_COLS, y1 = MOTION_GATE_REGION_ROWS, x2 = -1, y2 = -1;
+    pstMask->u32Active = 0;
+    for (int r = 0; r < MOTION_GATE_REGION_ROWS; r++) {
+        for (int c = 0; c < MOTION_GATE_REGION_COLS; c++) {
+            bool bActive = au8Changed[r * MOTION_GATE_REGION_COLS + c] >= pstGate->stConfig.u32MinBlocks;
+            pstMask->abRegion[r * MOTION_GATE_REGION_COLS + c] = bActive;
+            if (bActive) {
+                pstMask->u32Active++;
+                x1 = std::min(x1, c);
+                y1 = std::min(y1, r);
+                x2 = std::max(x2, c);
+                y2 = std::max(y2, r);
+            }
+        }
+    }
+    std::memset(&pstMask->stActive, 0, sizeof(pstMask->stActive));
+    if (pstMask->u32Active > 0) {
+        pstMask->stActive.x1 = (float)x1 / MOTION_GATE_REGION_COLS;
+        pstMask->stActive.y1 = (float)y1 / MOTION_GATE_REGION_ROWS;
+        pstMask->stActive.x2 = (float)(x2 + 1) / MOTION_GATE_REGION_COLS;
+        pstMask->stActive.y2 = (float)(y2 + 1) / MOTION_GATE_REGION_ROWS;
+        pstGate->u64LastMotionPTS = u64PTS;
+        pstGate->u64MotionFrames++;
+    }
+    return pstMask->u32Active;
+}
+
+bool MotionGate_Idle(const MotionGate_t *pstGate, uint64_t u64PTS) {
+    return pstGate->bInit && u64PTS > pstGate->u64LastMotionPTS + pstGate->stConfig.u64HoldUs;
+}
+
+bool MotionGate_Overlaps(const MotionMask_t *pstMask, const cvtdl_bbox_t *pstBox, const SIZE_S *pstFrame) {
+    int c1 = std::max(0, (int)(pstBox->x1 * MOTION_GATE_REGION_COLS / pstFrame->u32Width));
+    int r1 = std::max(0, (int)(pstBox->y1 * MOTION_GATE_REGION_ROWS / pstFrame->u32Height));
+    int c2 = std::min(MOTION_GATE_REGION_COLS - 1, (int)(pstBox->x2 * MOTION_GATE_REGION_COLS / pstFrame->u32Width));
+    int r2 = std::min(MOTION_GATE_REGION_ROWS - 1, (int)(pstBox->y2 * MOTION_GATE_REGION_ROWS / pstFrame->u32Height));
+    for (int r = r1; r <= r2; r++) {
+        for (int c = c1; c <= c2; c++) {
+            if (pstMask->abRegion[r * MOTION_GATE_REGION_COLS + c]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool MotionGate_Within(const MotionMask_t *pstMask, const RECT_S *pstWindow, const SIZE_S *pstFrame) {
+    if (pstMask->u32Active == 0) {
+        return false;
+    }
+    return pstMask->stActive.x1 * pstFrame->u32Width >= pstWindow->s32X &&
+           pstMask->stActive.y1 * pstFrame->u32Height >= pstWindow->s32Y &&
+           pstMask->stActive.x2 * pstFrame->u32Width <= pstWindow->s32X + (float)pstWindow->u32Width &&
+           pstMask->stActive.y2 * pstFrame->u32Height <= pstWindow->s32Y + (float)pstWindow->u32Height;
+}
@@ -0,0 +1,115 @@
+#include <cstring>
+#include <iostream>
+#include "osd.h"
+
+CVI_S32 Osd_Init(Osd_t *pstOsd, VPSS_GRP grp, VPSS_CHN chn, const SIZE_S *pstSize, uint32_t u32Cross,
+                 uint32_t u32Thickness, const cvtdl_service_brush_t &brush) {
+    std::memset(pstOsd, 0, sizeof(Osd_t));
+    pstOsd->grp = grp;
+    pstOsd->chn = chn;
+    pstOsd->stSize = *pstSize;
+
+    CVI_S32 s32Ret = HAL_Osd_CreateCanvas(OSD_RGN_CANVAS, grp, chn, pstSize);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Cannot create the OSD canvas, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+        return s32Ret;
+    }
+    pstOsd->bCanvas = true;
+
+    // the crosshair never changes, two covers draw it without any canvas pixels
+    CVI_U32 u32Rgb = (CVI_U32)brush.color.r << 16 | (CVI_U32)brush.color.g << 8 | (CVI_U32)brush.color.b;
+    int cx = (int)(pstSize->u32Width / 2) & ~1, cy = (int)(pstSize->u32Height / 2) & ~1;
+    int s = (int)u32Cross, t = (int)((u32Thickness + 1) & ~1u);
+    RECT_S astCross[2] = {
+        {cx - s, cy - t / 2, (CVI_U32)(2 * s), (CVI_U32)t},
+        {cx - t / 2, cy - s, (CVI_U32)t, (CVI_U32)(2 * s)},
+    };
+    const RGN_HANDLE aHandle[2] = {OSD_RGN_CROSS_H, OSD_RGN_CROSS_V};
+    for (int i = 0; i < 2; i++) {
+        s32Ret = HAL_Osd_CreateCover(aHandle[i], grp, chn, &astCross[i], u32Rgb);
+        if (s32Ret != CVI_SUCCESS) {
+            std::cerr << "Cannot create the crosshair cover, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+            Osd_Cleanup(pstOsd);
+            return s32Ret;
+        }
+        pstOsd->abCover[i] = true;
+    }
+    pstOsd->bShow = true;
+    std::cout << "OSD on VPSS Chn" << chn << ": " << pstSize->u32Width << "x" << pstSize->u32Height
+              << " canvas, crosshair covers" << std::endl;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 Osd_Show(Osd_t *pstOsd, bool bShow) {
+    if (pstOsd->bShow == bShow) {
+        return CVI_SUCCESS;
+    }
+    CVI_S32 s32Ret = HAL_Osd_Show(OSD_RGN_CANVAS, pstOsd->grp, pstOsd->chn, bShow);
+    if (s32Ret == CVI_SUCCESS) {
+        s32Ret = HAL_Osd_Show(OSD_RGN_CROSS_H, pstOsd->grp, pstOsd->chn, bShow);
+    }
+    if (s32Ret == CVI_SUCCESS) {
+        s32Ret = HAL_Osd_Show(OSD_RGN_CROSS_V, pstOsd->grp, pstOsd->chn, bShow);
+    }
+    if (s32Ret == CVI_SUCCESS) {
+        pstOsd->bShow = bShow;
+    }
+    return s32Ret;
+}
+
+CVI_S32 Osd_Update(Osd_t *pstOsd, const OverlayBatch_t *pstBatch) {
+    if (pstOsd->u32Updates > 0 && Overlay_Equal(&pstOsd->stShown, pstBatch)) {
+        pstOsd->u32Unchanged++;
+        return CVI_SUCCESS;
+    }
+    HalOsdCanvas_t stCanvas;
+    CVI_S32 s32Ret = HAL_Osd_GetCanvas(OSD_RGN_CANVAS, &stCanvas);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+
+    // each buffer still holds what was drawn on it two updates ago
+    int s32Buffer = -1;
+    for (int i = 0; i < 2; i++) {
+        if (pstOsd->au64Buffer[i] == stCanvas.u64PhyAddr) {
+            s32Buffer = i;
+        }
+    }
+    if (s32Buffer >= 0) {
+        Overlay_RenderCanvas(&pstOsd->astDrawn[s32Buffer], stCanvas.pu8Data, stCanvas.u32Stride, &stCanvas.stSize,
+                             true);
+    } else {
+        // first use, its content is unknown
+        s32Buffer = pstOsd->au64Buffer[0] == 0 ? 0 : 1;
+        pstOsd->au64Buffer[s32Buffer] = stCanvas.u64PhyAddr;
+        for (CVI_U32 y = 0; y < stCanvas.stSize.u32Height; y++) {
+            std::memset(stCanvas.pu8Data + (size_t)y * stCanvas.u32Stride, 0,
+                        stCanvas.stSize.u32Width * sizeof(uint16_t));
+        }
+    }
+    Overlay_RenderCanvas(pstBatch, stCanvas.pu8Data, stCanvas.u32Stride, &stCanvas.stSize, false);
+    pstOsd->astDrawn[s32Buffer] = *pstBatch;
+
+    s32Ret = HAL_Osd_UpdateCanvas(OSD_RGN_CANVAS);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    pstOsd->stShown = *pstBatch;
+    pstOsd->u32Updates++;
+    return CVI_SUCCESS;
+}
+
+void Osd_Cleanup(Osd_t *pstOsd) {
+    if (pstOsd->abCover[1]) {
+        HAL_Osd_Destroy(OSD_RGN_CROSS_V, pstOsd->grp, pstOsd->chn);
+    }
+    if (pstOsd->abCover[0]) {
+        HAL_Osd_Destroy(OSD_RGN_CROSS_H, pstOsd->grp, pstOsd->chn);
+    }
+    if (pstOsd->bCanvas) {
+        HAL_Osd_Destroy(OSD_RGN_CANVAS, pstOsd->grp, pstOsd->chn);
+        std::cout << "OSD stopped: canvas updates=" << pstOsd->u32Updates
+                  << ", frames unchanged=" << pstOsd->u32Unchanged << std::endl;
+    }
+    std::memset(pstOsd, 0, sizeof(Osd_t));
+}
@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/time.h>
+#include <vector>
+#include "overlay.h"
+#include "overlay_text.h"
+#include "draw_utils.h"
+#include "hal.h"
+
+static uint64_t Overlay_NowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static uint8_t Overlay_Clamp(float f) {
+    return (uint8_t)(f < 0.0f ? 0.0f : (f > 255.0f ? 255.0f : f + 0.5f));
+}
+
+OverlayColor_t Overlay_Color(const cvtdl_service_brush_t &brush) {
+    float r = brush.color.r, g = brush.color.g, b = brush.color.b;
+    OverlayColor_t stColor;
+    stColor.u8Y = Overlay_Clamp(0.257f * r + 0.504f * g + 0.098f * b + 16.0f);
+    stColor.u8U = Overlay_Clamp(-0.148f * r - 0.291f * g + 0.439f * b + 128.0f);
+    stColor.u8V = Overlay_Clamp(0.439f * r - 0.368f * g - 0.071f * b + 128.0f);
+    stColor.u16Argb1555 = (uint16_t)(0x8000 | (Overlay_Clamp(r) >> 3) << 10 | (Overlay_Clamp(g) >> 3) << 5 |
+                                     Overlay_Clamp(b) >> 3);
+    return stColor;
+}
+
+void Overlay_Begin(OverlayBatch_t *pstBatch) {
+    pstBatch->u32Count = 0;
+    pstBatch->u32Dropped = 0;
+    pstBatch->u32TextCount = 0;
+}
+
+static int16_t Overlay_Even(float f) {
+    int v = (int)f;
+    v = std::min(std::max(v, -0x4000), 0x3ffe);
+    return (int16_t)(v & ~1);
+}
+
+static OverlayShape_t *Overlay_Next(OverlayBatch_t *pstBatch) {
+    if (pstBatch->u32Count >= OVERLAY_MAX_SHAPES) {
+        pstBatch->u32Dropped++;
+        return NULL;
+    }
+    return &pstBatch->astShape[pstBatch->u32Count++];
+}
+
+void Overlay_AddBox(OverlayBatch_t *pstBatch, const cvtdl_bbox_t *pstBox, OverlayColor_t stColor,
+                    uint32_t u32Thickness) {
+    OverlayShape_t *pstShape = Overlay_Next(pstBatch);
+    if (!pstShape) {
+        return;
+    }
+    pstShape->s16X0 = Overlay_Even(pstBox->x1);
+    pstShape->s16Y0 = Overlay_Even(pstBox->y1);
+    pstShape->s16X1 = Overlay_Even(pstBox->x2 + 1.0f);
+    pstShape->s16Y1 = Overlay_Even(pstBox->y2 + 1.0f);
+    pstShape->u8Type = OVERLAY_SHAPE_BOX;
+    pstShape->u8Thickness = (uint8_t)std::min<uint32_t>((u32Thickness + 1) & ~1u, 254);
+    pstShape->stColor = stColor;
+}
+
+void Overlay_AddFill(OverlayBatch_t *pstBatch, int x0, int y0, int x1, int y1, OverlayColor_t stColor) {
+    OverlayShape_t *pstShape = Overlay_Next(pstBatch);
+    if (!pstShape) {
+        return;
+    }
+    pstShape->s16X0 = Overlay_Even((float)x0);
+    pstShape->s16Y0 = Overlay_Even((float)y0);
+    pstShape->s16X1 = Overlay_Even((float)x1 + 1.0f);
+    pstShape->s16Y1 = Overlay_Even((float)y1 + 1.0f);
+    pstShape->u8Type = OVERLAY_SHAPE_FILL;
+    pstShape->u8Thickness = 0;
+    pstShape->stColor = stColor;
+}
+
+void Overlay_AddCrosshair(OverlayBatch_t *pstBatch, int x, int y, uint32_t u32Size, OverlayColor_t stColor,
+                          uint32_t u32Thickness) {
+    int s = (int)u32Size, t = (int)std::max<uint32_t>(u32Thickness, 2) / 2;
+    Overlay_AddFill(pstBatch, x - s, y - t, x + s, y + t - 1, stColor);
+    Overlay_AddFill(pstBatch, x - t, y - s, x + t - 1, y + s, stColor);
+}
+
+void Overlay_AddText(OverlayBatch_t *pstBatch, int x, int y, const char *pszText, OverlayColor_t stColor,
+                     uint32_t u32Scale) {
+    if (pstBatch->u32TextCount >= OVERLAY_MAX_TEXTS) {
+        pstBatch->u32Dropped++;
+        return;
+    }
+    OverlayText_t *pstText = &pstBatch->astText[pstBatch->u32TextCount++];
+    pstText->s16X = Overlay_Even((float)x);
+    pstText->s16Y = Overlay_Even((float)y);
+    pstText->u8Scale = (uint8_t)std::min<uint32_t>(std::max<uint32_t>(u32Scale, 1), 16);
+    pstText->stColor = stColor;
+    std::strncpy(pstText->szText, pszText, OVERLAY_TEXT_MAX - 1);
+    pstText->szText[OVERLAY_TEXT_MAX - 1] = '\0';
+}
+
+static bool Overlay_SameColor(OverlayColor_t a, OverlayColor_t b) {
+    return a.u16Argb1555 == b.u16Argb1555 && a.u8Y == b.u8Y && a.u8U == b.u8U && a.u8V == b.u8V;
+}
+
+bool Overlay_Equal(const OverlayBatch_t *pstA, const OverlayBatch_t *pstB) {
+    if (pstA->u32Count != pstB->u32Count || pstA->u32TextCount != pstB->u32TextCount) {
+        return false;
+    }
+    for (uint32_t i = 0; i < pstA->u32Count; i++) {
+        const OverlayShape_t *a = &pstA->astShape[i], *b = &pstB->astShape[i];
+        if (a->s16X0 != b->s16X0 || a->s16Y0 != b->s16Y0 || a->s16X1 != b->s16X1 || a->s16Y1 != b->s16Y1 ||
+            a->u8Type != b->u8Type || a->u8Thickness != b->u8Thickness || !Overlay_SameColor(a->stColor, b->stColor)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < pstA->u32TextCount; i++) {
+        const OverlayText_t *a = &pstA->astText[i], *b = &pstB->astText[i];
+        if (a->s16X != b->s16X || a->s16Y != b->s16Y || a->u8Scale != b->u8Scale ||
+            !Overlay_SameColor(a->stColor, b->stColor) || std::strcmp(a->szText, b->szText) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The mapped planes of one frame
+typedef struct {
+    uint8_t *pu8Y;
+    uint8_t *pu8C;             // interleaved chroma, half height
+    uint32_t u32StrideY;
+    uint32_t u32StrideC;
+    int s32Width;              // even
+    int s32Height;
+} OverlayPlanes_t;
+
+// Chroma pair as stored: VU for NV21, UV for NV12
+template <bool bVU>
+static inline uint16_t Overlay_ChromaPair(OverlayColor_t stColor) {
+    uint8_t au8Pair[2] = {bVU ? stColor.u8V : stColor.u8U, bVU ? stColor.u8U : stColor.u8V};
+    uint16_t u16Pair;
+    std::memcpy(&u16Pair, au8Pair, sizeof(u16Pair));
+    return u16Pair;
+}
+
+// N chroma pairs from pu8Row; with N known at compile time the loop becomes a few stores
+template <int N>
+static inline void Overlay_StoreChroma(uint8_t *pu8Row, uint16_t u16Pair, int n) {
+    if (N > 0) {
+        for (int i = 0; i < N; i++) {
+            std::memcpy(pu8Row + 2 * i, &u16Pair, 2);
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            std::memcpy(pu8Row + 2 * i, &u16Pair, 2);
+        }
+    }
+}
+
+// Solid span [x0, x1) x [y0, y1), already clipped and even
+template <bool bVU>
+static void Overlay_FillSpan(const OverlayPlanes_t *pstPlanes, int x0, int y0, int x1, int y1,
+                             OverlayColor_t stColor) {
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+    for (int y = y0; y < y1; y++) {
+        std::memset(pstPlanes->pu8Y + (size_t)y * pstPlanes->u32StrideY + x0, stColor.u8Y, x1 - x0);
+    }
+    uint16_t u16Pair = Overlay_ChromaPair<bVU>(stColor);
+    for (int y = y0 / 2; y < y1 / 2; y++) {
+        Overlay_StoreChroma<0>(pstPlanes->pu8C + (size_t)y * pstPlanes->u32StrideC + x0, u16Pair, (x1 - x0) / 2);
+    }
+}
+
+template <bool bVU>
+static void Overlay_FillClipped(const OverlayPlanes_t *pstPlanes, int x0, int y0, int x1, int y1,
+                                OverlayColor_t stColor) {
+    Overlay_FillSpan<bVU>(pstPlanes, std::max(x0, 0), std::max(y0, 0), std::min(x1, pstPlanes->s32Width),
+                          std::min(y1, pstPlanes->s32Height), stColor);
+}
+
+// Outline of thickness T (0 = t, known only at run time). Boxes inside the
+// frame draw their sides row by row with fixed-size stores; the others are
+// clipped as four spans.
+template <bool bVU, int T>
+static void Overlay_DrawBox(const OverlayPlanes_t *pstPlanes, const OverlayShape_t *pstShape) {
+    const int t = T > 0 ? T : pstShape->u8Thickness;
+    int x0 = pstShape->s16X0, y0 = pstShape->s16Y0, x1 = pstShape->s16X1, y1 = pstShape->s16Y1;
+    if (x1 - x0 <= 2 * t || y1 - y0 <= 2 * t) {
+        Overlay_FillClipped<bVU>(pstPlanes, x0, y0, x1, y1, pstShape->stColor);
+        return;
+    }
+    if (x0 < 0 || y0 < 0 || x1 > pstPlanes->s32Width || y1 > pstPlanes->s32Height) {
+        Overlay_FillClipped<bVU>(pstPlanes, x0, y0, x1, y0 + t, pstShape->stColor);
+        Overlay_FillClipped<bVU>(pstPlanes, x0, y1 - t, x1, y1, pstShape->stColor);
+        Overlay_FillClipped<bVU>(pstPlanes, x0, y0 + t, x0 + t, y1 - t, pstShape->stColor);
+        Overlay_FillClipped<bVU>(pstPlanes, x1 - t, y0 + t, x1, y1 - t, pstShape->stColor);
+        return;
+    }
+
+    Overlay_FillSpan<bVU>(pstPlanes, x0, y0, x1, y0 + t, pstShape->stColor);
+    Overlay_FillSpan<bVU>(pstPlanes, x0, y1 - t, x1, y1, pstShape->stColor);
+    const uint8_t u8Y = pstShape->stColor.u8Y;
+    for (int y = y0 + t; y < y1 - t; y++) {
+        uint8_t *pu8Row = pstPlanes->pu8Y + (size_t)y * pstPlanes->u32StrideY;
+        std::memset(pu8Row + x0, u8Y, T > 0 ? T : t);
+        std::memset(pu8Row + x1 - t, u8Y, T > 0 ? T : t);
+    }
+    uint16_t u16Pair = Overlay_ChromaPair<bVU>(pstShape->stColor);
+    for (int y = (y0 + t) / 2; y < (y1 - t) / 2; y++) {
+        uint8_t *pu8Row = pstPlanes->pu8C + (size_t)y * pstPlanes->u32StrideC;
+        Overlay_StoreChroma<T / 2>(pu8Row + x0, u16Pair, t / 2);
+        Overlay_StoreChroma<T / 2>(pu8Row + x1 - t, u16Pair, t / 2);
+    }
+}
+
+template <bool bVU>
+static void Overlay_DrawAll(const OverlayPlanes_t *pstPlanes, const OverlayBatch_t *pstBatch) {
+    for (uint32_t i = 0; i < pstBatch->u32Count; i++) {
+        const OverlayShape_t *pstShape = &pstBatch->astShape[i];
+        if (pstShape->u8Type == OVERLAY_SHAPE_FILL) {
+            Overlay_FillClipped<bVU>(pstPlanes, pstShape->s16X0, pstShape->s16Y0, pstShape->s16X1, pstShape->s16Y1,
+                                     pstShape->stColor);
+            continue;
+        }
+        switch (pstShape->u8Thickness) {
+        case 2:
+            Overlay_DrawBox<bVU, 2>(pstPlanes, pstShape);
+            break;
+        case 4:
+            Overlay_DrawBox<bVU, 4>(pstPlanes, pstShape);
+            break;
+        default:
+            Overlay_DrawBox<bVU, 0>(pstPlanes, pstShape);
+            break;
+        }
+    }
+}
+
+CVI_S32 Overlay_Render(const OverlayBatch_t *pstBatch, VIDEO_FRAME_INFO_S *pstFrame) {
+    if (!pstBatch || !pstFrame) {
+        return CVI_FAILURE;
+    }
+    VIDEO_FRAME_S *pstV = &pstFrame->stVFrame;
+    bool bVU = pstV->enPixelFormat == PIXEL_FORMAT_NV21;
+    if (!bVU && pstV->enPixelFormat != PIXEL_FORMAT_NV12) {
+        return CVI_FAILURE;
+    }
+    if (pstBatch->u32Count == 0 && pstBatch->u32TextCount == 0) {
+        return CVI_SUCCESS;
+    }
+
+    HAL_FrameSource_Mmap(pstFrame);
+    OverlayPlanes_t stPlanes;
+    stPlanes.pu8Y = pstV->pu8VirAddr[0];
+    stPlanes.pu8C = pstV->pu8VirAddr[1];
+    stPlanes.u32StrideY = pstV->u32Stride[0];
+    stPlanes.u32StrideC = pstV->u32Stride[1];
+    stPlanes.s32Width = (int)(pstV->u32Width & ~1u);
+    stPlanes.s32Height = (int)(pstV->u32Height & ~1u);
+    if (bVU) {
+        Overlay_DrawAll<true>(&stPlanes, pstBatch);
+    } else {
+        Overlay_DrawAll<false>(&stPlanes, pstBatch);
+    }
+    // text last, over the boxes
+    for (uint32_t i = 0; i < pstBatch->u32TextCount; i++) {
+        OverlayText_Draw(&pstBatch->astText[i], stPlanes.pu8Y, stPlanes.u32StrideY, stPlanes.pu8C,
+                         stPlanes.u32StrideC, stPlanes.s32Width, stPlanes.s32Height, bVU);
+    }
+    HAL_FrameSource_Munmap(pstFrame);
+    return CVI_SUCCESS;
+}
+
+static void Overlay_FillCanvas(uint8_t *pu8Canvas, uint32_t u32Stride, const SIZE_S *pstSize, int x0, int y0, int x1,
+                               int y1, uint16_t u16Pixel) {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, (int)pstSize->u32Width);
+    y1 = std::min(y1, (int)pstSize->u32Height);
+    for (int y = y0; y < y1; y++) {
+        uint16_t *pu16Row = (uint16_t *)(pu8Canvas + (size_t)y * u32Stride);
+        std::fill(pu16Row + std::min(x0, x1), pu16Row + x1, u16Pixel);
+    }
+}
+
+void Overlay_RenderCanvas(const OverlayBatch_t *pstBatch, uint8_t *pu8Canvas, uint32_t u32Stride,
+                          const SIZE_S *pstSize, bool bErase) {
+    for (uint32_t i = 0; i < pstBatch->u32Count; i++) {
+        const OverlayShape_t *s = &pstBatch->astShape[i];
+        uint16_t u16Pixel = bErase ? 0 : s->stColor.u16Argb1555;
+        int t = s->u8Thickness;
+        if (s->u8Type == OVERLAY_SHAPE_FILL || s->s16X1 - s->s16X0 <= 2 * t || s->s16Y1 - s->s16Y0 <= 2 * t) {
+            Overlay_FillCanvas(pu8Canvas, u32Stride, pstSize, s->s16X0, s->s16Y0, s->s16X1, s->s16Y1, u16Pixel);
+            continue;
+        }
+        Overlay_FillCanvas(pu8Canvas, u32Stride, pstSize, s->s16X0, s->s16Y0, s->s16X1, s->s16Y0 + t, u16Pixel);
+        Overlay_FillCanvas(pu8Canvas, u32Stride, pstSize, s->s16X0, s->s16Y1 - t, s->s16X1, s->s16Y1, u16Pixel);
+        Overlay_FillCanvas(pu8Canvas, u32Stride, pstSize, s->s16X0, s->s16Y0 + t, s->s16X0 + t, s->s16Y1 - t, u16Pixel);
+        Overlay_FillCanvas(pu8Canvas, u32Stride, pstSize, s->s16X1 - t, s->s16Y0 + t, s->s16X1, s->s16Y1 - t, u16Pixel);
+    }
+    for (uint32_t i = 0; i < pstBatch->u32TextCount; i++) {
+        const OverlayText_t *pstText = &pstBatch->astText[i];
+        if (!bErase) {
+            OverlayText_DrawCanvas(pstText, pu8Canvas, u32Stride, pstSize);
+            continue;
+        }
+        // the whole string box, whatever the glyphs were
+        int k = pstText->u8Scale;
+        int w = (int)std::strlen(pstText->szText) * (OVERLAY_FONT_WIDTH + 1) * k;
+        Overlay_FillCanvas(pu8Canvas, u32Stride, pstSize, pstText->s16X, pstText->s16Y, pstText->s16X + w,
+                           pstText->s16Y + OVERLAY_FONT_HEIGHT * k, 0);
+    }
+}
+
+// Pixel by pixel, for the benchmark to check the kernels against
+static void Overlay_RenderReference(const OverlayBatch_t *pstBatch, const OverlayPlanes_t *pstPlanes) {
+    for (uint32_t i = 0; i < pstBatch->u32Count; i++) {
+        const OverlayShape_t *s = &pstBatch->astShape[i];
+        int t = s->u8Type == OVERLAY_SHAPE_BOX ? s->u8Thickness : 0;
+        for (int y = std::max<int>(s->s16Y0, 0); y < std::min<int>(s->s16Y1, pstPlanes->s32Height); y++) {
+            for (int x = std::max<int>(s->s16X0, 0); x < std::min<int>(s->s16X1, pstPlanes->s32Width); x++) {
+                bool bInner = t > 0 && x >= s->s16X0 + t && x < s->s16X1 - t && y >= s->s16Y0 + t && y < s->s16Y1 - t;
+                if (bInner) {
+                    continue;
+                }
+                pstPlanes->pu8Y[(size_t)y * pstPlanes->u32StrideY + x] = s->stColor.u8Y;
+                uint8_t *pu8C = pstPlanes->pu8C + (size_t)(y / 2) * pstPlanes->u32StrideC + (x & ~1);
+                pu8C[0] = s->stColor.u8V;
+                pu8C[1] = s->stColor.u8U;
+            }
+        }
+    }
+}
+
+CVI_S32 Overlay_Benchmark(uint32_t u32Faces) {
+    const uint32_t u32Width = 1920, u32Height = 1080;
+    std::vector<uint8_t> frame(u32Width * u32Height * 3 / 2, 128);
+    std::vector<uint8_t> reference(frame);
+    VIDEO_FRAME_INFO_S stFrame;
+    std::memset(&stFrame, 0, sizeof(stFrame));
+    VIDEO_FRAME_S *pstV = &stFrame.stVFrame;
+    pstV->enPixelFormat = PIXEL_FORMAT_NV21;
+    pstV->u32Width = u32Width;
+    pstV->u32Height = u32Height;
+    pstV->u32Stride[0] = pstV->u32Stride[1] = u32Width;
+    pstV->u32Length[0] = u32Width * u32Height;
+    pstV->u32Length[1] = u32Width * u32Height / 2;
+    pstV->pu8VirAddr[0] = frame.data();
+    pstV->pu8VirAddr[1] = frame.data() + pstV->u32Length[0];
+    pstV->u64PhyAddr[0] = (uint64_t)(uintptr_t)pstV->pu8VirAddr[0];
+    pstV->u64PhyAddr[1] = (uint64_t)(uintptr_t)pstV->pu8VirAddr[1];
+
+    // faces of 40 to 200 pixels, some crossing the frame edge
+    static OverlayBatch_t s_stBatch;
+    Overlay_Begin(&s_stBatch);
+    srand(1);
+    for (uint32_t i = 0; i < u32Faces; i++) {
+        cvtdl_bbox_t stBox;
+        float fSide = 40.0f + rand() % 160;
+        stBox.x1 = (float)(rand() % (u32Width + 100)) - 50.0f;
+        stBox.y1 = (float)(rand() % (u32Height + 100)) - 50.0f;
+        stBox.x2 = stBox.x1 + fSide;
+        stBox.y2 = stBox.y1 + fSide;
+        Overlay_AddBox(&s_stBatch, &stBox, Overlay_Color(i == 0 ? BRUSH_RED : BRUSH_BLUE), i % 3 == 2 ? 6 : 2);
+    }
+    Overlay_AddCrosshair(&s_stBatch, u32Width / 2, u32Height / 2, 20, Overlay_Color(BRUSH_GREEN), 2);
+
+    Overlay_Render(&s_stBatch, &stFrame);
+    OverlayPlanes_t stPlanes = {reference.data(), reference.data() + u32Width * u32Height, u32Width, u32Width,
+                                (int)u32Width, (int)u32Height};
+    Overlay_RenderReference(&s_stBatch, &stPlanes);
+    bool bExact = frame == reference;
+
+    const uint32_t u32Rounds = 200;
+    uint64_t u64Start = Overlay_NowUs();
+    for (uint32_t r = 0; r < u32Rounds; r++) {
+        Overlay_Render(&s_stBatch, &stFrame);
+    }
+    double dRenderUs = (double)(Overlay_NowUs() - u64Start) / u32Rounds;
+    u64Start = Overlay_NowUs();
+    for (uint32_t r = 0; r < u32Rounds / 10; r++) {
+        Overlay_RenderReference(&s_stBatch, &stPlanes);
+    }
+    double dReferenceUs = (double)(Overlay_NowUs() - u64Start) / (u32Rounds / 10);
+
+    std::cout << "=== Overlay Benchmark ===" << std::endl;
+    std::cout << "Frame: " << u32Width << "x" << u32Height << " NV21, shapes: " << s_stBatch.u32Count
+              << " (" << u32Faces << " faces, crosshair)" << std::endl;
+    std::cout << "Render: " << dRenderUs << " us per frame, per-pixel reference " << dReferenceUs << " us, speedup "
+              << dReferenceUs / dRenderUs << "x" << std::endl;
+    std::cout << "Reference: " << (bExact ? "bit-exact" : "MISMATCH") << std::endl;
+    std::cout << "=========================" << std::endl;
+    return bExact ? CVI_SUCCESS : CVI_FAILURE;
+}
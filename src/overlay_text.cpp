@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <sys/time.h>
+#include <vector>
+#include "overlay_text.h"
+#include "draw_utils.h"
+
+#if defined(OVERLAY_TEXT_KERNEL_RVV)
+#include <riscv_vector.h>
+#endif
+
+static uint64_t OverlayText_NowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+// 5x7 cells, one byte per row with the leftmost pixel in bit 4
+typedef struct {
+    char c;
+    uint8_t au8Rows[OVERLAY_FONT_HEIGHT];
+} OverlayTextGlyph_t;
+
+static const OverlayTextGlyph_t kOverlayFont[] = {
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}}, {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}}, {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}}, {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}}, {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}}, {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {'A', {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}}, {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}}, {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}}, {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}}, {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}}, {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}}, {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+    {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}}, {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}}, {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}}, {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}}, {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}}, {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}}, {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}}, {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {' ', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}}, {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}}, {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+    {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}}, {'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+    {'_', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F}}, {'#', {0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A}},
+    {'?', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}},
+};
+
+// The font baked once into byte masks (0x00 or 0xFF per pixel), indexed by
+// character, so rendering a string is row copies without bit tests
+typedef struct {
+    const uint8_t *apu8Rows[128];
+    uint8_t au8Mask[128][OVERLAY_FONT_HEIGHT][OVERLAY_FONT_WIDTH];
+} OverlayTextAtlas_t;
+
+static OverlayTextAtlas_t s_stAtlas;
+static pthread_once_t s_atlasOnce = PTHREAD_ONCE_INIT;
+
+static void OverlayText_BuildAtlas() {
+    const size_t n = sizeof(kOverlayFont) / sizeof(kOverlayFont[0]);
+    for (int ch = 0; ch < 128; ch++) {
+        char c = (char)(ch >= 'a' && ch <= 'z' ? ch - 'a' + 'A' : ch);
+        const uint8_t *pu8Rows = kOverlayFont[n - 1].au8Rows;
+        for (size_t i = 0; i < n; i++) {
+            if (kOverlayFont[i].c == c) {
+                pu8Rows = kOverlayFont[i].au8Rows;
+                break;
+            }
+        }
+        s_stAtlas.apu8Rows[ch] = pu8Rows;
+        for (int r = 0; r < OVERLAY_FONT_HEIGHT; r++) {
+            for (int x = 0; x < OVERLAY_FONT_WIDTH; x++) {
+                s_stAtlas.au8Mask[ch][r][x] = (pu8Rows[r] & (0x10 >> x)) ? 0xFF : 0x00;
+            }
+        }
+    }
+}
+
+static inline int OverlayText_Index(char c) {
+    return (unsigned char)c < 128 ? (unsigned char)c : '?';
+}
+
+const uint8_t *OverlayText_Glyph(char c) {
+    pthread_once(&s_atlasOnce, OverlayText_BuildAtlas);
+    return s_stAtlas.apu8Rows[OverlayText_Index(c)];
+}
+
+// One string rendered at one scale: a luma mask of s32Width x s32Height and a
+// chroma mask of s32Width x (s32Height + 1) / 2 where both bytes of a pair are
+// set if any of its 2x2 pixels is
+typedef struct {
+    char szText[OVERLAY_TEXT_MAX];
+    uint8_t u8Scale;
+    int s32Width;
+    int s32Height;
+    uint32_t u32Used;          // draw clock at the last use, 0 = empty
+    std::vector<uint8_t> luma;
+    std::vector<uint8_t> chroma;
+} OverlayTextEntry_t;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    uint32_t u32Clock;
+    uint32_t u32Hits;
+    uint32_t u32Renders;
+    OverlayTextEntry_t astEntry[OVERLAY_TEXT_CACHE_ENTRIES];
+} OverlayTextCache_t;
+
+static OverlayTextCache_t s_stCache = {PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, {}};
+
+// Compose the string from the atlas, k x k per font pixel, OVERLAY_FONT_WIDTH + 1
+// cells of advance. The vectors keep their capacity, so replacing an entry
+// does not allocate once the longest string has been seen.
+static void OverlayText_Render(OverlayTextEntry_t *pstEntry, const char *pszText, int k) {
+    pthread_once(&s_atlasOnce, OverlayText_BuildAtlas);
+    std::strncpy(pstEntry->szText, pszText, OVERLAY_TEXT_MAX - 1);
+    pstEntry->szText[OVERLAY_TEXT_MAX - 1] = '\0';
+    pstEntry->u8Scale = (uint8_t)k;
+    int n = (int)std::strlen(pstEntry->szText);
+    int w = n * (OVERLAY_FONT_WIDTH + 1) * k, h = OVERLAY_FONT_HEIGHT * k;
+    pstEntry->s32Width = w;
+    pstEntry->s32Height = h;
+    pstEntry->luma.assign((size_t)w * h, 0);
+    for (int r = 0; r < OVERLAY_FONT_HEIGHT; r++) {
+        uint8_t *pu8Row = pstEntry->luma.data() + (size_t)r * k * w;
+        for (int i = 0; i < n; i++) {
+            const uint8_t *pu8Glyph = s_stAtlas.au8Mask[OverlayText_Index(pstEntry->szText[i])][r];
+            uint8_t *pu8Cell = pu8Row + i * (OVERLAY_FONT_WIDTH + 1) * k;
+            for (int x = 0; x < OVERLAY_FONT_WIDTH; x++) {
+                std::memset(pu8Cell + x * k, pu8Glyph[x], k);
+            }
+        }
+        for (int dy = 1; dy < k; dy++) {
+            std::memcpy(pu8Row + (size_t)dy * w, pu8Row, w);
+        }
+    }
+    int hc = (h + 1) / 2;
+    pstEntry->chroma.assign((size_t)w * hc, 0);
+    for (int y = 0; y < hc; y++) {
+        const uint8_t *pu8Top = pstEntry->luma.data() + (size_t)2 * y * w;
+        const uint8_t *pu8Bottom = 2 * y + 1 < h ? pu8Top + w : pu8Top;
+        uint8_t *pu8C = pstEntry->chroma.data() + (size_t)y * w;
+        for (int x = 0; x < w; x += 2) {
+            uint8_t u8Any = pu8Top[x] | pu8Top[x + 1] | pu8Bottom[x] | pu8Bottom[x + 1];
+            pu8C[x] = pu8C[x + 1] = u8Any;
+        }
+    }
+}
+
+// Called with the cache mutex held
+static const OverlayTextEntry_t *OverlayText_Lookup(const OverlayText_t *pstText) {
+    uint32_t u32Clock = ++s_stCache.u32Clock;
+    OverlayTextEntry_t *pstOldest = &s_stCache.astEntry[0];
+    for (int i = 0; i < OVERLAY_TEXT_CACHE_ENTRIES; i++) {
+        OverlayTextEntry_t *pstEntry = &s_stCache.astEntry[i];
+        if (pstEntry->u32Used && pstEntry->u8Scale == pstText->u8Scale &&
+            std::strcmp(pstEntry->szText, pstText->szText) == 0) {
+            pstEntry->u32Used = u32Clock;
+            s_stCache.u32Hits++;
+            return pstEntry;
+        }
+        if (pstEntry->u32Used < pstOldest->u32Used) {
+            pstOldest = pstEntry;
+        }
+    }
+    OverlayText_Render(pstOldest, pstText->szText, pstText->u8Scale);
+    pstOldest->u32Used = u32Clock;
+    s_stCache.u32Renders++;
+    return pstOldest;
+}
+
+// pu8Dst = pu8Mask ? pattern : pu8Dst, over n bytes. The pattern repeats the
+// luma value, or the chroma pair from an even offset; 64 bytes cover the
+// longest vector the RVV kernel uses (LMUL=4 on 128-bit registers).
+#define OVERLAY_TEXT_PATTERN 64
+
+#if defined(OVERLAY_TEXT_KERNEL_RVV)
+static void OverlayText_Select(uint8_t *pu8Dst, const uint8_t *pu8Mask, const uint8_t *pu8Pattern, int n) {
+    vuint8m4_t vP = vle8_v_u8m4(pu8Pattern, vsetvl_e8m4(OVERLAY_TEXT_PATTERN));
+    size_t vl;
+    for (int i = 0; i < n; i += (int)vl) {
+        vl = vsetvl_e8m4(n - i);
+        vuint8m4_t vM = vle8_v_u8m4(pu8Mask + i, vl);
+        vuint8m4_t vD = vle8_v_u8m4(pu8Dst + i, vl);
+        vD = vor_vv_u8m4(vand_vv_u8m4(vD, vnot_v_u8m4(vM, vl), vl), vand_vv_u8m4(vP, vM, vl), vl);
+        vse8_v_u8m4(pu8Dst + i, vD, vl);
+    }
+}
+#elif defined(OVERLAY_TEXT_KERNEL_GENERIC)
+typedef uint8_t OverlayTextU8x16_t __attribute__((vector_size(16)));
+
+static void OverlayText_Select(uint8_t *pu8Dst, const uint8_t *pu8Mask, const uint8_t *pu8Pattern, int n) {
+    OverlayTextU8x16_t vP;
+    std::memcpy(&vP, pu8Pattern, sizeof(vP));
+    int i = 0;
+    for (; i + (int)sizeof(vP) <= n; i += sizeof(vP)) {
+        OverlayTextU8x16_t vM, vD;
+        std::memcpy(&vM, pu8Mask + i, sizeof(vM));
+        std::memcpy(&vD, pu8Dst + i, sizeof(vD));
+        vD = (vD & ~vM) | (vP & vM);
+        std::memcpy(pu8Dst + i, &vD, sizeof(vD));
+    }
+    for (; i < n; i++) {
+        pu8Dst[i] = (uint8_t)((pu8Dst[i] & ~pu8Mask[i]) | (pu8Pattern[i & 15] & pu8Mask[i]));
+    }
+}
+#else
+static void OverlayText_Select(uint8_t *pu8Dst, const uint8_t *pu8Mask, const uint8_t *pu8Pattern, int n) {
+    for (int i = 0; i < n; i++) {
+        pu8Dst[i] = (uint8_t)((pu8Dst[i] & ~pu8Mask[i]) | (pu8Pattern[i % OVERLAY_TEXT_PATTERN] & pu8Mask[i]));
+    }
+}
+#endif
+
+const char *OverlayText_KernelName() {
+#if defined(OVERLAY_TEXT_KERNEL_RVV)
+    return "RVV";
+#elif defined(OVERLAY_TEXT_KERNEL_GENERIC)
+    return "GENERIC";
+#else
+    return "SCALAR";
+#endif
+}
+
+// Blit the masks of pstEntry with the top left corner at (x, y), even
+static void OverlayText_Blit(const OverlayTextEntry_t *pstEntry, int x, int y, OverlayColor_t stColor,
+                             uint8_t *pu8Y, uint32_t u32StrideY, uint8_t *pu8C, uint32_t u32StrideC, int s32Width,
+                             int s32Height, bool bVU) {
+    int x0 = std::max(x, 0), x1 = std::min(x + pstEntry->s32Width, s32Width);
+    int y0 = std::max(y, 0), y1 = std::min(y + pstEntry->s32Height, s32Height);
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+    uint8_t au8Luma[OVERLAY_TEXT_PATTERN], au8Chroma[OVERLAY_TEXT_PATTERN];
+    std::memset(au8Luma, stColor.u8Y, sizeof(au8Luma));
+    for (int i = 0; i < OVERLAY_TEXT_PATTERN; i += 2) {
+        au8Chroma[i] = bVU ? stColor.u8V : stColor.u8U;
+        au8Chroma[i + 1] = bVU ? stColor.u8U : stColor.u8V;
+    }
+    for (int row = y0; row < y1; row++) {
+        OverlayText_Select(pu8Y + (size_t)row * u32StrideY + x0,
+                           pstEntry->luma.data() + (size_t)(row - y) * pstEntry->s32Width + (x0 - x), au8Luma,
+                           x1 - x0);
+    }
+    for (int row = y0 / 2; row < (y1 + 1) / 2; row++) {
+        OverlayText_Select(pu8C + (size_t)row * u32StrideC + x0,
+                           pstEntry->chroma.data() + (size_t)(row - y / 2) * pstEntry->s32Width + (x0 - x),
+                           au8Chroma, x1 - x0);
+    }
+}
+
+void OverlayText_Draw(const OverlayText_t *pstText, uint8_t *pu8Y, uint32_t u32StrideY, uint8_t *pu8C,
+                      uint32_t u32StrideC, int s32Width, int s32Height, bool bVU) {
+    if (pstText->szText[0] == '\0') {
+        return;
+    }
+    pthread_mutex_lock(&s_stCache.mutex);
+    const OverlayTextEntry_t *pstEntry = OverlayText_Lookup(pstText);
+    OverlayText_Blit(pstEntry, pstText->s16X & ~1, pstText->s16Y & ~1, pstText->stColor, pu8Y, u32StrideY, pu8C,
+                     u32StrideC, s32Width, s32Height, bVU);
+    pthread_mutex_unlock(&s_stCache.mutex);
+}
+
+void OverlayText_DrawCanvas(const OverlayText_t *pstText, uint8_t *pu8Canvas, uint32_t u32Stride,
+                            const SIZE_S *pstSize) {
+    if (pstText->szText[0] == '\0') {
+        return;
+    }
+    pthread_mutex_lock(&s_stCache.mutex);
+    const OverlayTextEntry_t *pstEntry = OverlayText_Lookup(pstText);
+    int x = pstText->s16X, y = pstText->s16Y;
+    int x0 = std::max(x, 0), x1 = std::min(x + pstEntry->s32Width, (int)pstSize->u32Width);
+    int y0 = std::max(y, 0), y1 = std::min(y + pstEntry->s32Height, (int)pstSize->u32Height);
+    for (int row = y0; row < y1; row++) {
+        uint16_t *pu16Row = (uint16_t *)(pu8Canvas + (size_t)row * u32Stride);
+        const uint8_t *pu8Mask = pstEntry->luma.data() + (size_t)(row - y) * pstEntry->s32Width - x;
+        for (int col = x0; col < x1; col++) {
+            if (pu8Mask[col]) {
+                pu16Row[col] = pstText->stColor.u16Argb1555;
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_stCache.mutex);
+}
+
+// Pixel by pixel from the font bits, for the benchmark to check the masks against
+static void OverlayText_DrawReference(const OverlayText_t *pstText, uint8_t *pu8Y, uint8_t *pu8C, int s32Width,
+                                      int s32Height) {
+    int k = pstText->u8Scale;
+    int x = pstText->s16X & ~1, y = pstText->s16Y & ~1;
+    for (const char *pc = pstText->szText; *pc; pc++, x += (OVERLAY_FONT_WIDTH + 1) * k) {
+        const uint8_t *pu8Rows = OverlayText_Glyph(*pc);
+        for (int r = 0; r < OVERLAY_FONT_HEIGHT * k; r++) {
+            for (int c = 0; c < OVERLAY_FONT_WIDTH * k; c++) {
+                int px = x + c, py = y + r;
+                if (!(pu8Rows[r / k] & (0x10 >> (c / k))) || px < 0 || py < 0 || px >= s32Width ||
+                    py >= s32Height) {
+                    continue;
+                }
+                pu8Y[(size_t)py * s32Width + px] = pstText->stColor.u8Y;
+                uint8_t *pu8Pair = pu8C + (size_t)(py / 2) * s32Width + (px & ~1);
+                pu8Pair[0] = pstText->stColor.u8V;
+                pu8Pair[1] = pstText->stColor.u8U;
+            }
+        }
+    }
+}
+
+CVI_S32 OverlayText_Benchmark(uint32_t u32Labels) {
+    const int s32Width = 1920, s32Height = 1080;
+    std::vector<uint8_t> frame((size_t)s32Width * s32Height * 3 / 2, 128);
+    std::vector<uint8_t> reference(frame);
+    uint8_t *pu8Y = frame.data(), *pu8C = frame.data() + (size_t)s32Width * s32Height;
+
+    // the per-face labels to come: track ID, name and score, some over the frame edge
+    std::vector<OverlayText_t> labels(std::max<uint32_t>(u32Labels, 1));
+    uint32_t u32Glyphs = 0;
+    srand(1);
+    const char *const apszNames[] = {"ALICE", "BOB", "CAROL", "DAVE", "UNKNOWN"};
+    for (size_t i = 0; i < labels.size(); i++) {
+        OverlayText_t *pstText = &labels[i];
+        std::memset(pstText, 0, sizeof(OverlayText_t));
+        pstText->s16X = (int16_t)((rand() % (s32Width + 100)) - 100);
+        pstText->s16Y = (int16_t)((rand() % (s32Height + 20)) - 10);
+        pstText->u8Scale = i == 0 ? 2 : 1 + i % 2;
+        pstText->stColor = Overlay_Color(i % 2 ? BRUSH_BLUE : BRUSH_GREEN);
+        snprintf(pstText->szText, 17, "#%u %s %.2f", (unsigned)(i + 1), apszNames[i % 5], (rand() % 100) / 100.0f);
+        u32Glyphs += (uint32_t)std::strlen(pstText->szText);
+    }
+
+    for (size_t i = 0; i < labels.size(); i++) {
+        OverlayText_Draw(&labels[i], pu8Y, s32Width, pu8C, s32Width, s32Width, s32Height, true);
+        OverlayText_DrawReference(&labels[i], reference.data(), reference.data() + (size_t)s32Width * s32Height,
+                                  s32Width, s32Height);
+    }
+    bool bExact = frame == reference;
+
+    const uint32_t u32Rounds = 200;
+    pthread_mutex_lock(&s_stCache.mutex);
+    uint32_t u32Hits = s_stCache.u32Hits, u32Renders = s_stCache.u32Renders;
+    pthread_mutex_unlock(&s_stCache.mutex);
+    uint64_t u64Start = OverlayText_NowUs();
+    for (uint32_t r = 0; r < u32Rounds; r++) {
+        for (size_t i = 0; i < labels.size(); i++) {
+            OverlayText_Draw(&labels[i], pu8Y, s32Width, pu8C, s32Width, s32Width, s32Height, true);
+        }
+    }
+    double dCachedUs = (double)(OverlayText_NowUs() - u64Start) / u32Rounds;
+    pthread_mutex_lock(&s_stCache.mutex);
+    u32Hits = s_stCache.u32Hits - u32Hits;
+    u32Renders = s_stCache.u32Renders - u32Renders;
+    pthread_mutex_unlock(&s_stCache.mutex);
+
+    // every string rendered again before its blit, as without the cache
+    static OverlayTextEntry_t s_stScratch;
+    u64Start = OverlayText_NowUs();
+    for (uint32_t r = 0; r < u32Rounds; r++) {
+        for (size_t i = 0; i < labels.size(); i++) {
+            OverlayText_Render(&s_stScratch, labels[i].szText, labels[i].u8Scale);
+            OverlayText_Blit(&s_stScratch, labels[i].s16X & ~1, labels[i].s16Y & ~1, labels[i].stColor, pu8Y,
+                             s32Width, pu8C, s32Width, s32Width, s32Height, true);
+        }
+    }
+    double dRenderUs = (double)(OverlayText_NowUs() - u64Start) / u32Rounds;
+
+    u64Start = OverlayText_NowUs();
+    for (uint32_t r = 0; r < u32Rounds / 10; r++) {
+        for (size_t i = 0; i < labels.size(); i++) {
+            OverlayText_DrawReference(&labels[i], reference.data(),
+                                      reference.data() + (size_t)s32Width * s32Height, s32Width, s32Height);
+        }
+    }
+    double dReferenceUs = (double)(OverlayText_NowUs() - u64Start) / (u32Rounds / 10);
+
+    std::cout << "=== Text Benchmark ===" << std::endl;
+    std::cout << "Frame: " << s32Width << "x" << s32Height << " NV21, labels: " << labels.size() << ", glyphs: "
+              << u32Glyphs << ", kernel: " << OverlayText_KernelName() << std::endl;
+    std::cout << "Cached: " << dCachedUs << " us per frame, " << u32Glyphs / dCachedUs * 1000.0 << " glyphs/ms ("
+              << u32Hits << " hits, " << u32Renders << " renders)" << std::endl;
+    std::cout << "Render every draw: " << dRenderUs << " us, " << u32Glyphs / dRenderUs * 1000.0 << " glyphs/ms"
+              << std::endl;
+    std::cout << "Per-pixel reference: " << dReferenceUs << " us, " << u32Glyphs / dReferenceUs * 1000.0
+              << " glyphs/ms" << std::endl;
+    std::cout << "Speedup: " << dRenderUs / dCachedUs << "x over rendering every draw, "
+              << dReferenceUs / dCachedUs << "x over per pixel" << std::endl;
+    std::cout << "Reference: " << (bExact ? "bit-exact" : "MISMATCH") << std::endl;
+    std::cout << "======================" << std::endl;
+    return bExact ? CVI_SUCCESS : CVI_FAILURE;
+}
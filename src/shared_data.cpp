@@ -1,25 +1,199 @@
+
+#include <algorithm>
+#include <iostream>
 #include <cstring>
 #include "shared_data.h"
 
+#define FACE_RESULT_DIRTY 0x4u
+#define FACE_RESULT_INDEX_MASK 0x3u
 
 std::atomic<bool> g_bExit(false);
-cvtdl_face_t g_stFaceMeta = {0};
-pthread_mutex_t g_ResultMutex;
+FaceResultExchange_t g_stFaceResults;
+FaceResultHistory_t g_stFaceHistory;
 
 // FPS tracking
-float g_fCurrentFPS = 0.0f;
-pthread_mutex_t g_FPSMutex;
+std::atomic<float> g_fCurrentFPS(0.0f);
+
+static void FaceResult_ResetSlot(FaceResultSlot_t *pstSlot) {
+    std::memset(pstSlot, 0, sizeof(FaceResultSlot_t));
+    pstSlot->stMeta.info = pstSlot->astInfo;
+}
+
+void FaceResult_Init(FaceResultExchange_t *pstExchange) {
+    for (int i = 0; i < 3; i++) {
+        FaceResult_ResetSlot(&pstExchange->astSlot[i]);
+    }
+    pstExchange->u32Back = 0;
+    pstExchange->u32Middle.store(1, std::memory_order_relaxed);
+    pstExchange->u32Front = 2;
+    pstExchange->u64PublishSeq = 0;
+    pstExchange->u32Truncated = 0;
+}
+
+static void FaceResult_FillSlot(FaceResultSlot_t *pstSlot, const cvtdl_face_t *pstFaceMeta,
+                               const VIDEO_FRAME_S *pstSrcFrame, uint32_t *pu32Truncated) {
+    uint32_t u32Size = pstFaceMeta->info ? pstFaceMeta->size : 0;
+    if (u32Size > FACE_RESULT_MAX_FACES) {
+        if ((*pu32Truncated)++ == 0) {
+            std::cerr << "Face result truncated from " << u32Size << " to "
+                      << FACE_RESULT_MAX_FACES << " faces" << std::endl;
+        }
+        u32Size = FACE_RESULT_MAX_FACES;
+    }
+
+    pstSlot->stMeta.size = u32Size;
+    pstSlot->stMeta.width = pstFaceMeta->width;
+    pstSlot->stMeta.height = pstFaceMeta->height;
+    pstSlot->stMeta.rescale_type = pstFaceMeta->rescale_type;
+    pstSlot->stMeta.info = pstSlot->astInfo;
+    pstSlot->stMeta.dms = NULL;
+    pstSlot->u64FramePTS = pstSrcFrame->u64PTS;
+    pstSlot->u32FrameSeq = pstSrcFrame->u32TimeRef;
+
+    for (uint32_t i = 0; i < u32Size; i++) {
+        const cvtdl_face_info_t *pstSrc = &pstFaceMeta->info[i];
+        cvtdl_face_info_t *pstDst = &pstSlot->astInfo[i];
+        std::memcpy(pstDst, pstSrc, sizeof(cvtdl_face_info_t));
+
+        uint32_t u32Pts = 0;
+        if (pstSrc->pts.x && pstSrc->pts.y) {
+            u32Pts = std::min<uint32_t>(pstSrc->pts.size, FACE_RESULT_MAX_PTS);
+        }
+        if (u32Pts) {
+            std::memcpy(pstSlot->afPtsX[i], pstSrc->pts.x, sizeof(float) * u32Pts);
+            std::memcpy(pstSlot->afPtsY[i], pstSrc->pts.y, sizeof(float) * u32Pts);
+        }
+        pstDst->pts.x = pstSlot->afPtsX[i];
+        pstDst->pts.y = pstSlot->afPtsY[i];
+        pstDst->pts.size = u32Pts;
+        pstDst->feature.ptr = NULL;
+        pstDst->feature.size = 0;
+    }
+}
+
+// Copy only the used part of a slot and re-point it at its own storage
+static void FaceResult_CopySlot(FaceResultSlot_t *pstDst, const FaceResultSlot_t *pstSrc) {
+    uint32_t u32Size = std::min<uint32_t>(pstSrc->stMeta.size, FACE_RESULT_MAX_FACES);
+    pstDst->stMeta = pstSrc->stMeta;
+    pstDst->stMeta.size = u32Size;
+    pstDst->stMeta.info = pstDst->astInfo;
+    pstDst->u64PublishSeq = pstSrc->u64PublishSeq;
+    pstDst->u64FramePTS = pstSrc->u64FramePTS;
+    pstDst->u32FrameSeq = pstSrc->u32FrameSeq;
+    std::memcpy(pstDst->astInfo, pstSrc->astInfo, sizeof(cvtdl_face_info_t) * u32Size);
+    std::memcpy(pstDst->afPtsX, pstSrc->afPtsX, sizeof(pstSrc->afPtsX[0]) * u32Size);
+    std::memcpy(pstDst->afPtsY, pstSrc->afPtsY, sizeof(pstSrc->afPtsY[0]) * u32Size);
+    for (uint32_t i = 0; i < u32Size; i++) {
+        pstDst->astInfo[i].pts.x = pstDst->afPtsX[i];
+        pstDst->astInfo[i].pts.y = pstDst->afPtsY[i];
+    }
+}
+
+void FaceResult_Publish(FaceResultExchange_t *pstExchange, const cvtdl_face_t *pstFaceMeta,
+                        const VIDEO_FRAME_S *pstSrcFrame) {
+    FaceResultSlot_t *pstSlot = &pstExchange->astSlot[pstExchange->u32Back];
+    FaceResult_FillSlot(pstSlot, pstFaceMeta, pstSrcFrame, &pstExchange->u32Truncated);
+    pstSlot->u64PublishSeq = ++pstExchange->u64PublishSeq;
+
+    uint32_t u32Old = pstExchange->u32Middle.exchange(pstExchange->u32Back | FACE_RESULT_DIRTY,
+                                                      std::memory_order_acq_rel);
+    pstExchange->u32Back = u32Old & FACE_RESULT_INDEX_MASK;
+}
+
+FaceResultSlot_t *FaceResult_Acquire(FaceResultExchange_t *pstExchange) {
+    if (pstExchange->u32Middle.load(std::memory_order_relaxed) & FACE_RESULT_DIRTY) {
+        uint32_t u32Old = pstExchange->u32Middle.exchange(pstExchange->u32Front,
+                                                          std::memory_order_acq_rel);
+        pstExchange->u32Front = u32Old & FACE_RESULT_INDEX_MASK;
+    }
+    return &pstExchange->astSlot[pstExchange->u32Front];
+}
+
+void FaceResultHistory_Init(FaceResultHistory_t *pstHistory) {
+    for (int i = 0; i < FACE_RESULT_HISTORY; i++) {
+        pstHistory->astEntry[i].u32Lock.store(0, std::memory_order_relaxed);
+        FaceResult_ResetSlot(&pstHistory->astEntry[i].stSlot);
+    }
+    pstHistory->u64Count.store(0, std::memory_order_relaxed);
+    pstHistory->u64LatestPTS.store(0, std::memory_order_relaxed);
+}
+
+void FaceResultHistory_Push(FaceResultHistory_t *pstHistory, const cvtdl_face_t *pstFaceMeta,
+                            const VIDEO_FRAME_S *pstSrcFrame) {
+    static uint32_t s_u32Truncated = 0;
+    uint64_t u64Count = pstHistory->u64Count.load(std::memory_order_relaxed);
+    FaceResultHistoryEntry_t *pstEntry = &pstHistory->astEntry[u64Count % FACE_RESULT_HISTORY];
+
+    uint32_t u32Lock = pstEntry->u32Lock.load(std::memory_order_relaxed);
+    pstEntry->u32Lock.store(u32Lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    FaceResult_FillSlot(&pstEntry->stSlot, pstFaceMeta, pstSrcFrame, &s_u32Truncated);
+    pstEntry->stSlot.u64PublishSeq = u64Count + 1;
+    pstEntry->u32Lock.store(u32Lock + 2, std::memory_order_release);
+
+    pstHistory->u64Count.store(u64Count + 1, std::memory_order_release);
+    pstHistory->u64LatestPTS.store(pstSrcFrame->u64PTS, std::memory_order_release);
+}
+
+uint64_t FaceResultHistory_LatestPTS(FaceResultHistory_t *pstHistory) {
+    return pstHistory->u64LatestPTS.load(std::memory_order_acquire);
+}
+
+static uint64_t FaceResult_PTSDistance(uint64_t a, uint64_t b) {
+    return a > b ? a - b : b - a;
+}
+
+bool FaceResultHistory_FindNearest(FaceResultHistory_t *pstHistory, uint64_t u64PTS,
+                                   FaceResultSlot_t *pstOut) {
+    for (int attempt = 0; attempt < 4; attempt++) {
+        uint64_t u64Count = pstHistory->u64Count.load(std::memory_order_acquire);
+        if (u64Count == 0) {
+            return false;
+        }
+        uint64_t u64First = u64Count > FACE_RESULT_HISTORY ? u64Count - FACE_RESULT_HISTORY : 0;
+
+        // Pick the closest entry from the (unlocked) PTS values first
+        int best = -1;
+        uint64_t u64BestDistance = UINT64_MAX;
+        for (uint64_t n = u64First; n < u64Count; n++) {
+            FaceResultHistoryEntry_t *pstEntry = &pstHistory->astEntry[n % FACE_RESULT_HISTORY];
+            uint32_t u32Lock = pstEntry->u32Lock.load(std::memory_order_acquire);
+            uint64_t u64EntryPTS = pstEntry->stSlot.u64FramePTS;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((u32Lock & 1) || pstEntry->u32Lock.load(std::memory_order_relaxed) != u32Lock) {
+                continue;
+            }
+            uint64_t u64Distance = FaceResult_PTSDistance(u64EntryPTS, u64PTS);
+            if (u64Distance < u64BestDistance) {
+                u64BestDistance = u64Distance;
+                best = (int)(n % FACE_RESULT_HISTORY);
+            }
+        }
+        if (best < 0) {
+            continue;
+        }
+
+        FaceResultHistoryEntry_t *pstEntry = &pstHistory->astEntry[best];
+        uint32_t u32Lock = pstEntry->u32Lock.load(std::memory_order_acquire);
+        if (u32Lock & 1) {
+            continue;
+        }
+        FaceResult_CopySlot(pstOut, &pstEntry->stSlot);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (pstEntry->u32Lock.load(std::memory_order_relaxed) == u32Lock) {
+            return true;
+        }
+    }
+    return false;
+}
 
 void SharedData_Init() {
     g_bExit = false;
-    std::memset(&g_stFaceMeta, 0, sizeof(cvtdl_face_t));
-    pthread_mutex_init(&g_ResultMutex, NULL);
-    pthread_mutex_init(&g_FPSMutex, NULL);
+    FaceResult_Init(&g_stFaceResults);
+    FaceResultHistory_Init(&g_stFaceHistory);
     g_fCurrentFPS = 0.0f;
 }
 
 void SharedData_Cleanup() {
-    CVI_TDL_Free(&g_stFaceMeta);
-    pthread_mutex_destroy(&g_ResultMutex);
-    pthread_mutex_destroy(&g_FPSMutex);
+    // Result slots are static storage, nothing to free
 }
@@ -0,0 +1,192 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include "startup.h"
+
+static uint64_t Startup_ClockUs(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static uint64_t Startup_NowUs(const Startup_t *pstStartup) {
+    return Startup_ClockUs(CLOCK_MONOTONIC) - pstStartup->u64OriginUs;
+}
+
+void Startup_Init(Startup_t *pstStartup) {
+    std::memset(pstStartup->astStep, 0, sizeof(pstStartup->astStep));
+    pstStartup->u32Count = 0;
+    pstStartup->u64OriginUs = Startup_ClockUs(CLOCK_MONOTONIC);
+    pstStartup->u64BootUs = Startup_ClockUs(CLOCK_BOOTTIME);
+    pstStartup->u64EndUs = 0;
+    pthread_mutex_init(&pstStartup->mutex, NULL);
+    pthread_cond_init(&pstStartup->cond, NULL);
+}
+
+uint32_t Startup_AddStep(Startup_t *pstStartup, const char *pszName, StartupStepFn_t pfnRun, void *pArgs,
+                         uint32_t u32After, bool bOptional) {
+    if (pstStartup->u32Count >= STARTUP_MAX_STEPS || !pfnRun) {
+        std::cerr << "Cannot add start-up step " << (pszName ? pszName : "") << std::endl;
+        return 0;
+    }
+    StartupStep_t *pstStep = &pstStartup->astStep[pstStartup->u32Count];
+    pstStep->pszName = pszName;
+    pstStep->pfnRun = pfnRun;
+    pstStep->pArgs = pArgs;
+    // only earlier steps, so the dependencies cannot form a cycle
+    pstStep->u32After = u32After & ((1u << pstStartup->u32Count) - 1);
+    pstStep->bOptional = bOptional;
+    pstStep->enState = STARTUP_STEP_PENDING;
+    return 1u << pstStartup->u32Count++;
+}
+
+typedef struct {
+    Startup_t *pstStartup;
+    uint32_t u32Index;
+} StartupWorker_t;
+
+// Called with the mutex held
+static bool Startup_Ready(const Startup_t *pstStartup, const StartupStep_t *pstStep, bool *pbBlocked) {
+    *pbBlocked = false;
+    for (uint32_t i = 0; i < pstStartup->u32Count; i++) {
+        if (!(pstStep->u32After & (1u << i))) {
+            continue;
+        }
+        StartupStepState_t enState = pstStartup->astStep[i].enState;
+        if (enState == STARTUP_STEP_FAILED || enState == STARTUP_STEP_SKIPPED) {
+            *pbBlocked = true;
+            return true;
+        }
+        if (enState != STARTUP_STEP_DONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void *Startup_WorkerRoutine(void *pArgs) {
+    StartupWorker_t *pstWorker = static_cast<StartupWorker_t *>(pArgs);
+    Startup_t *pstStartup = pstWorker->pstStartup;
+    StartupStep_t *pstStep = &pstStartup->astStep[pstWorker->u32Index];
+
+    bool bBlocked;
+    pthread_mutex_lock(&pstStartup->mutex);
+    while (!Startup_Ready(pstStartup, pstStep, &bBlocked)) {
+        pthread_cond_wait(&pstStartup->cond, &pstStartup->mutex);
+    }
+    pstStep->u64StartUs = Startup_NowUs(pstStartup);
+    pstStep->enState = bBlocked ? STARTUP_STEP_SKIPPED : STARTUP_STEP_RUNNING;
+    pthread_mutex_unlock(&pstStartup->mutex);
+
+    CVI_S32 s32Ret = bBlocked ? CVI_FAILURE : pstStep->pfnRun(pstStep->pArgs);
+
+    pthread_mutex_lock(&pstStartup->mutex);
+    pstStep->u64EndUs = Startup_NowUs(pstStartup);
+    pstStep->s32Result = s32Ret;
+    if (!bBlocked) {
+        pstStep->enState = s32Ret == CVI_SUCCESS ? STARTUP_STEP_DONE : STARTUP_STEP_FAILED;
+    }
+    pthread_cond_broadcast(&pstStartup->cond);
+    pthread_mutex_unlock(&pstStartup->mutex);
+    return nullptr;
+}
+
+CVI_S32 Startup_Run(Startup_t *pstStartup) {
+    StartupWorker_t astWorker[STARTUP_MAX_STEPS];
+    pthread_t aThread[STARTUP_MAX_STEPS];
+    bool abStarted[STARTUP_MAX_STEPS];
+    for (uint32_t i = 0; i < pstStartup->u32Count; i++) {
+        astWorker[i].pstStartup = pstStartup;
+        astWorker[i].u32Index = i;
+        abStarted[i] = pthread_create(&aThread[i], nullptr, Startup_WorkerRoutine, &astWorker[i]) == 0;
+        if (!abStarted[i]) {
+            // no thread to spare, run it here once its dependencies are done
+            std::cerr << "No thread for start-up step " << pstStartup->astStep[i].pszName
+                      << ", running it in order" << std::endl;
+            Startup_WorkerRoutine(&astWorker[i]);
+        }
+    }
+    for (uint32_t i = 0; i < pstStartup->u32Count; i++) {
+        if (abStarted[i]) {
+            pthread_join(aThread[i], nullptr);
+        }
+    }
+    pstStartup->u64EndUs = Startup_NowUs(pstStartup);
+
+    CVI_S32 s32Ret = CVI_SUCCESS;
+    for (uint32_t i = 0; i < pstStartup->u32Count; i++) {
+        const StartupStep_t *pstStep = &pstStartup->astStep[i];
+        if (pstStep->enState == STARTUP_STEP_DONE) {
+            continue;
+        }
+        std::cerr << "Start-up step " << pstStep->pszName
+                  << (pstStep->enState == STARTUP_STEP_SKIPPED ? " skipped" : " failed")
+                  << (pstStep->bOptional ? ", continuing without it" : "") << std::endl;
+        if (!pstStep->bOptional) {
+            s32Ret = CVI_FAILURE;
+        }
+    }
+    return s32Ret;
+}
+
+bool Startup_Done(const Startup_t *pstStartup, uint32_t u32Steps) {
+    for (uint32_t i = 0; i < pstStartup->u32Count; i++) {
+        if ((u32Steps & (1u << i)) && pstStartup->astStep[i].enState != STARTUP_STEP_DONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Startup_Report(const Startup_t *pstStartup) {
+    static const char *const kStates[] = {"pending", "running", "done", "failed", "skipped"};
+    uint64_t u64SumUs = 0;
+    std::cout << "=== Start-up timing (ms) ===" << std::endl;
+    std::cout << "  step              start      took" << std::endl;
+    for (uint32_t i = 0; i < pstStartup->u32Count; i++) {
+        const StartupStep_t *pstStep = &pstStartup->astStep[i];
+        uint64_t u64TookUs = pstStep->u64EndUs - pstStep->u64StartUs;
+        u64SumUs += u64TookUs;
+        char line[96];
+        snprintf(line, sizeof(line), "  %-14s %8.1f  %8.1f  %s", pstStep->pszName, pstStep->u64StartUs / 1000.0,
+                 u64TookUs / 1000.0, kStates[pstStep->enState]);
+        std::cout << line << std::endl;
+    }
+    char line[128];
+    snprintf(line, sizeof(line), "Start-up: %.1f ms (%.1f ms of steps in sequence), began %.1f ms after power-on",
+             pstStartup->u64EndUs / 1000.0, u64SumUs / 1000.0, pstStartup->u64BootUs / 1000.0);
+    std::cout << line << std::endl;
+}
+
+void Startup_Destroy(Startup_t *pstStartup) {
+    pthread_cond_destroy(&pstStartup->cond);
+    pthread_mutex_destroy(&pstStartup->mutex);
+}
+
+CVI_S32 Startup_PrefetchFiles(const char *const *ppszPaths) {
+    std::vector<char> buf(STARTUP_PREFETCH_CHUNK);
+    for (; *ppszPaths; ppszPaths++) {
+        if ((*ppszPaths)[0] == '\0') {
+            continue;
+        }
+        int fd = open(*ppszPaths, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        ssize_t len;
+        while ((len = read(fd, buf.data(), buf.size())) > 0 || (len < 0 && errno == EINTR)) {
+        }
+        close(fd);
+    }
+    return CVI_SUCCESS;
+}
+
+uint64_t Startup_SinceBootMs() {
+    return Startup_ClockUs(CLOCK_BOOTTIME) / 1000;
+}
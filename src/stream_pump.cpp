@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "stream_pump.h"
+#include "hal.h"
+#include "shared_data.h"
+
+// Fetch what the encoder holds into the pool, without waiting; the number of
+// frames fetched, or -1 when the pump must stop
+static int StreamPump_Drain(StreamPump_t *pstPump) {
+    int s32Count = 0;
+    while (s32Count < STREAM_PUMP_POOL_FRAMES) {
+        CVI_U32 u32PackCount = 0;
+        CVI_S32 s32Ret = HAL_Encoder_QueryPacks(pstPump->pstMWContext, &u32PackCount);
+        if (s32Ret != CVI_SUCCESS) {
+            std::cerr << "Encoder query status failed, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+            pstPump->s32Error = s32Ret;
+            return -1;
+        }
+        if (u32PackCount == 0) {
+            break;
+        }
+        if (u32PackCount > STREAM_PUMP_MAX_PACKS) {
+            std::cerr << "Encoded frame has " << u32PackCount << " packets, the pool holds "
+                      << STREAM_PUMP_MAX_PACKS << std::endl;
+            pstPump->s32Error = CVI_FAILURE;
+            return -1;
+        }
+        VENC_STREAM_S *pstStream = &pstPump->astStream[s32Count];
+        std::memset(pstStream, 0, sizeof(VENC_STREAM_S));
+        pstStream->pstPack = pstPump->aastPack[s32Count];
+        s32Ret = HAL_Encoder_GetStream(pstPump->pstMWContext, pstStream, 0);
+        if (s32Ret == CVI_ERR_VENC_BUF_EMPTY) {
+            break;
+        }
+        if (s32Ret != CVI_SUCCESS) {
+            std::cerr << "Encoder get stream failed, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+            pstPump->s32Error = s32Ret;
+            return -1;
+        }
+        s32Count++;
+    }
+    return s32Count;
+}
+
+static void StreamPump_FanOut(StreamPump_t *pstPump, VENC_STREAM_S *pstStream) {
+    for (uint32_t i = 0; i < pstPump->u32Sinks; i++) {
+        StreamPumpSink_t *pstSink = &pstPump->astSink[i];
+        if (pstSink->pfnWrite(pstSink->pCtx, pstStream) != CVI_SUCCESS && pstSink->u64Errors++ == 0) {
+            // one failing sink does not hold back the others
+            std::cerr << "Stream sink " << pstSink->pszName << " write failed" << std::endl;
+        }
+    }
+    for (CVI_U32 i = 0; i < pstStream->u32PackCount; i++) {
+        pstPump->u64Bytes += pstStream->pstPack[i].u32Len - pstStream->pstPack[i].u32Offset;
+    }
+    pstPump->u64Packets += pstStream->u32PackCount;
+    HAL_Encoder_ReleaseStream(pstPump->pstMWContext, pstStream);
+}
+
+static void *StreamPump_ThreadRoutine(void *pArgs) {
+    StreamPump_t *pstPump = static_cast<StreamPump_t *>(pArgs);
+    bool bStop = false;
+    while (!bStop) {
+        struct epoll_event astEvent[2];
+        int s32Events = epoll_wait(pstPump->s32EpollFd, astEvent, 2, -1);
+        if (s32Events < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Stream pump: epoll_wait failed: " << std::strerror(errno) << std::endl;
+            pstPump->s32Error = CVI_FAILURE;
+            // nobody else drains the encoder, the stream cannot go on
+            g_bExit = true;
+            break;
+        }
+        bool bReady = false;
+        for (int i = 0; i < s32Events; i++) {
+            if (astEvent[i].data.fd == pstPump->s32WakeFd) {
+                bStop = true;
+            } else {
+                bReady = true;
+            }
+        }
+        if (!bReady || bStop) {
+            continue;
+        }
+
+        int s32Count = StreamPump_Drain(pstPump);
+        if (s32Count < 0) {
+            g_bExit = true;
+            break;
+        }
+        if (s32Count == 0) {
+            // readable without a frame to fetch; the fd is level-triggered,
+            // so back off instead of spinning on it
+            if (pstPump->u64Spurious++ == 0) {
+                std::cerr << "Stream pump: encoder fd readable without a frame" << std::endl;
+            }
+            usleep(STREAM_PUMP_SPURIOUS_BACKOFF_US);
+            continue;
+        }
+        pstPump->u32MaxDrained = std::max(pstPump->u32MaxDrained, (uint32_t)s32Count);
+        for (int i = 0; i < s32Count; i++) {
+            StreamPump_FanOut(pstPump, &pstPump->astStream[i]);
+        }
+        pthread_mutex_lock(&pstPump->mutex);
+        pstPump->u64Frames += s32Count;
+        pthread_cond_broadcast(&pstPump->cond);
+        pthread_mutex_unlock(&pstPump->mutex);
+    }
+
+    pthread_mutex_lock(&pstPump->mutex);
+    pstPump->bStopped = true;
+    pthread_cond_broadcast(&pstPump->cond);
+    pthread_mutex_unlock(&pstPump->mutex);
+    return nullptr;
+}
+
+void StreamPump_Init(StreamPump_t *pstPump, SAMPLE_TDL_MW_CONTEXT *pstMWContext) {
+    std::memset(pstPump, 0, sizeof(StreamPump_t));
+    pstPump->pstMWContext = pstMWContext;
+    pstPump->s32EpollFd = -1;
+    pstPump->s32WakeFd = -1;
+}
+
+CVI_S32 StreamPump_AddSink(StreamPump_t *pstPump, const char *pszName, StreamPumpWrite_t pfnWrite, void *pCtx) {
+    if (pstPump->u32Sinks == STREAM_PUMP_MAX_SINKS || pstPump->bThreadStarted) {
+        return CVI_FAILURE;
+    }
+    StreamPumpSink_t *pstSink = &pstPump->astSink[pstPump->u32Sinks++];
+    pstSink->pszName = pszName;
+    pstSink->pfnWrite = pfnWrite;
+    pstSink->pCtx = pCtx;
+    pstSink->u64Errors = 0;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 StreamPump_Start(StreamPump_t *pstPump) {
+    CVI_S32 s32VencFd = HAL_Encoder_GetFd(pstPump->pstMWContext);
+    if (s32VencFd < 0) {
+        std::cerr << "Cannot get the encoder fd, ret=0x" << std::hex << s32VencFd << std::dec << std::endl;
+        return CVI_FAILURE;
+    }
+    pstPump->s32EpollFd = epoll_create1(EPOLL_CLOEXEC);
+    pstPump->s32WakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event stVenc, stWake;
+    std::memset(&stVenc, 0, sizeof(stVenc));
+    std::memset(&stWake, 0, sizeof(stWake));
+    stVenc.events = EPOLLIN;
+    stVenc.data.fd = s32VencFd;
+    stWake.events = EPOLLIN;
+    stWake.data.fd = pstPump->s32WakeFd;
+    if (pstPump->s32EpollFd < 0 || pstPump->s32WakeFd < 0 ||
+        epoll_ctl(pstPump->s32EpollFd, EPOLL_CTL_ADD, s32VencFd, &stVenc) != 0 ||
+        epoll_ctl(pstPump->s32EpollFd, EPOLL_CTL_ADD, pstPump->s32WakeFd, &stWake) != 0) {
+        std::cerr << "Cannot poll the encoder: " << std::strerror(errno) << std::endl;
+        StreamPump_Stop(pstPump);
+        return CVI_FAILURE;
+    }
+    pthread_mutex_init(&pstPump->mutex, NULL);
+    pthread_cond_init(&pstPump->cond, NULL);
+    pstPump->bStopped = false;
+
+    if (pthread_create(&pstPump->thread, nullptr, StreamPump_ThreadRoutine, pstPump) != 0) {
+        std::cerr << "Failed to create stream pump thread" << std::endl;
+        pthread_cond_destroy(&pstPump->cond);
+        pthread_mutex_destroy(&pstPump->mutex);
+        StreamPump_Stop(pstPump);
+        return CVI_FAILURE;
+    }
+    pstPump->bThreadStarted = true;
+    std::cout << "Stream pump started, " << pstPump->u32Sinks << " sink(s)" << std::endl;
+    return CVI_SUCCESS;
+}
+
+void StreamPump_Stop(StreamPump_t *pstPump) {
+    if (pstPump->bThreadStarted) {
+        uint64_t u64One = 1;
+        ssize_t s64Ret = write(pstPump->s32WakeFd, &u64One, sizeof(u64One));
+        (void)s64Ret;
+        pthread_join(pstPump->thread, nullptr);
+        pstPump->bThreadStarted = false;
+        std::cout << "Stream pump stopped: frames=" << pstPump->u64Frames << ", packets=" << pstPump->u64Packets
+                  << ", bytes=" << pstPump->u64Bytes << ", most frames per wake-up=" << pstPump->u32MaxDrained
+                  << ", empty wake-ups=" << pstPump->u64Spurious << std::endl;
+        for (uint32_t i = 0; i < pstPump->u32Sinks; i++) {
+            if (pstPump->astSink[i].u64Errors) {
+                std::cout << "Stream sink " << pstPump->astSink[i].pszName
+                          << ": write errors=" << pstPump->astSink[i].u64Errors << std::endl;
+            }
+        }
+        pthread_cond_destroy(&pstPump->cond);
+        pthread_mutex_destroy(&pstPump->mutex);
+    }
+    if (pstPump->s32WakeFd >= 0) {
+        close(pstPump->s32WakeFd);
+        pstPump->s32WakeFd = -1;
+    }
+    if (pstPump->s32EpollFd >= 0) {
+        close(pstPump->s32EpollFd);
+        pstPump->s32EpollFd = -1;
+    }
+}
+
+CVI_S32 StreamPump_WaitFrame(StreamPump_t *pstPump, uint64_t *pu64Seen, CVI_S32 s32MilliSec) {
+    struct timespec stDeadline;
+    clock_gettime(CLOCK_REALTIME, &stDeadline);
+    stDeadline.tv_sec += s32MilliSec / 1000;
+    stDeadline.tv_nsec += (long)(s32MilliSec % 1000) * 1000000L;
+    if (stDeadline.tv_nsec >= 1000000000L) {
+        stDeadline.tv_sec++;
+        stDeadline.tv_nsec -= 1000000000L;
+    }
+
+    CVI_S32 s32Ret = CVI_SUCCESS;
+    pthread_mutex_lock(&pstPump->mutex);
+    while (pstPump->u64Frames <= *pu64Seen) {
+        if (pstPump->bStopped) {
+            s32Ret = pstPump->s32Error != CVI_SUCCESS ? pstPump->s32Error : CVI_FAILURE;
+            break;
+        }
+        if (pthread_cond_timedwait(&pstPump->cond, &pstPump->mutex, &stDeadline) != 0) {
+            s32Ret = CVI_ERR_VENC_BUF_EMPTY;
+            break;
+        }
+    }
+    *pu64Seen = pstPump->u64Frames;
+    pthread_mutex_unlock(&pstPump->mutex);
+    return s32Ret;
+}
@@ -38,10 +38,6 @@ CVI_S32 SystemInit_GetSensorConfig(SystemConfig_t *pstConfig) {
         return CVI_FAILURE;
     }
     
-    // Setup frame size of video encoder to 1080p
-    pstConfig->stVencSize.u32Width = 1920;
-    pstConfig->stVencSize.u32Height = 1080;
-    
     std::cout << "Sensor size: " << pstConfig->stSensorSize.u32Width << "x" 
               << pstConfig->stSensorSize.u32Height << std::endl;
     std::cout << "VENC size: " << pstConfig->stVencSize.u32Width << "x" 
@@ -51,34 +47,73 @@ CVI_S32 SystemInit_GetSensorConfig(SystemConfig_t *pstConfig) {
 }
 
 CVI_S32 SystemInit_SetupVBPool(SystemConfig_t *pstConfig) {
-    pstConfig->stMWConfig.stVBPoolConfig.u32VBPoolCount = 3;
+    pstConfig->stMWConfig.stVBPoolConfig.u32VBPoolCount = 2;
+    if (pstConfig->bCenterRoi && pstConfig->enDetectInput != SYSTEM_DETECT_MODEL_CHN) {
+        std::cerr << "Center ROI needs the model-sized detect channel, disabled" << std::endl;
+        pstConfig->bCenterRoi = false;
+    }
     
-    // VBPool 0 for VPSS Grp0 Chn0
+    // VBPool 0 for VPSS Grp0 Chn0, shared by detection and encoding through the frame broker
     pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].enFormat = VI_PIXEL_FORMAT;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].u32BlkCount = 5;
+    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].u32BlkCount = pstConfig->u32SharedBlks;
     pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].u32Height = pstConfig->stSensorSize.u32Height;
     pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].u32Width = pstConfig->stSensorSize.u32Width;
     pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].bBind = true;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].u32VpssChnBinding = VPSS_CHN0;
+    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].u32VpssChnBinding = SYSTEM_VPSS_CHN;
     pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[0].u32VpssGrpBinding = (VPSS_GRP)0;
     
-    // VBPool 1 for VPSS Grp0 Chn1
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].enFormat = VI_PIXEL_FORMAT;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32BlkCount = 5;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32Height = pstConfig->stVencSize.u32Height;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32Width = pstConfig->stVencSize.u32Width;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].bBind = true;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32VpssChnBinding = VPSS_CHN1;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32VpssGrpBinding = (VPSS_GRP)0;
-    
-    // VBPool 2 for TDL preprocessing
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[2].enFormat = PIXEL_FORMAT_BGR_888_PLANAR;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[2].u32BlkCount = 3;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[2].u32Height = 1080;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[2].u32Width = 1920;
-    pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[2].bBind = false;
-    
-    std::cout << "VBPool configured: 3 pools" << std::endl;
+    if (pstConfig->enDetectInput == SYSTEM_DETECT_MODEL_CHN) {
+        // VBPool 1 for VPSS Grp0 Chn1, already at model size so the SDK skips its own resize
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].enFormat = PIXEL_FORMAT_BGR_888_PLANAR;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32BlkCount = pstConfig->u32DetectBlks;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32Height = pstConfig->stDetectSize.u32Height;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32Width = pstConfig->stDetectSize.u32Width;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].bBind = true;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32VpssChnBinding = SYSTEM_DETECT_VPSS_CHN;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[1].u32VpssGrpBinding = (VPSS_GRP)0;
+    } else {
+        // VBPool 1 for TDL preprocessing
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[SYSTEM_TDL_VBPOOL].enFormat = PIXEL_FORMAT_BGR_888_PLANAR;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[SYSTEM_TDL_VBPOOL].u32BlkCount = pstConfig->u32TdlBlks;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[SYSTEM_TDL_VBPOOL].u32Height = pstConfig->stVencSize.u32Height;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[SYSTEM_TDL_VBPOOL].u32Width = pstConfig->stVencSize.u32Width;
+        pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[SYSTEM_TDL_VBPOOL].bBind = false;
+    }
+    
+    if (pstConfig->bCenterRoi) {
+        // VBPool 2 for VPSS Grp0 Chn2, the crosshair window at the ROI model size
+        SAMPLE_TDL_VB_CONFIG_S *pstRoiPool = &pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[SYSTEM_ROI_VBPOOL];
+        pstRoiPool->enFormat = PIXEL_FORMAT_BGR_888_PLANAR;
+        pstRoiPool->u32BlkCount = pstConfig->u32RoiBlks;
+        pstRoiPool->u32Height = pstConfig->stRoiSize.u32Height;
+        pstRoiPool->u32Width = pstConfig->stRoiSize.u32Width;
+        pstRoiPool->bBind = true;
+        pstRoiPool->u32VpssChnBinding = SYSTEM_ROI_VPSS_CHN;
+        pstRoiPool->u32VpssGrpBinding = (VPSS_GRP)0;
+        pstConfig->stMWConfig.stVBPoolConfig.u32VBPoolCount = 3;
+    }
+    
+    if (pstConfig->bEncodeChn) {
+        pstConfig->encodeChn = SystemInit_EncodeChn(pstConfig);
+        if (pstConfig->encodeChn < 0) {
+            std::cerr << "No VPSS channel left for the encoder, region overlays disabled" << std::endl;
+            pstConfig->bEncodeChn = false;
+        }
+    }
+    if (pstConfig->bEncodeChn) {
+        // next VBPool for the encoder-only channel, at the shared frame size
+        CVI_U32 u32Pool = pstConfig->stMWConfig.stVBPoolConfig.u32VBPoolCount++;
+        SAMPLE_TDL_VB_CONFIG_S *pstEncodePool = &pstConfig->stMWConfig.stVBPoolConfig.astVBPoolSetup[u32Pool];
+        pstEncodePool->enFormat = VI_PIXEL_FORMAT;
+        pstEncodePool->u32BlkCount = pstConfig->u32EncodeBlks;
+        pstEncodePool->u32Height = pstConfig->stVencSize.u32Height;
+        pstEncodePool->u32Width = pstConfig->stVencSize.u32Width;
+        pstEncodePool->bBind = true;
+        pstEncodePool->u32VpssChnBinding = pstConfig->encodeChn;
+        pstEncodePool->u32VpssGrpBinding = (VPSS_GRP)0;
+    }
+    
+    std::cout << "VBPool configured: " << pstConfig->stMWConfig.stVBPoolConfig.u32VBPoolCount << " pools" << std::endl;
     return CVI_SUCCESS;
 }
 
@@ -102,20 +137,45 @@ CVI_S32 SystemInit_SetupVPSS(SystemConfig_t *pstConfig) {
                              pstConfig->stSensorSize.u32Height, 
                              VI_PIXEL_FORMAT, 1);
     
-    pstVpssConfig->u32ChnCount = 2;
+    // One output channel, the frame broker fans it out to detection and encoding
+    pstVpssConfig->u32ChnCount = 1;
     pstVpssConfig->u32ChnBindVI = 0;
     
-    VPSS_CHN_DEFAULT_HELPER(&pstVpssConfig->astVpssChnAttr[0], 
+    VPSS_CHN_DEFAULT_HELPER(&pstVpssConfig->astVpssChnAttr[SYSTEM_VPSS_CHN], 
                             pstConfig->stVencSize.u32Width,
                             pstConfig->stVencSize.u32Height, 
                             VI_PIXEL_FORMAT, true);
     
-    VPSS_CHN_DEFAULT_HELPER(&pstVpssConfig->astVpssChnAttr[1], 
-                            pstConfig->stVencSize.u32Width,
-                            pstConfig->stVencSize.u32Height, 
-                            VI_PIXEL_FORMAT, true);
+    if (pstConfig->enDetectInput == SYSTEM_DETECT_MODEL_CHN) {
+        // Placeholder attributes, the model's scaling and normalization are applied
+        // once it is loaded (HAL_Detector_BindInputChannel)
+        pstVpssConfig->u32ChnCount = 2;
+        VPSS_CHN_DEFAULT_HELPER(&pstVpssConfig->astVpssChnAttr[SYSTEM_DETECT_VPSS_CHN], 
+                                pstConfig->stDetectSize.u32Width,
+                                pstConfig->stDetectSize.u32Height, 
+                                PIXEL_FORMAT_BGR_888_PLANAR, true);
+    }
+    
+    if (pstConfig->bCenterRoi) {
+        // Placeholder as well; the crop window is set with the ROI model
+        // (HAL_FrameSource_SetCrop, HAL_Detector_BindInputChannel)
+        pstVpssConfig->u32ChnCount = 3;
+        VPSS_CHN_DEFAULT_HELPER(&pstVpssConfig->astVpssChnAttr[SYSTEM_ROI_VPSS_CHN], 
+                                pstConfig->stRoiSize.u32Width,
+                                pstConfig->stRoiSize.u32Height, 
+                                PIXEL_FORMAT_BGR_888_PLANAR, true);
+    }
     
-    std::cout << "VPSS configured: 1 group, 2 channels" << std::endl;
+    if (pstConfig->bEncodeChn) {
+        // same picture as the shared channel; the OSD regions are attached to it
+        pstVpssConfig->u32ChnCount = pstConfig->encodeChn + 1;
+        VPSS_CHN_DEFAULT_HELPER(&pstVpssConfig->astVpssChnAttr[pstConfig->encodeChn],
+                                pstConfig->stVencSize.u32Width,
+                                pstConfig->stVencSize.u32Height,
+                                VI_PIXEL_FORMAT, true);
+    }
+    
+    std::cout << "VPSS configured: 1 group, " << pstVpssConfig->u32ChnCount << " channel(s)" << std::endl;
     return CVI_SUCCESS;
 }
 
@@ -123,15 +183,25 @@ CVI_S32 SystemInit_SetupVENC(SystemConfig_t *pstConfig) {
     SAMPLE_TDL_Get_Input_Config(&pstConfig->stMWConfig.stVencConfig.stChnInputCfg);
     pstConfig->stMWConfig.stVencConfig.u32FrameWidth = pstConfig->stVencSize.u32Width;
     pstConfig->stMWConfig.stVencConfig.u32FrameHeight = pstConfig->stVencSize.u32Height;
+    SAMPLE_COMM_CHN_INPUT_CONFIG_S *pstInCfg = &pstConfig->stMWConfig.stVencConfig.stChnInputCfg;
+    pstInCfg->bitrate = (CVI_S32)pstConfig->u32VencBitrateKbps;
+    pstInCfg->srcFramerate = SYSTEM_VENC_FPS;
+    pstInCfg->framerate = SYSTEM_VENC_FPS;
+    if (pstConfig->enVencRc == SYSTEM_RC_VBR) {
+        pstInCfg->rcMode = SAMPLE_RC_VBR;
+        pstInCfg->maxbitrate = (CVI_S32)pstConfig->u32VencBitrateKbps;
+    }
     
     std::cout << "VENC configured: " << pstConfig->stVencSize.u32Width << "x" 
-              << pstConfig->stVencSize.u32Height << std::endl;
+              << pstConfig->stVencSize.u32Height << ", " << pstConfig->u32VencBitrateKbps << " kbps "
+              << (pstConfig->enVencRc == SYSTEM_RC_VBR ? "VBR" : "CBR") << std::endl;
     return CVI_SUCCESS;
 }
 
 CVI_S32 SystemInit_SetupRTSP(SystemConfig_t *pstConfig) {
     SAMPLE_TDL_Get_RTSP_Config(&pstConfig->stMWConfig.stRTSPConfig.stRTSPConfig);
-    std::cout << "RTSP configured" << std::endl;
+    pstConfig->stMWConfig.stRTSPConfig.stRTSPConfig.port = (int)pstConfig->u32RtspPort;
+    std::cout << "RTSP configured on port " << pstConfig->u32RtspPort << std::endl;
     return CVI_SUCCESS;
 }
 
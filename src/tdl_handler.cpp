@@ -1,13 +1,22 @@
+#include <algorithm>
 #include <iostream>
 #include <cstring>
 #include <sys/time.h>
 #include <time.h>
 #include <cmath>
 #include <cfloat>
+#include <vector>
 #include "tdl_handler.h"
+#include "face_tracker.h"
+#include "track_store.h"
+#include "face_matcher.h"
 #include "shared_data.h"
 #include "draw_utils.h"
 #include "button_handler.h"
+#include "tdl_pipeline.h"
+#include "app_config.h"
+#include "live_config.h"
+#include "startup.h"
 
 extern "C" {
 #include <cvi_sys.h>
@@ -23,40 +32,27 @@ CVI_S32 TDLHandler_Init(TDLHandler_t *pstHandler, const char *modelPath) {
     std::memset(pstHandler, 0, sizeof(TDLHandler_t));
     pstHandler->modelPath = modelPath;
     pstHandler->buttonHandler = nullptr;
+    pstHandler->pstFrameBroker = nullptr;
+    pstHandler->pstRecognizer = nullptr;
+    pstHandler->pstGallery = nullptr;
+    pstHandler->pstIndex = nullptr;
+    FaceQuality_Init(&pstHandler->stQuality, NULL);
+    TDLHandler_DefaultDetectConfig(&pstHandler->stDetect);
+    MotionGate_Init(&pstHandler->stMotion, &pstHandler->stDetect.stMotion);
     
-    // Create TDL handle and assign VPSS Grp1 Device 0 to TDL SDK
-    CVI_S32 s32Ret = CVI_TDL_CreateHandle2(&pstHandler->tdlHandle, 1, 0);
+    CVI_S32 s32Ret = HAL_Detector_Open(&pstHandler->tdlHandle, &pstHandler->serviceHandle, modelPath);
     if (s32Ret != CVI_SUCCESS) {
-        std::cerr << "Failed to create TDL handle, ret=0x" << std::hex << s32Ret << std::endl;
         return s32Ret;
     }
     
-    // Set VBPool for TDL
-    s32Ret = CVI_TDL_SetVBPool(pstHandler->tdlHandle, 0, 2);
+    s32Ret = HAL_Tracker_Open(pstHandler->tdlHandle);
     if (s32Ret != CVI_SUCCESS) {
-        std::cerr << "Failed to set VBPool, ret=0x" << std::hex << s32Ret << std::endl;
-        CVI_TDL_DestroyHandle(pstHandler->tdlHandle);
+        HAL_Detector_Close(pstHandler->tdlHandle, pstHandler->serviceHandle);
         return s32Ret;
     }
-    
-    // Set VPSS timeout
-    CVI_TDL_SetVpssTimeout(pstHandler->tdlHandle, 1000);
-    
-    // Create service handle
-    s32Ret = CVI_TDL_Service_CreateHandle(&pstHandler->serviceHandle, pstHandler->tdlHandle);
-    if (s32Ret != CVI_SUCCESS) {
-        std::cerr << "Failed to create service handle, ret=0x" << std::hex << s32Ret << std::endl;
-        CVI_TDL_DestroyHandle(pstHandler->tdlHandle);
-        return s32Ret;
-    }
-    
-    // Open face detection model
-    s32Ret = CVI_TDL_OpenModel(pstHandler->tdlHandle, CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, modelPath);
-    if (s32Ret != CVI_SUCCESS) {
-        std::cerr << "Failed to open model, ret=0x" << std::hex << s32Ret << std::endl;
-        CVI_TDL_Service_DestroyHandle(pstHandler->serviceHandle);
-        CVI_TDL_DestroyHandle(pstHandler->tdlHandle);
-        return s32Ret;
+    if (HAL_Detector_GetThresholds(pstHandler->tdlHandle, &pstHandler->fModelScore,
+                                   &pstHandler->fModelNms) != CVI_SUCCESS) {
+        std::cerr << "Cannot read the detector thresholds, they stay as loaded" << std::endl;
     }
     
     std::cout << "TDL Handler initialized successfully" << std::endl;
@@ -67,12 +63,10 @@ CVI_S32 TDLHandler_Init(TDLHandler_t *pstHandler, const char *modelPath) {
 
 void TDLHandler_Cleanup(TDLHandler_t *pstHandler) {
     if (pstHandler) {
-        if (pstHandler->serviceHandle) {
-            CVI_TDL_Service_DestroyHandle(pstHandler->serviceHandle);
-        }
-        if (pstHandler->tdlHandle) {
-            CVI_TDL_DestroyHandle(pstHandler->tdlHandle);
+        if (pstHandler->roiHandle) {
+            HAL_Detector_Close(pstHandler->roiHandle, NULL);
         }
+        HAL_Detector_Close(pstHandler->tdlHandle, pstHandler->serviceHandle);
         std::memset(pstHandler, 0, sizeof(TDLHandler_t));
     }
     std::cout << "TDL Handler cleaned up" << std::endl;
@@ -85,14 +79,14 @@ CVI_S32 TDLHandler_DetectFace(TDLHandler_t *pstHandler,
         return CVI_FAILURE;
     }
     
-    return CVI_TDL_FaceDetection(pstHandler->tdlHandle, pstFrame, 
-                                 CVI_TDL_SUPPORTED_MODEL_SCRFDFACE, pstFaceMeta);
+    return HAL_Detector_DetectFace(pstHandler->tdlHandle, pstFrame, pstFaceMeta);
 }
 
-CVI_S32 TDLHandler_DrawFaceRect(TDLHandler_t *pstHandler,
-                                cvtdl_face_t *pstFaceMeta,
-                                VIDEO_FRAME_INFO_S *pstFrame) {
-    if (!pstHandler || !pstFaceMeta || !pstFrame) {
+CVI_S32 TDLHandler_AddFaceRects(TDLHandler_t *pstHandler,
+                                const cvtdl_face_t *pstFaceMeta,
+                                const VIDEO_FRAME_INFO_S *pstFrame,
+                                OverlayBatch_t *pstBatch) {
+    if (!pstHandler || !pstFaceMeta || !pstFrame || !pstBatch) {
         return CVI_FAILURE;
     }
 
@@ -105,9 +99,13 @@ CVI_S32 TDLHandler_DrawFaceRect(TDLHandler_t *pstHandler,
     float frame_center_y = pstFrame->stVFrame.u32Height / 2.0f;
     
     float center_threshold = 80.0f; 
+    // a locked face keeps the highlight until it moves this far away
+    float release_threshold = 1.5f * center_threshold;
     
-    // find the face closest to the center crosshair (within threshold)
+    // find the face closest to the center crosshair (within threshold),
+    // unless the face locked before is still close enough
     int center_face_idx = -1;
+    int locked_face_idx = -1;
     float min_distance = FLT_MAX;
     
     for (uint32_t i = 0; i < pstFaceMeta->size; i++) {
@@ -123,6 +121,11 @@ CVI_S32 TDLHandler_DrawFaceRect(TDLHandler_t *pstHandler,
         float dy = face_center_y - frame_center_y;
         float distance = sqrt(dx * dx + dy * dy);
         
+        uint64_t unique_id = pstFaceMeta->info[i].unique_id;
+        if (unique_id != 0 && unique_id == pstHandler->u64CenterTrackId && distance < release_threshold) {
+            locked_face_idx = i;
+        }
+        
         // if in the threshold 
         if (distance < center_threshold && distance < min_distance) {
             min_distance = distance;
@@ -130,37 +133,22 @@ CVI_S32 TDLHandler_DrawFaceRect(TDLHandler_t *pstHandler,
         }
     }
     
+    if (locked_face_idx >= 0) {
+        center_face_idx = locked_face_idx;
+    }
+    pstHandler->u64CenterTrackId = center_face_idx >= 0 ? pstFaceMeta->info[center_face_idx].unique_id : 0;
+    
     
-    CVI_S32 s32Ret = CVI_SUCCESS;
+    // all faces go into the batch; the colors are converted once per frame
+    OverlayColor_t stCenter = Overlay_Color(BRUSH_RED);
+    OverlayColor_t stOther = Overlay_Color(BRUSH_BLUE);
     for (uint32_t i = 0; i < pstFaceMeta->size; i++) {
-        cvtdl_service_brush_t brush;
-        brush.size = 4;
-        if ((int)i == center_face_idx) 
-            brush = BRUSH_RED;
-        else 
-            brush = BRUSH_BLUE;
-  
-        cvtdl_face_t single_face = {0};
-        single_face.size = 1;
-        single_face.width = pstFaceMeta->width;
-        single_face.height = pstFaceMeta->height;
-        single_face.info = (cvtdl_face_info_t *)malloc(sizeof(cvtdl_face_info_t));
-        if (single_face.info) {
-            memcpy(single_face.info, &pstFaceMeta->info[i], sizeof(cvtdl_face_info_t));
-            
-            s32Ret = CVI_TDL_Service_FaceDrawRect(pstHandler->serviceHandle, &single_face, 
-                                                  pstFrame, false, brush);
-            
-            free(single_face.info);
-            if (s32Ret != CVI_SUCCESS) {
-                return s32Ret;
-            }
-        }
+        Overlay_AddBox(pstBatch, &pstFaceMeta->info[i].bbox,
+                       (int)i == center_face_idx ? stCenter : stOther, BRUSH_RED.size);
     }
-    
-    return s32Ret;
-}
 
+    return CVI_SUCCESS;
+}
 
 void TDLHandler_SetButtonHandler(TDLHandler_t *pstHandler, ButtonHandler_t *buttonHandler) {
     if (pstHandler) {
@@ -168,6 +156,129 @@ void TDLHandler_SetButtonHandler(TDLHandler_t *pstHandler, ButtonHandler_t *butt
     }
 }
 
+void TDLHandler_SetFrameBroker(TDLHandler_t *pstHandler, FrameBroker_t *pstFrameBroker) {
+    if (pstHandler) {
+        pstHandler->pstFrameBroker = pstFrameBroker;
+    }
+}
+
+void TDLHandler_SetRecognizer(TDLHandler_t *pstHandler, FaceRecognizer_t *pstRecognizer) {
+    if (pstHandler) {
+        pstHandler->pstRecognizer = pstRecognizer;
+    }
+}
+
+void TDLHandler_SetGallery(TDLHandler_t *pstHandler, const FaceGallery_t *pstGallery) {
+    if (pstHandler) {
+        pstHandler->pstGallery = pstGallery;
+    }
+}
+
+void TDLHandler_SetIndex(TDLHandler_t *pstHandler, const FaceIndex_t *pstIndex) {
+    if (pstHandler) {
+        pstHandler->pstIndex = pstIndex;
+    }
+}
+
+void TDLHandler_SetQualityConfig(TDLHandler_t *pstHandler, const FaceQualityConfig_t *pstConfig) {
+    if (pstHandler && pstConfig) {
+        FaceQuality_Init(&pstHandler->stQuality, pstConfig);
+    }
+}
+
+void TDLHandler_DefaultDetectConfig(TDLDetectConfig_t *pstConfig) {
+    pstConfig->u32IntervalMax = TDL_DETECT_INTERVAL_MAX;
+    pstConfig->fTrackMaxDrift = TDL_TRACK_MAX_DRIFT;
+    pstConfig->u32RoiFullInterval = TDL_ROI_FULL_INTERVAL;
+    MotionGate_DefaultConfig(&pstConfig->stMotion);
+}
+
+void TDLHandler_SetDetectConfig(TDLHandler_t *pstHandler, const TDLDetectConfig_t *pstConfig) {
+    if (pstHandler && pstConfig) {
+        pstHandler->stDetect = *pstConfig;
+        MotionGate_Init(&pstHandler->stMotion, &pstConfig->stMotion);
+    }
+}
+
+void TDLHandler_SetThreadCpus(TDLHandler_t *pstHandler, uint32_t u32AcquireCpus, uint32_t u32InferCpus,
+                              uint32_t u32PostCpus) {
+    if (pstHandler) {
+        pstHandler->au32Cpus[0] = u32AcquireCpus;
+        pstHandler->au32Cpus[1] = u32InferCpus;
+        pstHandler->au32Cpus[2] = u32PostCpus;
+    }
+}
+
+void TDLHandler_SetLiveConfig(TDLHandler_t *pstHandler, struct LiveConfigStore *pstLive) {
+    if (pstHandler) {
+        pstHandler->pstLive = pstLive;
+    }
+}
+
+CVI_S32 TDLHandler_ConfigureInput(TDLHandler_t *pstHandler, const SystemConfig_t *pstConfig) {
+    if (!pstHandler || !pstConfig) {
+        return CVI_FAILURE;
+    }
+    
+    pstHandler->stFrameSize = pstConfig->stVencSize;
+    if (pstConfig->enDetectInput != SYSTEM_DETECT_MODEL_CHN) {
+        pstHandler->bDetectChn = false;
+        return HAL_Detector_SetPreprocessPool(pstHandler->tdlHandle, SYSTEM_TDL_VBPOOL);
+    }
+    
+    CVI_S32 s32Ret = HAL_Detector_BindInputChannel(pstHandler->tdlHandle, 0, SYSTEM_DETECT_VPSS_CHN,
+                                                   &pstConfig->stVencSize, &pstConfig->stDetectSize);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    pstHandler->bDetectChn = true;
+    pstHandler->detectChn = SYSTEM_DETECT_VPSS_CHN;
+    std::cout << "Detector input: VPSS Chn" << SYSTEM_DETECT_VPSS_CHN << " "
+              << pstConfig->stDetectSize.u32Width << "x" << pstConfig->stDetectSize.u32Height
+              << ", SDK preprocessing skipped" << std::endl;
+    return CVI_SUCCESS;
+}
+
+CVI_S32 TDLHandler_ConfigureRoi(TDLHandler_t *pstHandler, const SystemConfig_t *pstConfig, const char *modelPath) {
+    if (!pstHandler || !pstConfig || !modelPath) {
+        return CVI_FAILURE;
+    }
+    if (!pstConfig->bCenterRoi) {
+        std::cerr << "Center ROI channel not configured" << std::endl;
+        return CVI_FAILURE;
+    }
+    
+    RECT_S stRect = SystemInit_CenterWindow(&pstConfig->stVencSize, &pstConfig->stRoiWindow);
+    // the crop applies to the VPSS group input, the sensor frame
+    RECT_S stCrop;
+    stCrop.s32X = (CVI_S32)((uint64_t)stRect.s32X * pstConfig->stSensorSize.u32Width / pstConfig->stVencSize.u32Width) & ~1;
+    stCrop.s32Y = (CVI_S32)((uint64_t)stRect.s32Y * pstConfig->stSensorSize.u32Height / pstConfig->stVencSize.u32Height) & ~1;
+    stCrop.u32Width = (CVI_U32)((uint64_t)stRect.u32Width * pstConfig->stSensorSize.u32Width / pstConfig->stVencSize.u32Width) & ~1u;
+    stCrop.u32Height = (CVI_U32)((uint64_t)stRect.u32Height * pstConfig->stSensorSize.u32Height / pstConfig->stVencSize.u32Height) & ~1u;
+    SIZE_S stCropSize = {stCrop.u32Width, stCrop.u32Height};
+    
+    cvitdl_handle_t roiHandle = NULL;
+    CVI_S32 s32Ret = HAL_Detector_OpenRoi(&roiHandle, modelPath);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    s32Ret = HAL_FrameSource_SetCrop(0, SYSTEM_ROI_VPSS_CHN, &stCrop);
+    if (s32Ret == CVI_SUCCESS) {
+        s32Ret = HAL_Detector_BindInputChannel(roiHandle, 0, SYSTEM_ROI_VPSS_CHN, &stCropSize, &pstConfig->stRoiSize);
+    }
+    if (s32Ret != CVI_SUCCESS) {
+        HAL_Detector_Close(roiHandle, NULL);
+        return s32Ret;
+    }
+    pstHandler->roiHandle = roiHandle;
+    pstHandler->stRoiRect = stRect;
+    std::cout << "Center ROI: " << stRect.u32Width << "x" << stRect.u32Height << " at (" << stRect.s32X << ", "
+              << stRect.s32Y << ") on VPSS Chn" << SYSTEM_ROI_VPSS_CHN << " " << pstConfig->stRoiSize.u32Width << "x"
+              << pstConfig->stRoiSize.u32Height << ", full frame every " << pstHandler->stDetect.u32RoiFullInterval
+              << "+ frames, model " << modelPath << std::endl;
+    return CVI_SUCCESS;
+}
+
 CVI_S32 TDLHandler_CapturePhoto(VIDEO_FRAME_INFO_S *pstFrame, const char *filepath) {
     if (!pstFrame || !filepath) {
         std::cerr << "Invalid parameters for capture" << std::endl;
@@ -176,155 +287,822 @@ CVI_S32 TDLHandler_CapturePhoto(VIDEO_FRAME_INFO_S *pstFrame, const char *filepa
 
     CVI_Mmap(pstFrame);
         
-    CVI_S32 ret = CVI_TDL_DumpVpssFrame(filepath, pstFrame);
+    CVI_S32 ret = HAL_FrameSource_DumpFrame(filepath, pstFrame);
     
     CVI_Mmap(pstFrame, true);
     return ret;
 }
 
-void *TDLHandler_ThreadRoutine(void *pHandle) {
-    std::cout << "Enter TDL thread" << std::endl;
-    
-    TDLHandler_t *pstHandler = static_cast<TDLHandler_t *>(pHandle);
+// Next detector input: the newest shared frame, or the newest frame of the model-sized channel
+static CVI_S32 TDLHandler_GetInputFrame(TDLHandler_t *pstHandler, uint64_t *pu64Cursor,
+                                        FrameBrokerSlot_t **ppstSlot, VIDEO_FRAME_INFO_S *pstFrame) {
+    if (pstHandler->bDetectChn) {
+        *ppstSlot = NULL;
+        return HAL_FrameSource_GetFrame(0, pstHandler->detectChn, pstFrame, 2000);
+    }
+    CVI_S32 s32Ret = FrameBroker_Acquire(pstHandler->pstFrameBroker, pu64Cursor, true, ppstSlot, 2000);
+    if (s32Ret == CVI_SUCCESS) {
+        *pstFrame = (*ppstSlot)->stFrame;
+    }
+    return s32Ret;
+}
+
+static void TDLHandler_ReleaseInputFrame(TDLHandler_t *pstHandler, FrameBrokerSlot_t *pstSlot,
+                                         VIDEO_FRAME_INFO_S *pstFrame) {
+    if (pstSlot) {
+        FrameBroker_Release(pstHandler->pstFrameBroker, pstSlot);
+    } else {
+        HAL_FrameSource_ReleaseFrame(0, pstHandler->detectChn, pstFrame);
+    }
+}
+
+// Photos are always taken from the full-size shared frame
+static CVI_S32 TDLHandler_CaptureShared(TDLHandler_t *pstHandler, VIDEO_FRAME_INFO_S *pstInput,
+                                        const char *filepath) {
+    if (!pstHandler->bDetectChn) {
+        return TDLHandler_CapturePhoto(pstInput, filepath);
+    }
+    uint64_t u64Cursor = 0;
+    FrameBrokerSlot_t *pstSlot = NULL;
+    CVI_S32 s32Ret = FrameBroker_Acquire(pstHandler->pstFrameBroker, &u64Cursor, true, &pstSlot, 2000);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    VIDEO_FRAME_INFO_S stFrame = pstSlot->stFrame;
+    s32Ret = TDLHandler_CapturePhoto(&stFrame, filepath);
+    FrameBroker_Release(pstHandler->pstFrameBroker, pstSlot);
+    return s32Ret;
+}
+
+// Detect on the newest frame of the crosshair window and bring the boxes to
+// the shared frame; pu64PTS receives the PTS of that frame
+static CVI_S32 TDLHandler_DetectRoi(TDLHandler_t *pstHandler, cvtdl_face_t *pstFaceMeta, uint64_t *pu64PTS) {
     VIDEO_FRAME_INFO_S stFrame;
-    cvtdl_face_t stFaceMeta = {0};
-    CVI_S32 s32Ret;
-    static uint32_t s_u32LastFaceSize = 0;
+    CVI_S32 s32Ret = HAL_FrameSource_GetFrame(0, SYSTEM_ROI_VPSS_CHN, &stFrame, 100);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    struct timeval t0, t1;
+    gettimeofday(&t0, NULL);
+    s32Ret = HAL_Detector_DetectFace(pstHandler->roiHandle, &stFrame, pstFaceMeta);
+    gettimeofday(&t1, NULL);
+    *pu64PTS = stFrame.stVFrame.u64PTS;
+    HAL_FrameSource_ReleaseFrame(0, SYSTEM_ROI_VPSS_CHN, &stFrame);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
     
-    struct timeval t0, t1 ,fps_t0, fps_t1;;
-    unsigned long execution_time;
-    gettimeofday(&fps_t0, NULL);
-    int frame_count = 0;
-    float current_fps = 0.0f;
+    float fInferMs = ((t1.tv_sec - t0.tv_sec) * 1000000 + t1.tv_usec - t0.tv_usec) / 1000.0f;
+    pstHandler->fRoiInferMs = pstHandler->u64RoiDetects ? 0.8f * pstHandler->fRoiInferMs + 0.2f * fInferMs : fInferMs;
+    pstHandler->u64RoiDetects++;
     
-    while (!g_bExit) {
-        s32Ret = CVI_VPSS_GetChnFrame(0, VPSS_CHN1, &stFrame, 2000);
-        
-        if (s32Ret == CVI_SUCCESS) {
-            if (pstHandler->buttonHandler) {
-                ButtonPressType_t pressType = ButtonHandler_GetPressType(pstHandler->buttonHandler);
-                
-                if (pressType == BUTTON_PRESS_SHORT) {
-                    time_t now = time(NULL);
-                    struct tm *t = localtime(&now);
-                    char filename[256];
-                    snprintf(filename, sizeof(filename), 
-                            "capture_%04d%02d%02d_%02d%02d%02d.bin",
-                            t->tm_year + 1900, t->tm_mon + 1, t->tm_mday,
-                            t->tm_hour, t->tm_min, t->tm_sec);
-                    
-                    std::cout << "=== Short Press: Capturing Photo ===" << std::endl;
-                    std::cout << "Filename: " << filename << std::endl;
-                    
-                    s32Ret = TDLHandler_CapturePhoto(&stFrame, filename);
-                    if (s32Ret == CVI_SUCCESS) {
-                        std::cout << "Photo captured successfully!" << std::endl;
-                        std::cout << "Size: " << stFrame.stVFrame.u32Width << "x" 
-                                  << stFrame.stVFrame.u32Height << std::endl;
-                    } else {
-                        std::cerr << "Failed to capture photo" << std::endl;
-                    }
-                    std::cout << "=====================================" << std::endl;
-                    
-                    ButtonHandler_ClearPressType(pstHandler->buttonHandler);
-                } 
-                else if (pressType == BUTTON_PRESS_LONG) {
-                    std::cout << "=== Long Press: Special Function ===" << std::endl;
-                    std::cout << "Long press detected - executing special function" << std::endl;
-                    std::cout << "====================================" << std::endl;
-                    
-                    ButtonHandler_ClearPressType(pstHandler->buttonHandler);
-                }
+    // model input -> window -> shared frame
+    const RECT_S *pstRect = &pstHandler->stRoiRect;
+    SIZE_S stWindow = {pstRect->u32Width, pstRect->u32Height};
+    s32Ret = HAL_Detector_RescaleFaceMeta(&stWindow, pstFaceMeta);
+    if (s32Ret != CVI_SUCCESS) {
+        return s32Ret;
+    }
+    for (uint32_t i = 0; pstFaceMeta->info && i < pstFaceMeta->size; i++) {
+        cvtdl_face_info_t *pstInfo = &pstFaceMeta->info[i];
+        pstInfo->bbox.x1 += pstRect->s32X;
+        pstInfo->bbox.x2 += pstRect->s32X;
+        pstInfo->bbox.y1 += pstRect->s32Y;
+        pstInfo->bbox.y2 += pstRect->s32Y;
+        for (uint32_t j = 0; j < pstInfo->pts.size; j++) {
+            pstInfo->pts.x[j] += pstRect->s32X;
+            pstInfo->pts.y[j] += pstRect->s32Y;
+        }
+    }
+    pstFaceMeta->width = pstHandler->stFrameSize.u32Width;
+    pstFaceMeta->height = pstHandler->stFrameSize.u32Height;
+    return CVI_SUCCESS;
+}
+
+// Crops are cut from the shared frame the faces were detected on; with a
+// model-sized input that is the broker frame of the same PTS, held since
+// acquisition or looked up now. False when it is gone.
+static bool TDLHandler_TakeCrops(TDLHandler_t *pstHandler, TrackStore_t *pstStore,
+                                 const cvtdl_face_t *pstFaceMeta, TDLJob_t *pstJob) {
+    if (!pstHandler->bDetectChn) {
+        TrackStore_TakeCrops(pstStore, pstFaceMeta, &pstJob->stFrame, &pstHandler->stQuality);
+        return true;
+    }
+    if (!pstJob->pstCropSlot &&
+        FrameBroker_AcquirePTS(pstHandler->pstFrameBroker, pstJob->stFrame.stVFrame.u64PTS, &pstJob->pstCropSlot,
+                               TDL_CROP_WAIT_MS) != CVI_SUCCESS) {
+        // retried on the next detection
+        pstJob->pstCropSlot = NULL;
+        return false;
+    }
+    VIDEO_FRAME_INFO_S stFrame = pstJob->pstCropSlot->stFrame;
+    TrackStore_TakeCrops(pstStore, pstFaceMeta, &stFrame, &pstHandler->stQuality);
+    return true;
+}
+
+static void TDLHandler_ReleaseCropFrame(TDLHandler_t *pstHandler, TDLJob_t *pstJob) {
+    if (pstJob->pstCropSlot) {
+        FrameBroker_Release(pstHandler->pstFrameBroker, pstJob->pstCropSlot);
+        pstJob->pstCropSlot = NULL;
+    }
+}
+
+// Name the tracks whose embeddings just arrived, all in one pass over the
+// gallery, or through the index of a large one
+static void TDLHandler_MatchEmbeddings(const FaceGallery_t *pstGallery, const FaceIndex_t *pstIndex,
+                                       TrackState_t *const *ppstEntries, uint32_t u32Count) {
+    const int8_t *aps8Queries[FACE_MATCHER_MAX_QUERIES];
+    FaceMatch_t astMatch[FACE_MATCHER_MAX_QUERIES];
+    uint32_t au32Size[FACE_MATCHER_MAX_QUERIES];
+    for (uint32_t i = 0; i < u32Count; i++) {
+        aps8Queries[i] = ppstEntries[i]->as8Fused;
+    }
+    CVI_S32 s32Ret = pstIndex ? FaceIndex_Query(pstIndex, pstGallery, aps8Queries, u32Count, 1, 0.0f, astMatch, au32Size)
+                              : FaceMatcher_Match(pstGallery, aps8Queries, u32Count, 1, 0.0f, astMatch, au32Size);
+    if (s32Ret != CVI_SUCCESS) {
+        return;
+    }
+    for (uint32_t i = 0; i < u32Count; i++) {
+        TrackState_t *pstEntry = ppstEntries[i];
+        bool bKnown = au32Size[i] > 0 && astMatch[i].fScore >= FACE_MATCHER_THRESHOLD;
+        if (bKnown) {
+            snprintf(pstEntry->szName, sizeof(pstEntry->szName), "%s",
+                     FaceGallery_Name(pstGallery, astMatch[i].u32Index));
+        } else {
+            pstEntry->szName[0] = '\0';
+        }
+        pstEntry->fRecogScore = au32Size[i] > 0 ? astMatch[i].fScore : 0.0f;
+        pstEntry->bAttrValid = true;
+    }
+}
+
+// Cache the embeddings the recognizer finished in the track store
+static void TDLHandler_CollectEmbeddings(FaceRecognizer_t *pstRecog, const FaceGallery_t *pstGallery,
+                                         const FaceIndex_t *pstIndex, TrackStore_t *pstStore) {
+    static_assert(FACE_RECOG_FEATURE_DIM <= TRACK_STORE_FEATURE_DIM, "embedding does not fit the track store");
+    static_assert(FACE_RECOG_MAX_BATCH <= FACE_MATCHER_MAX_QUERIES, "a batch does not fit one match pass");
+    FaceRecogJob_t *pstJob;
+    while ((pstJob = FaceRecognizer_PollDone(pstRecog)) != NULL) {
+        TrackState_t *apstUpdated[FACE_RECOG_MAX_BATCH];
+        uint32_t u32Updated = 0;
+        for (uint32_t i = 0; i < pstJob->u32Count; i++) {
+            const FaceRecogInput_t *pstInput = &pstJob->astInput[i];
+            TrackState_t *pstEntry = TrackStore_Find(pstStore, pstInput->u64TrackId);
+            if (!pstEntry) {
+                continue;
             }
-            
-            static bool bFirstFrame = true;
-            if (bFirstFrame) {
-                std::cout << "=== Frame Information ===" << std::endl;
-                std::cout << "Width: " << stFrame.stVFrame.u32Width << std::endl;
-                std::cout << "Height: " << stFrame.stVFrame.u32Height << std::endl;
-                std::cout << "Pixel Format: " << stFrame.stVFrame.enPixelFormat << std::endl;
-                std::cout << "Stride[0]: " << stFrame.stVFrame.u32Stride[0] << std::endl;
-                std::cout << "=========================" << std::endl;
-                bFirstFrame = false;
+            if (pstEntry->u64FeatureRequestPTS == pstInput->u64CropPTS) {
+                pstEntry->u64FeatureRequestPTS = 0;
+            }
+            if (i >= pstJob->stFaces.size) {
+                continue;
             }
+            const cvtdl_feature_t *pstFeature = &pstJob->stFaces.info[i].feature;
+            TrackStore_AddFeature(pstStore, pstEntry, (const int8_t *)pstFeature->ptr, pstFeature->size,
+                                  pstInput->u64CropPTS, pstInput->fQuality);
+            apstUpdated[u32Updated++] = pstEntry;
         }
-        
-        if (s32Ret != CVI_SUCCESS) {
-            std::cerr << "CVI_VPSS_GetChnFrame failed with 0x" << std::hex << s32Ret << std::endl;
+        FaceRecognizer_Recycle(pstRecog, pstJob);
+        if (pstGallery && FaceGallery_Live(pstGallery) > 0 && u32Updated > 0) {
+            TDLHandler_MatchEmbeddings(pstGallery, pstIndex, apstUpdated, u32Updated);
+        }
+    }
+}
+
+static void TDLHandler_PrintCacheStats(const TrackStore_t *pstStore) {
+    std::cout << "Embedding cache: " << TrackStore_HitRate(pstStore) * 100.0f << "% hits, "
+              << pstStore->u32Requests << " inferences for " << pstStore->u64Lookups << " faces shown, "
+              << TrackStore_Saved(pstStore) << " saved (refresh: "
+              << pstStore->au32Refresh[TRACK_REFRESH_QUALITY] << " quality, "
+              << pstStore->au32Refresh[TRACK_REFRESH_SCALE] << " scale, "
+              << pstStore->au32Refresh[TRACK_REFRESH_TTL] << " ttl)" << std::endl;
+}
+
+static void TDLHandler_PrintQualityStats(const FaceQuality_t *pstQuality) {
+    std::cout << "Quality gate: " << pstQuality->au64Rejects[FACE_QUALITY_OK] << "/" << pstQuality->u64Faces
+              << " faces passed, rejected";
+    for (int i = FACE_QUALITY_OK + 1; i < FACE_QUALITY_COUNT; i++) {
+        std::cout << " " << pstQuality->au64Rejects[i] << " " << FaceQuality_VerdictName((FaceQualityVerdict_t)i);
+    }
+    std::cout << " (of " << pstQuality->u64Crops << " crops), " << pstQuality->u64MetadataDrops
+              << " boxes unpublished" << std::endl;
+}
+
+static void TDLHandler_PrintRoiStats(uint64_t u64RoiDetects, float fRoiInferMs, float fFullInferMs) {
+    std::cout << "Center ROI: " << u64RoiDetects << " window detections, " << fRoiInferMs
+              << " ms each (full frame " << fFullInferMs << " ms)" << std::endl;
+}
+
+static void TDLHandler_PrintMotionStats(const TDLHandler_t *pstHandler, uint64_t u64MotionFrames,
+                                        uint64_t u64Frames) {
+    std::cout << "Motion gate: " << u64MotionFrames << "/" << u64Frames << " frames with motion, "
+              << pstHandler->u64IdleSkips << " detections skipped, " << pstHandler->u64StillFaces
+              << " still faces ignored" << std::endl;
+}
+
+// Detections that lie in regions without motion and were not there on the
+// previous detection (posters, screens, reflections) start no track. They are
+// swapped behind the new size; the original one is restored before freeing.
+// astKept receives the boxes kept.
+static uint32_t TDLHandler_DropStillFaces(const MotionMask_t *pstMotion, const SIZE_S *pstFrameSize,
+                                          std::vector<cvtdl_bbox_t> *pastKept, cvtdl_face_t *pstFaceMeta) {
+    if (!pstFaceMeta->info) {
+        pastKept->clear();
+        return 0;
+    }
+    uint32_t u32Kept = 0;
+    for (uint32_t i = 0; i < pstFaceMeta->size; i++) {
+        const cvtdl_bbox_t *pstBox = &pstFaceMeta->info[i].bbox;
+        bool bKeep = MotionGate_Overlaps(pstMotion, pstBox, pstFrameSize);
+        float fCx = (pstBox->x1 + pstBox->x2) / 2.0f;
+        float fCy = (pstBox->y1 + pstBox->y2) / 2.0f;
+        for (size_t k = 0; k < pastKept->size() && !bKeep; k++) {
+            const cvtdl_bbox_t *pstPrev = &(*pastKept)[k];
+            bKeep = fCx >= pstPrev->x1 && fCx <= pstPrev->x2 && fCy >= pstPrev->y1 && fCy <= pstPrev->y2;
+        }
+        if (!bKeep) {
+            continue;
+        }
+        if (u32Kept != i) {
+            std::swap(pstFaceMeta->info[u32Kept], pstFaceMeta->info[i]);
+        }
+        u32Kept++;
+    }
+    pastKept->resize(u32Kept);
+    for (uint32_t i = 0; i < u32Kept; i++) {
+        (*pastKept)[i] = pstFaceMeta->info[i].bbox;
+    }
+    uint32_t u32Dropped = pstFaceMeta->size - u32Kept;
+    pstFaceMeta->size = u32Kept;
+    return u32Dropped;
+}
+
+// Names from the track store onto the tracked boxes
+static void TDLHandler_Annotate(TrackStore_t *pstStore, cvtdl_face_t *pstFaceMeta) {
+    for (uint32_t i = 0; i < pstFaceMeta->size; i++) {
+        cvtdl_face_info_t *pstInfo = &pstFaceMeta->info[i];
+        const TrackState_t *pstEntry = TrackStore_Lookup(pstStore, pstInfo->unique_id);
+        if (pstEntry && pstEntry->bAttrValid) {
+            std::memcpy(pstInfo->name, pstEntry->szName, sizeof(pstInfo->name));
+            pstInfo->recog_score = pstEntry->fRecogScore;
+        }
+    }
+}
+
+// Send the crops not embedded yet to the recognizer, all in one batch
+static void TDLHandler_RequestEmbeddings(FaceRecognizer_t *pstRecog, TrackStore_t *pstStore) {
+    FaceRecogJob_t *pstJob = NULL;
+    for (int i = 0; i < TRACK_STORE_MAX; i++) {
+        TrackState_t *pstEntry = &pstStore->astEntry[i];
+        if (pstEntry->u64Id == 0 || !pstEntry->bHasCrop || pstEntry->u64FeatureRequestPTS != 0 ||
+            (pstEntry->bHasFeature && pstEntry->u64FeaturePTS == pstEntry->u64CropPTS)) {
+            continue;
+        }
+        if (!pstJob && (pstJob = FaceRecognizer_GetFreeJob(pstRecog)) == NULL) {
+            // recognizer busy, try again on the next detection
+            return;
+        }
+        FaceRecogInput_t *pstInput = &pstJob->astInput[pstJob->u32Count++];
+        pstInput->u64TrackId = pstEntry->u64Id;
+        pstInput->u64CropPTS = pstEntry->u64CropPTS;
+        pstInput->fQuality = pstEntry->fBestQuality;
+        pstInput->u32Pts = pstEntry->u32CropPts;
+        std::memcpy(pstInput->afPtsX, pstEntry->afCropPtsX, sizeof(pstInput->afPtsX));
+        std::memcpy(pstInput->afPtsY, pstEntry->afCropPtsY, sizeof(pstInput->afPtsY));
+        std::memcpy(pstInput->au8Crop, pstEntry->au8Crop, sizeof(pstInput->au8Crop));
+        pstEntry->u64FeatureRequestPTS = pstEntry->u64CropPTS;
+        pstStore->u32Requests++;
+        if (pstJob->u32Count == FACE_RECOG_MAX_BATCH) {
             break;
         }
+    }
+    if (pstJob) {
+        FaceRecognizer_Submit(pstRecog, pstJob);
+    }
+}
+
+// Adaptive detect-every-N scheduling, in PTS time
+typedef struct {
+    uint32_t u32Interval;
+    uint32_t u32MinInterval;
+    uint32_t u32MaxInterval;
+    float fMaxDrift;
+    float fInferMs;
+    float fFrameMs;
+    uint64_t u64LastPTS;
+    uint64_t u64LastDetectPTS;
+    bool bIdle;            // the motion gate was idle on the previous frame
+} TDLDetectSchedule_t;
+
+static bool TDLHandler_ScheduleDetect(TDLDetectSchedule_t *pstSchedule, uint64_t u64PTS,
+                                      const MotionGate_t *pstGate) {
+    // Frame period: frames are skipped while inference runs, so follow the
+    // smallest PTS step and only average steps close to it
+    if (pstSchedule->u64LastPTS && u64PTS > pstSchedule->u64LastPTS) {
+        float fDeltaMs = (float)(u64PTS - pstSchedule->u64LastPTS) / 1000.0f;
+        if (pstSchedule->fFrameMs <= 0.0f || fDeltaMs < pstSchedule->fFrameMs) {
+            pstSchedule->fFrameMs = fDeltaMs;
+        } else if (fDeltaMs < 1.5f * pstSchedule->fFrameMs) {
+            pstSchedule->fFrameMs = 0.9f * pstSchedule->fFrameMs + 0.1f * fDeltaMs;
+        }
+    }
+    pstSchedule->u64LastPTS = u64PTS;
+
+    bool bDetect = true;
+    bool bIdle = MotionGate_Idle(pstGate, u64PTS);
+    if (bIdle) {
+        // still scene: only a heartbeat keeps the tracks of faces standing still
+        bDetect = u64PTS >= pstSchedule->u64LastDetectPTS + pstGate->stConfig.u64HeartbeatUs;
+    } else if (pstSchedule->bIdle) {
+        // motion is back, do not wait out the interval
+        bDetect = true;
+    } else if (pstSchedule->u64LastDetectPTS && pstSchedule->fFrameMs > 0.0f) {
+        // half a frame of slack for PTS jitter
+        float fElapsedFrames = (float)(u64PTS - pstSchedule->u64LastDetectPTS) / 1000.0f /
+                               pstSchedule->fFrameMs;
+        bDetect = fElapsedFrames + 0.5f >= (float)pstSchedule->u32Interval;
+    }
+    pstSchedule->bIdle = bIdle;
+    if (bDetect) {
+        pstSchedule->u64LastDetectPTS = u64PTS;
+    }
+    return bDetect;
+}
+
+static void TDLHandler_ScheduleUpdate(TDLDetectSchedule_t *pstSchedule, float fInferMs,
+                                      const FaceTracker_t *pstTracker) {
+    pstSchedule->fInferMs = pstSchedule->fInferMs > 0.0f
+                                ? 0.8f * pstSchedule->fInferMs + 0.2f * fInferMs
+                                : fInferMs;
+    if (pstSchedule->fFrameMs <= 0.0f) {
+        return;
+    }
+
+    // the TPU cannot detect more often than once per inference time anyway
+    uint32_t u32Min = std::max<uint32_t>(1, (uint32_t)ceilf(pstSchedule->fInferMs / pstSchedule->fFrameMs));
+    uint32_t u32Interval = pstSchedule->u32MaxInterval;
+    float fMotion = FaceTracker_Motion(pstTracker);
+    if (FaceTracker_ActiveCount(pstTracker) > 0 && fMotion > 0.0f) {
+        float fFrames = pstSchedule->fMaxDrift / (fMotion * pstSchedule->fFrameMs / 1000.0f);
+        u32Interval = (uint32_t)std::min<float>(fFrames, (float)pstSchedule->u32MaxInterval);
+    }
+    u32Interval = std::max(std::max(u32Interval, u32Min), pstSchedule->u32MinInterval);
+
+    if (u32Interval != pstSchedule->u32Interval) {
+        std::cout << "Detect interval: " << u32Interval << " frame(s) (inference "
+                  << pstSchedule->fInferMs << " ms, motion " << fMotion << " box/s)" << std::endl;
+        pstSchedule->u32Interval = u32Interval;
+    }
+}
+
+static uint64_t TDLHandler_NowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+// State of one run of the detection pipeline, shared by its three stages
+typedef struct {
+    TDLHandler_t *pstHandler;
+    TDLPipeline_t stPipe;
+    // decided on by acquisition, tuned by post-processing, under stPipe.mutex
+    TDLDetectSchedule_t stSchedule;
+    // inference: boxes kept by the last full-frame detection
+    std::vector<cvtdl_bbox_t> astKept;
+    // post-processing
+    FaceTracker_t stTracker;
+    TrackStore_t stTrackStore;
+    std::vector<FaceQualityVerdict_t> aenVerdict;
+    cvtdl_bbox_t stRoiWindow;
+    uint32_t u32LastFaceSize;
+    uint64_t u64FpsStartUs;
+    uint32_t u32FpsFrames;
+    float fFps;
+    bool bStatsDue;            // a new FPS interval began, the next detection prints the stats
+    // live configuration generation applied by each stage, and the thresholds inference set
+    uint32_t au32LiveGeneration[3];
+    float fScoreThreshold;
+    float fNmsThreshold;
+    bool bDetected;            // a full-frame detection completed
+} TDLRun_t;
+
+// Acquisition: detection cadence and the motion gate
+static void TDLHandler_ApplyLiveDetect(TDLRun_t *pstRun) {
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    const LiveConfig_t *pstLive = LiveConfig_Read(pstHandler->pstLive, LIVE_READER_TDL_ACQUIRE);
+    if (pstLive->u32Generation == pstRun->au32LiveGeneration[0]) {
+        return;
+    }
+    bool bChanged = pstRun->au32LiveGeneration[0] != 0;
+    pstRun->au32LiveGeneration[0] = pstLive->u32Generation;
+    pstHandler->stDetect = pstLive->stDetect;
+    MotionGate_SetConfig(&pstHandler->stMotion, &pstLive->stDetect.stMotion);
+    pthread_mutex_lock(&pstRun->stPipe.mutex);
+    pstRun->stSchedule.u32MinInterval = pstHandler->roiHandle ? pstLive->stDetect.u32RoiFullInterval : 1;
+    pstRun->stSchedule.u32MaxInterval = pstLive->stDetect.u32IntervalMax;
+    pstRun->stSchedule.fMaxDrift = pstLive->stDetect.fTrackMaxDrift;
+    pthread_mutex_unlock(&pstRun->stPipe.mutex);
+    if (bChanged) {
+        std::cout << "Detection cadence: interval up to " << pstLive->stDetect.u32IntervalMax << ", drift "
+                  << pstLive->stDetect.fTrackMaxDrift << ", motion threshold "
+                  << pstLive->stDetect.stMotion.u32Threshold << std::endl;
+    }
+}
+
+// Inference: detector thresholds, on the ROI detector too
+static void TDLHandler_ApplyLiveThresholds(TDLRun_t *pstRun) {
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    const LiveConfig_t *pstLive = LiveConfig_Read(pstHandler->pstLive, LIVE_READER_TDL_INFER);
+    if (pstLive->u32Generation == pstRun->au32LiveGeneration[1]) {
+        return;
+    }
+    pstRun->au32LiveGeneration[1] = pstLive->u32Generation;
+    float fScore = pstLive->fScoreThreshold > 0.0f ? pstLive->fScoreThreshold : pstHandler->fModelScore;
+    float fNms = pstLive->fNmsThreshold > 0.0f ? pstLive->fNmsThreshold : pstHandler->fModelNms;
+    if (fScore == pstRun->fScoreThreshold && fNms == pstRun->fNmsThreshold) {
+        return;
+    }
+    CVI_S32 s32Ret = HAL_Detector_SetThresholds(pstHandler->tdlHandle, fScore, fNms);
+    if (s32Ret == CVI_SUCCESS && pstHandler->roiHandle) {
+        s32Ret = HAL_Detector_SetThresholds(pstHandler->roiHandle, fScore, fNms);
+    }
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Cannot set the detector thresholds, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+        return;
+    }
+    pstRun->fScoreThreshold = fScore;
+    pstRun->fNmsThreshold = fNms;
+    std::cout << "Detector thresholds: score " << fScore << ", NMS " << fNms << std::endl;
+}
+
+// Post-processing: the quality gate
+static void TDLHandler_ApplyLiveQuality(TDLRun_t *pstRun) {
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    const LiveConfig_t *pstLive = LiveConfig_Read(pstHandler->pstLive, LIVE_READER_TDL_POST);
+    if (pstLive->u32Generation == pstRun->au32LiveGeneration[2]) {
+        return;
+    }
+    pstRun->au32LiveGeneration[2] = pstLive->u32Generation;
+    FaceQuality_SetConfig(&pstHandler->stQuality, &pstLive->stQuality);
+}
+
+// Acquisition: the button, the motion gate and the detection schedule
+static void TDLHandler_Prepare(TDLRun_t *pstRun, TDLJob_t *pstJob) {
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    if (pstHandler->buttonHandler) {
+        ButtonPressType_t pressType = ButtonHandler_GetPressType(pstHandler->buttonHandler);
         
-        std::memset(&stFaceMeta, 0, sizeof(cvtdl_face_t));
-        gettimeofday(&t0, NULL);
-        
-        s32Ret = TDLHandler_DetectFace(pstHandler, &stFrame, &stFaceMeta);
-        
-        gettimeofday(&t1, NULL);
-        
-        if (s32Ret != CVI_TDL_SUCCESS) {
-            std::cerr << "Inference failed, ret=0x" << std::hex << s32Ret << std::endl;
-            CVI_TDL_Free(&stFaceMeta);
-            CVI_VPSS_ReleaseChnFrame(0, 1, &stFrame);
-            if (s32Ret != CVI_SUCCESS) {
-                g_bExit = true;
+        if (pressType == BUTTON_PRESS_SHORT) {
+            time_t now = time(NULL);
+            struct tm *t = localtime(&now);
+            char filename[256];
+            snprintf(filename, sizeof(filename), 
+                    "capture_%04d%02d%02d_%02d%02d%02d.bin",
+                    t->tm_year + 1900, t->tm_mon + 1, t->tm_mday,
+                    t->tm_hour, t->tm_min, t->tm_sec);
+            
+            std::cout << "=== Short Press: Capturing Photo ===" << std::endl;
+            std::cout << "Filename: " << filename << std::endl;
+            
+            CVI_S32 s32Ret = TDLHandler_CaptureShared(pstHandler, &pstJob->stFrame, filename);
+            if (s32Ret == CVI_SUCCESS) {
+                std::cout << "Photo captured successfully!" << std::endl;
+                std::cout << "Size: " << pstHandler->stFrameSize.u32Width << "x" 
+                          << pstHandler->stFrameSize.u32Height << std::endl;
+            } else {
+                std::cerr << "Failed to capture photo" << std::endl;
             }
-            continue;
+            std::cout << "=====================================" << std::endl;
+            
+            ButtonHandler_ClearPressType(pstHandler->buttonHandler);
+        } 
+        else if (pressType == BUTTON_PRESS_LONG) {
+            std::cout << "=== Long Press: Special Function ===" << std::endl;
+            std::cout << "Long press detected - executing special function" << std::endl;
+            std::cout << "====================================" << std::endl;
+            
+            ButtonHandler_ClearPressType(pstHandler->buttonHandler);
         }
-        
-        execution_time = ((t1.tv_sec - t0.tv_sec) * 1000000 + t1.tv_usec - t0.tv_usec);
-        
+    }
+    
+    static bool bFirstFrame = true;
+    if (bFirstFrame) {
+        std::cout << "=== Frame Information ===" << std::endl;
+        std::cout << "Width: " << pstJob->stFrame.stVFrame.u32Width << std::endl;
+        std::cout << "Height: " << pstJob->stFrame.stVFrame.u32Height << std::endl;
+        std::cout << "Pixel Format: " << pstJob->stFrame.stVFrame.enPixelFormat << std::endl;
+        std::cout << "Stride[0]: " << pstJob->stFrame.stVFrame.u32Stride[0] << std::endl;
+        std::cout << "=========================" << std::endl;
+        bFirstFrame = false;
+    }
+    
+    pstJob->u64PTS = pstJob->stFrame.stVFrame.u64PTS;
+    MotionGate_Update(&pstHandler->stMotion, &pstJob->stFrame);
+    pstJob->stMotion = pstHandler->stMotion.stMask;
+    pstJob->u64MotionFrames = pstHandler->stMotion.u64MotionFrames;
+    pstJob->u64GateFrames = pstHandler->stMotion.u64Frames;
+    pstJob->bIdle = MotionGate_Idle(&pstHandler->stMotion, pstJob->u64PTS);
+    pthread_mutex_lock(&pstRun->stPipe.mutex);
+    pstJob->bDetect = TDLHandler_ScheduleDetect(&pstRun->stSchedule, pstJob->u64PTS, &pstHandler->stMotion);
+    pthread_mutex_unlock(&pstRun->stPipe.mutex);
+}
+
+// Inference: detect on the whole frame, drop new faces in still regions and
+// assign track IDs (DeepSORT shares the detector's handle, so it runs here)
+static void TDLHandler_InferFull(TDLRun_t *pstRun, TDLJob_t *pstJob) {
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    uint64_t u64Start = TDLHandler_NowUs();
+    pstJob->s32Result = TDLHandler_DetectFace(pstHandler, &pstJob->stFrame, &pstJob->stFaceMeta);
+    uint64_t u64Elapsed = TDLHandler_NowUs() - u64Start;
+    pstJob->fInferMs = u64Elapsed / 1000.0f;
+    pstJob->u32Detected = pstJob->stFaceMeta.size;
+    pstRun->stPipe.u64Detects++;
+    pstRun->stPipe.u64InferUs += u64Elapsed;
+    if (pstJob->s32Result != CVI_TDL_SUCCESS) {
+        return;
+    }
+    if (!pstRun->bDetected) {
+        // the figure that counts for devices booted on motion
+        pstRun->bDetected = true;
+        std::cout << "First detection: " << Startup_SinceBootMs() << " ms after power-on" << std::endl;
+    }
+    
+    // boxes are in model input coordinates, bring them to the encoded frame
+    if (pstHandler->bDetectChn) {
+        HAL_Detector_RescaleFaceMeta(&pstHandler->stFrameSize, &pstJob->stFaceMeta);
+    }
+    pstJob->u32StillFaces = TDLHandler_DropStillFaces(&pstJob->stMotion, &pstHandler->stFrameSize,
+                                                      &pstRun->astKept, &pstJob->stFaceMeta);
+    
+    // stable IDs across detections
+    CVI_S32 s32Ret = HAL_Tracker_TrackFace(pstHandler->tdlHandle, &pstJob->stFaceMeta, &pstJob->stTrackerMeta);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Face tracking failed, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+    }
+}
+
+static void *TDLHandler_InferRoutine(void *pArgs) {
+    TDLRun_t *pstRun = static_cast<TDLRun_t *>(pArgs);
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    uint32_t u32Cursor = 0;
+    TDLJob_t *pstJob;
+    while ((pstJob = TDLPipeline_Wait(&pstRun->stPipe, &u32Cursor, TDL_JOB_ACQUIRED)) != NULL) {
+        if (pstHandler->pstLive) {
+            TDLHandler_ApplyLiveThresholds(pstRun);
+        }
+        if (pstJob->bDetect) {
+            TDLHandler_InferFull(pstRun, pstJob);
+        } else if (pstHandler->roiHandle && !pstJob->bIdle) {
+            // fast path: only the faces near the crosshair, no new crops or IDs
+            uint64_t u64Start = TDLHandler_NowUs();
+            pstJob->bRoi = TDLHandler_DetectRoi(pstHandler, &pstJob->stFaceMeta, &pstJob->u64RoiPTS) == CVI_SUCCESS;
+            pstJob->u32Detected = pstJob->stFaceMeta.size;
+            pstRun->stPipe.u64InferUs += TDLHandler_NowUs() - u64Start;
+        }
+        pstJob->u64RoiDetects = pstHandler->u64RoiDetects;
+        pstJob->fRoiInferMs = pstHandler->fRoiInferMs;
+        TDLPipeline_Advance(&pstRun->stPipe, pstJob, TDL_JOB_INFERRED);
+    }
+    if (pstHandler->pstLive) {
+        LiveConfig_Offline(pstHandler->pstLive, LIVE_READER_TDL_INFER);
+    }
+    return nullptr;
+}
+
+// Post-processing of a full-frame detection: per-track state, crops,
+// recognition, the box tracker and the schedule
+static void TDLHandler_PostDetect(TDLRun_t *pstRun, TDLJob_t *pstJob) {
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    cvtdl_face_t *pstFaceMeta = &pstJob->stFaceMeta;
+    // faces not worth recognizing keep their track but get no new crop
+    pstRun->aenVerdict.resize(pstFaceMeta->info ? pstFaceMeta->size : 0);
+    for (size_t i = 0; i < pstRun->aenVerdict.size(); i++) {
+        pstRun->aenVerdict[i] = FaceQuality_CheckFace(&pstHandler->stQuality, &pstFaceMeta->info[i]);
+    }
+    if (TrackStore_Update(&pstRun->stTrackStore, pstFaceMeta, &pstJob->stTrackerMeta, pstJob->u64PTS,
+                          pstRun->aenVerdict.data()) > 0) {
+        if (!TDLHandler_TakeCrops(pstHandler, &pstRun->stTrackStore, pstFaceMeta, pstJob)) {
+            pstRun->stPipe.u64CropMisses++;
+        }
+    }
+    TDLHandler_ReleaseCropFrame(pstHandler, pstJob);
+    if (pstHandler->pstRecognizer) {
+        TDLHandler_CollectEmbeddings(pstHandler->pstRecognizer, pstHandler->pstGallery, pstHandler->pstIndex,
+                                     &pstRun->stTrackStore);
+        TDLHandler_RequestEmbeddings(pstHandler->pstRecognizer, &pstRun->stTrackStore);
+    }
+    
+    FaceTracker_Update(&pstRun->stTracker, pstFaceMeta, pstJob->u64PTS);
+    pthread_mutex_lock(&pstRun->stPipe.mutex);
+    TDLHandler_ScheduleUpdate(&pstRun->stSchedule, pstJob->fInferMs, &pstRun->stTracker);
+    pthread_mutex_unlock(&pstRun->stPipe.mutex);
+}
 
-        frame_count++;
-        gettimeofday(&fps_t1, NULL);
-        unsigned long fps_elapsed = ((fps_t1.tv_sec - fps_t0.tv_sec) * 1000000 + fps_t1.tv_usec - fps_t0.tv_usec);
-        if (fps_elapsed >= 1000000) { // 1 second
-            current_fps = (float)frame_count * 1000000.0f / (float)fps_elapsed;
-            {
-                LOCK_FPS_MUTEX();
-                g_fCurrentFPS = current_fps;
-                UNLOCK_FPS_MUTEX();
+static void TDLHandler_PrintDetection(TDLRun_t *pstRun, const TDLJob_t *pstJob) {
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    const cvtdl_face_t *pstFaceMeta = &pstJob->stFaceMeta;
+    if (pstFaceMeta->size > 0) {
+        std::cout << "=== Face Detection Results ===" << std::endl;
+        std::cout << "Face count: " << pstFaceMeta->size << std::endl;
+        std::cout << "Inference time: " << pstJob->fInferMs << " ms" << std::endl;
+        std::cout << "FPS: " << pstRun->fFps << std::endl;
+        std::cout << "Frame size: " << pstJob->stFrame.stVFrame.u32Width << "x" 
+                  << pstJob->stFrame.stVFrame.u32Height << std::endl;
+        
+        for (uint32_t i = 0; i < pstFaceMeta->size; i++) {
+            std::cout << "Face[" << i << "] id=" << pstFaceMeta->info[i].unique_id << " bbox: "
+                      << "x1=" << pstFaceMeta->info[i].bbox.x1 << ", "
+                      << "y1=" << pstFaceMeta->info[i].bbox.y1 << ", "
+                      << "x2=" << pstFaceMeta->info[i].bbox.x2 << ", "
+                      << "y2=" << pstFaceMeta->info[i].bbox.y2 << ", "
+                      << "score=" << pstFaceMeta->info[i].bbox.score << std::endl;
+        }
+        // the running stats at most once per FPS interval
+        if (pstRun->bStatsDue) {
+            pstRun->bStatsDue = false;
+            const TrackStore_t *pstStore = &pstRun->stTrackStore;
+            std::cout << "Tracks: " << TrackStore_Count(pstStore) << " active, "
+                      << pstStore->u64Tracks << " seen, " << pstStore->u32Crops
+                      << " crops, " << pstStore->u32Features << " embeddings" << std::endl;
+            if (pstHandler->pstRecognizer) {
+                TDLHandler_PrintCacheStats(pstStore);
+            }
+            TDLHandler_PrintQualityStats(&pstHandler->stQuality);
+            if (pstHandler->roiHandle) {
+                TDLHandler_PrintRoiStats(pstJob->u64RoiDetects, pstJob->fRoiInferMs, pstRun->stSchedule.fInferMs);
             }
-            frame_count = 0;
-            fps_t0 = fps_t1;
+            TDLHandler_PrintMotionStats(pstHandler, pstJob->u64MotionFrames, pstJob->u64GateFrames);
+        }
+        std::cout << "=============================" << std::endl;
+    } else if (pstFaceMeta->size != pstRun->u32LastFaceSize) {
+        std::cout << "No face detected" << std::endl;
+    }
+    pstRun->u32LastFaceSize = pstFaceMeta->size;
+}
+
+// Post-processing: update the tracks, publish the boxes of every frame and
+// release the frame, in acquisition order
+static void *TDLHandler_PostRoutine(void *pArgs) {
+    TDLRun_t *pstRun = static_cast<TDLRun_t *>(pArgs);
+    TDLHandler_t *pstHandler = pstRun->pstHandler;
+    uint32_t u32Cursor = 0;
+    TDLJob_t *pstJob;
+    while ((pstJob = TDLPipeline_Wait(&pstRun->stPipe, &u32Cursor, TDL_JOB_INFERRED)) != NULL) {
+        if (pstHandler->pstLive) {
+            TDLHandler_ApplyLiveQuality(pstRun);
+        }
+        bool bPublish = true;
+        if (pstJob->bDetect && pstJob->s32Result != CVI_TDL_SUCCESS) {
+            std::cerr << "Inference failed, ret=0x" << std::hex << pstJob->s32Result << std::dec << std::endl;
+            g_bExit = true;
+            bPublish = false;
+        } else if (pstJob->bDetect) {
+            TDLHandler_PostDetect(pstRun, pstJob);
+        } else if (pstJob->bRoi) {
+            FaceTracker_UpdateWindow(&pstRun->stTracker, &pstJob->stFaceMeta, pstJob->u64RoiPTS, &pstRun->stRoiWindow);
+        }
+        HAL_Tracker_FreeResult(&pstJob->stTrackerMeta);
+        if (pstJob->bIdle && !pstJob->bDetect) {
+            pstHandler->u64IdleSkips++;
         }
+        pstHandler->u64StillFaces += pstJob->u32StillFaces;
         
-        if (stFaceMeta.size > 0) {
-            std::cout << "=== Face Detection Results ===" << std::endl;
-            std::cout << "Face count: " << stFaceMeta.size << std::endl;
-            std::cout << "Inference time: " << (float)execution_time / 1000 << " ms" << std::endl;
-            std::cout << "FPS: " << current_fps << std::endl;
-            std::cout << "Frame size: " << stFrame.stVFrame.u32Width << "x" 
-                      << stFrame.stVFrame.u32Height << std::endl;
+        if (bPublish) {
+            // every frame gets boxes, detected or extrapolated by the tracker
+            cvtdl_face_t *pstTracked = FaceTracker_Predict(&pstRun->stTracker, pstJob->u64PTS);
+            FaceQuality_FilterMetadata(&pstHandler->stQuality, pstTracked);
+            TDLHandler_Annotate(&pstRun->stTrackStore, pstTracked);
             
-            for (uint32_t i = 0; i < stFaceMeta.size; i++) {
-                std::cout << "Face[" << i << "] bbox: "
-                          << "x1=" << stFaceMeta.info[i].bbox.x1 << ", "
-                          << "y1=" << stFaceMeta.info[i].bbox.y1 << ", "
-                          << "x2=" << stFaceMeta.info[i].bbox.x2 << ", "
-                          << "y2=" << stFaceMeta.info[i].bbox.y2 << ", "
-                          << "score=" << stFaceMeta.info[i].bbox.score << std::endl;
+            pstRun->u32FpsFrames++;
+            uint64_t u64NowUs = TDLHandler_NowUs();
+            if (u64NowUs - pstRun->u64FpsStartUs >= 1000000) { // 1 second
+                pstRun->fFps = (float)pstRun->u32FpsFrames * 1000000.0f / (float)(u64NowUs - pstRun->u64FpsStartUs);
+                g_fCurrentFPS = pstRun->fFps;
+                pstRun->u32FpsFrames = 0;
+                pstRun->u64FpsStartUs = u64NowUs;
+                pstRun->bStatsDue = true;
             }
-            std::cout << "=============================" << std::endl;
-        } else if (stFaceMeta.size != s_u32LastFaceSize) {
-            std::cout << "No face detected" << std::endl;
+            if (pstJob->bDetect) {
+                TDLHandler_PrintDetection(pstRun, pstJob);
+            }
+            
+            // 更新全局人臉數據
+            FaceResult_Publish(&g_stFaceResults, pstTracked, &pstJob->stFrame.stVFrame);
+            FaceResultHistory_Push(&g_stFaceHistory, pstTracked, &pstJob->stFrame.stVFrame);
         }
         
-        s_u32LastFaceSize = stFaceMeta.size;
+        // the still faces dropped by inference are freed too
+        pstJob->stFaceMeta.size = pstJob->u32Detected;
+        HAL_Detector_FreeFaceMeta(&pstJob->stFaceMeta);
+        TDLHandler_ReleaseCropFrame(pstHandler, pstJob);
+        TDLHandler_ReleaseInputFrame(pstHandler, pstJob->pstSlot, &pstJob->stFrame);
+        pstRun->stPipe.u64EndUs = TDLHandler_NowUs();
+        pstRun->stPipe.u64LatencyUs += pstRun->stPipe.u64EndUs - pstJob->u64AcquireUs;
+        TDLPipeline_Advance(&pstRun->stPipe, pstJob, TDL_JOB_FREE);
+    }
+    if (pstHandler->pstLive) {
+        LiveConfig_Offline(pstHandler->pstLive, LIVE_READER_TDL_POST);
+    }
+    return nullptr;
+}
+
+// Acquisition runs on the calling thread. Inference and post-processing each
+// get a thread, so fetching the next frame, the TPU and the CPU work on the
+// previous result overlap, with up to TDL_PIPELINE_DEPTH frames held.
+void *TDLHandler_ThreadRoutine(void *pHandle) {
+    std::cout << "Enter TDL thread" << std::endl;
+    
+    TDLHandler_t *pstHandler = static_cast<TDLHandler_t *>(pHandle);
+    // before the other stages start, they would inherit the old mask
+    AppConfig_PinThread(pthread_self(), pstHandler->au32Cpus[0], "TDL acquisition");
+    TDLRun_t *pstRun = new TDLRun_t();
+    pstRun->pstHandler = pstHandler;
+    TDLPipeline_Init(&pstRun->stPipe);
+    FaceTracker_Init(&pstRun->stTracker);
+    TrackStore_Init(&pstRun->stTrackStore);
+    pstRun->stSchedule.u32Interval = 1;
+    // the window detector covers the frames in between
+    pstRun->stSchedule.u32MinInterval = pstHandler->roiHandle ? pstHandler->stDetect.u32RoiFullInterval : 1;
+    pstRun->stSchedule.u32MaxInterval = pstHandler->stDetect.u32IntervalMax;
+    pstRun->stSchedule.fMaxDrift = pstHandler->stDetect.fTrackMaxDrift;
+    pstRun->fScoreThreshold = pstHandler->fModelScore;
+    pstRun->fNmsThreshold = pstHandler->fModelNms;
+    const RECT_S *pstRoiRect = &pstHandler->stRoiRect;
+    pstRun->stRoiWindow.x1 = (float)pstRoiRect->s32X;
+    pstRun->stRoiWindow.y1 = (float)pstRoiRect->s32Y;
+    pstRun->stRoiWindow.x2 = (float)(pstRoiRect->s32X + pstRoiRect->u32Width);
+    pstRun->stRoiWindow.y2 = (float)(pstRoiRect->s32Y + pstRoiRect->u32Height);
+    pstRun->u64FpsStartUs = TDLHandler_NowUs();
+    pstRun->stPipe.u64StartUs = pstRun->u64FpsStartUs;
+    
+    pthread_t inferThread, postThread;
+    bool bInferStarted = pthread_create(&inferThread, nullptr, TDLHandler_InferRoutine, pstRun) == 0;
+    bool bPostStarted = bInferStarted && pthread_create(&postThread, nullptr, TDLHandler_PostRoutine, pstRun) == 0;
+    if (!bPostStarted) {
+        std::cerr << "Failed to create detection pipeline threads" << std::endl;
+        g_bExit = true;
+    } else {
+        AppConfig_PinThread(inferThread, pstHandler->au32Cpus[1], "TDL inference");
+        AppConfig_PinThread(postThread, pstHandler->au32Cpus[2], "TDL post-processing");
+    }
+    
+    FrameBrokerSlot_t *pstSlot = NULL;
+    uint64_t u64Cursor = 0;
+    uint32_t u32Cursor = 0;
+    while (!g_bExit) {
+        uint64_t u64WaitUs = TDLHandler_NowUs();
+        TDLJob_t *pstJob = TDLPipeline_Wait(&pstRun->stPipe, &u32Cursor, TDL_JOB_FREE);
+        pstRun->stPipe.u64StallUs += TDLHandler_NowUs() - u64WaitUs;
+        std::memset(pstJob, 0, sizeof(TDLJob_t));
         
-        // 更新全局人臉數據
-        {
-            LOCK_RESULT_MUTEX();
-            std::memset(&g_stFaceMeta, 0, sizeof(cvtdl_face_t));
-            if (stFaceMeta.info != nullptr) {
-                CVI_TDL_CopyFaceMeta(&stFaceMeta, &g_stFaceMeta);
+        // always detect on the newest frame, skipping the ones missed during inference
+        CVI_S32 s32Ret = TDLHandler_GetInputFrame(pstHandler, &u64Cursor, &pstSlot, &pstJob->stFrame);
+        if (s32Ret != CVI_SUCCESS) {
+            if (!g_bExit) {
+                std::cerr << "Get detector input frame failed with 0x" << std::hex << s32Ret << std::dec << std::endl;
             }
-            UNLOCK_RESULT_MUTEX();
+            break;
         }
-        
-        CVI_TDL_Free(&stFaceMeta);
-        CVI_VPSS_ReleaseChnFrame(0, 1, &stFrame);
+        pstJob->pstSlot = pstSlot;
+        pstJob->u64AcquireUs = TDLHandler_NowUs();
+        pstRun->stPipe.u64Frames++;
+        if (pstHandler->pstLive) {
+            TDLHandler_ApplyLiveDetect(pstRun);
+        }
+        TDLHandler_Prepare(pstRun, pstJob);
+        // the broker only retains the newest frames, this one has to outlive the
+        // inference; holding it also keeps the CPU overlay off it until the crops are cut
+        if (pstJob->bDetect && pstHandler->bDetectChn &&
+            FrameBroker_AcquirePTS(pstHandler->pstFrameBroker, pstJob->stFrame.stVFrame.u64PTS,
+                                   &pstJob->pstCropSlot, TDL_CROP_WAIT_MS) != CVI_SUCCESS) {
+            pstJob->pstCropSlot = NULL;
+        }
+        TDLPipeline_Advance(&pstRun->stPipe, pstJob, TDL_JOB_ACQUIRED);
+    }
+    
+    if (pstHandler->pstLive) {
+        LiveConfig_Offline(pstHandler->pstLive, LIVE_READER_TDL_ACQUIRE);
+    }
+    // let the frames in flight through, then stop the stages
+    TDLPipeline_Close(&pstRun->stPipe);
+    if (bInferStarted) {
+        pthread_join(inferThread, nullptr);
+    }
+    if (bPostStarted) {
+        pthread_join(postThread, nullptr);
     }
     
+    if (pstHandler->pstRecognizer) {
+        TDLHandler_PrintCacheStats(&pstRun->stTrackStore);
+    }
+    TDLHandler_PrintQualityStats(&pstHandler->stQuality);
+    if (pstHandler->roiHandle) {
+        TDLHandler_PrintRoiStats(pstHandler->u64RoiDetects, pstHandler->fRoiInferMs, pstRun->stSchedule.fInferMs);
+    }
+    TDLHandler_PrintMotionStats(pstHandler, pstHandler->stMotion.u64MotionFrames, pstHandler->stMotion.u64Frames);
+    TDLPipeline_PrintStats(&pstRun->stPipe);
+    TDLPipeline_Destroy(&pstRun->stPipe);
+    delete pstRun;
     std::cout << "Exit TDL thread" << std::endl;
     pthread_exit(nullptr);
 }
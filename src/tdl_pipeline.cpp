@@ -0,0 +1,58 @@
+#include <iostream>
+#include <cstring>
+#include "tdl_pipeline.h"
+
+void TDLPipeline_Init(TDLPipeline_t *pstPipe) {
+    std::memset(pstPipe, 0, sizeof(TDLPipeline_t));
+    pthread_mutex_init(&pstPipe->mutex, NULL);
+    pthread_cond_init(&pstPipe->cond, NULL);
+}
+
+void TDLPipeline_Destroy(TDLPipeline_t *pstPipe) {
+    pthread_cond_destroy(&pstPipe->cond);
+    pthread_mutex_destroy(&pstPipe->mutex);
+}
+
+TDLJob_t *TDLPipeline_Wait(TDLPipeline_t *pstPipe, uint32_t *pu32Cursor, TDLJobState_t enState) {
+    const uint32_t u32Index = *pu32Cursor;
+    pthread_mutex_lock(&pstPipe->mutex);
+    while (pstPipe->aenState[u32Index] != enState) {
+        // once closed, only a job already acquired still moves on
+        TDLJobState_t enNow = pstPipe->aenState[u32Index];
+        if (pstPipe->bClosed && (enNow == TDL_JOB_FREE || enNow > enState)) {
+            pthread_mutex_unlock(&pstPipe->mutex);
+            return NULL;
+        }
+        pthread_cond_wait(&pstPipe->cond, &pstPipe->mutex);
+    }
+    pthread_mutex_unlock(&pstPipe->mutex);
+    *pu32Cursor = (u32Index + 1) % TDL_PIPELINE_DEPTH;
+    return &pstPipe->astJob[u32Index];
+}
+
+void TDLPipeline_Advance(TDLPipeline_t *pstPipe, TDLJob_t *pstJob, TDLJobState_t enNext) {
+    pthread_mutex_lock(&pstPipe->mutex);
+    pstPipe->aenState[pstJob - pstPipe->astJob] = enNext;
+    pthread_cond_broadcast(&pstPipe->cond);
+    pthread_mutex_unlock(&pstPipe->mutex);
+}
+
+void TDLPipeline_Close(TDLPipeline_t *pstPipe) {
+    pthread_mutex_lock(&pstPipe->mutex);
+    pstPipe->bClosed = true;
+    pthread_cond_broadcast(&pstPipe->cond);
+    pthread_mutex_unlock(&pstPipe->mutex);
+}
+
+void TDLPipeline_PrintStats(const TDLPipeline_t *pstPipe) {
+    if (pstPipe->u64Frames == 0 || pstPipe->u64EndUs <= pstPipe->u64StartUs) {
+        return;
+    }
+    float fSeconds = (pstPipe->u64EndUs - pstPipe->u64StartUs) / 1000000.0f;
+    std::cout << "Detect pipeline: " << pstPipe->u64Frames / fSeconds << " frames/s, "
+              << pstPipe->u64Detects / fSeconds << " detections/s, detector busy "
+              << pstPipe->u64InferUs / 10000.0f / fSeconds << "%, acquisition stalled "
+              << pstPipe->u64StallUs / 1000 << " ms, latency "
+              << pstPipe->u64LatencyUs / 1000.0f / pstPipe->u64Frames << " ms per frame, crop frames missed "
+              << pstPipe->u64CropMisses << std::endl;
+}
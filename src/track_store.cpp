@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "track_store.h"
+#include "hal.h"
+
+void TrackStore_Init(TrackStore_t *pstStore) {
+    std::memset(pstStore, 0, sizeof(TrackStore_t));
+}
+
+TrackState_t *TrackStore_Find(TrackStore_t *pstStore, uint64_t u64Id) {
+    if (u64Id == 0) {
+        return NULL;
+    }
+    for (int i = 0; i < TRACK_STORE_MAX; i++) {
+        if (pstStore->astEntry[i].u64Id == u64Id) {
+            return &pstStore->astEntry[i];
+        }
+    }
+    return NULL;
+}
+
+TrackState_t *TrackStore_Lookup(TrackStore_t *pstStore, uint64_t u64Id) {
+    TrackState_t *pstEntry = TrackStore_Find(pstStore, u64Id);
+    if (u64Id != 0) {
+        pstStore->u64Lookups++;
+        if (pstEntry && pstEntry->bHasFeature) {
+            pstStore->u64Hits++;
+        }
+    }
+    return pstEntry;
+}
+
+// Free entry, or the one unseen for the longest time when the table is full
+static TrackState_t *TrackStore_Allocate(TrackStore_t *pstStore, uint64_t u64Id, uint64_t u64PTS) {
+    TrackState_t *pstOldest = &pstStore->astEntry[0];
+    for (int i = 0; i < TRACK_STORE_MAX; i++) {
+        TrackState_t *pstEntry = &pstStore->astEntry[i];
+        if (pstEntry->u64Id == 0) {
+            pstOldest = pstEntry;
+            break;
+        }
+        if (pstEntry->u64LastPTS < pstOldest->u64LastPTS) {
+            pstOldest = pstEntry;
+        }
+    }
+    std::memset(pstOldest, 0, sizeof(TrackState_t));
+    pstOldest->u64Id = u64Id;
+    pstOldest->u64FirstPTS = u64PTS;
+    pstStore->u64Tracks++;
+    return pstOldest;
+}
+
+static float TrackStore_Side(const cvtdl_bbox_t *pstBox) {
+    return std::max(pstBox->x2 - pstBox->x1, pstBox->y2 - pstBox->y1);
+}
+
+// Detector confidence, discounted for faces smaller than the crop
+static float TrackStore_Quality(const cvtdl_face_info_t *pstInfo) {
+    float fSide = std::min(pstInfo->bbox.x2 - pstInfo->bbox.x1, pstInfo->bbox.y2 - pstInfo->bbox.y1);
+    float fSize = std::min(std::max(fSide, 0.0f) / (float)TRACK_STORE_CROP_SIZE, 1.0f);
+    return pstInfo->bbox.score * fSize;
+}
+
+uint32_t TrackStore_Update(TrackStore_t *pstStore, const cvtdl_face_t *pstFaceMeta,
+                           const cvtdl_tracker_t *pstTracker, uint64_t u64PTS,
+                           const FaceQualityVerdict_t *penVerdict) {
+    uint32_t u32Pending = 0;
+    uint32_t u32Size = pstFaceMeta->info ? pstFaceMeta->size : 0;
+    for (uint32_t i = 0; i < u32Size; i++) {
+        const cvtdl_face_info_t *pstInfo = &pstFaceMeta->info[i];
+        if (pstInfo->unique_id == 0) {
+            continue;
+        }
+        TrackState_t *pstEntry = TrackStore_Find(pstStore, pstInfo->unique_id);
+        if (!pstEntry) {
+            pstEntry = TrackStore_Allocate(pstStore, pstInfo->unique_id, u64PTS);
+        }
+        pstEntry->stBox = pstInfo->bbox;
+        pstEntry->u64LastPTS = u64PTS;
+        pstEntry->u32Hits++;
+        if (pstTracker && pstTracker->info && i < pstTracker->size) {
+            pstEntry->enState = pstTracker->info[i].state;
+        }
+        pstEntry->enQuality = penVerdict ? penVerdict[i] : FACE_QUALITY_OK;
+
+        // the cached embedding stays valid unless the face got clearly better,
+        // moved closer or further away, or the embedding is getting old
+        float fSide = TrackStore_Side(&pstInfo->bbox);
+        pstEntry->bCropPending = true;
+        if (pstEntry->enQuality != FACE_QUALITY_OK) {
+            // not worth embedding, the cached embedding (if any) stays
+            pstEntry->bCropPending = false;
+        } else if (!pstEntry->bHasCrop) {
+            pstEntry->enCropReason = TRACK_REFRESH_NEW;
+        } else if (TrackStore_Quality(pstInfo) > pstEntry->fBestQuality + TRACK_STORE_QUALITY_MARGIN) {
+            pstEntry->enCropReason = TRACK_REFRESH_QUALITY;
+        } else if (fSide > pstEntry->fCropSide * TRACK_STORE_SCALE_CHANGE ||
+                   fSide * TRACK_STORE_SCALE_CHANGE < pstEntry->fCropSide) {
+            pstEntry->enCropReason = TRACK_REFRESH_SCALE;
+        } else if (u64PTS > pstEntry->u64CropPTS + TRACK_STORE_FEATURE_TTL_US) {
+            pstEntry->enCropReason = TRACK_REFRESH_TTL;
+        } else {
+            pstEntry->bCropPending = false;
+        }
+        if (pstEntry->bCropPending) {
+            u32Pending++;
+        }
+    }
+
+    for (int i = 0; i < TRACK_STORE_MAX; i++) {
+        TrackState_t *pstEntry = &pstStore->astEntry[i];
+        if (pstEntry->u64Id != 0 && pstEntry->u64LastPTS + TRACK_STORE_EXPIRE_US < u64PTS) {
+            pstEntry->u64Id = 0;
+        }
+    }
+    return u32Pending;
+}
+
+// Nearest-neighbour sample of one pixel as BGR, black outside the frame
+static void TrackStore_SamplePixel(const VIDEO_FRAME_S *pstV, int x, int y, uint8_t *pu8Bgr) {
+    if (x < 0 || y < 0 || x >= (int)pstV->u32Width || y >= (int)pstV->u32Height) {
+        pu8Bgr[0] = pu8Bgr[1] = pu8Bgr[2] = 0;
+        return;
+    }
+    if (pstV->enPixelFormat == PIXEL_FORMAT_BGR_888_PLANAR) {
+        size_t offset = (size_t)y * pstV->u32Stride[0] + x;
+        pu8Bgr[0] = pstV->pu8VirAddr[0][offset];
+        pu8Bgr[1] = pstV->pu8VirAddr[1][offset];
+        pu8Bgr[2] = pstV->pu8VirAddr[2][offset];
+        return;
+    }
+
+    // NV21, BT.601 limited range
+    int Y = pstV->pu8VirAddr[0][(size_t)y * pstV->u32Stride[0] + x] - 16;
+    const uint8_t *pu8VU = pstV->pu8VirAddr[1] + (size_t)(y / 2) * pstV->u32Stride[1] + (x & ~1);
+    int V = pu8VU[0] - 128;
+    int U = pu8VU[1] - 128;
+    int c = 298 * std::max(Y, 0);
+    int r = (c + 409 * V + 128) >> 8;
+    int g = (c - 100 * U - 208 * V + 128) >> 8;
+    int b = (c + 516 * U + 128) >> 8;
+    pu8Bgr[0] = (uint8_t)std::min(std::max(b, 0), 255);
+    pu8Bgr[1] = (uint8_t)std::min(std::max(g, 0), 255);
+    pu8Bgr[2] = (uint8_t)std::min(std::max(r, 0), 255);
+}
+
+// Square crop around the box, with the landmarks in crop pixels
+static void TrackStore_Crop(const cvtdl_face_info_t *pstInfo, const VIDEO_FRAME_S *pstV, uint8_t *pu8Crop,
+                            uint32_t *pu32Pts, float *pfPtsX, float *pfPtsY) {
+    const cvtdl_bbox_t *pstBox = &pstInfo->bbox;
+    float fSide = std::max(pstBox->x2 - pstBox->x1, pstBox->y2 - pstBox->y1) * TRACK_STORE_CROP_SCALE;
+    float fX0 = (pstBox->x1 + pstBox->x2 - fSide) / 2.0f;
+    float fY0 = (pstBox->y1 + pstBox->y2 - fSide) / 2.0f;
+    float fStep = fSide / (float)TRACK_STORE_CROP_SIZE;
+
+    uint8_t *pu8Dst = pu8Crop;
+    for (int y = 0; y < TRACK_STORE_CROP_SIZE; y++) {
+        int sy = (int)(fY0 + (y + 0.5f) * fStep);
+        for (int x = 0; x < TRACK_STORE_CROP_SIZE; x++) {
+            TrackStore_SamplePixel(pstV, (int)(fX0 + (x + 0.5f) * fStep), sy, pu8Dst);
+            pu8Dst += 3;
+        }
+    }
+
+    *pu32Pts = 0;
+    if (pstInfo->pts.x && pstInfo->pts.y) {
+        *pu32Pts = std::min<uint32_t>(pstInfo->pts.size, FACE_RESULT_MAX_PTS);
+        for (uint32_t i = 0; i < *pu32Pts; i++) {
+            pfPtsX[i] = (pstInfo->pts.x[i] - fX0) / fStep;
+            pfPtsY[i] = (pstInfo->pts.y[i] - fY0) / fStep;
+        }
+    }
+}
+
+void TrackStore_TakeCrops(TrackStore_t *pstStore, const cvtdl_face_t *pstFaceMeta,
+                          VIDEO_FRAME_INFO_S *pstFrame, FaceQuality_t *pstQuality) {
+    bool bMapped = false;
+    uint32_t u32Size = pstFaceMeta->info ? pstFaceMeta->size : 0;
+    for (uint32_t i = 0; i < u32Size; i++) {
+        const cvtdl_face_info_t *pstInfo = &pstFaceMeta->info[i];
+        TrackState_t *pstEntry = TrackStore_Find(pstStore, pstInfo->unique_id);
+        if (!pstEntry || !pstEntry->bCropPending) {
+            continue;
+        }
+        if (!bMapped) {
+            HAL_FrameSource_Mmap(pstFrame);
+            bMapped = true;
+        }
+        pstEntry->bCropPending = false;
+        // checked in scratch first, so a blurred crop does not replace a good one
+        uint32_t u32Pts;
+        float afPtsX[FACE_RESULT_MAX_PTS], afPtsY[FACE_RESULT_MAX_PTS];
+        TrackStore_Crop(pstInfo, &pstFrame->stVFrame, pstStore->au8Scratch, &u32Pts, afPtsX, afPtsY);
+        if (pstQuality &&
+            FaceQuality_CheckCrop(pstQuality, pstStore->au8Scratch, TRACK_STORE_CROP_SIZE) != FACE_QUALITY_OK) {
+            // retried on the next detection that still wants a crop
+            continue;
+        }
+        std::memcpy(pstEntry->au8Crop, pstStore->au8Scratch, sizeof(pstEntry->au8Crop));
+        pstEntry->u32CropPts = u32Pts;
+        std::memcpy(pstEntry->afCropPtsX, afPtsX, sizeof(afPtsX));
+        std::memcpy(pstEntry->afCropPtsY, afPtsY, sizeof(afPtsY));
+        pstEntry->fBestQuality = TrackStore_Quality(pstInfo);
+        pstEntry->bHasCrop = true;
+        pstEntry->u64CropPTS = pstFrame->stVFrame.u64PTS;
+        pstEntry->fCropSide = TrackStore_Side(&pstInfo->bbox);
+        pstStore->u32Crops++;
+        pstStore->au32Refresh[pstEntry->enCropReason]++;
+    }
+    if (bMapped) {
+        HAL_FrameSource_Munmap(pstFrame);
+    }
+}
+
+void TrackStore_AddFeature(TrackStore_t *pstStore, TrackState_t *pstEntry, const int8_t *ps8Feature,
+                           uint32_t u32Dim, uint64_t u64CropPTS, float fQuality) {
+    u32Dim = std::min<uint32_t>(u32Dim, TRACK_STORE_FEATURE_DIM);
+    std::memcpy(pstEntry->as8Feature, ps8Feature, u32Dim);
+    pstEntry->u32FeatureDim = u32Dim;
+    pstEntry->u64FeaturePTS = u64CropPTS;
+    pstEntry->bHasFeature = true;
+    pstStore->u32Features++;
+
+    // unit-length embeddings, weighted by crop quality
+    float fNorm = 0.0f;
+    for (uint32_t d = 0; d < u32Dim; d++) {
+        fNorm += (float)ps8Feature[d] * ps8Feature[d];
+    }
+    if (fNorm <= 0.0f) {
+        return;
+    }
+    float fWeight = std::max(fQuality, 0.01f) / sqrtf(fNorm);
+    float fMax = 0.0f;
+    for (uint32_t d = 0; d < u32Dim; d++) {
+        pstEntry->afFusedSum[d] += fWeight * ps8Feature[d];
+        fMax = std::max(fMax, std::fabs(pstEntry->afFusedSum[d]));
+    }
+    pstEntry->u32Fused++;
+    // matching is by cosine similarity, so only the direction is kept
+    for (uint32_t d = 0; d < u32Dim; d++) {
+        pstEntry->as8Fused[d] = fMax > 0.0f ? (int8_t)lrintf(pstEntry->afFusedSum[d] * 127.0f / fMax) : 0;
+    }
+}
+
+float TrackStore_HitRate(const TrackStore_t *pstStore) {
+    return pstStore->u64Lookups ? (float)pstStore->u64Hits / pstStore->u64Lookups : 0.0f;
+}
+
+uint64_t TrackStore_Saved(const TrackStore_t *pstStore) {
+    return pstStore->u64Lookups > pstStore->u32Requests ? pstStore->u64Lookups - pstStore->u32Requests : 0;
+}
+
+uint32_t TrackStore_Count(const TrackStore_t *pstStore) {
+    uint32_t u32Count = 0;
+    for (int i = 0; i < TRACK_STORE_MAX; i++) {
+        if (pstStore->astEntry[i].u64Id != 0) {
+            u32Count++;
+        }
+    }
+    return u32Count;
+}
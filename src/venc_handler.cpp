@@ -1,123 +1,579 @@
+#include <algorithm>
 #include <iostream>
 #include <cstring>
+#include <sys/resource.h>
+#include <time.h>
 #include "venc_handler.h"
 #include "shared_data.h"
 #include "draw_utils.h"
+#include "hal.h"
+#include "live_config.h"
+#include "overlay.h"
 
 extern "C" {
 #include "middleware_utils.h"
-#include "sample_utils.h"
+}
+
+// Cost of the encode path, reported every VENC_PATH_REPORT_FRAMES frames and
+// at exit: glass-to-RTSP latency is the time from the frame's capture PTS
+// (CLOCK_MONOTONIC microseconds) until its packets were handed to the sink.
+// The stream bitrate is compared with the last report without the encoder
+// ROI, so toggling it live gives an A/B on the same scene. Updated by the
+// stream pump thread, the encoder thread sets the mode, the configured rate
+// and whether the ROI is on.
+typedef struct {
+    const char *pszMode;
+    uint32_t u32Frames;
+    uint32_t u32Dropped;           // not accepted by the encoder
+    uint32_t u32Stamped;           // frames whose PTS could be compared with the clock
+    uint64_t u64Bytes;
+    uint64_t u64LastUs;            // when the last frame was handed to the sink
+    uint64_t u64SumLatencyUs;
+    uint64_t u64MaxLatencyUs;
+    uint64_t u64StartUs;
+    uint64_t u64StartProcessUs;    // CPU time of the process, all threads
+    uint64_t u64StartEncoderUs;    // CPU time of the encoder thread
+    uint64_t u64StartPumpUs;       // CPU time of the stream pump thread
+    bool bEncoderClock;
+    clockid_t encoderClock;
+    uint32_t u32ConfiguredKbps;
+    bool bRoi;
+    uint32_t u32BaselineKbps;      // of the last report without the ROI at this rate, 0 = none yet
+} VENCPathStats_t;
+
+static VENCPathStats_t s_stPath;
+static pthread_mutex_t s_pathMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t VENCHandler_NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t VENCHandler_CpuUs(int who) {
+    struct rusage ru;
+    if (getrusage(who, &ru) != 0) {
+        return 0;
+    }
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 + ru.ru_utime.tv_usec +
+           ru.ru_stime.tv_usec;
+}
+
+static uint64_t VENCHandler_EncoderCpuUs(const VENCPathStats_t *pstStats) {
+    struct timespec ts;
+    if (!pstStats->bEncoderClock || clock_gettime(pstStats->encoderClock, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Called with s_pathMutex held; bPump when called on the stream pump thread
+static void VENCHandler_ResetPath(VENCPathStats_t *pstStats, bool bPump) {
+    const char *pszMode = pstStats->pszMode;
+    bool bEncoderClock = pstStats->bEncoderClock;
+    clockid_t encoderClock = pstStats->encoderClock;
+    uint64_t u64StartPumpUs = pstStats->u64StartPumpUs;
+    uint32_t u32ConfiguredKbps = pstStats->u32ConfiguredKbps;
+    bool bRoi = pstStats->bRoi;
+    uint32_t u32BaselineKbps = pstStats->u32BaselineKbps;
+    std::memset(pstStats, 0, sizeof(VENCPathStats_t));
+    pstStats->pszMode = pszMode;
+    pstStats->u32ConfiguredKbps = u32ConfiguredKbps;
+    pstStats->bRoi = bRoi;
+    pstStats->u32BaselineKbps = u32BaselineKbps;
+    pstStats->bEncoderClock = bEncoderClock;
+    pstStats->encoderClock = encoderClock;
+    pstStats->u64StartUs = VENCHandler_NowUs();
+    pstStats->u64StartProcessUs = VENCHandler_CpuUs(RUSAGE_SELF);
+    pstStats->u64StartEncoderUs = VENCHandler_EncoderCpuUs(pstStats);
+    pstStats->u64StartPumpUs = bPump ? VENCHandler_CpuUs(RUSAGE_THREAD) : u64StartPumpUs;
+}
+
+// Called with s_pathMutex held; the pump thread figure only on that thread
+static void VENCHandler_ReportPath(VENCPathStats_t *pstStats, bool bPump) {
+    if (pstStats->u32Frames == 0) {
+        return;
+    }
+    uint64_t u64WallUs = VENCHandler_NowUs() - pstStats->u64StartUs;
+    if (u64WallUs == 0) {
+        return;
+    }
+    float process_pct = 100.0f * (VENCHandler_CpuUs(RUSAGE_SELF) - pstStats->u64StartProcessUs) / u64WallUs;
+    float encoder_pct = 100.0f * (VENCHandler_EncoderCpuUs(pstStats) - pstStats->u64StartEncoderUs) / u64WallUs;
+    float avg_ms = pstStats->u32Stamped
+                       ? (float)pstStats->u64SumLatencyUs / pstStats->u32Stamped / 1000.0f
+                       : 0.0f;
+    std::cout << "=== Encode Path ===" << std::endl;
+    std::cout << "Mode: " << pstStats->pszMode << ", frames: " << pstStats->u32Frames << " in "
+              << (float)u64WallUs / 1000.0f << " ms, dropped by the encoder: " << pstStats->u32Dropped << std::endl;
+    std::cout << "CPU: process " << process_pct << "%, encoder thread " << encoder_pct << "%";
+    if (bPump) {
+        std::cout << ", stream pump " << 100.0f * (VENCHandler_CpuUs(RUSAGE_THREAD) - pstStats->u64StartPumpUs) / u64WallUs
+                  << "%";
+    }
+    std::cout << " of one core" << std::endl;
+    std::cout << "Glass-to-RTSP avg: " << avg_ms << " ms, max: " << (float)pstStats->u64MaxLatencyUs / 1000.0f
+              << " ms (" << pstStats->u32Stamped << " frames stamped)" << std::endl;
+    // up to the last frame, an idle tail at exit would dilute it
+    uint64_t u64StreamUs = std::max<uint64_t>(pstStats->u64LastUs - pstStats->u64StartUs, 1);
+    uint32_t u32Kbps = (uint32_t)(pstStats->u64Bytes * 8000 / u64StreamUs);
+    std::cout << "Stream: " << u32Kbps << " kbps (" << pstStats->u32ConfiguredKbps << " configured), encoder ROI "
+              << (pstStats->bRoi ? "on" : "off");
+    if (!pstStats->bRoi) {
+        pstStats->u32BaselineKbps = u32Kbps;
+    } else {
+        uint32_t u32RefKbps = pstStats->u32BaselineKbps ? pstStats->u32BaselineKbps : pstStats->u32ConfiguredKbps;
+        std::cout << ", saved " << 100.0f - 100.0f * u32Kbps / u32RefKbps << "% vs " << u32RefKbps << " kbps "
+                  << (pstStats->u32BaselineKbps ? "without it" : "configured");
+    }
+    std::cout << std::endl;
+    std::cout << "===================" << std::endl;
+}
+
+// Start measuring a path on the encoder thread
+static void VENCHandler_StartPath(const char *pszMode) {
+    pthread_mutex_lock(&s_pathMutex);
+    s_stPath.pszMode = pszMode;
+    s_stPath.bEncoderClock = pthread_getcpuclockid(pthread_self(), &s_stPath.encoderClock) == 0;
+    VENCHandler_ResetPath(&s_stPath, false);
+    pthread_mutex_unlock(&s_pathMutex);
+}
+
+// The encoder thread changed the rate or the encoder ROI: report the frames
+// encoded before and start a new window
+static void VENCHandler_SetPathStream(uint32_t u32BitrateKbps, bool bRoi) {
+    pthread_mutex_lock(&s_pathMutex);
+    if (u32BitrateKbps != s_stPath.u32ConfiguredKbps || bRoi != s_stPath.bRoi) {
+        VENCHandler_ReportPath(&s_stPath, false);
+        if (u32BitrateKbps != s_stPath.u32ConfiguredKbps) {
+            s_stPath.u32BaselineKbps = 0;
+        }
+        s_stPath.u32ConfiguredKbps = u32BitrateKbps;
+        s_stPath.bRoi = bRoi;
+        VENCHandler_ResetPath(&s_stPath, false);
+    }
+    pthread_mutex_unlock(&s_pathMutex);
+}
+
+// Report the frames since the last report, on the encoder thread at exit
+static void VENCHandler_EndPath() {
+    pthread_mutex_lock(&s_pathMutex);
+    VENCHandler_ReportPath(&s_stPath, false);
+    s_stPath.u32Frames = 0;
+    s_stPath.bEncoderClock = false;
+    pthread_mutex_unlock(&s_pathMutex);
+}
+
+CVI_S32 VENCHandler_MetricsSink(void *pCtx, VENC_STREAM_S *pstStream) {
+    (void)pCtx;
+    pthread_mutex_lock(&s_pathMutex);
+    VENCPathStats_t *pstStats = &s_stPath;
+    if (pstStats->u64StartPumpUs == 0) {
+        pstStats->u64StartPumpUs = VENCHandler_CpuUs(RUSAGE_THREAD);
+    }
+    pstStats->u32Frames++;
+    for (CVI_U32 i = 0; i < pstStream->u32PackCount; i++) {
+        pstStats->u64Bytes += pstStream->pstPack[i].u32Len - pstStream->pstPack[i].u32Offset;
+    }
+    pstStats->u64LastUs = VENCHandler_NowUs();
+    if (pstStream->u32PackCount > 0) {
+        uint64_t u64PTS = pstStream->pstPack[pstStream->u32PackCount - 1].u64PTS;
+        uint64_t u64NowUs = VENCHandler_NowUs();
+        // a PTS from another clock (or none) would make the figures meaningless
+        if (u64PTS > 0 && u64PTS <= u64NowUs && u64NowUs - u64PTS < 10000000) {
+            uint64_t u64LatencyUs = u64NowUs - u64PTS;
+            pstStats->u32Stamped++;
+            pstStats->u64SumLatencyUs += u64LatencyUs;
+            pstStats->u64MaxLatencyUs = std::max(pstStats->u64MaxLatencyUs, u64LatencyUs);
+        }
+    }
+    if (pstStats->u32Frames >= VENC_PATH_REPORT_FRAMES) {
+        VENCHandler_ReportPath(pstStats, true);
+        VENCHandler_ResetPath(pstStats, true);
+    }
+    pthread_mutex_unlock(&s_pathMutex);
+    return CVI_SUCCESS;
+}
+
+CVI_S32 VENCHandler_RtspSink(void *pCtx, VENC_STREAM_S *pstStream) {
+    return HAL_StreamSink_Write(static_cast<SAMPLE_TDL_MW_CONTEXT *>(pCtx), pstStream);
 }
 
 CVI_S32 VENCHandler_SendFrameRTSP(VIDEO_FRAME_INFO_S *pstFrame, 
                                   SAMPLE_TDL_MW_CONTEXT *pstMWContext) {
-    return SAMPLE_TDL_Send_Frame_RTSP(pstFrame, pstMWContext);
+    CVI_S32 s32Ret = HAL_Encoder_SendFrame(pstMWContext, pstFrame, VENC_SEND_TIMEOUT_MS);
+    if (s32Ret == CVI_ERR_VENC_BUF_FULL || s32Ret == CVI_ERR_VENC_BUSY) {
+        // the stream pump is behind, skip the frame rather than wait for it
+        pthread_mutex_lock(&s_pathMutex);
+        if (s_stPath.u32Dropped++ == 0) {
+            std::cerr << "Encoder full, dropping frames" << std::endl;
+        }
+        pthread_mutex_unlock(&s_pathMutex);
+        return CVI_SUCCESS;
+    }
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Encoder send frame failed, ret=0x" << std::hex << s32Ret << std::endl;
+    }
+    return s32Ret;
 }
 
-void *VENCHandler_ThreadRoutine(void *pArgs) {
-    std::cout << "Enter encoder thread" << std::endl;
+// Overlay-to-frame skew, reported every VENC_SKEW_REPORT_FRAMES frames
+typedef struct {
+    uint32_t u32Frames;
+    uint32_t u32Matched;
+    uint32_t u32Exact;
+    uint64_t u64SumSkewUs;
+    uint64_t u64MaxSkewUs;
+} VENCSkewStats_t;
+
+static void VENCHandler_UpdateSkew(VENCSkewStats_t *pstStats, const FaceResultSlot_t *pstResult,
+                                   const VIDEO_FRAME_INFO_S *pstFrame) {
+    pstStats->u32Frames++;
+    if (pstResult && pstResult->u64PublishSeq) {
+        uint64_t u64FramePTS = pstFrame->stVFrame.u64PTS;
+        uint64_t u64SkewUs = u64FramePTS > pstResult->u64FramePTS
+                                 ? u64FramePTS - pstResult->u64FramePTS
+                                 : pstResult->u64FramePTS - u64FramePTS;
+        pstStats->u32Matched++;
+        pstStats->u32Exact += (u64SkewUs == 0);
+        pstStats->u64SumSkewUs += u64SkewUs;
+        if (u64SkewUs > pstStats->u64MaxSkewUs) {
+            pstStats->u64MaxSkewUs = u64SkewUs;
+        }
+    }
+
+    if (pstStats->u32Frames >= VENC_SKEW_REPORT_FRAMES) {
+        float avg_ms = pstStats->u32Matched
+                           ? (float)pstStats->u64SumSkewUs / pstStats->u32Matched / 1000.0f
+                           : 0.0f;
+        std::cout << "=== Overlay Skew ===" << std::endl;
+        std::cout << "Frames: " << pstStats->u32Frames << ", with result: " << pstStats->u32Matched
+                  << ", exact: " << pstStats->u32Exact << std::endl;
+        std::cout << "Skew avg: " << avg_ms << " ms, max: "
+                  << (float)pstStats->u64MaxSkewUs / 1000.0f << " ms" << std::endl;
+        std::cout << "====================" << std::endl;
+        std::memset(pstStats, 0, sizeof(VENCSkewStats_t));
+    }
+}
+
+// Face rectangles of pstResult (none without one) and the FPS line for
+// pstFrame, in a batch shared by every call
+static OverlayBatch_t *VENCHandler_BuildOverlay(VENCHandler_t *pstHandler, const FaceResultSlot_t *pstResult,
+                                                const VIDEO_FRAME_INFO_S *pstFrame) {
+    static OverlayBatch_t s_stBatch;
+    cvtdl_face_t stNoFace = {};
+    Overlay_Begin(&s_stBatch);
+    TDLHandler_AddFaceRects(pstHandler->pstTDLHandler, pstResult ? &pstResult->stMeta : &stNoFace, pstFrame,
+                            &s_stBatch);
+    char fps_text[OVERLAY_TEXT_MAX];
+    snprintf(fps_text, sizeof(fps_text), "FPS: %.1f", (float)g_fCurrentFPS);
+    // 繪製文字到畫面左上角
+    Overlay_AddText(&s_stBatch, 10, 16, fps_text, Overlay_Color(BRUSH_GREEN), 2);
+    return &s_stBatch;
+}
+
+static CVI_S32 VENCHandler_DrawAndSend(VENCHandler_t *pstHandler, VIDEO_FRAME_INFO_S *pstFrame,
+                                       const FaceResultSlot_t *pstResult) {
+    // face rectangles, the crosshair and the FPS line, drawn together in one pass
+    OverlayBatch_t *pstBatch = VENCHandler_BuildOverlay(pstHandler, pstResult, pstFrame);
+    Overlay_AddCrosshair(pstBatch, pstFrame->stVFrame.u32Width / 2, pstFrame->stVFrame.u32Height / 2, 20,
+                         Overlay_Color(BRUSH_GREEN), BRUSH_GREEN.size);
+    CVI_S32 s32Ret = Overlay_Render(pstBatch, pstFrame);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Draw frame failed, ret=0x" << std::hex << s32Ret << std::endl;
+        return s32Ret;
+    }
     
-    VENCHandler_t *pstHandler = static_cast<VENCHandler_t *>(pArgs);
+    // 發送畫面到 RTSP
+    s32Ret = VENCHandler_SendFrameRTSP(pstFrame, pstHandler->pstMWContext);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Send output frame failed, ret=0x" << std::hex << s32Ret << std::endl;
+    }
+    return s32Ret;
+}
+
+// Overlay and rate control as currently configured
+typedef struct {
+    uint32_t u32Generation;        // of the live configuration applied, 0 = none yet
+    bool bOverlay;
+    VENCOverlayMode_t enOverlayMode;
+    uint32_t u32MaxDelayFrames;    // as configured
+    bool bAligned;
+    uint32_t u32MaxDelay;          // in effect
+    uint32_t u32BitrateKbps;
+    uint32_t u32Gop;               // last set, 0 = as the channel was set up
+    EncoderRoi_t stRoi;
+} VENCState_t;
+
+static void VENCHandler_SetOverlay(VENCState_t *pstState, bool bOverlay, VENCOverlayMode_t enMode,
+                                   uint32_t u32MaxDelayFrames) {
+    pstState->bOverlay = bOverlay;
+    pstState->enOverlayMode = enMode;
+    pstState->u32MaxDelayFrames = u32MaxDelayFrames;
+    pstState->bAligned = enMode == VENC_OVERLAY_ALIGNED;
+    // frames without an overlay need not wait for their result
+    pstState->u32MaxDelay = bOverlay && pstState->bAligned
+                                ? std::min<uint32_t>(u32MaxDelayFrames, VENC_MAX_DELAY_FRAMES)
+                                : 0;
+    if (!bOverlay) {
+        std::cout << "Overlay off" << std::endl;
+        return;
+    }
+    std::cout << "Overlay mode: " << (pstState->bAligned ? "aligned" : "latest")
+              << ", max delay: " << pstState->u32MaxDelay << " frames" << std::endl;
+}
+
+// Pick up a new live configuration between two frames
+static void VENCHandler_ApplyLive(VENCHandler_t *pstHandler, VENCState_t *pstState) {
+    const LiveConfig_t *pstLive = LiveConfig_Read(pstHandler->pstLive, LIVE_READER_VENC);
+    if (pstLive->u32Generation == pstState->u32Generation) {
+        return;
+    }
+    pstState->u32Generation = pstLive->u32Generation;
+    if (pstLive->bOverlay != pstState->bOverlay || pstLive->enOverlayMode != pstState->enOverlayMode ||
+        pstLive->u32MaxDelayFrames != pstState->u32MaxDelayFrames) {
+        VENCHandler_SetOverlay(pstState, pstLive->bOverlay, pstLive->enOverlayMode, pstLive->u32MaxDelayFrames);
+    }
+    if (!EncoderRoi_ConfigEqual(&pstLive->stEncoderRoi, &pstState->stRoi.stConfig)) {
+        EncoderRoi_SetConfig(&pstState->stRoi, &pstLive->stEncoderRoi);
+        VENCHandler_SetPathStream(pstState->u32BitrateKbps, pstLive->stEncoderRoi.bEnabled);
+    }
+    if (pstLive->u32VencBitrateKbps == pstState->u32BitrateKbps && pstLive->u32VencGop == pstState->u32Gop) {
+        return;
+    }
+    CVI_S32 s32Ret = HAL_Encoder_SetRate(pstHandler->pstMWContext, pstLive->u32VencBitrateKbps,
+                                         pstLive->u32VencGop);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Cannot change the encoder rate, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+        return;
+    }
+    pstState->u32BitrateKbps = pstLive->u32VencBitrateKbps;
+    pstState->u32Gop = pstLive->u32VencGop;
+    std::cout << "Encoder rate: " << pstState->u32BitrateKbps << " kbps";
+    if (pstState->u32Gop) {
+        std::cout << ", GOP " << pstState->u32Gop;
+    }
+    std::cout << std::endl;
+    VENCHandler_SetPathStream(pstState->u32BitrateKbps, pstState->stRoi.stConfig.bEnabled);
+}
+
+// Face result for pstFrame as the overlay mode picks it
+static FaceResultSlot_t *VENCHandler_FindResult(const VENCState_t *pstState, const VIDEO_FRAME_INFO_S *pstFrame,
+                                                FaceResultSlot_t *pstAligned) {
+    if (pstState->bAligned) {
+        // result detected on the same (or nearest) frame
+        return FaceResultHistory_FindNearest(&g_stFaceHistory, pstFrame->stVFrame.u64PTS, pstAligned) ? pstAligned
+                                                                                                       : NULL;
+    }
+    // latest face result, owned by this thread until the next acquire
+    return FaceResult_Acquire(&g_stFaceResults);
+}
+
+// Frames of the encoder-only channel already carry the regions, the CPU only
+// redraws the canvas when the faces or the text change
+static void VENCHandler_RunOsd(VENCHandler_t *pstHandler, VENCState_t *pstState) {
+    std::cout << "Overlay backend: VPSS regions on Chn" << pstHandler->encodeChn
+              << ", showing the latest result" << std::endl;
+    if (pstState->bAligned) {
+        std::cout << "Aligned overlay mode needs CPU overlays, the regions are composed before results exist"
+                  << std::endl;
+    }
     VIDEO_FRAME_INFO_S stFrame;
-    cvtdl_face_t stFaceMeta = {0};
-    CVI_S32 s32Ret;
-    
     while (!g_bExit) {
-        s32Ret = CVI_VPSS_GetChnFrame(0, 0, &stFrame, 2000);
+        if (pstHandler->pstLive) {
+            VENCHandler_ApplyLive(pstHandler, pstState);
+        }
+        if (Osd_Show(pstHandler->pstOsd, pstState->bOverlay) != CVI_SUCCESS) {
+            std::cerr << "Cannot show or hide the overlay regions" << std::endl;
+        }
+        CVI_S32 s32Ret = HAL_FrameSource_GetFrame(0, pstHandler->encodeChn, &stFrame, 2000);
         if (s32Ret != CVI_SUCCESS) {
-            std::cerr << "CVI_VPSS_GetChnFrame chn0 failed with 0x" 
-                      << std::hex << s32Ret << std::endl;
+            if (!g_bExit) {
+                std::cerr << "Get encoder frame failed, ret=0x" << std::hex << s32Ret << std::dec << std::endl;
+            }
             break;
         }
-        
-        // copy face meta data from shared data
-        {
-            LOCK_RESULT_MUTEX();
-            std::memset(&stFaceMeta, 0, sizeof(cvtdl_face_t));
-            if (g_stFaceMeta.info != nullptr) {
-                CVI_TDL_CopyFaceMeta(&g_stFaceMeta, &stFaceMeta);
+
+        // latest face result, owned by this thread until the next acquire
+        FaceResultSlot_t *pstResult = NULL;
+        if (pstState->bOverlay || pstState->stRoi.stConfig.bEnabled) {
+            pstResult = FaceResult_Acquire(&g_stFaceResults);
+        }
+        EncoderRoi_Update(&pstState->stRoi, pstResult ? &pstResult->stMeta : NULL);
+        if (pstState->bOverlay) {
+            if (Osd_Update(pstHandler->pstOsd, VENCHandler_BuildOverlay(pstHandler, pstResult, &stFrame)) !=
+                CVI_SUCCESS) {
+                std::cerr << "Overlay canvas update failed" << std::endl;
             }
-            UNLOCK_RESULT_MUTEX();
         }
-        
-        // draw face rectangles on the frame
-        s32Ret = TDLHandler_DrawFaceRect(pstHandler->pstTDLHandler, &stFaceMeta, &stFrame);
-        if (s32Ret != CVI_TDL_SUCCESS) {
-            std::cerr << "Draw frame failed, ret=0x" << std::hex << s32Ret << std::endl;
-            CVI_TDL_Free(&stFaceMeta);
-            CVI_VPSS_ReleaseChnFrame(0, 0, &stFrame);
-            if (s32Ret != CVI_SUCCESS) {
+
+        s32Ret = VENCHandler_SendFrameRTSP(&stFrame, pstHandler->pstMWContext);
+        HAL_FrameSource_ReleaseFrame(0, pstHandler->encodeChn, &stFrame);
+        if (s32Ret != CVI_SUCCESS) {
+            g_bExit = true;
+            break;
+        }
+    }
+}
+
+// VENC takes the frames of the encoder-only channel straight from VPSS and
+// the stream pump sends the packets; this thread only redraws the canvas once
+// per encoded frame
+static void VENCHandler_RunBound(VENCHandler_t *pstHandler, VENCState_t *pstState) {
+    CVI_S32 s32Ret = HAL_Encoder_Bind(pstHandler->pstMWContext, 0, pstHandler->encodeChn);
+    if (s32Ret != CVI_SUCCESS) {
+        std::cerr << "Cannot bind VPSS Chn" << pstHandler->encodeChn << " to the encoder, ret=0x" << std::hex
+                  << s32Ret << std::dec << ", sending the frames from this thread" << std::endl;
+        VENCHandler_StartPath("copy/osd");
+        VENCHandler_RunOsd(pstHandler, pstState);
+        return;
+    }
+    std::cout << "Encode path: VPSS Chn" << pstHandler->encodeChn << " bound to the encoder, overlay regions"
+              << std::endl;
+    // the frames never reach this thread, the boxes only need their size
+    VIDEO_FRAME_INFO_S stFrame;
+    std::memset(&stFrame, 0, sizeof(stFrame));
+    stFrame.stVFrame.u32Width = pstHandler->pstOsd->stSize.u32Width;
+    stFrame.stVFrame.u32Height = pstHandler->pstOsd->stSize.u32Height;
+    uint64_t u64Seen = 0;
+    while (!g_bExit) {
+        if (pstHandler->pstLive) {
+            VENCHandler_ApplyLive(pstHandler, pstState);
+        }
+        if (Osd_Show(pstHandler->pstOsd, pstState->bOverlay) != CVI_SUCCESS) {
+            std::cerr << "Cannot show or hide the overlay regions" << std::endl;
+        }
+        s32Ret = StreamPump_WaitFrame(pstHandler->pstPump, &u64Seen, 2000);
+        if (s32Ret != CVI_SUCCESS) {
+            if (!g_bExit) {
+                std::cerr << "No encoded frame from the stream pump, ret=0x" << std::hex << s32Ret << std::dec
+                          << std::endl;
                 g_bExit = true;
             }
-            continue;
+            break;
         }
-        
-        {
-            int center_x = stFrame.stVFrame.u32Width / 2;
-            int center_y = stFrame.stVFrame.u32Height / 2;
-            int cross_size = 20;
-            
-            cvtdl_pts_t crosshair;
-            crosshair.size = 4;
-            crosshair.x = (float*)malloc(sizeof(float) * 4);
-            crosshair.y = (float*)malloc(sizeof(float) * 4);
-            
-            if (crosshair.x && crosshair.y) {
-                crosshair.x[0] = center_x - cross_size;
-                crosshair.y[0] = center_y;
-                crosshair.x[1] = center_x + cross_size;
-                crosshair.y[1] = center_y;
-                crosshair.x[2] = center_x;
-                crosshair.y[2] = center_y - cross_size;
-                crosshair.x[3] = center_x;
-                crosshair.y[3] = center_y + cross_size;
-                
-                cvtdl_pts_t h_line;
-                h_line.size = 2;
-                h_line.x = &crosshair.x[0];
-                h_line.y = &crosshair.y[0];
-                CVI_TDL_Service_DrawPolygon(pstHandler->pstTDLHandler->serviceHandle, &stFrame, &h_line, BRUSH_GREEN);
-                
-                cvtdl_pts_t v_line;
-                v_line.size = 2;
-                v_line.x = &crosshair.x[2];
-                v_line.y = &crosshair.y[2];
-                CVI_TDL_Service_DrawPolygon(pstHandler->pstTDLHandler->serviceHandle, &stFrame, &v_line, BRUSH_GREEN);
-                
-                free(crosshair.x);
-                free(crosshair.y);
+
+        // takes effect from one of the next frames, as the regions are composed by VPSS
+        // and the encoder ROI set while VENC works on its queue
+        FaceResultSlot_t *pstResult = NULL;
+        if (pstState->bOverlay || pstState->stRoi.stConfig.bEnabled) {
+            pstResult = FaceResult_Acquire(&g_stFaceResults);
+        }
+        EncoderRoi_Update(&pstState->stRoi, pstResult ? &pstResult->stMeta : NULL);
+        if (pstState->bOverlay) {
+            if (Osd_Update(pstHandler->pstOsd, VENCHandler_BuildOverlay(pstHandler, pstResult, &stFrame)) !=
+                CVI_SUCCESS) {
+                std::cerr << "Overlay canvas update failed" << std::endl;
             }
         }
+    }
+    HAL_Encoder_Unbind(pstHandler->pstMWContext, 0, pstHandler->encodeChn);
+}
 
-        {
-            float fps_value = 0.0f;
-            {
-                LOCK_FPS_MUTEX();
-                fps_value = g_fCurrentFPS;
-                UNLOCK_FPS_MUTEX();
-            }
-            
-            char fps_text[10];
-            snprintf(fps_text, sizeof(fps_text), "FPS: %.1f", fps_value);
-            
-            // 繪製文字到畫面左上角
-            CVI_TDL_Service_ObjectWriteText(fps_text, 10, 30, &stFrame, 0.0f, 255.0f, 0.0f);
+void *VENCHandler_ThreadRoutine(void *pArgs) {
+    std::cout << "Enter encoder thread" << std::endl;
+    
+    VENCHandler_t *pstHandler = static_cast<VENCHandler_t *>(pArgs);
+    VENCState_t stState;
+    std::memset(&stState, 0, sizeof(stState));
+    stState.u32BitrateKbps = pstHandler->u32BitrateKbps;
+    VENCHandler_SetOverlay(&stState, true, pstHandler->enOverlayMode, pstHandler->u32MaxDelayFrames);
+    EncoderRoi_Init(&stState.stRoi, pstHandler->pstMWContext, &pstHandler->stVencSize, SYSTEM_VENC_FPS,
+                    &pstHandler->stEncoderRoi);
+    VENCHandler_StartPath(pstHandler->bBind ? "bind" : pstHandler->pstOsd ? "copy/osd" : "copy/cpu");
+    VENCHandler_SetPathStream(stState.u32BitrateKbps, stState.stRoi.stConfig.bEnabled);
+    if (pstHandler->pstOsd) {
+        if (pstHandler->bBind) {
+            VENCHandler_RunBound(pstHandler, &stState);
+        } else {
+            VENCHandler_RunOsd(pstHandler, &stState);
         }
-        
-        // 發送畫面到 RTSP
-        s32Ret = VENCHandler_SendFrameRTSP(&stFrame, pstHandler->pstMWContext);
+        EncoderRoi_Cleanup(&stState.stRoi);
+        VENCHandler_EndPath();
+        if (pstHandler->pstLive) {
+            LiveConfig_Offline(pstHandler->pstLive, LIVE_READER_VENC);
+        }
+        std::cout << "Exit encoder thread" << std::endl;
+        pthread_exit(nullptr);
+    }
+    
+    // frames waiting for their detection result, oldest first
+    FrameBroker_t *pstBroker = pstHandler->pstFrameBroker;
+    FrameBrokerSlot_t *apstHeld[VENC_MAX_DELAY_FRAMES + 1];
+    uint32_t u32Held = 0;
+    uint64_t u64Cursor = 0;
+    uint32_t u32Unlocked = 0;
+    static FaceResultSlot_t s_stAligned;
+    VENCSkewStats_t stSkew;
+    std::memset(&stSkew, 0, sizeof(stSkew));
+    CVI_S32 s32Ret = CVI_SUCCESS;
+    
+    while (!g_bExit) {
+        if (pstHandler->pstLive) {
+            VENCHandler_ApplyLive(pstHandler, &stState);
+        }
+        s32Ret = FrameBroker_Acquire(pstBroker, &u64Cursor, false, &apstHeld[u32Held], 2000);
         if (s32Ret != CVI_SUCCESS) {
-            std::cerr << "Send output frame failed, ret=0x" << std::hex << s32Ret << std::endl;
+            if (!g_bExit) {
+                std::cerr << "Frame broker acquire failed with 0x" 
+                          << std::hex << s32Ret << std::endl;
+            }
+            break;
         }
+        u32Held++;
         
-        CVI_TDL_Free(&stFaceMeta);
-        CVI_VPSS_ReleaseChnFrame(0, 0, &stFrame);
-        
-        if (s32Ret != CVI_SUCCESS) {
-            g_bExit = true;
+        while (u32Held > 0) {
+            VIDEO_FRAME_INFO_S *pstFrame = &apstHeld[0]->stFrame;
+            
+            // hold the frame until the detector has passed it, up to u32MaxDelay frames
+            if (stState.bAligned && u32Held <= stState.u32MaxDelay &&
+                FaceResultHistory_LatestPTS(&g_stFaceHistory) < pstFrame->stVFrame.u64PTS) {
+                break;
+            }
+            
+            FaceResultSlot_t *pstResult = NULL;
+            if (stState.bOverlay || stState.stRoi.stConfig.bEnabled) {
+                pstResult = VENCHandler_FindResult(&stState, pstFrame, &s_stAligned);
+            }
+            EncoderRoi_Update(&stState.stRoi, pstResult ? &pstResult->stMeta : NULL);
+            
+            if (!stState.bOverlay) {
+                s32Ret = VENCHandler_SendFrameRTSP(pstFrame, pstHandler->pstMWContext);
+            } else if (FrameBroker_LockForWrite(pstBroker, apstHeld[0], VENC_WRITE_LOCK_MS) != CVI_SUCCESS) {
+                // the detector may still be reading this frame, never draw under it
+                if (u32Unlocked++ == 0) {
+                    std::cerr << "Frame still in use by the detector, sending it without overlay"
+                              << std::endl;
+                }
+                s32Ret = VENCHandler_SendFrameRTSP(pstFrame, pstHandler->pstMWContext);
+            } else {
+                VENCHandler_UpdateSkew(&stSkew, pstResult, pstFrame);
+                
+                s32Ret = VENCHandler_DrawAndSend(pstHandler, pstFrame, pstResult);
+            }
+            FrameBroker_Release(pstBroker, apstHeld[0]);
+            u32Held--;
+            std::memmove(&apstHeld[0], &apstHeld[1], sizeof(FrameBrokerSlot_t *) * u32Held);
+            
+            if (s32Ret != CVI_SUCCESS) {
+                g_bExit = true;
+                break;
+            }
         }
     }
     
+    for (uint32_t i = 0; i < u32Held; i++) {
+        FrameBroker_Release(pstBroker, apstHeld[i]);
+    }
+    if (u32Unlocked > 0) {
+        std::cout << "Frames sent without overlay while the detector read them: " << u32Unlocked << std::endl;
+    }
+    EncoderRoi_Cleanup(&stState.stRoi);
+    VENCHandler_EndPath();
+    if (pstHandler->pstLive) {
+        LiveConfig_Offline(pstHandler->pstLive, LIVE_READER_VENC);
+    }
+    
     std::cout << "Exit encoder thread" << std::endl;
     pthread_exit(nullptr);
 }